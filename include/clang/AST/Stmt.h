@@ -433,6 +433,15 @@ public:
   /// written in the source.
   void Profile(llvm::FoldingSetNodeID &ID, const ASTContext &Context,
                bool Canonical) const;
+
+  /// \brief Produce a canonical profile of this statement that does not
+  /// depend on the addresses of AST nodes.
+  ///
+  /// Declarations, types and names are identified by their spelling, so the
+  /// profile of the same code is the same in different compilations, and can
+  /// be used to tell whether the code changed between them.
+  void ProfileStable(llvm::FoldingSetNodeID &ID,
+                     const ASTContext &Context) const;
 };
 
 /// DeclStmt - Adaptor class for mixing declarations with statements and
@@ -22,6 +22,7 @@
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/FileSystem.h"
@@ -110,6 +111,7 @@ public:
 };
 
 struct FileData;
+class SharedFileSystemCache;
 
 /// \brief Implements support for file system lookup, file system caching,
 /// and directory search management.
@@ -160,6 +162,21 @@ class FileManager : public RefCountedBase<FileManager> {
   /// \brief Storage for canonical names that we have computed.
   llvm::BumpPtrAllocator CanonicalNameStorage;
 
+  /// \brief The names of the entries of a real directory, once it has been
+  /// asked about often enough to be worth reading.
+  struct DirectoryListing {
+    unsigned NumLookups;
+    /// \brief Whether \c Entries holds the contents of the directory.
+    bool Listed;
+    /// \brief Whether the directory ignores case, so that \c Entries holds
+    /// lowercase names.
+    bool FoldCase;
+    llvm::StringSet<> Entries;
+  };
+
+  /// \brief Listings of the directories passed to \c mayContainFile().
+  llvm::DenseMap<const DirectoryEntry *, DirectoryListing *> DirListings;
+
   /// \brief Each FileEntry we create is assigned a unique ID #.
   ///
   unsigned NextFileUID;
@@ -167,12 +184,17 @@ class FileManager : public RefCountedBase<FileManager> {
   // Statistics.
   unsigned NumDirLookups, NumFileLookups;
   unsigned NumDirCacheMisses, NumFileCacheMisses;
+  unsigned NumDirListings, NumFilesPrunedByListings;
 
   // Caching.
   OwningPtr<FileSystemStatCache> StatCache;
+  IntrusiveRefCntPtr<SharedFileSystemCache> SharedCache;
+
+  /// \brief Forget all directory listings made by \c mayContainFile().
+  void invalidateDirectoryListings();
 
   bool getStatValue(const char *Path, FileData &Data, bool isFile,
-                    int *FileDescriptor);
+                    int *FileDescriptor, bool CacheFailure = true);
 
   /// Add all ancestors of the given path (pointing to either a file
   /// or a directory) as virtual directories.
@@ -198,9 +220,24 @@ public:
   /// \brief Removes the specified FileSystemStatCache object from the manager.
   void removeStatCache(FileSystemStatCache *statCache);
 
-  /// \brief Removes all FileSystemStatCache objects from the manager.
+  /// \brief Removes all FileSystemStatCache objects from the manager, and
+  /// forgets the directory listings made by \c mayContainFile().
+  ///
+  /// Long-lived clients call this whenever files may have been added since.
   void clearStatCaches();
 
+  /// \brief Installs a cache of 'stat' results and file contents that is
+  /// shared with other FileManagers.
+  ///
+  /// The shared cache is consulted instead of the file system whenever no
+  /// FileSystemStatCache objects are installed, and is not affected by
+  /// \c clearStatCaches().
+  void setSharedCache(SharedFileSystemCache *Cache);
+
+  /// \brief Returns the shared cache installed with \c setSharedCache(), if
+  /// any.
+  SharedFileSystemCache *getSharedCache() const { return SharedCache.getPtr(); }
+
   /// \brief Lookup, cache, and verify the specified directory (real or
   /// virtual).
   ///
@@ -223,6 +260,19 @@ public:
   const FileEntry *getFile(StringRef Filename, bool OpenFile = false,
                            bool CacheFailure = true);
 
+  /// \brief Determine whether the real directory \p Dir may contain the file
+  /// at the relative path \p Filename, without touching the file system if
+  /// possible.
+  ///
+  /// Clients that look for the same relative path in many directories, such
+  /// as header search, call this before \c getFile() to avoid a 'stat' call
+  /// for every directory that does not have the file. A directory that is
+  /// asked about repeatedly is read once and its entries are remembered, so
+  /// that the first component of \p Filename can be checked against them.
+  ///
+  /// \returns false only if the file is known not to exist.
+  bool mayContainFile(const DirectoryEntry *Dir, StringRef Filename);
+
   /// \brief Returns the current file system options
   const FileSystemOptions &getFileSystemOptions() { return FileSystemOpts; }
 
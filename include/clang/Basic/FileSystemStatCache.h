@@ -16,11 +16,21 @@
 #define LLVM_CLANG_FILESYSTEMSTATCACHE_H
 
 #include "clang/Basic/LLVM.h"
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Mutex.h"
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class MemoryBuffer;
+}
 
 namespace clang {
 
@@ -110,6 +120,142 @@ public:
                                int *FileDescriptor);
 };
 
+/// \brief A process-wide cache of 'stat' results and file contents that can
+/// be shared by many FileManagers, possibly on different threads.
+///
+/// Tools that process many translation units (see \c ClangTool) look up and
+/// read the same headers over and over again. Installing a single
+/// SharedFileSystemCache on all of their FileManagers turns those repeated
+/// system calls into hash table lookups.
+///
+/// Only absolute paths are cached, since the meaning of a relative path
+/// depends on the current directory. Failed lookups are cached as well, so
+/// the cache assumes that the file system does not change while it is in
+/// use; clients call \c invalidateStats() before each batch of compilations
+/// (a \c ClangTool run, or a job of the cc1 server) to see changes made
+/// since the previous one.
+///
+/// File contents are keyed by path, unique ID, size and modification time,
+/// so they are reused only if a stat shows the same file. A file's contents
+/// are only retained once a second client asks for them, so files that are
+/// read just once (such as main source files) do not stay in memory. Since
+/// modification times only have a resolution of one second, the contents of
+/// files modified in the second they were read are never retained: the file
+/// could be rewritten again without its size or modification time
+/// changing.
+///
+/// The cache also remembers which macro guards each header against multiple
+/// inclusion, so that a preprocessor can skip the first \#include of a header
+/// in a translation unit when the guard macro is already defined, without
+/// lexing the header at all. Guards are keyed by the file's unique ID, size
+/// and a hash of its contents, so they stay correct however quickly a header
+/// is rewritten.
+class SharedFileSystemCache
+    : public llvm::ThreadSafeRefCountedBase<SharedFileSystemCache> {
+  struct StatEntry {
+    bool Exists;
+    FileData Data;
+  };
+
+  struct BufferEntry {
+    llvm::sys::fs::UniqueID UniqueID;
+    uint64_t Size;
+    time_t ModTime;
+    unsigned NumRequests;
+    /// \brief The retained file contents, or null if only requested once.
+    llvm::MemoryBuffer *Buffer;
+  };
+
+  struct IncludeGuardEntry {
+    uint64_t Size;
+    llvm::MD5::MD5Result Hash;
+    std::string Macro;
+  };
+
+  mutable llvm::sys::Mutex Lock;
+  llvm::StringMap<StatEntry> StatEntries;
+  llvm::StringMap<BufferEntry> BufferEntries;
+  std::map<llvm::sys::fs::UniqueID, IncludeGuardEntry> IncludeGuards;
+
+  /// \brief Retained contents of files that have since changed on disk.
+  std::vector<llvm::MemoryBuffer *> StaleBuffers;
+
+  // Statistics.
+  unsigned NumStatHits, NumStatMisses;
+  unsigned NumBufferHits, NumBufferMisses;
+  uint64_t NumBytesRetained;
+  unsigned NumIncludeGuardHits, NumIncludeGuardMisses;
+
+public:
+  SharedFileSystemCache();
+  ~SharedFileSystemCache();
+
+  /// \brief Get the 'stat' information for the specified path, using the
+  /// cache if possible.
+  ///
+  /// Has the same semantics as \c FileSystemStatCache::get(), except that it
+  /// never opens the file.
+  ///
+  /// If \p CacheFailure is false, the path may be created or replaced later,
+  /// e.g. a module file that has yet to be built, so the cached result is
+  /// not used; the path is stat'ed again and only an existing file is
+  /// remembered.
+  bool getStat(const char *Path, FileData &Data, bool isFile,
+               bool CacheFailure = true);
+
+  /// \brief Get the contents of the file at \p Path, which is known to have
+  /// the given unique ID, size and modification time.
+  ///
+  /// Returns a new MemoryBuffer owned by the caller, or null if the file
+  /// could not be read, in which case \p ErrorStr is set. If the contents
+  /// are retained by the cache, the returned buffer refers to them instead
+  /// of copying them.
+  llvm::MemoryBuffer *getBufferForFile(const char *Path,
+                                       const llvm::sys::fs::UniqueID &UniqueID,
+                                       uint64_t Size, time_t ModTime,
+                                       std::string *ErrorStr);
+
+  /// \brief Record that \p Contents, the whole contents of the file with the
+  /// given unique ID, are guarded by \p Macro.
+  void setIncludeGuard(const llvm::sys::fs::UniqueID &UniqueID,
+                       StringRef Contents, StringRef Macro);
+
+  /// \brief Look up the macro recorded as guarding the file with the given
+  /// unique ID and size.
+  ///
+  /// The guard only applies if \c isIncludeGuardCurrent() confirms that the
+  /// file still has the contents it was learned from.
+  ///
+  /// \returns true and sets \p Macro if a guard was recorded for the file.
+  bool getIncludeGuard(const llvm::sys::fs::UniqueID &UniqueID, uint64_t Size,
+                       std::string &Macro);
+
+  /// \brief Returns true if the guard recorded for the file with the given
+  /// unique ID was learned from \p Contents.
+  bool isIncludeGuardCurrent(const llvm::sys::fs::UniqueID &UniqueID,
+                             StringRef Contents);
+
+  /// \brief Forget all cached stat results, but keep file contents.
+  ///
+  /// Retained contents are still keyed by unique ID, size and modification
+  /// time, so they are only reused if a fresh stat shows that the file is
+  /// unchanged.
+  /// Long-lived clients call this whenever the file system may have changed.
+  void invalidateStats();
+
+  /// \brief Forget everything that has been cached.
+  ///
+  /// Buffers previously returned by \c getBufferForFile() must no longer be
+  /// in use.
+  void clear();
+
+  /// \brief Returns the number of bytes of file contents held by the cache,
+  /// including contents of files that have since changed on disk.
+  uint64_t getNumBytesRetained() const;
+
+  void PrintStats() const;
+};
+
 } // end namespace clang
 
 #endif
@@ -0,0 +1,67 @@
+//===--- Parallel.h - Running independent work items on threads -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines a minimal fork/join helper for running independent work
+/// items on a bounded number of threads.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_BASIC_PARALLEL_H
+#define LLVM_CLANG_BASIC_PARALLEL_H
+
+#include <vector>
+
+namespace clang {
+
+/// \brief Returns the number of hardware threads available to the process,
+/// or 1 if it cannot be determined.
+unsigned getHardwareConcurrency();
+
+/// \brief Invokes \p Fn(UserData, Index) for every \c Index in
+/// [0, \p NumItems), using at most \p NumThreads threads.
+///
+/// The calling thread participates in the work, so at most \p NumThreads - 1
+/// additional threads are created. Work items are handed out in increasing
+/// index order, but may complete in any order; callers that need
+/// deterministic output should record per-index results and emit them in
+/// index order. Each worker thread gets a stack large enough to run a full
+/// compilation.
+///
+/// If \p NumThreads is 0, \c getHardwareConcurrency() threads are used. If
+/// only one thread is requested, or LLVM was built without thread support,
+/// all items are run serially on the calling thread.
+///
+/// Returns once every work item has completed.
+void runInParallel(unsigned NumItems, unsigned NumThreads,
+                   void (*Fn)(void *UserData, unsigned Index),
+                   void *UserData);
+
+/// \brief Invokes \p Fn(UserData, Index) for the items of a dependency graph
+/// with \p Dependencies.size() items, using at most \p NumThreads threads.
+///
+/// Item \c I runs as soon as every item in \p Dependencies[I] has run and
+/// returned true, so a slow item only holds up the items that depend on it.
+/// Items that depend on an item that returned false, and items in dependency
+/// cycles, are never run. Items are handed out in the order they become
+/// ready, and threads are only started while there are items ready to run.
+///
+/// If \p NumThreads is 0, \c getHardwareConcurrency() threads are used. If
+/// only one thread is requested, or LLVM was built without thread support,
+/// all items are run serially on the calling thread.
+///
+/// Returns once no more items can run.
+void runDependencyGraph(const std::vector<std::vector<unsigned> > &Dependencies,
+                        unsigned NumThreads,
+                        bool (*Fn)(void *UserData, unsigned Index),
+                        void *UserData);
+
+} // end namespace clang
+
+#endif // LLVM_CLANG_BASIC_PARALLEL_H
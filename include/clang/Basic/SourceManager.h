@@ -386,39 +386,53 @@ namespace SrcMgr {
   ///
   /// SourceManager keeps an array of these objects, and they are uniquely
   /// identified by the FileID datatype.
+  ///
+  /// Macro expansions create far more entries than files do, so the FileInfo
+  /// of a file is allocated by the SourceManager and referenced from here.
+  /// That keeps every entry as small as an expansion, i.e. 16 bytes.
   class SLocEntry {
-    unsigned Offset;   // low bit is set for expansion info.
+    // Both kinds of entries start with the offset, whose low bit is set for
+    // expansion info.
+    struct FileEntryInfo {
+      unsigned Offset;
+      const FileInfo *Info;
+    };
+    struct ExpansionEntryInfo {
+      unsigned Offset;
+      ExpansionInfo Info;
+    };
     union {
-      FileInfo File;
-      ExpansionInfo Expansion;
+      FileEntryInfo File;
+      ExpansionEntryInfo Expansion;
     };
   public:
-    unsigned getOffset() const { return Offset >> 1; }
+    unsigned getOffset() const { return File.Offset >> 1; }
 
-    bool isExpansion() const { return Offset & 1; }
+    bool isExpansion() const { return File.Offset & 1; }
     bool isFile() const { return !isExpansion(); }
 
     const FileInfo &getFile() const {
       assert(isFile() && "Not a file SLocEntry!");
-      return File;
+      return *File.Info;
     }
 
     const ExpansionInfo &getExpansion() const {
       assert(isExpansion() && "Not a macro expansion SLocEntry!");
-      return Expansion;
+      return Expansion.Info;
     }
 
-    static SLocEntry get(unsigned Offset, const FileInfo &FI) {
+    /// \brief Return a file entry.  The FileInfo must outlive the entry.
+    static SLocEntry get(unsigned Offset, const FileInfo *FI) {
       SLocEntry E;
-      E.Offset = Offset << 1;
-      E.File = FI;
+      E.File.Offset = Offset << 1;
+      E.File.Info = FI;
       return E;
     }
 
     static SLocEntry get(unsigned Offset, const ExpansionInfo &Expansion) {
       SLocEntry E;
-      E.Offset = (Offset << 1) | 1;
-      E.Expansion = Expansion;
+      E.Expansion.Offset = (Offset << 1) | 1;
+      E.Expansion.Info = Expansion;
       return E;
     }
   };
@@ -625,6 +639,36 @@ class SourceManager : public RefCountedBase<SourceManager> {
   /// is very common to look up many tokens from the same file.
   mutable FileID LastFileIDLookup;
 
+  /// \brief A FileID found by getFileIDSlow, with the range of offsets it
+  /// covers.
+  struct FileIDLookup {
+    FileID ID;
+    unsigned Begin, End;
+    bool IsExpansion;
+  };
+
+  /// \brief A small cache of recent getFileIDSlow results, the second level
+  /// of getFileID.
+  ///
+  /// Unlike LastFileIDLookup, this also remembers macro expansions, which
+  /// are often looked up several times in a row, e.g. by diagnostics.
+  /// Entries are replaced round-robin.
+  static const unsigned NumRecentFileIDLookups = 8;
+  mutable FileIDLookup RecentFileIDLookups[NumRecentFileIDLookups];
+  mutable unsigned NextRecentFileIDLookup;
+
+  /// \brief An index of LocalSLocEntryTable by offset.
+  ///
+  /// Element I is the index of the local entry that contains the offset
+  /// I << LocalSLocEntryIndexShift, so getFileIDLocal only has to search the
+  /// few entries that start between two consecutive indexed offsets.  The
+  /// index is extended on demand, as the table only ever grows at the end.
+  static const unsigned LocalSLocEntryIndexShift = 8;
+  mutable std::vector<unsigned> LocalSLocEntryIndex;
+
+  /// \brief The number of local entries covered by LocalSLocEntryIndex.
+  mutable unsigned NumIndexedSLocEntries;
+
   /// \brief Holds information for \#line directives.
   ///
   /// This is referenced by indices from SLocEntryTable.
@@ -645,6 +689,7 @@ class SourceManager : public RefCountedBase<SourceManager> {
 
   // Statistics for -print-stats.
   mutable unsigned NumLinearScans, NumBinaryProbes;
+  mutable unsigned NumRecentFileIDHits, NumIndexedFileIDLookups;
 
   /// \brief Associates a FileID with its "included/expanded in" decomposed
   /// location.
@@ -1562,6 +1607,12 @@ private:
 
   const SrcMgr::SLocEntry &loadSLocEntry(unsigned Index, bool *Invalid) const;
 
+  /// \brief Allocate the FileInfo of a file entry, which lives as long as the
+  /// SourceManager.
+  const SrcMgr::FileInfo *
+  allocateFileInfo(SourceLocation IncludePos, const SrcMgr::ContentCache *File,
+                   SrcMgr::CharacteristicKind FileCharacter) const;
+
   /// \brief Get the entry with the given unwrapped FileID.
   const SrcMgr::SLocEntry &getSLocEntryByID(int ID, bool *Invalid = 0) const {
     assert(ID != -1 && "Using FileID sentinel value");
@@ -1631,6 +1682,8 @@ private:
   FileID getFileIDSlow(unsigned SLocOffset) const;
   FileID getFileIDLocal(unsigned SLocOffset) const;
   FileID getFileIDLoaded(unsigned SLocOffset) const;
+  void rememberFileIDLookup(FileID FID, unsigned SLocOffset) const;
+  void updateLocalSLocEntryIndex() const;
 
   SourceLocation getExpansionLocSlowCase(SourceLocation Loc) const;
   SourceLocation getSpellingLocSlowCase(SourceLocation Loc) const;
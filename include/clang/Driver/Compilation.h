@@ -186,6 +186,22 @@ public:
   void ExecuteJob(const Job &J,
      SmallVectorImpl< std::pair<int, const Command *> > &FailingCommands) const;
 
+  /// ExecuteJobsInParallel - Execute the commands in a job list, running up
+  /// to \p NumJobs of them at the same time.
+  ///
+  /// A command is started once every command producing one of its inputs has
+  /// finished, and is skipped if any of them failed, just like with
+  /// ExecuteJob. The output of each command is captured in temporary files
+  /// and printed in job order, so it is the same as with serial execution.
+  ///
+  /// \param NumJobs - The maximum number of concurrent commands. If it is 1,
+  /// or the output of the compilation is redirected, this is equivalent to
+  /// ExecuteJob.
+  /// \param FailingCommands - For non-zero results, this will be a vector of
+  /// failing commands and their associated result code, in job order.
+  void ExecuteJobsInParallel(const JobList &Jobs, unsigned NumJobs,
+     SmallVectorImpl< std::pair<int, const Command *> > &FailingCommands) const;
+
   /// initCompilationForDiagnostics - Remove stale state and suppress output
   /// so compilation can be reexecuted to generate additional diagnostic
   /// information (e.g., preprocessed source(s)).
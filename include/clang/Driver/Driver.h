@@ -153,6 +153,18 @@ public:
   /// Whether the driver is generating diagnostics for debugging purposes.
   unsigned CCGenDiagnostics : 1;
 
+  /// Signature of a function that runs a "-cc1" job in the driver's process.
+  ///
+  /// \param ArgBegin, ArgEnd - The job's arguments, following "-cc1".
+  /// \param Argv0 - The executable the job would have been run with.
+  /// \return The job's result code, negative if it crashed.
+  typedef int (*CC1MainFn)(const char **ArgBegin, const char **ArgEnd,
+                           const char *Argv0);
+
+  /// The function used to run "-cc1" jobs in process with -fintegrated-cc1,
+  /// or null if every job must be run in a new process.
+  CC1MainFn CC1Main;
+
 private:
   /// Name to use when invoking gcc/g++.
   std::string CCCGenericGCCName;
@@ -26,6 +26,13 @@ namespace driver {
   /// ActionList - Type used for lists of actions.
   typedef SmallVector<Action*, 3> ActionList;
 
+  /// CC1ArgsSetLLVMOptions - Whether the -cc1 arguments \p Args set LLVM
+  /// command line options (-mllvm, and the options the backend passes on to
+  /// LLVM, such as -mdebug-pass and -ftime-report). Those options are global
+  /// to the process and most of them may only be given once, so a job that
+  /// sets them needs a process of its own.
+  bool CC1ArgsSetLLVMOptions(ArrayRef<const char *> Args);
+
 } // end namespace driver
 } // end namespace clang
 
@@ -312,16 +312,22 @@ std::string configurationAsText(const FormatStyle &Style);
 ///
 /// Returns the \c Replacements necessary to make all \p Ranges comply with
 /// \p Style.
+///
+/// Lines that do not fit into the column limit are broken using up to
+/// \p NumThreads threads, or one per hardware thread if \p NumThreads is 0.
+/// The result does not depend on the number of threads.
 tooling::Replacements reformat(const FormatStyle &Style, Lexer &Lex,
                                SourceManager &SourceMgr,
-                               std::vector<CharSourceRange> Ranges);
+                               std::vector<CharSourceRange> Ranges,
+                               unsigned NumThreads = 1);
 
 /// \brief Reformats the given \p Ranges in \p Code.
 ///
 /// Otherwise identical to the reformat() function consuming a \c Lexer.
 tooling::Replacements reformat(const FormatStyle &Style, StringRef Code,
                                std::vector<tooling::Range> Ranges,
-                               StringRef FileName = "<stdin>");
+                               StringRef FileName = "<stdin>",
+                               unsigned NumThreads = 1);
 
 /// \brief Returns the \c LangOpts that the formatter expects you to set.
 ///
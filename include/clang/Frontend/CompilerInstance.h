@@ -20,9 +20,11 @@
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/StringRef.h"
 #include <cassert>
+#include <ctime>
 #include <list>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace llvm {
 class raw_fd_ostream;
@@ -42,6 +44,7 @@ class FileManager;
 class FrontendAction;
 class Module;
 class Preprocessor;
+struct PrebuiltModuleDiagnostics;
 class Sema;
 class SourceManager;
 class TargetInfo;
@@ -120,6 +123,50 @@ class CompilerInstance : public ModuleLoader {
   /// \brief One or more modules failed to build.
   bool ModuleBuildFailed;
 
+  /// \brief Whether the modules imported by this translation unit have been
+  /// built ahead of time.
+  bool ModulesPrebuilt;
+
+  /// \brief When this compiler instance was created. Module files modified
+  /// since then may be in use by this or a concurrent compilation, so they
+  /// are never pruned from the module cache.
+  time_t StartTime;
+
+  /// \brief The diagnostics of the modules built ahead of time, which are
+  /// reported once the modules are loaded.
+  std::vector<PrebuiltModuleDiagnostics *> PrebuiltModuleDiags;
+
+public:
+  /// \brief Statistics about the module files built for this translation
+  /// unit, including those built for the modules it imports.
+  struct ModuleCacheStatistics {
+    /// \brief The number of module files built.
+    unsigned NumModulesBuilt;
+
+    /// \brief The number of module files built that were identical to a
+    /// module file already in the module cache, and now share its storage.
+    unsigned NumModuleFilesShared;
+
+    /// \brief The number of module files removed when the module cache was
+    /// pruned.
+    unsigned NumModuleFilesPruned;
+
+    /// \brief The number of module files built ahead of time, concurrently.
+    unsigned NumModulesPrebuilt;
+
+    /// \brief The number of module files built ahead of time that replaced
+    /// out-of-date module files.
+    unsigned NumOutOfDateModulesPrebuilt;
+
+    ModuleCacheStatistics()
+      : NumModulesBuilt(0), NumModuleFilesShared(0), NumModuleFilesPruned(0),
+        NumModulesPrebuilt(0), NumOutOfDateModulesPrebuilt(0) {}
+  };
+
+private:
+  /// \brief Statistics about the module cache.
+  ModuleCacheStatistics ModuleCacheStats;
+
   /// \brief Holds information about the output file.
   ///
   /// If TempFilename is not empty we must rename it to Filename at the end.
@@ -140,6 +187,15 @@ class CompilerInstance : public ModuleLoader {
 
   CompilerInstance(const CompilerInstance &) LLVM_DELETED_FUNCTION;
   void operator=(const CompilerInstance &) LLVM_DELETED_FUNCTION;
+
+  /// \brief Build the module files that are missing or out of date for the
+  /// given module, imported at \p ImportLoc, and for the other modules this
+  /// translation unit imports, concurrently.
+  void prebuildModules(Module *Mod, SourceLocation ImportLoc);
+
+  /// \brief Report the diagnostics of the modules built ahead of time that
+  /// have been loaded since.
+  void reportPrebuiltModuleDiagnostics();
 public:
   CompilerInstance();
   ~CompilerInstance();
@@ -202,6 +258,13 @@ public:
     BuildGlobalModuleIndex = Build;
   }
 
+  /// \brief Retrieve the statistics about the module cache.
+  ModuleCacheStatistics &getModuleCacheStats() { return ModuleCacheStats; }
+
+  /// \brief Print the statistics about the module cache, and the module files
+  /// it contains.
+  void printModuleCacheStats(raw_ostream &OS);
+
   /// }
   /// @name Forwarding Methods
   /// {
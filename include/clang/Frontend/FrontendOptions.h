@@ -213,6 +213,11 @@ public:
   /// \brief File name of the file that will provide record layouts
   /// (in the format produced by -fdump-record-layouts).
   std::string OverrideRecordLayoutsFile;
+
+  /// \brief The number of modules to build at once when the modules imported
+  /// by the translation unit are built ahead of time.  With one, modules are
+  /// only built as they are imported; zero means one per hardware thread.
+  unsigned ModuleBuildJobs;
   
 public:
   FrontendOptions() :
@@ -223,7 +228,7 @@ public:
     SkipFunctionBodies(false), UseGlobalModuleIndex(true),
     GenerateGlobalModuleIndex(true), ASTDumpLookups(false),
     ARCMTAction(ARCMT_None), ObjCMTAction(ObjCMT_None),
-    ProgramAction(frontend::ParseSyntaxOnly)
+    ProgramAction(frontend::ParseSyntaxOnly), ModuleBuildJobs(1)
   {}
 
   /// getInputKindForExtension - Return the appropriate input kind for a file
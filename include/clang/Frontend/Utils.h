@@ -82,6 +82,15 @@ void AttachDependencyFileGen(Preprocessor &PP,
   void AttachDependencyGraphGen(Preprocessor &PP, StringRef OutputFile,
                                 StringRef SysRoot);
 
+/// AttachHeaderSearchMapGen - Record where the headers included through the
+/// given preprocessor are found, and add them to the header map in
+/// \p OutputFile at the end of the main file.
+void AttachHeaderSearchMapGen(Preprocessor &PP, StringRef OutputFile);
+
+/// AttachHeaderTokenCacheGen - Write the entries that were missing from the
+/// header token cache of the given preprocessor at the end of the main file.
+void AttachHeaderTokenCacheGen(Preprocessor &PP);
+
 /// AttachHeaderIncludeGen - Create a header include list generator, and attach
 /// it to the given preprocessor.
 ///
@@ -101,6 +110,12 @@ void AttachHeaderIncludeGen(Preprocessor &PP, bool ShowAllHeaders = false,
 /// a seekable stream.
 void CacheTokens(Preprocessor &PP, llvm::raw_fd_ostream* OS);
 
+/// CacheHeaderTokens - Cache the tokens of the header \p FID under \p Key,
+/// for use with the header token cache.  Returns false if they cannot be
+/// cached.  Note that this requires a seekable stream.
+bool CacheHeaderTokens(Preprocessor &PP, FileID FID, const char *Key,
+                       llvm::raw_fd_ostream *OS);
+
 /// createInvocationFromCommandLine - Construct a compiler invocation object for
 /// a command line argument vector.
 ///
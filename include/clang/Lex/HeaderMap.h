@@ -15,7 +15,10 @@
 #define LLVM_CLANG_LEX_HEADERMAP_H
 
 #include "clang/Basic/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/Support/Compiler.h"
+#include <string>
+#include <vector>
 
 namespace llvm {
   class MemoryBuffer;
@@ -26,6 +29,14 @@ namespace clang {
   struct HMapBucket;
   struct HMapHeader;
 
+/// \brief One mapping of a header map, from a header name to the path that
+/// results from concatenating \c Prefix and \c Suffix.
+struct HeaderMapEntry {
+  std::string Key;
+  std::string Prefix;
+  std::string Suffix;
+};
+
 /// This class represents an Apple concept known as a 'header map'.  To the
 /// \#include file resolution process, it basically acts like a directory of
 /// symlinks to files.  Its advantages are that it is dense and more efficient
@@ -47,6 +58,16 @@ public:
   /// map.  If it doesn't look like a HeaderMap, it gives up and returns null.
   static const HeaderMap *Create(const FileEntry *FE, FileManager &FM);
 
+  /// \brief Create a header map from the contents of a file, taking
+  /// ownership of \p Buffer. Returns null if it is not a header map.
+  static const HeaderMap *Create(const llvm::MemoryBuffer *Buffer);
+
+  /// \brief Write a header map with the given entries to \p OS.
+  ///
+  /// Keys are compared without regard to case, as they are when looking them
+  /// up; of entries with equal keys, the last one is kept.
+  static void write(ArrayRef<HeaderMapEntry> Entries, raw_ostream &OS);
+
   /// LookupFile - Check to see if the specified relative filename is located in
   /// this HeaderMap.  If so, open it and return its FileEntry.
   /// If RawPath is not NULL and the file is found, RawPath will be set to the
@@ -55,6 +76,15 @@ public:
   /// "../../file.h".
   const FileEntry *LookupFile(StringRef Filename, FileManager &FM) const;
 
+  /// \brief Look up the entry for \p Filename, without accessing the file
+  /// system. Unlike \c LookupFile(), the key has to match exactly.
+  ///
+  /// \returns true and sets \p Entry if found.
+  bool lookupEntry(StringRef Filename, HeaderMapEntry &Entry) const;
+
+  /// \brief Append all entries of this header map to \p Entries.
+  void getEntries(std::vector<HeaderMapEntry> &Entries) const;
+
   /// getFileName - Return the filename of the headermap.
   const char *getFileName() const;
 
@@ -62,6 +92,10 @@ public:
   void dump() const;
 
 private:
+  /// \brief Find the bucket holding \p Filename, compared without regard
+  /// to case. Returns false if there is none.
+  bool findBucket(StringRef Filename, HMapBucket &Result) const;
+
   unsigned getEndianAdjustedWord(unsigned X) const;
   const HMapHeader &getHeader() const;
   HMapBucket getBucket(unsigned BucketNo) const;
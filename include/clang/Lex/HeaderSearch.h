@@ -22,6 +22,7 @@
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Support/Allocator.h"
+#include <ctime>
 #include <vector>
 
 namespace clang {
@@ -30,8 +31,10 @@ class DiagnosticsEngine;
 class ExternalIdentifierLookup;
 class FileEntry;
 class FileManager;
+struct HeaderMapEntry;
 class HeaderSearchOptions;
 class IdentifierInfo;
+class Preprocessor;
 
 /// \brief The preprocessor keeps track of this information for each
 /// file that is \#included.
@@ -210,6 +213,46 @@ class HeaderSearch {
   /// headermaps.  This vector owns the headermap.
   std::vector<std::pair<const FileEntry*, const HeaderMap*> > HeaderMaps;
 
+  /// \brief A header map, recorded by an earlier build with the same search
+  /// path, that tells where headers were found; see \c setSearchMap().
+  const HeaderMap *SearchMap;
+
+  /// \brief The modification time of \c SearchMap.
+  time_t SearchMapModTime;
+
+  /// \brief Whether \c SearchMap has been checked against the current
+  /// search path. If it doesn't match, \c SearchMap is reset to null.
+  bool SearchMapChecked;
+
+  /// \brief Maps the names of the normal directories in SearchDirs,
+  /// followed by a slash, to their index, for looking up \c SearchMap
+  /// results.
+  llvm::StringMap<unsigned> SearchMapDirs;
+
+  /// \brief Whether each entry in SearchDirs was modified after \c SearchMap
+  /// was written. Such a directory may hold a header that is newly found
+  /// before the one the map knows about, so lookups can't skip it.
+  std::vector<bool> SearchMapDirModified;
+
+  /// \brief Whether the subdirectories of entries in SearchDirs that headers
+  /// are included from, such as "dir/sys" for \<sys/types.h\>, were modified
+  /// after \c SearchMap was written, by path.
+  llvm::StringMap<bool> SearchMapSubdirModified;
+
+  /// \brief Whether to record where headers are found for
+  /// \c getSearchMapEntries().
+  bool RecordSearchMap;
+
+  /// \brief Whether the first \#include of a header may be skipped because
+  /// an earlier translation unit that shared the file manager's
+  /// SharedFileSystemCache learned the header's include guard.
+  bool UseSharedIncludeGuards;
+
+  /// \brief Maps the names of headers found by searching from the first
+  /// directory in SearchDirs to the index of the directory they were found
+  /// in.
+  llvm::StringMap<unsigned> RecordedLookups;
+
   /// \brief The mapping between modules and headers.
   mutable ModuleMap ModMap;
   
@@ -230,12 +273,28 @@ class HeaderSearch {
   // Various statistics we track for performance analysis.
   unsigned NumIncluded;
   unsigned NumMultiIncludeFileOptzn;
+  unsigned NumSharedIncludeGuardOptzn;
+  unsigned NumSearchMapHits;
   unsigned NumFrameworkLookups, NumSubFrameworkLookups;
 
   // HeaderSearch doesn't support default or copy construction.
   HeaderSearch(const HeaderSearch&) LLVM_DELETED_FUNCTION;
   void operator=(const HeaderSearch&) LLVM_DELETED_FUNCTION;
 
+  /// \brief Look up \p Filename in \c SearchMap, for a search starting at
+  /// index \p StartIdx in SearchDirs.
+  ///
+  /// \returns true and sets \p DirIdx to the index in SearchDirs of the
+  /// directory the file was found in when searching from the first one, if
+  /// the search can skip ahead to it.
+  bool lookupSearchMap(StringRef Filename, unsigned StartIdx,
+                       unsigned &DirIdx);
+
+  /// \brief Returns true if a header named \p Filename may have been added
+  /// to the directory at index \p DirIdx in SearchDirs since \c SearchMap
+  /// was written.
+  bool isSearchMapDirModified(unsigned DirIdx, StringRef Filename);
+
   friend class DirectoryLookup;
   
 public:
@@ -260,6 +319,7 @@ public:
     AngledDirIdx = angledDirIdx;
     SystemDirIdx = systemDirIdx;
     NoCurDirSearch = noCurDirSearch;
+    SearchMapChecked = false;
     //LookupFileCache.clear();
   }
 
@@ -270,8 +330,47 @@ public:
     if (!isAngled)
       AngledDirIdx++;
     SystemDirIdx++;
+    SearchMapChecked = false;
+  }
+
+  /// \brief Use a header map recorded by an earlier build to find headers.
+  ///
+  /// \p Map must have been produced from \c getSearchMapEntries() by a
+  /// build with the same search path; otherwise it is ignored. A header it
+  /// knows about is looked for only in the directory it was found in last
+  /// time, unless it is no longer there, or a directory searched before that
+  /// one was modified after \p ModTime, the modification time of the map.
+  ///
+  /// A header added to a subdirectory of an earlier directory, without
+  /// modifying the directory itself, is not noticed and remains shadowed by
+  /// the one the map knows about.
+  void setSearchMap(const HeaderMap *Map, time_t ModTime) {
+    SearchMap = Map;
+    SearchMapModTime = ModTime;
+    SearchMapChecked = false;
   }
 
+  /// \brief Record where headers are found, for \c getSearchMapEntries().
+  void setRecordSearchMap(bool Record) { RecordSearchMap = Record; }
+
+  /// \brief Set whether to skip headers whose include guard an earlier
+  /// translation unit learned. Clients that list every header entered turn
+  /// this off, since the skipped headers are never entered.
+  void setUseSharedIncludeGuards(bool Use) { UseSharedIncludeGuards = Use; }
+
+  /// \brief Produce the entries of a header map that tells where the headers
+  /// looked up so far were found, for use with \c setSearchMap().
+  ///
+  /// Each header name maps to its path in the directory it was found in.
+  /// Headers that were found relative to the including file or outside of
+  /// normal directories are left out. The empty key, which no \#include can
+  /// name, maps to a description of the search path.
+  void getSearchMapEntries(std::vector<HeaderMapEntry> &Entries) const;
+
+  /// \brief Returns a description of the search path that changes whenever
+  /// a header could be found in a different place.
+  std::string getSearchPathSignature() const;
+
   /// \brief Set the list of system header prefixes.
   void SetSystemHeaderPrefixes(ArrayRef<std::pair<std::string, bool> > P) {
     SystemHeaderPrefixes.assign(P.begin(), P.end());
@@ -397,9 +496,20 @@ public:
   /// \brief Mark the specified file as a target of of a \#include,
   /// \#include_next, or \#import directive.
   ///
+  /// If the file manager has a shared cache that knows the include guard of
+  /// a file from an earlier translation unit, the first \#include of the file
+  /// is skipped as well when \p PP has the guard macro defined.
+  ///
   /// \return false if \#including the file will have no effect or true
   /// if we should include it.
-  bool ShouldEnterIncludeFile(const FileEntry *File, bool isImport);
+  bool ShouldEnterIncludeFile(Preprocessor &PP, const FileEntry *File,
+                              bool isImport);
+
+  /// \brief Returns the number of \#includes skipped thanks to include guards
+  /// learned from earlier translation units.
+  unsigned getNumSharedIncludeGuardOptzn() const {
+    return NumSharedIncludeGuardOptzn;
+  }
 
 
   /// \brief Return whether the specified file is a normal header,
@@ -116,6 +116,24 @@ public:
   /// regenerated often.
   unsigned ModuleCachePruneAfter;
 
+  /// \brief The size (in kilobytes) to which the module cache is pruned.
+  ///
+  /// When a module has been built and the module cache is larger than this,
+  /// the least recently used module files are removed until it fits again.
+  /// Zero means that the size of the module cache is not limited.
+  unsigned ModuleCacheMaxSize;
+
+  /// \brief A header map recorded with \c HeaderSearchMapOutput by an
+  /// earlier build, used to find headers without searching.
+  ///
+  /// Search directories, and subdirectories of them that headers are
+  /// included from, are still searched if they were modified since the map
+  /// was written.
+  std::string HeaderSearchMap;
+
+  /// \brief The header map in which to record where headers are found.
+  std::string HeaderSearchMapOutput;
+
   /// \brief The set of macro names that should be ignored for the purposes
   /// of computing the module hash.
   llvm::SetVector<std::string> ModulesIgnoreMacros;
@@ -139,7 +157,7 @@ public:
   HeaderSearchOptions(StringRef _Sysroot = "/")
     : Sysroot(_Sysroot), DisableModuleHash(0), ModuleMaps(0),
       ModuleCachePruneInterval(7*24*60*60),
-      ModuleCachePruneAfter(31*24*60*60),
+      ModuleCachePruneAfter(31*24*60*60), ModuleCacheMaxSize(0),
       UseBuiltinIncludes(true),
       UseStandardSystemIncludes(true), UseStandardCXXIncludes(true),
       UseLibcxx(false), Verbose(false) {}
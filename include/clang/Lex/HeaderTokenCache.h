@@ -0,0 +1,86 @@
+//===--- HeaderTokenCache.h - Cached tokens of headers ----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines the HeaderTokenCache interface.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_HEADERTOKENCACHE_H
+#define LLVM_CLANG_HEADERTOKENCACHE_H
+
+#include "clang/Basic/LLVM.h"
+#include "clang/Basic/SourceLocation.h"
+#include "llvm/ADT/StringMap.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace clang {
+  class LangOptions;
+  class PTHLexer;
+  class PTHManager;
+  class Preprocessor;
+
+/// HeaderTokenCache - This class provides the tokens of headers from a
+/// directory of PTH files that each cache the tokens of a single header.
+///
+/// A cache entry is named after a hash of the contents of the header and of
+/// the options that affect how it is lexed, so it is used for any header with
+/// those contents, wherever the header was found, and it never needs to be
+/// invalidated.  Headers without an entry are lexed as usual, and remembered
+/// so that entries can be written for them once the translation unit has been
+/// preprocessed.
+class HeaderTokenCache {
+  /// Directory - The directory containing the cache entries.
+  std::string Directory;
+
+  /// Signature - A hash of the compiler version and the language options,
+  /// which is part of the key of every entry.
+  std::string Signature;
+
+  /// Entries - The entries that were looked up, by key.  Entries that could
+  /// not be loaded are null.
+  llvm::StringMap<PTHManager*> Entries;
+
+  /// MissingHeaders - The headers that had no entry, with their keys.
+  std::vector<std::pair<FileID, std::string> > MissingHeaders;
+
+  // Statistics.
+  unsigned NumHits, NumMisses;
+
+  HeaderTokenCache(const HeaderTokenCache &) LLVM_DELETED_FUNCTION;
+  void operator=(const HeaderTokenCache &) LLVM_DELETED_FUNCTION;
+
+public:
+  HeaderTokenCache(StringRef Directory, const LangOptions &LangOpts);
+  ~HeaderTokenCache();
+
+  StringRef getDirectory() const { return Directory; }
+
+  /// getEntryPath - Compute the path of the cache entry with the given key.
+  void getEntryPath(StringRef Key, SmallVectorImpl<char> &Path) const;
+
+  /// CreateLexer - Return a PTHLexer that "lexes" the cached tokens of the
+  /// specified file.  This method returns NULL if the file is not a header
+  /// that can be cached, or if it has no entry yet.
+  PTHLexer *CreateLexer(FileID FID, Preprocessor &PP);
+
+  /// getMissingHeaders - The headers that had no entry, with the keys of the
+  /// entries to write for them.
+  const std::vector<std::pair<FileID, std::string> > &
+  getMissingHeaders() const {
+    return MissingHeaders;
+  }
+
+  void PrintStats() const;
+};
+
+} // end namespace clang
+
+#endif
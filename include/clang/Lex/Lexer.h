@@ -211,6 +211,12 @@ public:
   /// uninterpreted string.  This switches the lexer out of directive mode.
   void ReadToEndOfLine(SmallVectorImpl<char> *Result = 0);
 
+  /// SkipExcludedLines - Skip over the lines of an excluded conditional block
+  /// that cannot contain a preprocessor directive, without lexing them.  This
+  /// stops before the next '#' at the start of a line, or earlier if the
+  /// following text needs to be lexed to find where its lines start.
+  void SkipExcludedLines();
+
 
   /// Diag - Forwarding function for diagnostics.  This translate a source
   /// position in the current buffer into a SourceLocation object for rendering.
@@ -589,6 +595,7 @@ private:
   bool SkipLineComment       (Token &Result, const char *CurPtr);
   bool SkipBlockComment      (Token &Result, const char *CurPtr);
   bool SaveLineComment       (Token &Result, const char *CurPtr);
+  bool SkipExcludedComment   (const char *&CurPtr);
   
   bool IsStartOfConflictMarker(const char *CurPtr);
   bool HandleEndOfConflictMarker(const char *CurPtr);
@@ -0,0 +1,121 @@
+//===--- MacroExpansionCache.h - Memoized macro expansions ------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines the MacroExpansionCache interface.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_MACROEXPANSIONCACHE_H
+#define LLVM_CLANG_MACROEXPANSIONCACHE_H
+
+#include "clang/Basic/SourceLocation.h"
+#include "clang/Lex/Token.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include <vector>
+
+namespace clang {
+  class MacroArgs;
+  class MacroDirective;
+  class MacroInfo;
+  class Preprocessor;
+  class SourceManager;
+
+/// MacroExpansionCache - This class remembers the fully expanded tokens of
+/// macro invocations, so that an invocation of the same macro with the same
+/// argument tokens can be replayed instead of being expanded again.
+///
+/// Entries are keyed by the macro directive and the spelling of the argument
+/// tokens.  The result of an expansion also depends on the definitions of the
+/// macros it expands, so the preprocessor invalidates the whole cache whenever
+/// a macro is defined or undefined.
+///
+/// Tokens spelled in the definition of the macro, or substituted for one of
+/// its parameters, are replayed with the same locations as a TokenLexer gives
+/// them.  Tokens that went through nested macro expansions, token pasting or
+/// stringification are replayed as if they were spelled by the macro itself,
+/// which drops the levels in between from macro backtraces, so expansions
+/// with such tokens are only recorded when macro backtraces are disabled.
+class MacroExpansionCache {
+  /// TokenLoc - Describes how to rebuild the location of a replayed token.
+  struct TokenLoc {
+    enum LocKind {
+      /// The token is spelled in the definition of the expanded macro, at
+      /// Offset.
+      Definition,
+      /// The token is the argument token with index Index, substituted for
+      /// the parameter at Offset in the definition.
+      Argument,
+      /// The token is spelled at Offset in spelling run Index.  The expansion
+      /// levels between the token and the macro are not kept.
+      Run
+    };
+    unsigned Kind : 2;
+    unsigned Index : 30;
+    unsigned Offset;
+  };
+
+  /// SpellingRun - A chunk of source that the spellings of consecutive tokens
+  /// fall into.  Each run gets a single expansion entry when replayed.
+  struct SpellingRun {
+    SourceLocation Start;
+    unsigned Length;
+  };
+
+  struct Entry {
+    std::vector<Token> Tokens;
+    std::vector<TokenLoc> Locs;
+    std::vector<SpellingRun> Runs;
+  };
+
+  llvm::StringMap<Entry> Entries;
+
+  // Statistics.
+  unsigned NumHits, NumMisses, NumUncacheable, NumInvalidations;
+
+public:
+  MacroExpansionCache();
+
+  /// computeKey - Compute the key for an invocation of the macro defined by
+  /// MD.  Args are the arguments of a function-like macro, or null.  The
+  /// locations of the argument tokens are returned in ArgLocs, with invalid
+  /// locations for the separators between arguments.
+  static void computeKey(const Token &Identifier, const MacroDirective *MD,
+                         const MacroArgs *Args, Preprocessor &PP,
+                         SmallVectorImpl<char> &Key,
+                         SmallVectorImpl<SourceLocation> &ArgLocs);
+
+  /// replay - If an expansion was recorded under Key, append its tokens to
+  /// Result and return true.  The tokens get locations that are expanded from
+  /// [ExpandStart, ExpandEnd], with arguments spelled at ArgLocs.
+  bool replay(StringRef Key, const MacroInfo *MI,
+              SourceLocation ExpandStart, SourceLocation ExpandEnd,
+              ArrayRef<SourceLocation> ArgLocs, SourceManager &SM,
+              SmallVectorImpl<Token> &Result);
+
+  /// record - Remember the tokens that the invocation with the given key
+  /// expanded to.  Expansions that cannot be replayed faithfully are not
+  /// recorded.
+  void record(StringRef Key, const MacroInfo *MI,
+              ArrayRef<SourceLocation> ArgLocs, ArrayRef<Token> Expanded,
+              Preprocessor &PP);
+
+  /// noteUncacheable - Count an expansion that could not be recorded.
+  void noteUncacheable() { ++NumUncacheable; }
+
+  /// invalidate - Forget all recorded expansions.
+  void invalidate();
+
+  void PrintStats() const;
+};
+
+} // end namespace clang
+
+#endif
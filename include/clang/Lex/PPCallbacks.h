@@ -54,11 +54,11 @@ public:
   /// \brief Callback invoked whenever a source file is skipped as the result
   /// of header guard optimization.
   ///
-  /// \param ParentFile The file that \#included the skipped file.
+  /// \param SkippedFile The file that was skipped.
   ///
-  /// \param FilenameTok The token in ParentFile that indicates the
+  /// \param FilenameTok The token in the including file that indicates the
   /// skipped file.
-  virtual void FileSkipped(const FileEntry &ParentFile,
+  virtual void FileSkipped(const FileEntry &SkippedFile,
                            const Token &FilenameTok,
                            SrcMgr::CharacteristicKind FileType) {
   }
@@ -316,11 +316,11 @@ public:
     Second->FileChanged(Loc, Reason, FileType, PrevFID);
   }
 
-  virtual void FileSkipped(const FileEntry &ParentFile,
+  virtual void FileSkipped(const FileEntry &SkippedFile,
                            const Token &FilenameTok,
                            SrcMgr::CharacteristicKind FileType) {
-    First->FileSkipped(ParentFile, FilenameTok, FileType);
-    Second->FileSkipped(ParentFile, FilenameTok, FileType);
+    First->FileSkipped(SkippedFile, FilenameTok, FileType);
+    Second->FileSkipped(SkippedFile, FilenameTok, FileType);
   }
 
   virtual bool FileNotFound(StringRef FileName,
@@ -66,6 +66,12 @@ class PTHManager : public IdentifierInfoLookup {
   ///  PTHLexer objects.
   Preprocessor* PP;
 
+  /// SharedIdentifiers - Whether identifiers are resolved through the
+  ///  identifier table of the Preprocessor instead of being created by this
+  ///  PTHManager.  This is the case for the caches of individual headers,
+  ///  which are not consulted by the identifier table.
+  bool SharedIdentifiers;
+
   /// SpellingBase - The base offset within the PTH memory buffer that
   ///  contains the cached spellings for literals.
   const unsigned char* const SpellingBase;
@@ -120,13 +126,29 @@ public:
   ///  is the name of the PTH file.  This method returns NULL upon failure.
   static PTHManager *Create(const std::string& file, DiagnosticsEngine &Diags);
 
+  /// Create - This method creates a PTHManager object for the PTH file 'file'
+  ///  that was already read into 'Buffer', taking ownership of the buffer.
+  ///  Invalid PTH files are diagnosed if 'Diags' is non-null.  This method
+  ///  returns NULL upon failure.
+  static PTHManager *Create(llvm::MemoryBuffer *Buffer, StringRef file,
+                            DiagnosticsEngine *Diags);
+
   void setPreprocessor(Preprocessor *pp) { PP = pp; }
 
+  /// setSharedIdentifiers - Resolve identifiers through the identifier table
+  ///  of the Preprocessor.
+  void setSharedIdentifiers(bool Shared) { SharedIdentifiers = Shared; }
+
   /// CreateLexer - Return a PTHLexer that "lexes" the cached tokens for the
   ///  specified file.  This method returns NULL if no cached tokens exist.
   ///  It is the responsibility of the caller to 'delete' the returned object.
   PTHLexer *CreateLexer(FileID FID);
 
+  /// CreateLexer - Return a PTHLexer that "lexes" the tokens cached for the
+  ///  file named 'Name' in the PTH file, for the specified file.  This method
+  ///  returns NULL if no such tokens exist.
+  PTHLexer *CreateLexer(FileID FID, const char *Name);
+
   /// createStatCache - Returns a FileSystemStatCache object for use with
   ///  FileManager objects.  These objects use the PTH data to speed up
   ///  calls to stat by memoizing their results from when the PTH file
@@ -54,6 +54,8 @@ class PPCallbacks;
 class CodeCompletionHandler;
 class DirectoryLookup;
 class PreprocessingRecord;
+class MacroExpansionCache;
+class HeaderTokenCache;
 class ModuleLoader;
 class PreprocessorOptions;
 
@@ -102,6 +104,11 @@ class Preprocessor : public RefCountedBase<Preprocessor> {
   ///  a token cache rather than lexing the original source file.
   OwningPtr<PTHManager> PTH;
 
+  /// HeaderTokens - An optional cache of the tokens of individual headers,
+  ///  used for getting tokens of headers that have cache entries when there
+  ///  is no PTHManager.
+  OwningPtr<HeaderTokenCache> HeaderTokens;
+
   /// BP - A BumpPtrAllocator object used to quickly allocate and release
   ///  objects internal to the Preprocessor.
   llvm::BumpPtrAllocator BP;
@@ -334,7 +341,7 @@ class Preprocessor : public RefCountedBase<Preprocessor> {
   // Various statistics we track for performance analysis.
   unsigned NumDirectives, NumIncluded, NumDefined, NumUndefined, NumPragma;
   unsigned NumIf, NumElse, NumEndif;
-  unsigned NumEnteredSourceFiles, MaxIncludeStackDepth;
+  unsigned NumEnteredSourceFiles, MaxIncludeStackDepth, NumSkippedIncludes;
   unsigned NumMacroExpanded, NumFnMacroExpanded, NumBuiltinMacroExpanded;
   unsigned NumFastMacroExpanded, NumTokenPaste, NumFastTokenPaste;
   unsigned NumSkipped;
@@ -366,6 +373,21 @@ class Preprocessor : public RefCountedBase<Preprocessor> {
   /// \c createPreprocessingRecord() prior to preprocessing.
   PreprocessingRecord *Record;
 
+  /// \brief Memoized expansions of macro invocations, or null if expansions
+  /// are not memoized.
+  ///
+  /// This is an optional side structure that can be enabled with
+  /// \c createMacroExpansionCache() prior to preprocessing.
+  MacroExpansionCache *ExpansionCache;
+
+  /// \brief The token stream that ends the macro expansion currently being
+  /// recorded in the expansion cache, or null.
+  TokenLexer *MemoizationBarrier;
+
+  /// \brief Whether the expansion being recorded read macro arguments past
+  /// its end, or expanded something that cannot be replayed.
+  bool MemoizedExpansionEscaped, MemoizedExpansionUncacheable;
+
 private:  // Cached tokens state.
   typedef SmallVector<Token, 1> CachedTokensTy;
 
@@ -447,6 +469,10 @@ public:
 
   PTHManager *getPTHManager() { return PTH.get(); }
 
+  void setHeaderTokenCache(HeaderTokenCache *Cache);
+
+  HeaderTokenCache *getHeaderTokenCache() { return HeaderTokens.get(); }
+
   void setExternalSource(ExternalPreprocessorSource *Source) {
     ExternalSource = Source;
   }
@@ -647,6 +673,20 @@ public:
   /// all macro expansions, macro definitions, etc.
   void createPreprocessingRecord();
 
+  /// \brief Retrieve the macro expansion cache, or NULL if macro expansions
+  /// are not memoized.
+  MacroExpansionCache *getMacroExpansionCache() const {
+    return ExpansionCache;
+  }
+
+  /// \brief Memoize macro expansions from now on, replaying the tokens of
+  /// invocations that were already expanded with the same arguments.
+  ///
+  /// Macros expanded within a replayed invocation are not reported to
+  /// \c PPCallbacks::MacroExpands, so expansions are never memoized while
+  /// there is a preprocessing record.
+  void createMacroExpansionCache();
+
   /// EnterMainSourceFile - Enter the specified FileID as the main source file,
   /// which implicitly adds the builtin defines etc.
   void EnterMainSourceFile();
@@ -1345,6 +1385,20 @@ private:
   /// the macro should not be expanded return true, otherwise return false.
   bool HandleMacroExpandedIdentifier(Token &Tok, MacroDirective *MD);
 
+  /// \brief Whether the macro invocation that was just read can be replayed
+  /// from, or recorded in, the macro expansion cache.
+  bool canMemoizeMacroExpansion() const;
+
+  /// \brief Expand a macro invocation through the macro expansion cache and
+  /// return the first token of its expansion in \p Tok.
+  void ExpandMemoizedMacro(Token &Tok, SourceLocation ExpansionEnd,
+                           MacroDirective *MD, MacroInfo *MI, MacroArgs *Args);
+
+  /// \brief Enter the fully expanded tokens of a memoized macro invocation
+  /// and return the first of them in \p Tok.
+  void EnterMemoizedExpansion(Token &Tok, ArrayRef<Token> Expanded,
+                              bool Escaped);
+
   /// \brief Cache macro expanded tokens for TokenLexers.
   //
   /// Works like a stack; a TokenLexer adds the macro expanded tokens that is
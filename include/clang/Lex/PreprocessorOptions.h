@@ -55,6 +55,10 @@ public:
   /// definitions and expansions.
   unsigned DetailedRecord : 1;
 
+  /// \brief Whether the expansions of macro invocations should be memoized
+  /// and replayed when a macro is invoked again with the same arguments.
+  unsigned MemoizeMacroExpansions : 1;
+
   /// The implicit PCH included at the start of the translation unit, or empty.
   std::string ImplicitPCHInclude;
 
@@ -65,6 +69,31 @@ public:
   /// precompiled headers.
   bool DisablePCHValidation;
 
+  /// \brief When true, the input files of a precompiled header are validated
+  /// when a source location in them is first needed, rather than all at once
+  /// when the precompiled header is loaded.
+  bool LazyPCHInputValidation;
+
+  /// \brief The time in seconds since the epoch when the current build
+  /// session started, or zero.
+  ///
+  /// With \c LazyPCHInputValidation, the input files of a precompiled header
+  /// that were not used are checked at the end of the translation unit. A
+  /// successful check is recorded next to the precompiled header, and later
+  /// translation units in the same build session skip it, since input files
+  /// are assumed not to change during a build session.
+  uint64_t BuildSessionTimestamp;
+
+  /// \brief When true, AST files record a signature of the contents of their
+  /// input files, and an input file whose modification time changed is still
+  /// accepted if its contents did not.
+  bool ValidateASTInputFilesContent;
+
+  /// \brief The number of threads that write the independent parts of AST
+  /// files, or 0 for one per hardware thread.  The AST file is the same
+  /// however many threads write it.
+  unsigned ASTWriteJobs;
+
   /// \brief When true, a PCH with compiler errors will not be rejected.
   bool AllowPCHWithCompilerErrors;
 
@@ -89,6 +118,11 @@ public:
   /// If given, a PTH cache file to use for speeding up header parsing.
   std::string TokenCache;
 
+  /// \brief If given, a directory of cached tokens of individual headers,
+  /// which is used for any system header whose contents match an entry, and
+  /// to which entries are added for the headers that were missing.
+  std::string HeaderTokenCachePath;
+
   /// \brief True if the SourceManager should report the original file name for
   /// contents of files that were remapped to other files. Defaults to true.
   bool RemappedFilesKeepOriginalName;
@@ -176,7 +210,12 @@ public:
   
 public:
   PreprocessorOptions() : UsePredefines(true), DetailedRecord(false),
+                          MemoizeMacroExpansions(false),
                           DisablePCHValidation(false),
+                          LazyPCHInputValidation(false),
+                          BuildSessionTimestamp(0),
+                          ValidateASTInputFilesContent(false),
+                          ASTWriteJobs(1),
                           AllowPCHWithCompilerErrors(false),
                           DumpDeserializedPCHDecls(false),
                           PrecompiledPreambleBytes(0, true),
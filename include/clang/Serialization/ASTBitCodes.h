@@ -45,7 +45,7 @@ namespace clang {
     /// for the previous version could still support reading the new
     /// version by ignoring new kinds of subblocks), this number
     /// should be increased.
-    const unsigned VERSION_MINOR = 0;
+    const unsigned VERSION_MINOR = 2;
 
     /// \brief An ID number that refers to an identifier in an AST file.
     /// 
@@ -538,7 +538,15 @@ namespace clang {
       UNDEFINED_BUT_USED = 49,
 
       /// \brief Record code for late parsed template functions.
-      LATE_PARSED_TEMPLATE = 50
+      LATE_PARSED_TEMPLATE = 50,
+
+      /// \brief Record code for the Bloom filter of the identifiers in the
+      /// identifier table.
+      ///
+      /// The filter is consulted before the identifier table is searched, so
+      /// that most lookups of identifiers that are not in this AST file do
+      /// not touch the table at all.
+      IDENTIFIER_BLOOM_FILTER = 51
     };
 
     /// \brief Record types used within a source manager block.
@@ -175,10 +175,23 @@ public:
   virtual bool needsInputFileVisitation() { return false; }
 
   /// \brief if \c needsInputFileVisitation returns true, this is called for each
-  /// input file of the AST file.
+  /// input file of the AST file, with the size and modification time the file
+  /// had when the AST file was written.
   ///
   /// \returns true to continue receiving the next input file, false to stop.
-  virtual bool visitInputFile(StringRef Filename, bool isSystem) { return true;}
+  virtual bool visitInputFile(StringRef Filename, bool isSystem,
+                              bool isOverridden, off_t Size, time_t ModTime) {
+    return true;
+  }
+
+  /// \brief Returns true if this \c ASTReaderListener wants to receive the
+  /// AST files imported by the AST file via \c visitImport, false otherwise.
+  virtual bool needsImportVisitation() { return false; }
+
+  /// \brief If \c needsImportVisitation returns true, this is called for each
+  /// AST file imported by the AST file, with the size and modification time
+  /// the imported file had when the AST file was written.
+  virtual void visitImport(StringRef Filename, off_t Size, time_t ModTime) {}
 };
 
 /// \brief ASTReaderListener implementation to validate the information of
@@ -779,6 +792,10 @@ private:
   /// \brief The number of lookups into identifier tables that succeed.
   unsigned NumIdentifierLookupHits;
 
+  /// \brief The number of lookups into identifier tables that were avoided
+  /// because the identifier was not in the table's Bloom filter.
+  unsigned NumIdentifierLookupsFiltered;
+
   /// \brief The number of selectors that have been read.
   unsigned NumSelectorsRead;
 
@@ -813,6 +830,18 @@ private:
   /// Total size of modules, in bits, currently loaded
   uint64_t TotalModulesSizeInBits;
 
+  /// \brief The number of module files read ahead of time by
+  /// prefetchImportedModuleFiles().
+  unsigned NumModuleFilesPrefetched;
+
+  /// \brief The number of input files whose size and modification time
+  /// were checked.
+  unsigned NumInputFilesValidated;
+
+  /// \brief The number of input files whose modification time changed, but
+  /// whose contents still matched their signature.
+  unsigned NumInputFilesMatchedBySignature;
+
   /// \brief Number of Decl/types that are currently deserializing.
   unsigned NumCurrentElementsDeserializing;
 
@@ -958,6 +987,10 @@ private:
   serialization::InputFile getInputFile(ModuleFile &F, unsigned ID,
                                         bool Complain = true);
 
+  /// \brief Determine whether the current contents of an input file have
+  /// the given signature.
+  bool inputFileMatchesSignature(const FileEntry *File, uint64_t Signature);
+
   /// \brief Get a FileEntry out of stored-in-PCH filename, making sure we take
   /// into account all the necessary relocations.
   const FileEntry *getFileEntry(StringRef filename);
@@ -983,6 +1016,7 @@ private:
   ASTReadResult ReadControlBlock(ModuleFile &F,
                                  SmallVectorImpl<ImportedModule> &Loaded,
                                  unsigned ClientLoadCapabilities);
+  void prefetchImportedModuleFiles(const RecordData &Imports);
   bool ReadASTBlock(ModuleFile &F);
   bool ParseLineTable(ModuleFile &F, SmallVectorImpl<uint64_t> &Record);
   bool ReadSourceManagerBlock(ModuleFile &F);
@@ -1256,6 +1290,11 @@ public:
     ModuleMgr.addInMemoryBuffer(FileName, Buffer);
   }
 
+  /// \brief Validate the user input files of the precompiled headers that
+  /// were validated lazily and have not been used, so that an out-of-date
+  /// file is diagnosed even if nothing was read from it.
+  void validateRemainingInputFiles();
+
   /// \brief Finalizes the AST reader's state before writing an AST file to
   /// disk.
   ///
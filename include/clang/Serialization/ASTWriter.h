@@ -425,10 +425,25 @@ private:
   void WriteInputFiles(SourceManager &SourceMgr,
                        HeaderSearchOptions &HSOpts,
                        StringRef isysroot,
-                       bool Modules);
+                       bool Modules,
+                       bool ContentSignatures,
+                       unsigned NumJobs);
+
+  /// \brief The contents of the source manager block, written into a buffer
+  /// of their own.  Defined in ASTWriter.cpp.
+  struct SourceManagerBlockContents;
+
+  /// \brief The blocks that are written concurrently once all declarations
+  /// and types have been written.  Defined in ASTWriter.cpp.
+  struct ConcurrentBlocks;
+
+  static void WriteConcurrentBlock(void *Blocks, unsigned Index);
+  void WriteSourceManagerContents(SourceManager &SourceMgr,
+                                  const Preprocessor &PP,
+                                  SourceManagerBlockContents &Contents) const;
   void WriteSourceManagerBlock(SourceManager &SourceMgr,
-                               const Preprocessor &PP,
-                               StringRef isysroot);
+                               StringRef isysroot,
+                               SourceManagerBlockContents &Contents);
   void WritePreprocessor(const Preprocessor &PP, bool IsModule);
   void WriteHeaderSearch(const HeaderSearch &HS, StringRef isysroot);
   void WritePreprocessorDetail(PreprocessingRecord &PPRec);
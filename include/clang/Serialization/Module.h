@@ -177,6 +177,10 @@ public:
   /// \brief The input files that have been loaded from this AST file.
   std::vector<InputFile> InputFilesLoaded;
 
+  /// \brief The number of user input files, which come before the system
+  /// input files.
+  unsigned NumUserInputFiles;
+
   // === Source Locations ===
 
   /// \brief Cursor used to read source location entries.
@@ -229,6 +233,17 @@ public:
   /// IdentifierHashTable.
   void *IdentifierLookupTable;
 
+  /// \brief The Bloom filter of the identifiers in the identifier table, or
+  /// NULL if this AST file has none.
+  const unsigned char *IdentifierBloomFilter;
+
+  /// \brief The number of bits in the identifier Bloom filter.
+  unsigned IdentifierBloomFilterBits;
+
+  /// \brief The number of bits set for each identifier in the identifier
+  /// Bloom filter.
+  unsigned IdentifierBloomFilterHashes;
+
   // === Macros ===
 
   /// \brief The cursor to the start of the preprocessor block, which stores
@@ -42,6 +42,13 @@ class ModuleManager {
   /// \brief A lookup of in-memory (virtual file) buffers
   llvm::DenseMap<const FileEntry *, llvm::MemoryBuffer *> InMemoryBuffers;
 
+  /// \brief The contents of module files that were read ahead of time, but
+  /// have not been loaded yet.  These buffers are owned by the module manager.
+  llvm::DenseMap<const FileEntry *, llvm::MemoryBuffer *> PrefetchedBuffers;
+
+  /// \brief The number of modules loaded from prefetched buffers.
+  unsigned NumPrefetchedBuffersUsed;
+
   /// \brief The visitation order.
   SmallVector<ModuleFile *, 4> VisitOrder;
       
@@ -199,6 +206,23 @@ public:
   /// \brief Add an in-memory buffer the list of known buffers
   void addInMemoryBuffer(StringRef FileName, llvm::MemoryBuffer *Buffer);
 
+  /// \brief Determine whether the given module file has been loaded, or its
+  /// contents are already available in memory.
+  bool isKnownModuleFile(const FileEntry *File) const;
+
+  /// \brief Provide the contents of a module file that has been read ahead
+  /// of time, to be used when the module file is loaded.  The module manager
+  /// takes ownership of the buffer.
+  void addPrefetchedBuffer(const FileEntry *File, llvm::MemoryBuffer *Buffer);
+
+  /// \brief Free the prefetched buffers that were not used.
+  void clearPrefetchedBuffers();
+
+  /// \brief The number of modules that were loaded from prefetched buffers.
+  unsigned getNumPrefetchedBuffersUsed() const {
+    return NumPrefetchedBuffersUsed;
+  }
+
   /// \brief Set the global module index.
   void setGlobalIndex(GlobalModuleIndex *Index);
 
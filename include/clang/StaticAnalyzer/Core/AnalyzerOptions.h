@@ -131,6 +131,10 @@ public:
   AnalysisPurgeMode AnalysisPurgeOpt;
   
   std::string AnalyzeSpecificFunction;
+
+  /// \brief The directory of the on-disk cache of functions whose analysis
+  /// produced no reports, or empty if no such cache is used.
+  std::string ResultsCachePath;
   
   /// \brief The maximum number of times the analyzer visits a block.
   unsigned maxBlockVisitOnPath;
@@ -238,6 +242,18 @@ private:
   /// \sa getMaxNodesPerTopLevelFunction
   Optional<unsigned> MaxNodesPerTopLevelFunction;
 
+  /// \sa getNumWorkerProcesses
+  Optional<unsigned> NumWorkerProcesses;
+
+  /// \sa getGraphMemoryBudget
+  Optional<unsigned> GraphMemoryBudget;
+
+  /// \sa getMinSummarizedFunctionSize
+  Optional<unsigned> MinSummarizedFunctionSize;
+
+  /// \sa getMaxSummaryReturnValues
+  Optional<unsigned> MaxSummaryReturnValues;
+
 public:
   /// Interprets an option's string value as a boolean.
   ///
@@ -395,6 +411,49 @@ public:
   /// This is controlled by the 'max-nodes' config option.
   unsigned getMaxNodesPerTopLevelFunction();
 
+  /// Returns the number of megabytes the exploded graph of a top level
+  /// function may use; 0 (the default) means no limit.
+  ///
+  /// Once half of the budget is in use, the analyzer reclaims nodes that
+  /// are only needed for precise path diagnostics. Once all of it is in use,
+  /// the analysis of the function stops, as if it had reached 'max-nodes'.
+  ///
+  /// This is controlled by the 'graph-memory-budget' config option.
+  unsigned getGraphMemoryBudget();
+
+  /// Returns the number of processes used to analyze the top-level functions
+  /// of a translation unit when inlining is enabled. 1 is default; 0 means
+  /// one per hardware thread.
+  ///
+  /// With more than one process, the top-level functions are split into
+  /// groups whose analyses cannot affect each other, and forked worker
+  /// processes analyze the groups. Each function is analyzed once, and the
+  /// reports are the same as with a single process.
+  ///
+  /// This is controlled by the 'worker-processes' config option.
+  unsigned getNumWorkerProcesses();
+
+  /// Returns the number of basic blocks a callee must have before calls to
+  /// it are evaluated from its function summary instead of being inlined.
+  /// 0 (the default) disables function summaries.
+  ///
+  /// Summaries are only used for callees that cannot change the caller's
+  /// state other than through their return value. Such calls keep all of the
+  /// caller's bindings, but lose any relation between the arguments and the
+  /// return value. Summarized callees are still analyzed as top level
+  /// functions.
+  ///
+  /// This is controlled by the 'summary-min-size' config option.
+  unsigned getMinSummarizedFunctionSize();
+
+  /// Returns the maximum number of distinct integer constants a function
+  /// summary records as possible return values. A call evaluated from such a
+  /// summary splits the path once per value; otherwise its return value is
+  /// unknown. 4 is default; 0 means return values are never recorded.
+  ///
+  /// This is controlled by the 'summary-max-return-values' config option.
+  unsigned getMaxSummaryReturnValues();
+
 public:
   AnalyzerOptions() :
     AnalysisStoreOpt(RegionStoreModel),
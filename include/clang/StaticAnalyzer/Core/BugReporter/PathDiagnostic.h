@@ -125,6 +125,8 @@ typedef llvm::PointerUnion<const LocationContext*, AnalysisDeclContext*>
                                                    LocationOrAnalysisDeclContext;
 
 class PathDiagnosticLocation {
+  friend class PathDiagnostic;
+
 private:
   enum Kind { RangeK, SingleLocK, StmtK, DeclK } K;
   const Stmt *S;
@@ -540,6 +542,8 @@ public:
 };
 
 class PathDiagnosticCallPiece : public PathDiagnosticPiece {
+  friend class PathDiagnostic;
+
   PathDiagnosticCallPiece(const Decl *callerD,
                           const PathDiagnosticLocation &callReturnPos)
     : PathDiagnosticPiece(Call), Caller(callerD), Callee(0),
@@ -725,6 +729,14 @@ class PathDiagnostic : public llvm::FoldingSetNode {
   const Decl *UniqueingDecl;
 
   PathDiagnostic() LLVM_DELETED_FUNCTION;
+
+  static void serializeLocation(raw_ostream &OS,
+                                const PathDiagnosticLocation &L);
+  static bool deserializeLocation(StringRef &Data, const SourceManager &SM,
+                                  PathDiagnosticLocation &L);
+  static void serializePieces(raw_ostream &OS, const PathPieces &Pieces);
+  static bool deserializePieces(StringRef &Data, const SourceManager &SM,
+                                PathPieces &Pieces);
 public:
   PathDiagnostic(const Decl *DeclWithIssue, StringRef bugtype,
                  StringRef verboseDesc, StringRef shortDesc,
@@ -829,6 +841,19 @@ public:
   /// Two diagnostics with the same issue along different paths will generate
   /// different profiles.
   void FullProfile(llvm::FoldingSetNodeID &ID) const;
+
+  /// \brief Writes the diagnostic, with flattened locations, to \p OS.
+  ///
+  /// Declarations and piece tags are written as pointers, so the diagnostic
+  /// can only be read back by a process sharing this one's AST, such as the
+  /// parent of a forked analyzer worker process.
+  void serialize(raw_ostream &OS) const;
+
+  /// \brief Reads a diagnostic written by serialize() from the start of
+  /// \p Data, and advances \p Data past it.
+  ///
+  /// \returns the new diagnostic, or null if \p Data is malformed.
+  static PathDiagnostic *deserialize(StringRef &Data, const SourceManager &SM);
 };  
 
 } // end GR namespace
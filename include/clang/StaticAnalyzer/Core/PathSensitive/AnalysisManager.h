@@ -98,6 +98,13 @@ public:
 
   void FlushDiagnostics();
 
+  /// \brief Hand bug reports to \p Consumers instead of the current
+  /// PathDiagnosticConsumers, without flushing those. Used by analyzer worker
+  /// processes, which pass their reports on to the parent process.
+  void setPathDiagnosticConsumers(const PathDiagnosticConsumers &Consumers) {
+    PathConsumers = Consumers;
+  }
+
   bool shouldVisualize() const {
     return options.visualizeExplodedGraphWithGraphViz ||
            options.visualizeExplodedGraphWithUbiGraph;
@@ -84,6 +84,15 @@ private:
   /// (This data is owned by AnalysisConsumer.)
   FunctionSummariesTy *FunctionSummaries;
 
+  /// The number of bytes the exploded graph may use, or 0 for no limit.
+  uint64_t GraphMemoryBudget;
+
+  /// Check the graph's memory usage against the budget, making node
+  /// reclamation more aggressive as the budget is approached.
+  ///
+  /// \returns false if the budget has been exceeded.
+  bool checkGraphMemoryBudget();
+
   void generateNode(const ProgramPoint &Loc,
                     ProgramStateRef State,
                     ExplodedNode *Pred);
@@ -113,7 +122,12 @@ public:
     : SubEng(subengine), G(new ExplodedGraph()),
       WList(WorkList::makeDFS()),
       BCounterFactory(G->getAllocator()),
-      FunctionSummaries(FS){}
+      FunctionSummaries(FS), GraphMemoryBudget(0) {}
+
+  /// Limit the memory used by the exploded graph to \p Bytes; 0 means no
+  /// limit. Once half of the budget is used, nodes are reclaimed more
+  /// aggressively; once all of it is used, the analysis stops.
+  void setGraphMemoryBudget(uint64_t Bytes) { GraphMemoryBudget = Bytes; }
 
   /// getGraph - Returns the exploded graph.
   ExplodedGraph& getGraph() { return *G.get(); }
@@ -287,6 +287,16 @@ protected:
   /// Counter to determine when to reclaim nodes.
   unsigned ReclaimCounter;
 
+  /// Whether to also reclaim nodes that are only kept to make path
+  /// diagnostics more precise.
+  bool AggressiveReclamation;
+
+  /// The largest number of nodes the graph has had at any one time.
+  unsigned PeakNumNodes;
+
+  /// The number of nodes reclaimed so far.
+  unsigned NumReclaimedNodes;
+
 public:
 
   /// \brief Retrieve the node associated with a (Location,State) pair,
@@ -323,6 +333,13 @@ public:
   bool empty() const { return NumNodes == 0; }
   unsigned size() const { return NumNodes; }
 
+  unsigned getPeakNumNodes() const { return PeakNumNodes; }
+  unsigned getNumReclaimedNodes() const { return NumReclaimedNodes; }
+
+  /// Returns the number of bytes allocated for the graph's nodes, and for
+  /// the program states allocated along with them.
+  size_t getMemoryUsage() { return getAllocator().getTotalMemory(); }
+
   // Iterators.
   typedef ExplodedNode                        NodeTy;
   typedef llvm::FoldingSet<ExplodedNode>      AllNodesTy;
@@ -382,6 +399,11 @@ public:
     ReclaimCounter = ReclaimNodeInterval = Interval;
   }
 
+  /// Also reclaim nodes that are only kept around to make path diagnostics
+  /// more precise, such as the nodes for lvalue expressions. This is used to
+  /// keep analyses that are running out of memory going.
+  void enableAggressiveReclamation() { AggressiveReclamation = true; }
+
   /// Reclaim "uninteresting" nodes created since the last time this method
   /// was called.
   void reclaimRecentlyAllocatedNodes();
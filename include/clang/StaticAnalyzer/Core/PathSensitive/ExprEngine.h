@@ -553,6 +553,13 @@ private:
   bool inlineCall(const CallEvent &Call, const Decl *D, NodeBuilder &Bldr,
                   ExplodedNode *Pred, ProgramStateRef State);
 
+  /// \brief Evaluate the call from the function summary of \p D instead of
+  /// inlining it, if the summary shows the callee has no side effects.
+  /// Returns false if no summary applies.
+  bool evalCallFromSummary(const CallEvent &Call, const Decl *D,
+                           NodeBuilder &Bldr, ExplodedNode *Pred,
+                           ProgramStateRef State);
+
   /// \brief Conservatively evaluate call by invalidating regions and binding
   /// a conjured return value.
   void conservativeEvalCall(const CallEvent &Call, NodeBuilder &Bldr,
@@ -15,14 +15,19 @@
 #define LLVM_CLANG_GR_FUNCTIONSUMMARY_H
 
 #include "clang/Basic/LLVM.h"
+#include "llvm/ADT/APSInt.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallBitVector.h"
+#include "llvm/ADT/SmallVector.h"
 #include <deque>
 
 namespace clang {
+class CFG;
 class Decl;
+class FunctionDecl;
+class Stmt;
 
 namespace ento {
 typedef std::deque<Decl*> SetOfDecls;
@@ -47,15 +52,39 @@ class FunctionSummariesTy {
     /// The number of times the function has been inlined.
     unsigned TimesInlined : 32;
 
+    /// True if this function has been checked for side effects.
+    unsigned EffectsChecked : 1;
+
+    /// True if calling this function cannot change any state visible to
+    /// its caller.
+    unsigned HasNoSideEffects : 1;
+
+    /// True if the constant return values of this function have been
+    /// computed.
+    unsigned ReturnValuesChecked : 1;
+
+    /// True if every path through this function returns one of
+    /// \c ReturnValues.
+    unsigned ReturnValuesKnown : 1;
+
+    /// The distinct integer constants this function may return.
+    SmallVector<llvm::APSInt, 4> ReturnValues;
+
     FunctionSummary() :
       TotalBasicBlocks(0),
       InlineChecked(0),
-      TimesInlined(0) {}
+      TimesInlined(0),
+      EffectsChecked(0),
+      HasNoSideEffects(0),
+      ReturnValuesChecked(0),
+      ReturnValuesKnown(0) {}
   };
 
   typedef llvm::DenseMap<const Decl *, FunctionSummary> MapTy;
   MapTy Map;
 
+  bool mayHaveSideEffects(const Stmt *S);
+
 public:
   MapTy::iterator findOrInsertSummary(const Decl *D) {
     MapTy::iterator I = Map.find(D);
@@ -133,6 +162,22 @@ public:
   unsigned getTotalNumBasicBlocks();
   unsigned getTotalNumVisitedBasicBlocks();
 
+  /// Returns true if calling \p FD cannot change any state visible to the
+  /// caller, other than by producing a return value.
+  ///
+  /// This is a syntactic check, done once per function: the body of \p FD,
+  /// and of every function it calls, may only write to its own local
+  /// variables, and may not allocate, throw, or call through function
+  /// pointers or virtual methods.
+  bool hasNoSideEffects(const FunctionDecl *FD);
+
+  /// If every path through \p FD ends in a return statement whose value is
+  /// an integer constant, and there are at most \p MaxValues distinct
+  /// constants, stores them in \p Values and returns true.
+  bool getConstantReturnValues(const FunctionDecl *FD, const CFG &Cfg,
+                               unsigned MaxValues,
+                               SmallVectorImpl<llvm::APSInt> &Values);
+
 };
 
 }} // end clang ento namespaces
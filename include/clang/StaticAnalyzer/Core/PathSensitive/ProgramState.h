@@ -466,6 +466,9 @@ private:
   /// A vector of ProgramStates that we can reuse.
   std::vector<ProgramState *> freeStates;
 
+  /// The largest number of states alive at any one time.
+  unsigned PeakNumStates;
+
 public:
   ProgramStateManager(ASTContext &Ctx,
                  StoreManagerCreator CreateStoreManager,
@@ -497,6 +500,12 @@ public:
 
   llvm::BumpPtrAllocator& getAllocator() { return Alloc; }
 
+  /// Returns the number of states currently alive.
+  unsigned getNumStates() const { return StateSet.size(); }
+
+  /// Returns the largest number of states alive at any one time.
+  unsigned getPeakNumStates() const { return PeakNumStates; }
+
   MemRegionManager& getRegionManager() {
     return svalBuilder->getRegionManager();
   }
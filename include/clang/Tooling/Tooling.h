@@ -31,6 +31,7 @@
 #define LLVM_CLANG_TOOLING_TOOLING_H
 
 #include "clang/Basic/FileManager.h"
+#include "clang/Basic/FileSystemStatCache.h"
 #include "clang/Basic/LLVM.h"
 #include "clang/Driver/Util.h"
 #include "clang/Frontend/FrontendAction.h"
@@ -48,6 +49,7 @@ class Compilation;
 } // end namespace driver
 
 class CompilerInvocation;
+class DiagnosticConsumer;
 class SourceManager;
 class FrontendAction;
 
@@ -154,6 +156,15 @@ class ToolInvocation {
   /// \param Content A null terminated buffer of the file's content.
   void mapVirtualFile(StringRef FilePath, StringRef Content);
 
+  /// \brief Set a \c DiagnosticConsumer to use during driver command-line
+  /// parsing and the action invocation itself.
+  ///
+  /// By default, diagnostics are printed to \c llvm::errs(). The consumer is
+  /// not owned by the invocation and must outlive the call to \c run().
+  void setDiagnosticConsumer(DiagnosticConsumer *DiagConsumer) {
+    this->DiagConsumer = DiagConsumer;
+  }
+
   /// \brief Run the clang invocation.
   ///
   /// \returns True if there were no errors during execution.
@@ -171,6 +182,7 @@ class ToolInvocation {
   FileManager *Files;
   // Maps <file name> -> <file content>.
   llvm::StringMap<StringRef> MappedFileContents;
+  DiagnosticConsumer *DiagConsumer;
 };
 
 /// \brief Utility to run a FrontendAction over a set of files.
@@ -216,6 +228,23 @@ class ClangTool {
   /// \brief Clear the command line arguments adjuster chain.
   void clearArgumentsAdjusters();
 
+  /// \brief Set the number of translation units processed concurrently by
+  /// \c run().
+  ///
+  /// With more than one thread, every translation unit gets its own
+  /// \c FileManager, relative paths are resolved against the compile
+  /// command's directory through \c -working-directory instead of changing
+  /// the process' working directory, and each translation unit's diagnostics
+  /// are buffered and printed in the order of the compile commands. The
+  /// \c FrontendActionFactory and the actions it creates must then be safe to
+  /// use from several threads; calls to \c FrontendActionFactory::create()
+  /// are serialized.
+  ///
+  /// \param NumThreads The number of threads to use; 0 means one per
+  /// hardware thread. Defaults to 1, which processes the translation units
+  /// serially on the calling thread.
+  void setNumThreads(unsigned NumThreads) { this->NumThreads = NumThreads; }
+
   /// Runs a frontend action over all files specified in the command line.
   ///
   /// \param ActionFactory Factory generating the frontend actions. The function
@@ -225,18 +254,33 @@ class ClangTool {
 
   /// \brief Returns the file manager used in the tool.
   ///
-  /// The file manager is shared between all translation units.
+  /// The file manager is shared between all translation units when they are
+  /// processed serially; it is not used by parallel runs.
   FileManager &getFiles() { return Files; }
 
+  /// \brief Returns the cache of 'stat' results and file contents shared by
+  /// the file managers of all translation units.
+  ///
+  /// The cache is cleared at the start of every \c run().
+  SharedFileSystemCache &getSharedFileSystemCache() { return *SharedCache; }
+
  private:
+  std::vector<std::string> getAdjustedCommandLine(unsigned Index,
+                                                  StringRef MainExecutable);
+  int runInParallel(FrontendActionFactory *ActionFactory,
+                    StringRef MainExecutable);
+
   // We store compile commands as pair (file name, compile command).
   std::vector< std::pair<std::string, CompileCommand> > CompileCommands;
 
   FileManager Files;
+  IntrusiveRefCntPtr<SharedFileSystemCache> SharedCache;
   // Contains a list of pairs (<file name>, <file content>).
   std::vector< std::pair<StringRef, StringRef> > MappedFileContents;
 
   SmallVector<ArgumentsAdjuster *, 2> ArgsAdjusters;
+
+  unsigned NumThreads;
 };
 
 template <typename T>
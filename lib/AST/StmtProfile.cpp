@@ -20,6 +20,7 @@
 #include "clang/AST/ExprObjC.h"
 #include "clang/AST/StmtVisitor.h"
 #include "llvm/ADT/FoldingSet.h"
+#include "llvm/Support/raw_ostream.h"
 using namespace clang;
 
 namespace {
@@ -28,10 +29,14 @@ namespace {
     const ASTContext &Context;
     bool Canonical;
 
+    /// \brief Whether to identify declarations, types and names by their
+    /// spelling rather than by their address.
+    bool Stable;
+
   public:
     StmtProfiler(llvm::FoldingSetNodeID &ID, const ASTContext &Context,
-                 bool Canonical)
-      : ID(ID), Context(Context), Canonical(Canonical) { }
+                 bool Canonical, bool Stable = false)
+      : ID(ID), Context(Context), Canonical(Canonical), Stable(Stable) { }
 
     void VisitStmt(const Stmt *S);
 
@@ -49,6 +54,10 @@ namespace {
     /// \brief Visit a name that occurs within an expression or statement.
     void VisitName(DeclarationName Name);
 
+    /// \brief Visit an identifier that occurs within an expression or
+    /// statement.
+    void VisitIdentifier(const IdentifierInfo *II);
+
     /// \brief Visit a nested-name-specifier that occurs within an expression
     /// or statement.
     void VisitNestedNameSpecifier(NestedNameSpecifier *NNS);
@@ -363,7 +372,7 @@ void StmtProfiler::VisitOffsetOfExpr(const OffsetOfExpr *S) {
       break;
 
     case OffsetOfExpr::OffsetOfNode::Identifier:
-      ID.AddPointer(ON.getFieldName());
+      VisitIdentifier(ON.getFieldName());
       break;
         
     case OffsetOfExpr::OffsetOfNode::Base:
@@ -920,7 +929,7 @@ StmtProfiler::VisitCXXPseudoDestructorExpr(const CXXPseudoDestructorExpr *S) {
   if (S->getDestroyedTypeInfo())
     VisitType(S->getDestroyedType());
   else
-    ID.AddPointer(S->getDestroyedTypeIdentifier());
+    VisitIdentifier(S->getDestroyedTypeIdentifier());
 }
 
 void StmtProfiler::VisitOverloadExpr(const OverloadExpr *S) {
@@ -1190,6 +1199,14 @@ void StmtProfiler::VisitDecl(const Decl *D) {
     }
   }
 
+  if (Stable && D) {
+    if (const NamedDecl *ND = dyn_cast<NamedDecl>(D))
+      ID.AddString(ND->getQualifiedNameAsString());
+    if (const ValueDecl *VD = dyn_cast<ValueDecl>(D))
+      VisitType(VD->getType());
+    return;
+  }
+
   ID.AddPointer(D? D->getCanonicalDecl() : 0);
 }
 
@@ -1197,16 +1214,46 @@ void StmtProfiler::VisitType(QualType T) {
   if (Canonical)
     T = Context.getCanonicalType(T);
 
+  if (Stable) {
+    ID.AddString(T.getAsString());
+    return;
+  }
+
   ID.AddPointer(T.getAsOpaquePtr());
 }
 
 void StmtProfiler::VisitName(DeclarationName Name) {
+  if (Stable) {
+    ID.AddString(Name.getAsString());
+    return;
+  }
+
   ID.AddPointer(Name.getAsOpaquePtr());
 }
 
+void StmtProfiler::VisitIdentifier(const IdentifierInfo *II) {
+  if (Stable) {
+    ID.AddString(II ? II->getName() : StringRef());
+    return;
+  }
+
+  ID.AddPointer(II);
+}
+
 void StmtProfiler::VisitNestedNameSpecifier(NestedNameSpecifier *NNS) {
   if (Canonical)
     NNS = Context.getCanonicalNestedNameSpecifier(NNS);
+
+  if (Stable) {
+    std::string Str;
+    if (NNS) {
+      llvm::raw_string_ostream OS(Str);
+      NNS->print(OS, Context.getPrintingPolicy());
+    }
+    ID.AddString(Str);
+    return;
+  }
+
   ID.AddPointer(NNS);
 }
 
@@ -1214,6 +1261,14 @@ void StmtProfiler::VisitTemplateName(TemplateName Name) {
   if (Canonical)
     Name = Context.getCanonicalTemplateName(Name);
 
+  if (Stable) {
+    std::string Str;
+    llvm::raw_string_ostream OS(Str);
+    Name.print(OS, Context.getPrintingPolicy());
+    ID.AddString(OS.str());
+    return;
+  }
+
   Name.Profile(ID);
 }
 
@@ -1270,3 +1325,9 @@ void Stmt::Profile(llvm::FoldingSetNodeID &ID, const ASTContext &Context,
   StmtProfiler Profiler(ID, Context, Canonical);
   Profiler.Visit(this);
 }
+
+void Stmt::ProfileStable(llvm::FoldingSetNodeID &ID,
+                         const ASTContext &Context) const {
+  StmtProfiler Profiler(ID, Context, /*Canonical=*/true, /*Stable=*/true);
+  Profiler.Visit(this);
+}
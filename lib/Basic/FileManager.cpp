@@ -19,6 +19,7 @@
 
 #include "clang/Basic/FileManager.h"
 #include "clang/Basic/FileSystemStatCache.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/Config/llvm-config.h"
 #include "llvm/Support/FileSystem.h"
@@ -29,6 +30,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 // FIXME: This is terrible, we need this for ::close.
 #if !defined(_MSC_VER) && !defined(__MINGW32__)
@@ -108,6 +110,7 @@ FileManager::FileManager(const FileSystemOptions &FSO)
     SeenDirEntries(64), SeenFileEntries(64), NextFileUID(0) {
   NumDirLookups = NumFileLookups = 0;
   NumDirCacheMisses = NumFileCacheMisses = 0;
+  NumDirListings = NumFilesPrunedByListings = 0;
 }
 
 FileManager::~FileManager() {
@@ -117,6 +120,7 @@ FileManager::~FileManager() {
     delete VirtualFileEntries[i];
   for (unsigned i = 0, e = VirtualDirectoryEntries.size(); i != e; ++i)
     delete VirtualDirectoryEntries[i];
+  invalidateDirectoryListings();
 }
 
 void FileManager::addStatCache(FileSystemStatCache *statCache,
@@ -156,6 +160,11 @@ void FileManager::removeStatCache(FileSystemStatCache *statCache) {
 
 void FileManager::clearStatCaches() {
   StatCache.reset(0);
+  invalidateDirectoryListings();
+}
+
+void FileManager::setSharedCache(SharedFileSystemCache *Cache) {
+  SharedCache = Cache;
 }
 
 /// \brief Retrieve the directory that the given file name resides in.
@@ -245,7 +254,8 @@ const DirectoryEntry *FileManager::getDirectory(StringRef DirName,
 
   // Check to see if the directory exists.
   FileData Data;
-  if (getStatValue(InterndDirName, Data, false, 0 /*directory lookup*/)) {
+  if (getStatValue(InterndDirName, Data, false, 0 /*directory lookup*/,
+                   CacheFailure)) {
     // There's no real directory at the given path.
     if (!CacheFailure)
       SeenDirEntries.erase(DirName);
@@ -312,7 +322,7 @@ const FileEntry *FileManager::getFile(StringRef Filename, bool openFile,
   int FileDescriptor = -1;
   FileData Data;
   if (getStatValue(InterndFileName, Data, true,
-                   openFile ? &FileDescriptor : 0)) {
+                   openFile ? &FileDescriptor : 0, CacheFailure)) {
     // There's no real file at the given path.
     if (!CacheFailure)
       SeenFileEntries.erase(Filename);
@@ -456,6 +466,15 @@ getBufferForFile(const FileEntry *Entry, std::string *ErrorStr,
 
   // Otherwise, open the file.
 
+  if (SharedCache && !isVolatile) {
+    SmallString<128> FilePath(Entry->getName());
+    FixupRelativePath(FilePath);
+    return SharedCache->getBufferForFile(FilePath.c_str(),
+                                         Entry->getUniqueID(), FileSize,
+                                         Entry->getModificationTime(),
+                                         ErrorStr);
+  }
+
   if (FileSystemOpts.WorkingDir.empty()) {
     ec = llvm::MemoryBuffer::getFile(Filename, Result, FileSize);
     if (ec && ErrorStr)
@@ -475,6 +494,21 @@ llvm::MemoryBuffer *FileManager::
 getBufferForFile(StringRef Filename, std::string *ErrorStr) {
   OwningPtr<llvm::MemoryBuffer> Result;
   llvm::error_code ec;
+
+  // Callers of this overload (such as the AST reader) don't have a FileEntry
+  // to vouch for the file's size, so stat it afresh before consulting the
+  // shared cache.
+  if (SharedCache) {
+    SmallString<128> FilePath(Filename);
+    FixupRelativePath(FilePath);
+    llvm::sys::fs::file_status Status;
+    if (!llvm::sys::fs::status(FilePath.c_str(), Status) &&
+        llvm::sys::fs::is_regular_file(Status))
+      return SharedCache->getBufferForFile(
+          FilePath.c_str(), Status.getUniqueID(), Status.getSize(),
+          Status.getLastModificationTime().toEpochTime(), ErrorStr);
+  }
+
   if (FileSystemOpts.WorkingDir.empty()) {
     ec = llvm::MemoryBuffer::getFile(Filename, Result);
     if (ec && ErrorStr)
@@ -494,20 +528,24 @@ getBufferForFile(StringRef Filename, std::string *ErrorStr) {
 /// using the cache to accelerate it if possible.  This returns true
 /// if the path points to a virtual file or does not exist, or returns
 /// false if it's an existent real file.  If FileDescriptor is NULL,
-/// do directory look-up instead of file look-up.
+/// do directory look-up instead of file look-up.  If CacheFailure is false,
+/// the shared cache does not remember that the path is missing.
 bool FileManager::getStatValue(const char *Path, FileData &Data, bool isFile,
-                               int *FileDescriptor) {
+                               int *FileDescriptor, bool CacheFailure) {
   // FIXME: FileSystemOpts shouldn't be passed in here, all paths should be
   // absolute!
-  if (FileSystemOpts.WorkingDir.empty())
-    return FileSystemStatCache::get(Path, Data, isFile, FileDescriptor,
-                                    StatCache.get());
-
   SmallString<128> FilePath(Path);
-  FixupRelativePath(FilePath);
+  if (!FileSystemOpts.WorkingDir.empty()) {
+    FixupRelativePath(FilePath);
+    Path = FilePath.c_str();
+  }
 
-  return FileSystemStatCache::get(FilePath.c_str(), Data, isFile,
-                                  FileDescriptor, StatCache.get());
+  // The shared cache never opens files; getBufferForFile() will do that.
+  if (SharedCache && !StatCache)
+    return SharedCache->getStat(Path, Data, isFile, CacheFailure);
+
+  return FileSystemStatCache::get(Path, Data, isFile, FileDescriptor,
+                                  StatCache.get());
 }
 
 bool FileManager::getNoncachedStatValue(StringRef Path,
@@ -518,11 +556,120 @@ bool FileManager::getNoncachedStatValue(StringRef Path,
   return llvm::sys::fs::status(FilePath.c_str(), Result);
 }
 
+/// \brief The number of times a directory is asked about before it is read.
+///
+/// Reading a large directory costs more than a few 'stat' calls, so only
+/// directories that are searched repeatedly are read.
+static const unsigned MinLookupsBeforeListing = 4;
+
+/// \brief Determines whether the directory \p DirName, whose entries are
+/// \p Names, finds files regardless of the case of their names.
+///
+/// One entry is looked up under another case. If no entry has a name with
+/// letters, or the lookup fails for another reason, case is assumed to be
+/// ignored, which only makes listings prune less.
+static bool ignoresCase(StringRef DirName, ArrayRef<std::string> Names) {
+  for (unsigned i = 0, e = Names.size(); i != e; ++i) {
+    StringRef Name = Names[i];
+    std::string OtherName = Name.lower();
+    if (OtherName == Name)
+      OtherName = Name.upper();
+    if (OtherName == Name)
+      continue;
+
+    SmallString<128> Path(DirName), OtherPath(DirName);
+    llvm::sys::path::append(Path, Name);
+    llvm::sys::path::append(OtherPath, OtherName);
+    llvm::sys::fs::file_status Status, OtherStatus;
+    if (llvm::sys::fs::status(Path.str(), Status))
+      continue;
+    if (llvm::sys::fs::status(OtherPath.str(), OtherStatus))
+      return OtherStatus.type() != llvm::sys::fs::file_type::file_not_found;
+    return llvm::sys::fs::equivalent(Status, OtherStatus);
+  }
+  return true;
+}
+
+bool FileManager::mayContainFile(const DirectoryEntry *Dir,
+                                 StringRef Filename) {
+  StringRef Name = *llvm::sys::path::begin(Filename);
+  if (Name.empty() || Name == "." || Name == ".." ||
+      llvm::sys::path::is_absolute(Filename))
+    return true;
+  // Names that are not plain ASCII may be normalized by the file system.
+  for (unsigned i = 0, e = Name.size(); i != e; ++i)
+    if (Name[i] & 0x80)
+      return true;
+
+  DirectoryListing *&Listing = DirListings[Dir];
+  if (!Listing) {
+    Listing = new DirectoryListing();
+    Listing->NumLookups = 0;
+    Listing->Listed = false;
+    Listing->FoldCase = false;
+  }
+
+  if (!Listing->Listed) {
+    if (++Listing->NumLookups < MinLookupsBeforeListing)
+      return true;
+
+    SmallString<128> DirName(Dir->getName());
+    FixupRelativePath(DirName);
+    llvm::error_code EC;
+    std::vector<std::string> Names;
+    for (llvm::sys::fs::directory_iterator I(DirName.str(), EC), E;
+         I != E && !EC; I.increment(EC))
+      Names.push_back(llvm::sys::path::filename(I->path()));
+    // Directories that cannot be read, including virtual ones, are never
+    // pruned; keep counting so that they are not read again right away.
+    if (EC) {
+      Listing->NumLookups = 0;
+      return true;
+    }
+
+    // Whether case matters depends on the file system, not the platform.
+    Listing->FoldCase = ignoresCase(DirName, Names);
+    for (unsigned i = 0, e = Names.size(); i != e; ++i)
+      Listing->Entries.insert(Listing->FoldCase ? StringRef(Names[i]).lower()
+                                                : Names[i]);
+    Listing->Listed = true;
+    ++NumDirListings;
+  }
+
+  if (Listing->Entries.count(Listing->FoldCase ? Name.lower() : Name.str()))
+    return true;
+
+  // Virtual files don't show up in directory listings.
+  StringRef DirName = Dir->getName();
+  for (unsigned i = 0, e = VirtualFileEntries.size(); i != e; ++i)
+    if (StringRef(VirtualFileEntries[i]->getName()).startswith(DirName))
+      return true;
+
+  ++NumFilesPrunedByListings;
+  return false;
+}
+
+void FileManager::invalidateDirectoryListings() {
+  for (llvm::DenseMap<const DirectoryEntry *, DirectoryListing *>::iterator
+           I = DirListings.begin(), E = DirListings.end();
+       I != E; ++I)
+    delete I->second;
+  DirListings.clear();
+}
+
 void FileManager::invalidateCache(const FileEntry *Entry) {
   assert(Entry && "Cannot invalidate a NULL FileEntry");
 
   SeenFileEntries.erase(Entry->getName());
 
+  // The file may have been created since its directory was read.
+  llvm::DenseMap<const DirectoryEntry *, DirectoryListing *>::iterator Listing
+    = DirListings.find(Entry->getDir());
+  if (Listing != DirListings.end()) {
+    delete Listing->second;
+    DirListings.erase(Listing);
+  }
+
   // FileEntry invalidation should not block future optimizations in the file
   // caches. Possible alternatives are cache truncation (invalidate last N) or
   // invalidation of the whole cache.
@@ -590,6 +737,12 @@ void FileManager::PrintStats() const {
                << NumDirCacheMisses << " dir cache misses.\n";
   llvm::errs() << NumFileLookups << " file lookups, "
                << NumFileCacheMisses << " file cache misses.\n";
+  llvm::errs() << NumDirListings << " dirs listed, "
+               << NumFilesPrunedByListings
+               << " file lookups answered by listings.\n";
+
+  if (SharedCache)
+    SharedCache->PrintStats();
 
   //llvm::errs() << PagesMapped << BytesOfPagesMapped << FSLookups;
 }
@@ -12,8 +12,14 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/Basic/FileSystemStatCache.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+#include <cstring>
+#include <ctime>
 
 // FIXME: This is terrible, we need this for ::close.
 #if !defined(_MSC_VER) && !defined(__MINGW32__)
@@ -134,3 +140,217 @@ MemorizeStatCalls::getStat(const char *Path, FileData &Data, bool isFile,
 
   return Result;
 }
+
+SharedFileSystemCache::SharedFileSystemCache()
+  : NumStatHits(0), NumStatMisses(0), NumBufferHits(0), NumBufferMisses(0),
+    NumBytesRetained(0), NumIncludeGuardHits(0), NumIncludeGuardMisses(0) {}
+
+SharedFileSystemCache::~SharedFileSystemCache() {
+  clear();
+}
+
+bool SharedFileSystemCache::getStat(const char *Path, FileData &Data,
+                                    bool isFile, bool CacheFailure) {
+  if (!llvm::sys::path::is_absolute(Path))
+    return FileSystemStatCache::get(Path, Data, isFile, 0, 0);
+
+  StatEntry Entry;
+  bool Found = false;
+  if (CacheFailure) {
+    llvm::sys::ScopedLock L(Lock);
+    llvm::StringMap<StatEntry>::iterator I = StatEntries.find(Path);
+    if (I != StatEntries.end()) {
+      Entry = I->getValue();
+      Found = true;
+      ++NumStatHits;
+    } else {
+      ++NumStatMisses;
+    }
+  }
+
+  // Don't hold the lock across the system call; if another thread races us
+  // to the same path, both compute the same answer.
+  if (!Found) {
+    llvm::sys::fs::file_status Status;
+    Entry.Exists = !llvm::sys::fs::status(Path, Status);
+    if (Entry.Exists)
+      copyStatusToFileData(Status, Entry.Data);
+
+    // A path that the caller expects to appear later must not be remembered
+    // as missing, nor keep an earlier "missing" result.
+    llvm::sys::ScopedLock L(Lock);
+    if (Entry.Exists || CacheFailure)
+      StatEntries[Path] = Entry;
+    else
+      StatEntries.erase(Path);
+  }
+
+  if (!Entry.Exists)
+    return true;
+
+  Data = Entry.Data;
+  // Like FileSystemStatCache::get, fail if the "directoryness" of the path
+  // doesn't match what the client asked for.
+  return Data.IsDirectory == isFile;
+}
+
+llvm::MemoryBuffer *
+SharedFileSystemCache::getBufferForFile(const char *Path,
+                                        const llvm::sys::fs::UniqueID &UniqueID,
+                                        uint64_t Size, time_t ModTime,
+                                        std::string *ErrorStr) {
+  bool Retain = false;
+  if (llvm::sys::path::is_absolute(Path)) {
+    llvm::sys::ScopedLock L(Lock);
+    llvm::StringMap<BufferEntry>::iterator I = BufferEntries.find(Path);
+    if (I != BufferEntries.end()) {
+      BufferEntry &Entry = I->getValue();
+      if (Entry.UniqueID == UniqueID && Entry.Size == Size &&
+          Entry.ModTime == ModTime) {
+        if (Entry.Buffer) {
+          ++NumBufferHits;
+          return llvm::MemoryBuffer::getMemBuffer(
+              Entry.Buffer->getBuffer(), Entry.Buffer->getBufferIdentifier());
+        }
+        // This is the second request for the file; keep it around.
+        Retain = true;
+      } else {
+        // The file changed on disk; start over. The old contents may still
+        // be referenced by clients, so they can only be freed by clear().
+        if (Entry.Buffer)
+          StaleBuffers.push_back(Entry.Buffer);
+        Entry.UniqueID = UniqueID;
+        Entry.Size = Size;
+        Entry.ModTime = ModTime;
+        Entry.NumRequests = 0;
+        Entry.Buffer = 0;
+      }
+      ++Entry.NumRequests;
+    } else {
+      BufferEntry Entry;
+      Entry.UniqueID = UniqueID;
+      Entry.Size = Size;
+      Entry.ModTime = ModTime;
+      Entry.NumRequests = 1;
+      Entry.Buffer = 0;
+      BufferEntries[Path] = Entry;
+    }
+    ++NumBufferMisses;
+  }
+
+  // A file modified in the second it is read could be modified again within
+  // that second, without a change to its size or modification time that
+  // would tell the two versions apart, so don't keep its contents.
+  if (Retain && ModTime >= ::time(0))
+    Retain = false;
+
+  OwningPtr<llvm::MemoryBuffer> Result;
+  llvm::error_code EC = llvm::MemoryBuffer::getFile(Path, Result, Size);
+  if (EC) {
+    if (ErrorStr)
+      *ErrorStr = EC.message();
+    return 0;
+  }
+  if (!Retain)
+    return Result.take();
+
+  llvm::sys::ScopedLock L(Lock);
+  BufferEntry &Entry = BufferEntries[Path];
+  if (Entry.Buffer) {
+    // Another thread got here first; use its copy.
+    return llvm::MemoryBuffer::getMemBuffer(
+        Entry.Buffer->getBuffer(), Entry.Buffer->getBufferIdentifier());
+  }
+  Entry.Buffer = Result.take();
+  NumBytesRetained += Entry.Buffer->getBufferSize();
+  return llvm::MemoryBuffer::getMemBuffer(Entry.Buffer->getBuffer(),
+                                          Entry.Buffer->getBufferIdentifier());
+}
+
+static void hashContents(StringRef Contents, llvm::MD5::MD5Result &Result) {
+  llvm::MD5 Hash;
+  Hash.update(Contents);
+  Hash.final(Result);
+}
+
+void SharedFileSystemCache::setIncludeGuard(
+    const llvm::sys::fs::UniqueID &UniqueID, StringRef Contents,
+    StringRef Macro) {
+  llvm::MD5::MD5Result Hash;
+  hashContents(Contents, Hash);
+
+  llvm::sys::ScopedLock L(Lock);
+  IncludeGuardEntry &Entry = IncludeGuards[UniqueID];
+  Entry.Size = Contents.size();
+  std::memcpy(Entry.Hash, Hash, sizeof(Hash));
+  Entry.Macro = Macro;
+}
+
+bool SharedFileSystemCache::getIncludeGuard(
+    const llvm::sys::fs::UniqueID &UniqueID, uint64_t Size,
+    std::string &Macro) {
+  llvm::sys::ScopedLock L(Lock);
+  std::map<llvm::sys::fs::UniqueID, IncludeGuardEntry>::iterator I =
+      IncludeGuards.find(UniqueID);
+  if (I == IncludeGuards.end() || I->second.Size != Size) {
+    ++NumIncludeGuardMisses;
+    return false;
+  }
+  Macro = I->second.Macro;
+  return true;
+}
+
+bool SharedFileSystemCache::isIncludeGuardCurrent(
+    const llvm::sys::fs::UniqueID &UniqueID, StringRef Contents) {
+  llvm::MD5::MD5Result Hash;
+  hashContents(Contents, Hash);
+
+  llvm::sys::ScopedLock L(Lock);
+  std::map<llvm::sys::fs::UniqueID, IncludeGuardEntry>::iterator I =
+      IncludeGuards.find(UniqueID);
+  if (I == IncludeGuards.end() || I->second.Size != Contents.size() ||
+      std::memcmp(I->second.Hash, Hash, sizeof(Hash)) != 0) {
+    ++NumIncludeGuardMisses;
+    return false;
+  }
+  ++NumIncludeGuardHits;
+  return true;
+}
+
+void SharedFileSystemCache::invalidateStats() {
+  llvm::sys::ScopedLock L(Lock);
+  StatEntries.clear();
+}
+
+void SharedFileSystemCache::clear() {
+  llvm::sys::ScopedLock L(Lock);
+  StatEntries.clear();
+  for (llvm::StringMap<BufferEntry>::iterator I = BufferEntries.begin(),
+                                              E = BufferEntries.end();
+       I != E; ++I)
+    delete I->getValue().Buffer;
+  BufferEntries.clear();
+  llvm::DeleteContainerPointers(StaleBuffers);
+  IncludeGuards.clear();
+  NumBytesRetained = 0;
+}
+
+uint64_t SharedFileSystemCache::getNumBytesRetained() const {
+  llvm::sys::ScopedLock L(Lock);
+  return NumBytesRetained;
+}
+
+void SharedFileSystemCache::PrintStats() const {
+  llvm::sys::ScopedLock L(Lock);
+  llvm::errs() << "\n*** Shared File System Cache Stats:\n";
+  llvm::errs() << StatEntries.size() << " paths stat'ed, "
+               << NumStatHits << " stat hits, "
+               << NumStatMisses << " stat misses.\n";
+  llvm::errs() << BufferEntries.size() << " files read, "
+               << NumBufferHits << " buffer hits, "
+               << NumBufferMisses << " buffer misses, "
+               << NumBytesRetained << " bytes retained.\n";
+  llvm::errs() << IncludeGuards.size() << " include guards known, "
+               << NumIncludeGuardHits << " guard hits, "
+               << NumIncludeGuardMisses << " guard misses.\n";
+}
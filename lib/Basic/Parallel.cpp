@@ -0,0 +1,301 @@
+//===--- Parallel.cpp - Running independent work items on threads ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the helpers declared in Parallel.h.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/Parallel.h"
+#include "llvm/Config/config.h"
+#include "llvm/Support/Atomic.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/Threading.h"
+#include <deque>
+#include <vector>
+
+#if defined(LLVM_ON_WIN32)
+#include <windows.h>
+#include <process.h>
+#elif defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+using namespace clang;
+
+/// \brief The stack size used for worker threads. Compiling a translation
+/// unit may recurse deeply, so match the size used for module builds.
+static const unsigned ThreadStackSize = 8 << 20;
+
+namespace {
+/// \brief State shared by all threads participating in a runInParallel call.
+struct ParallelContext {
+  void (*Fn)(void *UserData, unsigned Index);
+  void *UserData;
+  unsigned NumItems;
+
+  /// \brief The next work item to hand out.
+  volatile llvm::sys::cas_flag NextItem;
+};
+}
+
+/// \brief Pulls work items from \p Ctx until none are left.
+static void runWorkItems(ParallelContext &Ctx) {
+  while (true) {
+    unsigned Index = llvm::sys::AtomicIncrement(&Ctx.NextItem) - 1;
+    if (Index >= Ctx.NumItems)
+      return;
+    Ctx.Fn(Ctx.UserData, Index);
+  }
+}
+
+static void runWorkItemsOnThread(void *Ctx) {
+  runWorkItems(*static_cast<ParallelContext *>(Ctx));
+}
+
+namespace {
+/// \brief The function a worker thread runs, and its argument.
+struct WorkerStart {
+  void (*Body)(void *Arg);
+  void *Arg;
+};
+}
+
+#if defined(LLVM_ON_WIN32)
+typedef HANDLE WorkerThread;
+
+static unsigned __stdcall ExecuteWorker(void *Arg) {
+  WorkerStart Start = *static_cast<WorkerStart *>(Arg);
+  delete static_cast<WorkerStart *>(Arg);
+  Start.Body(Start.Arg);
+  return 0;
+}
+
+static bool startWorker(void (*Body)(void *), void *Arg,
+                        WorkerThread &Thread) {
+  WorkerStart *Start = new WorkerStart;
+  Start->Body = Body;
+  Start->Arg = Arg;
+  Thread = (HANDLE)_beginthreadex(NULL, ThreadStackSize, ExecuteWorker, Start,
+                                  0, NULL);
+  if (Thread == 0)
+    delete Start;
+  return Thread != 0;
+}
+
+static void joinWorker(WorkerThread Thread) {
+  ::WaitForSingleObject(Thread, INFINITE);
+  ::CloseHandle(Thread);
+}
+#elif defined(HAVE_PTHREAD_H)
+typedef pthread_t WorkerThread;
+
+static void *ExecuteWorker(void *Arg) {
+  WorkerStart Start = *static_cast<WorkerStart *>(Arg);
+  delete static_cast<WorkerStart *>(Arg);
+  Start.Body(Start.Arg);
+  return 0;
+}
+
+static bool startWorker(void (*Body)(void *), void *Arg,
+                        WorkerThread &Thread) {
+  pthread_attr_t Attr;
+  if (::pthread_attr_init(&Attr) != 0)
+    return false;
+  WorkerStart *Start = new WorkerStart;
+  Start->Body = Body;
+  Start->Arg = Arg;
+  // Failing to raise the stack size is not fatal; fall back to the default.
+  ::pthread_attr_setstacksize(&Attr, ThreadStackSize);
+  bool Started = ::pthread_create(&Thread, &Attr, ExecuteWorker, Start) == 0;
+  ::pthread_attr_destroy(&Attr);
+  if (!Started)
+    delete Start;
+  return Started;
+}
+
+static void joinWorker(WorkerThread Thread) {
+  ::pthread_join(Thread, 0);
+}
+#else
+typedef int WorkerThread;
+
+static bool startWorker(void (*)(void *), void *, WorkerThread &) {
+  return false;
+}
+
+static void joinWorker(WorkerThread) {}
+#endif
+
+unsigned clang::getHardwareConcurrency() {
+#if defined(LLVM_ON_WIN32)
+  SYSTEM_INFO Info;
+  ::GetSystemInfo(&Info);
+  if (Info.dwNumberOfProcessors > 0)
+    return Info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+  long NumCPUs = ::sysconf(_SC_NPROCESSORS_ONLN);
+  if (NumCPUs > 0)
+    return NumCPUs;
+#endif
+  return 1;
+}
+
+void clang::runInParallel(unsigned NumItems, unsigned NumThreads,
+                          void (*Fn)(void *UserData, unsigned Index),
+                          void *UserData) {
+  ParallelContext Ctx;
+  Ctx.Fn = Fn;
+  Ctx.UserData = UserData;
+  Ctx.NumItems = NumItems;
+  Ctx.NextItem = 0;
+
+  if (NumThreads == 0)
+    NumThreads = getHardwareConcurrency();
+  if (NumThreads > NumItems)
+    NumThreads = NumItems;
+
+  // Spawning threads requires LLVM's global state to be thread safe. If that
+  // is not possible, just do everything on this thread.
+  std::vector<WorkerThread> Workers;
+  if (NumThreads > 1 && llvm::llvm_start_multithreaded()) {
+    Workers.reserve(NumThreads - 1);
+    for (unsigned I = 1; I != NumThreads; ++I) {
+      WorkerThread Thread;
+      // If we run out of threads, the ones we have will pick up the slack.
+      if (!startWorker(runWorkItemsOnThread, &Ctx, Thread))
+        break;
+      Workers.push_back(Thread);
+    }
+  }
+
+  runWorkItems(Ctx);
+
+  for (unsigned I = 0, E = Workers.size(); I != E; ++I)
+    joinWorker(Workers[I]);
+}
+
+namespace {
+/// \brief State shared by all threads participating in a runDependencyGraph
+/// call. Everything but the callback is guarded by \c Lock.
+struct GraphContext {
+  bool (*Fn)(void *UserData, unsigned Index);
+  void *UserData;
+  unsigned MaxThreads;
+  bool CanStartThreads;
+
+  llvm::sys::Mutex Lock;
+
+  /// \brief The number of dependencies of each item that have not run yet.
+  std::vector<unsigned> NumPending;
+
+  /// \brief The items that depend on each item.
+  std::vector<std::vector<unsigned> > Dependents;
+
+  /// \brief The items whose dependencies have all run, in the order they
+  /// became ready.
+  std::deque<unsigned> Ready;
+
+  /// \brief The number of threads that have not finished yet, including the
+  /// calling thread.
+  unsigned NumActive;
+
+  /// \brief The threads started so far that have not been joined.
+  std::vector<WorkerThread> Threads;
+};
+}
+
+static void runGraphItemsOnThread(void *Ctx);
+
+/// \brief Starts threads for the ready items of \p Ctx, while there are
+/// threads to spare. Must be called with \c Ctx.Lock held.
+static void startGraphThreads(GraphContext &Ctx) {
+  for (unsigned N = Ctx.Ready.size();
+       N && Ctx.CanStartThreads && Ctx.NumActive < Ctx.MaxThreads; --N) {
+    WorkerThread Thread;
+    // If we run out of threads, the ones we have will pick up the slack.
+    if (!startWorker(runGraphItemsOnThread, &Ctx, Thread)) {
+      Ctx.CanStartThreads = false;
+      break;
+    }
+    ++Ctx.NumActive;
+    Ctx.Threads.push_back(Thread);
+  }
+}
+
+/// \brief Runs ready items of \p Ctx until none are ready.
+static void runGraphItems(GraphContext &Ctx) {
+  Ctx.Lock.acquire();
+  while (!Ctx.Ready.empty()) {
+    unsigned Index = Ctx.Ready.front();
+    Ctx.Ready.pop_front();
+    startGraphThreads(Ctx);
+    Ctx.Lock.release();
+
+    bool Succeeded = Ctx.Fn(Ctx.UserData, Index);
+
+    Ctx.Lock.acquire();
+    if (Succeeded) {
+      const std::vector<unsigned> &Dependents = Ctx.Dependents[Index];
+      for (unsigned I = 0, E = Dependents.size(); I != E; ++I)
+        if (--Ctx.NumPending[Dependents[I]] == 0)
+          Ctx.Ready.push_back(Dependents[I]);
+    }
+  }
+  --Ctx.NumActive;
+  Ctx.Lock.release();
+}
+
+static void runGraphItemsOnThread(void *Ctx) {
+  runGraphItems(*static_cast<GraphContext *>(Ctx));
+}
+
+void clang::runDependencyGraph(
+    const std::vector<std::vector<unsigned> > &Dependencies,
+    unsigned NumThreads, bool (*Fn)(void *UserData, unsigned Index),
+    void *UserData) {
+  GraphContext Ctx;
+  Ctx.Fn = Fn;
+  Ctx.UserData = UserData;
+  Ctx.MaxThreads = NumThreads ? NumThreads : getHardwareConcurrency();
+  Ctx.NumActive = 1;
+
+  unsigned NumItems = Dependencies.size();
+  Ctx.NumPending.resize(NumItems);
+  Ctx.Dependents.resize(NumItems);
+  for (unsigned I = 0; I != NumItems; ++I) {
+    Ctx.NumPending[I] = Dependencies[I].size();
+    for (unsigned J = 0, E = Dependencies[I].size(); J != E; ++J)
+      Ctx.Dependents[Dependencies[I][J]].push_back(I);
+    if (Dependencies[I].empty())
+      Ctx.Ready.push_back(I);
+  }
+
+  // Spawning threads requires LLVM's global state to be thread safe. If that
+  // is not possible, just do everything on this thread.
+  Ctx.CanStartThreads = Ctx.MaxThreads > 1 &&
+                        llvm::llvm_start_multithreaded();
+
+  runGraphItems(Ctx);
+
+  // Threads are only started by threads that have not finished, and are
+  // recorded before they start, so once there is nothing left to join,
+  // every thread has finished.
+  while (true) {
+    Ctx.Lock.acquire();
+    if (Ctx.Threads.empty()) {
+      Ctx.Lock.release();
+      break;
+    }
+    WorkerThread Thread = Ctx.Threads.back();
+    Ctx.Threads.pop_back();
+    Ctx.Lock.release();
+    joinWorker(Thread);
+  }
+}
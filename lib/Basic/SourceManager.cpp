@@ -375,7 +375,8 @@ SourceManager::SourceManager(DiagnosticsEngine &Diag, FileManager &FileMgr,
   : Diag(Diag), FileMgr(FileMgr), OverridenFilesKeepOriginalName(true),
     UserFilesAreVolatile(UserFilesAreVolatile),
     ExternalSLocEntries(0), LineTable(0), NumLinearScans(0),
-    NumBinaryProbes(0), FakeBufferForRecovery(0),
+    NumBinaryProbes(0), NumRecentFileIDHits(0), NumIndexedFileIDLookups(0),
+    FakeBufferForRecovery(0),
     FakeContentCacheForRecovery(0) {
   clearIDTables();
   Diag.setSourceManager(this);
@@ -418,6 +419,12 @@ void SourceManager::clearIDTables() {
   LastLineNoFileIDQuery = FileID();
   LastLineNoContentCache = 0;
   LastFileIDLookup = FileID();
+  for (unsigned I = 0; I != NumRecentFileIDLookups; ++I) {
+    RecentFileIDLookups[I].Begin = RecentFileIDLookups[I].End = 0;
+  }
+  NextRecentFileIDLookup = 0;
+  LocalSLocEntryIndex.clear();
+  NumIndexedSLocEntries = 0;
 
   if (LineTable)
     LineTable->clear();
@@ -493,15 +500,23 @@ const SrcMgr::SLocEntry &SourceManager::loadSLocEntry(unsigned Index,
     if (!SLocEntryLoaded[Index]) {
       // Try to recover; create a SLocEntry so the rest of clang can handle it.
       LoadedSLocEntryTable[Index] = SLocEntry::get(0,
-                                 FileInfo::get(SourceLocation(),
-                                               getFakeContentCacheForRecovery(),
-                                               SrcMgr::C_User));
+          allocateFileInfo(SourceLocation(), getFakeContentCacheForRecovery(),
+                           SrcMgr::C_User));
     }
   }
 
   return LoadedSLocEntryTable[Index];
 }
 
+const SrcMgr::FileInfo *
+SourceManager::allocateFileInfo(SourceLocation IncludePos,
+                                const ContentCache *File,
+                                CharacteristicKind FileCharacter) const {
+  FileInfo *Info = ContentCacheAlloc.Allocate<FileInfo>();
+  *Info = FileInfo::get(IncludePos, File, FileCharacter);
+  return Info;
+}
+
 std::pair<int, unsigned>
 SourceManager::AllocateLoadedSLocEntries(unsigned NumSLocEntries,
                                          unsigned TotalSize) {
@@ -590,13 +605,13 @@ FileID SourceManager::createFileID(const ContentCache *File,
     assert(Index < LoadedSLocEntryTable.size() && "FileID out of range");
     assert(!SLocEntryLoaded[Index] && "FileID already loaded");
     LoadedSLocEntryTable[Index] = SLocEntry::get(LoadedOffset,
-        FileInfo::get(IncludePos, File, FileCharacter));
+        allocateFileInfo(IncludePos, File, FileCharacter));
     SLocEntryLoaded[Index] = true;
     return FileID::get(LoadedID);
   }
-  LocalSLocEntryTable.push_back(SLocEntry::get(NextLocalOffset,
-                                               FileInfo::get(IncludePos, File,
-                                                             FileCharacter)));
+  LocalSLocEntryTable.push_back(
+      SLocEntry::get(NextLocalOffset,
+                     allocateFileInfo(IncludePos, File, FileCharacter)));
   unsigned FileSize = File->getSize();
   assert(NextLocalOffset + FileSize + 1 > NextLocalOffset &&
          NextLocalOffset + FileSize + 1 <= CurrentLoadedOffset &&
@@ -733,11 +748,84 @@ FileID SourceManager::getFileIDSlow(unsigned SLocOffset) const {
   if (!SLocOffset)
     return FileID::get(0);
 
+  // Check the FileIDs that were recently looked up.
+  for (unsigned I = 0; I != NumRecentFileIDLookups; ++I) {
+    const FileIDLookup &Lookup = RecentFileIDLookups[I];
+    if (Lookup.Begin <= SLocOffset && SLocOffset < Lookup.End) {
+      if (!Lookup.IsExpansion)
+        LastFileIDLookup = Lookup.ID;
+      ++NumRecentFileIDHits;
+      return Lookup.ID;
+    }
+  }
+
   // Now it is time to search for the correct file. See where the SLocOffset
   // sits in the global view and consult local or loaded buffers for it.
+  FileID Res;
   if (SLocOffset < NextLocalOffset)
-    return getFileIDLocal(SLocOffset);
-  return getFileIDLoaded(SLocOffset);
+    Res = getFileIDLocal(SLocOffset);
+  else
+    Res = getFileIDLoaded(SLocOffset);
+  if (!Res.isInvalid())
+    rememberFileIDLookup(Res, SLocOffset);
+  return Res;
+}
+
+/// \brief Add a FileID found by getFileIDSlow to the recent lookups.
+void SourceManager::rememberFileIDLookup(FileID FID,
+                                         unsigned SLocOffset) const {
+  int ID = FID.ID;
+  bool Invalid = false;
+  const SrcMgr::SLocEntry &Entry = getSLocEntryByID(ID, &Invalid);
+  if (Invalid)
+    return;
+  unsigned Begin = Entry.getOffset();
+  bool IsExpansion = Entry.isExpansion();
+
+  // The range of an entry ends where the next one in the address space
+  // starts.  New local entries only ever start at NextLocalOffset, so the
+  // range of the last local entry is final, too.
+  unsigned End;
+  if (ID >= 0) {
+    if (unsigned(ID) + 1 < LocalSLocEntryTable.size())
+      End = LocalSLocEntryTable[ID + 1].getOffset();
+    else
+      End = NextLocalOffset;
+  } else if (ID == -2) {
+    End = MaxLoadedOffset;
+  } else {
+    // Loaded entries are allocated downwards, so the next entry in the
+    // address space has the next higher ID.
+    End = getLoadedSLocEntryByID(ID + 1, &Invalid).getOffset();
+    if (Invalid)
+      return;
+  }
+
+  // Do not remember entries made up to recover from a broken AST file.
+  if (SLocOffset < Begin || SLocOffset >= End)
+    return;
+
+  FileIDLookup &Lookup = RecentFileIDLookups[NextRecentFileIDLookup];
+  Lookup.ID = FID;
+  Lookup.Begin = Begin;
+  Lookup.End = End;
+  Lookup.IsExpansion = IsExpansion;
+  if (++NextRecentFileIDLookup == NumRecentFileIDLookups)
+    NextRecentFileIDLookup = 0;
+}
+
+/// \brief Extend LocalSLocEntryIndex to the entries added since it was last
+/// updated.
+void SourceManager::updateLocalSLocEntryIndex() const {
+  unsigned NumEntries = LocalSLocEntryTable.size();
+  for (unsigned I = NumIndexedSLocEntries; I != NumEntries; ++I) {
+    // Every indexed offset below the start of this entry is in the previous
+    // one.
+    unsigned Offset = LocalSLocEntryTable[I].getOffset();
+    while ((LocalSLocEntryIndex.size() << LocalSLocEntryIndexShift) < Offset)
+      LocalSLocEntryIndex.push_back(I - 1);
+  }
+  NumIndexedSLocEntries = NumEntries;
 }
 
 /// \brief Return the FileID for a SourceLocation with a low offset.
@@ -791,44 +879,40 @@ FileID SourceManager::getFileIDLocal(unsigned SLocOffset) const {
   // Convert "I" back into an index.  We know that it is an entry whose index is
   // larger than the offset we are looking for.
   unsigned GreaterIndex = I - LocalSLocEntryTable.begin();
-  // LessIndex - This is the lower bound of the range that we're searching.
-  // We know that the offset corresponding to the FileID is is less than
-  // SLocOffset.
+
+  // Narrow the search down with the index.  LessIndex is an entry whose offset
+  // is known to be at most SLocOffset.
+  updateLocalSLocEntryIndex();
   unsigned LessIndex = 0;
+  unsigned Granule = SLocOffset >> LocalSLocEntryIndexShift;
+  if (Granule < LocalSLocEntryIndex.size())
+    LessIndex = LocalSLocEntryIndex[Granule];
+  else if (!LocalSLocEntryIndex.empty())
+    LessIndex = LocalSLocEntryIndex.back();
+  if (Granule + 1 < LocalSLocEntryIndex.size())
+    GreaterIndex = std::min(GreaterIndex, LocalSLocEntryIndex[Granule + 1] + 1);
+  ++NumIndexedFileIDLookups;
+
+  // Binary search for the last entry that starts at or before SLocOffset.
   NumProbes = 0;
-  while (1) {
-    bool Invalid = false;
+  while (GreaterIndex - LessIndex > 1) {
     unsigned MiddleIndex = (GreaterIndex-LessIndex)/2+LessIndex;
-    unsigned MidOffset = getLocalSLocEntry(MiddleIndex, &Invalid).getOffset();
-    if (Invalid)
-      return FileID::get(0);
-    
     ++NumProbes;
 
-    // If the offset of the midpoint is too large, chop the high side of the
-    // range to the midpoint.
-    if (MidOffset > SLocOffset) {
+    if (LocalSLocEntryTable[MiddleIndex].getOffset() > SLocOffset)
       GreaterIndex = MiddleIndex;
-      continue;
-    }
-
-    // If the middle index contains the value, succeed and return.
-    // FIXME: This could be made faster by using a function that's aware of
-    // being in the local area.
-    if (isOffsetInFileID(FileID::get(MiddleIndex), SLocOffset)) {
-      FileID Res = FileID::get(MiddleIndex);
+    else
+      LessIndex = MiddleIndex;
+  }
 
-      // If this isn't a macro expansion, remember it.  We have good locality
-      // across FileID lookups.
-      if (!LocalSLocEntryTable[MiddleIndex].isExpansion())
-        LastFileIDLookup = Res;
-      NumBinaryProbes += NumProbes;
-      return Res;
-    }
+  FileID Res = FileID::get(LessIndex);
 
-    // Otherwise, move the low-side up to the middle index.
-    LessIndex = MiddleIndex;
-  }
+  // If this isn't a macro expansion, remember it.  We have good locality
+  // across FileID lookups.
+  if (!LocalSLocEntryTable[LessIndex].isExpansion())
+    LastFileIDLookup = Res;
+  NumBinaryProbes += NumProbes;
+  return Res;
 }
 
 /// \brief Return the FileID for a SourceLocation with a high offset.
@@ -2136,6 +2220,10 @@ void SourceManager::PrintStats() const {
                << NumMacroArgsComputed << " files with macro args computed.\n";
   llvm::errs() << "FileID scans: " << NumLinearScans << " linear, "
                << NumBinaryProbes << " binary.\n";
+  llvm::errs() << "FileID lookups: " << NumRecentFileIDHits
+               << " recent lookup hits, " << NumIndexedFileIDLookups
+               << " indexed (" << llvm::capacity_in_bytes(LocalSLocEntryIndex)
+               << " bytes of index).\n";
 }
 
 ExternalSLocEntrySource::~ExternalSLocEntrySource() { }
@@ -2164,6 +2252,7 @@ size_t SourceManager::getDataStructureSizes() const {
   size_t size = llvm::capacity_in_bytes(MemBufferInfos)
     + llvm::capacity_in_bytes(LocalSLocEntryTable)
     + llvm::capacity_in_bytes(LoadedSLocEntryTable)
+    + llvm::capacity_in_bytes(LocalSLocEntryIndex)
     + llvm::capacity_in_bytes(SLocEntryLoaded)
     + llvm::capacity_in_bytes(FileInfos);
   
@@ -13,15 +13,27 @@
 #include "clang/Driver/DriverDiagnostic.h"
 #include "clang/Driver/Options.h"
 #include "clang/Driver/ToolChain.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Option/ArgList.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Program.h"
+#include "llvm/Support/Signals.h"
 #include "llvm/Support/raw_ostream.h"
 #include <errno.h>
 #include <sys/stat.h>
 
+// For Sleep/usleep, used to poll parallel jobs.
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
 using namespace clang::driver;
 using namespace clang;
 using namespace llvm::opt;
@@ -71,9 +83,40 @@ const DerivedArgList &Compilation::getArgsForToolChain(const ToolChain *TC,
   return *Entry;
 }
 
+bool clang::driver::CC1ArgsSetLLVMOptions(ArrayRef<const char *> Args) {
+  for (unsigned I = 0, E = Args.size(); I != E; ++I) {
+    bool SetsLLVMOption = llvm::StringSwitch<bool>(Args[I])
+      .Cases("-mllvm", "-backend-option", "-mdebug-pass", true)
+      .Cases("-mlimit-float-precision", "-mno-global-merge", true)
+      .Case("-ftime-report", true)
+      .Default(false);
+    if (SetsLLVMOption)
+      return true;
+  }
+  return false;
+}
+
+/// \brief Whether \p Cmd can be run with the driver's CC1Main callback.
+static bool CanExecuteInProcess(const Compilation &C, const Command &Cmd) {
+  const Driver &D = C.getDriver();
+  if (!D.CC1Main ||
+      !C.getArgs().hasFlag(options::OPT_fintegrated_cc1,
+                           options::OPT_fno_integrated_cc1, false))
+    return false;
+
+  const ArgStringList &Args = Cmd.getArguments();
+  if (Args.empty() || StringRef(Args[0]) != "-cc1" ||
+      StringRef(Cmd.getExecutable()) != D.getClangProgramPath())
+    return false;
+
+  return !CC1ArgsSetLLVMOptions(Args);
+}
+
 void Compilation::PrintJob(raw_ostream &OS, const Job &J,
                            const char *Terminator, bool Quote) const {
   if (const Command *C = dyn_cast<Command>(&J)) {
+    if (CanExecuteInProcess(*this, *C))
+      OS << " (in-process)" << Terminator;
     OS << " \"" << C->getExecutable() << '"';
     for (ArgStringList::const_iterator it = C->getArguments().begin(),
            ie = C->getArguments().end(); it != ie; ++it) {
@@ -258,45 +301,77 @@ bool Compilation::CleanupFileMap(const ArgStringMap &Files,
   return Success;
 }
 
+/// \brief Print \p Cmd before executing it, if -v or CC_PRINT_OPTIONS asked
+/// for it.
+///
+/// \param OS - Where to print the command, unless CC_PRINT_OPTIONS_FILE
+/// redirects it.
+/// \return false if the command could not be printed.
+static bool PrintCommandForExecution(const Compilation &C, const Command &Cmd,
+                                     raw_ostream &ErrOS) {
+  const Driver &D = C.getDriver();
+  if ((!D.CCPrintOptions && !C.getArgs().hasArg(options::OPT_v)) ||
+      D.CCGenDiagnostics)
+    return true;
+
+  raw_ostream *OS = &ErrOS;
+
+  // Follow gcc implementation of CC_PRINT_OPTIONS; we could also cache the
+  // output stream.
+  if (D.CCPrintOptions && D.CCPrintOptionsFilename) {
+    std::string Error;
+    OS = new llvm::raw_fd_ostream(D.CCPrintOptionsFilename, Error,
+                                  llvm::sys::fs::F_Append);
+    if (!Error.empty()) {
+      D.Diag(clang::diag::err_drv_cc_print_options_failure) << Error;
+      delete OS;
+      return false;
+    }
+  }
+
+  if (D.CCPrintOptions)
+    *OS << "[Logging clang options]";
+
+  C.PrintJob(*OS, Cmd, "\n", /*Quote=*/D.CCPrintOptions);
+
+  if (OS != &ErrOS)
+    delete OS;
+  return true;
+}
+
+/// \brief Build the null terminated argument vector to execute \p C with.
+static void BuildArgv(const Command &C, std::vector<const char *> &Argv) {
+  Argv.clear();
+  Argv.push_back(C.getExecutable());
+  Argv.insert(Argv.end(), C.getArguments().begin(), C.getArguments().end());
+  Argv.push_back(0);
+}
+
 int Compilation::ExecuteCommand(const Command &C,
                                 const Command *&FailingCommand) const {
   std::string Prog(C.getExecutable());
-  const char **Argv = new const char*[C.getArguments().size() + 2];
-  Argv[0] = C.getExecutable();
-  std::copy(C.getArguments().begin(), C.getArguments().end(), Argv+1);
-  Argv[C.getArguments().size() + 1] = 0;
-
-  if ((getDriver().CCPrintOptions ||
-       getArgs().hasArg(options::OPT_v)) && !getDriver().CCGenDiagnostics) {
-    raw_ostream *OS = &llvm::errs();
-
-    // Follow gcc implementation of CC_PRINT_OPTIONS; we could also cache the
-    // output stream.
-    if (getDriver().CCPrintOptions && getDriver().CCPrintOptionsFilename) {
-      std::string Error;
-      OS = new llvm::raw_fd_ostream(getDriver().CCPrintOptionsFilename, Error,
-                                    llvm::sys::fs::F_Append);
-      if (!Error.empty()) {
-        getDriver().Diag(clang::diag::err_drv_cc_print_options_failure)
-          << Error;
-        FailingCommand = &C;
-        delete OS;
-        return 1;
-      }
-    }
+  std::vector<const char *> Argv;
+  BuildArgv(C, Argv);
 
-    if (getDriver().CCPrintOptions)
-      *OS << "[Logging clang options]";
-
-    PrintJob(*OS, C, "\n", /*Quote=*/getDriver().CCPrintOptions);
+  if (!PrintCommandForExecution(*this, C, llvm::errs())) {
+    FailingCommand = &C;
+    return 1;
+  }
 
-    if (OS != &llvm::errs())
-      delete OS;
+  // Output that is redirected, e.g. when generating crash diagnostics, can
+  // only be redirected for a new process.
+  if (!Redirects && CanExecuteInProcess(*this, C)) {
+    // Argv is null terminated and starts with the executable and "-cc1".
+    int Res = getDriver().CC1Main(&Argv[2], &Argv[Argv.size() - 1],
+                                  C.getExecutable());
+    if (Res)
+      FailingCommand = &C;
+    return Res;
   }
 
   std::string Error;
   bool ExecutionFailed;
-  int Res = llvm::sys::ExecuteAndWait(Prog, Argv, /*env*/ 0, Redirects,
+  int Res = llvm::sys::ExecuteAndWait(Prog, &Argv[0], /*env*/ 0, Redirects,
                                       /*secondsToWait*/ 0, /*memoryLimit*/ 0,
                                       &Error, &ExecutionFailed);
   if (!Error.empty()) {
@@ -307,7 +382,6 @@ int Compilation::ExecuteCommand(const Command &C,
   if (Res)
     FailingCommand = &C;
 
-  delete[] Argv;
   return ExecutionFailed ? 1 : Res;
 }
 
@@ -352,6 +426,217 @@ void Compilation::ExecuteJob(const Job &J,
   }
 }
 
+/// \brief Collect the commands of a (possibly nested) job list in order.
+static void CollectCommands(const Job &J,
+                            SmallVectorImpl<const Command *> &Commands) {
+  if (const Command *C = dyn_cast<Command>(&J)) {
+    Commands.push_back(C);
+    return;
+  }
+  const JobList *Jobs = cast<JobList>(&J);
+  for (JobList::const_iterator it = Jobs->begin(), ie = Jobs->end();
+       it != ie; ++it)
+    CollectCommands(**it, Commands);
+}
+
+/// \brief Add to \p Deps the commands producing the inputs of \p A.
+static void CollectDependencies(
+    const Action *A, const llvm::DenseMap<const Action *, unsigned> &Producers,
+    llvm::SmallPtrSet<const Action *, 16> &Visited,
+    SmallVectorImpl<unsigned> &Deps) {
+  for (Action::const_iterator AI = A->begin(), AE = A->end(); AI != AE; ++AI) {
+    if (!Visited.insert(*AI))
+      continue;
+    llvm::DenseMap<const Action *, unsigned>::const_iterator P =
+        Producers.find(*AI);
+    if (P != Producers.end())
+      Deps.push_back(P->second);
+    CollectDependencies(*AI, Producers, Visited, Deps);
+  }
+}
+
+/// \brief Print the contents of \p File to \p OS and delete it.
+static void ReplayAndRemoveFile(StringRef File, raw_ostream &OS) {
+  OwningPtr<llvm::MemoryBuffer> Buffer;
+  if (!llvm::MemoryBuffer::getFile(File, Buffer))
+    OS << Buffer->getBuffer();
+  OS.flush();
+  llvm::sys::fs::remove(File);
+  llvm::sys::DontRemoveFileOnSignal(File);
+}
+
+/// \brief Sleep for a short while before polling running commands again.
+static void WaitBeforePolling() {
+#ifdef _WIN32
+  ::Sleep(5);
+#else
+  ::usleep(5000);
+#endif
+}
+
+namespace {
+/// \brief The state of one command run by ExecuteJobsInParallel.
+struct ParallelCommand {
+  enum CommandState { Waiting, Running, Finished, Skipped };
+
+  ParallelCommand() : C(0), State(Waiting), Res(0) {}
+
+  const Command *C;
+  CommandState State;
+  /// The commands that have to finish before this one can start.
+  SmallVector<unsigned, 4> Deps;
+  std::vector<const char *> Argv;
+  llvm::sys::ProcessInfo PI;
+  int Res;
+  /// Any -v output and error message, printed in job order.
+  std::string Log;
+  std::string ExecutionError;
+  /// Files capturing the standard output and error of the command.
+  SmallString<128> OutputFile;
+  SmallString<128> ErrorFile;
+};
+}
+
+void Compilation::ExecuteJobsInParallel(const JobList &Jobs, unsigned NumJobs,
+                                      FailingCommandList &FailingCommands) const {
+  SmallVector<const Command *, 8> Commands;
+  CollectCommands(Jobs, Commands);
+
+  // Output that is already redirected, e.g. when generating crash
+  // diagnostics, doesn't need to be ordered and isn't worth the effort.
+  if (NumJobs <= 1 || Commands.size() <= 1 || Redirects) {
+    ExecuteJob(Jobs, FailingCommands);
+    return;
+  }
+
+  std::vector<ParallelCommand> State(Commands.size());
+  llvm::DenseMap<const Action *, unsigned> Producers;
+  for (unsigned I = 0, E = Commands.size(); I != E; ++I) {
+    State[I].C = Commands[I];
+    Producers[&Commands[I]->getSource()] = I;
+  }
+  for (unsigned I = 0, E = Commands.size(); I != E; ++I) {
+    llvm::SmallPtrSet<const Action *, 16> Visited;
+    CollectDependencies(&Commands[I]->getSource(), Producers, Visited,
+                        State[I].Deps);
+  }
+
+  unsigned NumRunning = 0;
+  unsigned NextToReport = 0;
+  while (NextToReport != State.size()) {
+    bool MadeProgress = false;
+
+    // Start every command whose inputs are available, as long as there are
+    // free slots.
+    for (unsigned I = NextToReport, E = State.size(); I != E; ++I) {
+      ParallelCommand &PC = State[I];
+      if (PC.State != ParallelCommand::Waiting)
+        continue;
+
+      bool Ready = true, InputsFailed = false;
+      for (unsigned D = 0, DE = PC.Deps.size(); D != DE; ++D) {
+        const ParallelCommand &Dep = State[PC.Deps[D]];
+        if (Dep.State == ParallelCommand::Waiting ||
+            Dep.State == ParallelCommand::Running)
+          Ready = false;
+        else if (Dep.State == ParallelCommand::Skipped || Dep.Res)
+          InputsFailed = true;
+      }
+      if (!Ready)
+        continue;
+      if (InputsFailed) {
+        PC.State = ParallelCommand::Skipped;
+        MadeProgress = true;
+        continue;
+      }
+      if (NumRunning == NumJobs)
+        continue;
+
+      MadeProgress = true;
+      llvm::raw_string_ostream LogOS(PC.Log);
+      bool Printed = PrintCommandForExecution(*this, *PC.C, LogOS);
+      LogOS.flush();
+      if (!Printed) {
+        PC.State = ParallelCommand::Finished;
+        PC.Res = 1;
+        continue;
+      }
+
+      if (llvm::sys::fs::createTemporaryFile("cc-job", "out", PC.OutputFile) ||
+          llvm::sys::fs::createTemporaryFile("cc-job", "err", PC.ErrorFile)) {
+        PC.ExecutionError = "unable to create temporary file";
+        PC.State = ParallelCommand::Finished;
+        PC.Res = 1;
+        continue;
+      }
+      llvm::sys::RemoveFileOnSignal(PC.OutputFile);
+      llvm::sys::RemoveFileOnSignal(PC.ErrorFile);
+
+      BuildArgv(*PC.C, PC.Argv);
+      StringRef OutputFile(PC.OutputFile), ErrorFile(PC.ErrorFile);
+      const StringRef *CommandRedirects[] = { 0, &OutputFile, &ErrorFile };
+      bool ExecutionFailed;
+      PC.PI = llvm::sys::ExecuteNoWait(PC.C->getExecutable(), &PC.Argv[0],
+                                       /*env*/ 0, CommandRedirects,
+                                       /*memoryLimit*/ 0, &PC.ExecutionError,
+                                       &ExecutionFailed);
+      if (ExecutionFailed) {
+        PC.State = ParallelCommand::Finished;
+        PC.Res = 1;
+        continue;
+      }
+      PC.State = ParallelCommand::Running;
+      ++NumRunning;
+    }
+
+    // Reap the commands that have finished.
+    // FIXME: llvm::sys has no way to wait for any one of several children, so
+    // poll them instead.
+    for (unsigned I = NextToReport, E = State.size(); I != E; ++I) {
+      ParallelCommand &PC = State[I];
+      if (PC.State != ParallelCommand::Running)
+        continue;
+      llvm::sys::ProcessInfo Result =
+          llvm::sys::Wait(PC.PI, /*SecondsToWait*/ 0,
+                          /*WaitUntilTerminates*/ false, &PC.ExecutionError);
+      if (Result.Pid == 0)
+        continue;
+      PC.Res = Result.ReturnCode;
+      PC.State = ParallelCommand::Finished;
+      --NumRunning;
+      MadeProgress = true;
+    }
+
+    // Print the output of finished commands in job order.
+    while (NextToReport != State.size() &&
+           (State[NextToReport].State == ParallelCommand::Finished ||
+            State[NextToReport].State == ParallelCommand::Skipped)) {
+      ParallelCommand &PC = State[NextToReport++];
+      MadeProgress = true;
+      if (PC.State == ParallelCommand::Skipped)
+        continue;
+
+      llvm::errs() << PC.Log;
+      if (!PC.OutputFile.empty()) {
+        ReplayAndRemoveFile(PC.OutputFile, llvm::outs());
+        ReplayAndRemoveFile(PC.ErrorFile, llvm::errs());
+      }
+      if (!PC.ExecutionError.empty()) {
+        assert(PC.Res && "Error string set with 0 result code!");
+        getDriver().Diag(clang::diag::err_drv_command_failure)
+          << PC.ExecutionError;
+      }
+      if (PC.Res)
+        FailingCommands.push_back(std::make_pair(PC.Res, PC.C));
+    }
+
+    if (!MadeProgress) {
+      assert(NumRunning && "Jobs are not in dependency order!");
+      WaitBeforePolling();
+    }
+  }
+}
+
 void Compilation::initCompilationForDiagnostics() {
   // Free actions and jobs.
   DeleteContainerPointers(Actions);
@@ -10,6 +10,7 @@
 #include "clang/Driver/Driver.h"
 #include "InputInfo.h"
 #include "ToolChains.h"
+#include "clang/Basic/Parallel.h"
 #include "clang/Basic/Version.h"
 #include "clang/Driver/Action.h"
 #include "clang/Driver/Compilation.h"
@@ -59,7 +60,8 @@ Driver::Driver(StringRef ClangExecutable,
     CCLogDiagnosticsFilename(0),
     CCCPrintBindings(false),
     CCPrintHeaders(false), CCLogDiagnostics(false),
-    CCGenDiagnostics(false), CCCGenericGCCName(""), CheckInputsExist(true),
+    CCGenDiagnostics(false), CC1Main(0), CCCGenericGCCName(""),
+    CheckInputsExist(true),
     CCCUsePCH(true), SuppressMissingInputWarning(false) {
 
   Name = llvm::sys::path::stem(ClangExecutable);
@@ -337,6 +339,12 @@ Compilation *Driver::BuildCompilation(ArrayRef<const char *> ArgList) {
   // Ignore -pipe.
   Args->ClaimAllArgs(options::OPT_pipe);
 
+  // -fparallel-jobs and -f[no-]integrated-cc1 are only used when executing
+  // the compilation.
+  Args->ClaimAllArgs(options::OPT_fparallel_jobs_EQ);
+  Args->ClaimAllArgs(options::OPT_fintegrated_cc1);
+  Args->ClaimAllArgs(options::OPT_fno_integrated_cc1);
+
   // Extract -ccc args.
   //
   // FIXME: We need to figure out where this behavior should live. Most of it
@@ -586,7 +594,19 @@ int Driver::ExecuteCompilation(const Compilation &C,
   if (Diags.hasErrorOccurred())
     return 1;
 
-  C.ExecuteJob(C.getJobs(), FailingCommands);
+  unsigned NumJobs = 1;
+  if (Arg *A = C.getArgs().getLastArg(options::OPT_fparallel_jobs_EQ)) {
+    StringRef Value = A->getValue();
+    if (Value.getAsInteger(10, NumJobs)) {
+      Diag(clang::diag::err_drv_invalid_int_value)
+        << A->getAsString(C.getArgs()) << Value;
+      return 1;
+    }
+    if (NumJobs == 0)
+      NumJobs = getHardwareConcurrency();
+  }
+
+  C.ExecuteJobsInParallel(C.getJobs(), NumJobs, FailingCommands);
 
   // Remove temp files.
   C.CleanupFileList(C.getTempFiles());
@@ -3042,6 +3042,12 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
   Args.AddAllArgs(CmdArgs, options::OPT_fmodules_ignore_macro);
   Args.AddLastArg(CmdArgs, options::OPT_fmodules_prune_interval);
   Args.AddLastArg(CmdArgs, options::OPT_fmodules_prune_after);
+  Args.AddLastArg(CmdArgs, options::OPT_fmodules_cache_max_size);
+  Args.AddLastArg(CmdArgs, options::OPT_fmodules_build_jobs_EQ);
+  Args.AddLastArg(CmdArgs, options::OPT_fpch_write_jobs_EQ);
+
+  Args.AddLastArg(CmdArgs, options::OPT_fheader_search_map_EQ);
+  Args.AddLastArg(CmdArgs, options::OPT_fheader_search_map_output_EQ);
 
   // -faccess-control is default.
   if (Args.hasFlag(options::OPT_fno_access_control,
@@ -20,6 +20,7 @@
 #include "UnwrappedLineParser.h"
 #include "WhitespaceManager.h"
 #include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/Parallel.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Format/Format.h"
 #include "clang/Lex/Lexer.h"
@@ -27,6 +28,7 @@
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/YAMLTraits.h"
+#include <algorithm>
 #include <queue>
 #include <string>
 
@@ -354,18 +356,54 @@ public:
   ///
   /// If \p DryRun is \c false, directly applies the changes.
   unsigned format(unsigned FirstIndent, bool DryRun = false) {
+    LineState State = getInitialState(FirstIndent, DryRun);
+
+    // Find best solution in solution space.
+    return analyzeSolutionSpace(State, DryRun);
+  }
+
+  /// \brief Finds the best solution for an \c UnwrappedLine without applying
+  /// it.
+  ///
+  /// Stores in \p Path whether a line break is inserted before each token
+  /// after the first one. As this only reads the line's tokens, different
+  /// lines can be searched concurrently. Returns \c false if no solution was
+  /// found.
+  bool findPath(unsigned FirstIndent, std::vector<bool> &Path) {
+    LineState State = getInitialState(FirstIndent, /*DryRun=*/true);
+    unsigned Penalty = 0;
+    StateNode *Current = findSolution(State, Penalty);
+    if (Current == NULL)
+      return false;
+
+    Path.clear();
+    for (; Current->Previous; Current = Current->Previous)
+      Path.push_back(Current->NewLine);
+    std::reverse(Path.begin(), Path.end());
+    return true;
+  }
+
+  /// \brief Applies the changes for a \p Path found by \c findPath().
+  void applyPath(unsigned FirstIndent, const std::vector<bool> &Path) {
+    LineState State = getInitialState(FirstIndent, /*DryRun=*/false);
+    for (unsigned i = 0, e = Path.size(); i != e; ++i) {
+      unsigned Penalty = 0;
+      formatChildren(State, Path[i], /*DryRun=*/false, Penalty);
+      Indenter->addTokenToState(State, Path[i], false);
+    }
+  }
+
+private:
+  LineState getInitialState(unsigned FirstIndent, bool DryRun) {
     LineState State = Indenter->getInitialState(FirstIndent, &Line, DryRun);
 
     // If the ObjC method declaration does not fit on a line, we should format
     // it with one arg per line.
     if (Line.Type == LT_ObjCMethodDecl)
       State.Stack.back().BreakBeforeParameter = true;
-
-    // Find best solution in solution space.
-    return analyzeSolutionSpace(State, DryRun);
+    return State;
   }
 
-private:
   /// \brief An edge in the solution space from \c Previous->State to \c State,
   /// inserting a newline dependent on the \c NewLine.
   struct StateNode {
@@ -400,6 +438,28 @@ private:
   ///
   /// If \p DryRun is \c false, directly applies the changes.
   unsigned analyzeSolutionSpace(LineState &InitialState, bool DryRun = false) {
+    unsigned Penalty = 0;
+    StateNode *Solution = findSolution(InitialState, Penalty);
+    if (Solution == NULL)
+      // We were unable to find a solution, do nothing.
+      // FIXME: Add diagnostic?
+      return 0;
+
+    // Reconstruct the solution.
+    if (!DryRun)
+      reconstructPath(InitialState, Solution);
+
+    DEBUG(llvm::dbgs() << "Total number of analyzed states: " << Count << "\n");
+    DEBUG(llvm::dbgs() << "---\n");
+
+    return Penalty;
+  }
+
+  /// \brief Runs the search of \c analyzeSolutionSpace() from \p InitialState.
+  ///
+  /// Returns the final node of the best solution and stores its penalty in
+  /// \p Penalty, or returns \c NULL if there is no solution.
+  StateNode *findSolution(LineState &InitialState, unsigned &Penalty) {
     std::set<LineState> Seen;
 
     // Insert start element into queue.
@@ -408,8 +468,6 @@ private:
     Queue.push(QueueItem(OrderedPenalty(0, Count), Node));
     ++Count;
 
-    unsigned Penalty = 0;
-
     // While not empty, take first element and follow edges.
     while (!Queue.empty()) {
       Penalty = Queue.top().first.first;
@@ -434,18 +492,8 @@ private:
     }
 
     if (Queue.empty())
-      // We were unable to find a solution, do nothing.
-      // FIXME: Add diagnostic?
-      return 0;
-
-    // Reconstruct the solution.
-    if (!DryRun)
-      reconstructPath(InitialState, Queue.top().second);
-
-    DEBUG(llvm::dbgs() << "Total number of analyzed states: " << Count << "\n");
-    DEBUG(llvm::dbgs() << "---\n");
-
-    return Penalty;
+      return NULL;
+    return Queue.top().second;
   }
 
   void reconstructPath(LineState &State, StateNode *Current) {
@@ -728,9 +776,9 @@ private:
 class Formatter : public UnwrappedLineConsumer {
 public:
   Formatter(const FormatStyle &Style, Lexer &Lex, SourceManager &SourceMgr,
-            const std::vector<CharSourceRange> &Ranges)
+            const std::vector<CharSourceRange> &Ranges, unsigned NumThreads)
       : Style(Style), Lex(Lex), SourceMgr(SourceMgr),
-        Whitespaces(SourceMgr, Style), Ranges(Ranges),
+        Whitespaces(SourceMgr, Style), Ranges(Ranges), NumThreads(NumThreads),
         Encoding(encoding::detectEncoding(Lex.getBuffer())) {
     DEBUG(llvm::dbgs() << "File encoding: "
                        << (Encoding == encoding::Encoding_UTF8 ? "UTF8"
@@ -824,6 +872,11 @@ public:
         } else if (Style.ColumnLimit == 0) {
           NoColumnLimitFormatter Formatter(&Indenter);
           Formatter.format(Indent, &TheLine);
+        } else if (NumThreads != 1) {
+          // The line's indent is known, and nothing the following lines do
+          // depends on how it is broken; search for its solution later, in
+          // parallel with the other lines.
+          PendingLines.push_back(PendingLine(&TheLine, Indent));
         } else {
           UnwrappedLineFormatter Formatter(&Indenter, &Whitespaces, Style,
                                            TheLine);
@@ -864,10 +917,64 @@ public:
       }
       PreviousLineLastToken = TheLine.Last;
     }
+    formatPendingLines();
     return Whitespaces.generateReplacements();
   }
 
 private:
+  /// \brief A line whose solution space is searched after all other lines
+  /// have been formatted.
+  struct PendingLine {
+    PendingLine(const AnnotatedLine *Line, unsigned Indent)
+        : Line(Line), Indent(Indent), Found(false) {}
+    const AnnotatedLine *Line;
+    unsigned Indent;
+    std::vector<bool> Path;
+    bool Found;
+  };
+
+  static void findPendingPath(void *UserData, unsigned Index) {
+    Formatter *F = static_cast<Formatter *>(UserData);
+    PendingLine &Pending = F->PendingLines[Index];
+    ContinuationIndenter Indenter(F->Style, F->SourceMgr, F->Whitespaces,
+                                  F->Encoding,
+                                  F->BinPackInconclusiveFunctions);
+    UnwrappedLineFormatter Formatter(&Indenter, &F->Whitespaces, F->Style,
+                                     *Pending.Line);
+    Pending.Found = Formatter.findPath(Pending.Indent, Pending.Path);
+  }
+
+  /// \brief Formats the lines in \c PendingLines.
+  ///
+  /// The searches only read the lines and the \c SourceManager, so they run
+  /// concurrently. The solutions are then applied in line order; as the
+  /// \c WhitespaceManager sorts its changes by location, the replacements
+  /// are the same as when formatting serially.
+  void formatPendingLines() {
+    if (PendingLines.empty())
+      return;
+
+    // Column numbers are computed through the SourceManager, which caches the
+    // last FileID it looked up. Make sure that it already refers to the
+    // formatted file, so that the searches do not update it.
+    SourceMgr.getSpellingColumnNumber(
+        PendingLines[0].Line->First->Tok.getLocation());
+
+    runInParallel(PendingLines.size(), NumThreads, findPendingPath, this);
+
+    for (unsigned i = 0, e = PendingLines.size(); i != e; ++i) {
+      const PendingLine &Pending = PendingLines[i];
+      if (!Pending.Found)
+        continue;
+      ContinuationIndenter Indenter(Style, SourceMgr, Whitespaces, Encoding,
+                                    BinPackInconclusiveFunctions);
+      UnwrappedLineFormatter Formatter(&Indenter, &Whitespaces, Style,
+                                       *Pending.Line);
+      Formatter.applyPath(Pending.Indent, Pending.Path);
+    }
+    PendingLines.clear();
+  }
+
   void deriveLocalStyle() {
     unsigned CountBoundToVariable = 0;
     unsigned CountBoundToType = 0;
@@ -1179,6 +1286,8 @@ private:
   WhitespaceManager Whitespaces;
   std::vector<CharSourceRange> Ranges;
   SmallVector<AnnotatedLine *, 16> AnnotatedLines;
+  unsigned NumThreads;
+  std::vector<PendingLine> PendingLines;
 
   encoding::Encoding Encoding;
   bool BinPackInconclusiveFunctions;
@@ -1188,14 +1297,15 @@ private:
 
 tooling::Replacements reformat(const FormatStyle &Style, Lexer &Lex,
                                SourceManager &SourceMgr,
-                               std::vector<CharSourceRange> Ranges) {
-  Formatter formatter(Style, Lex, SourceMgr, Ranges);
+                               std::vector<CharSourceRange> Ranges,
+                               unsigned NumThreads) {
+  Formatter formatter(Style, Lex, SourceMgr, Ranges, NumThreads);
   return formatter.format();
 }
 
 tooling::Replacements reformat(const FormatStyle &Style, StringRef Code,
                                std::vector<tooling::Range> Ranges,
-                               StringRef FileName) {
+                               StringRef FileName, unsigned NumThreads) {
   FileManager Files((FileSystemOptions()));
   DiagnosticsEngine Diagnostics(
       IntrusiveRefCntPtr<DiagnosticIDs>(new DiagnosticIDs),
@@ -1216,7 +1326,7 @@ tooling::Replacements reformat(const FormatStyle &Style, StringRef Code,
     SourceLocation End = Start.getLocWithOffset(Ranges[i].getLength());
     CharRanges.push_back(CharSourceRange::getCharRange(Start, End));
   }
-  return reformat(Style, Lex, SourceMgr, CharRanges);
+  return reformat(Style, Lex, SourceMgr, CharRanges, NumThreads);
 }
 
 LangOptions getFormattingLangOpts(FormatStyle::LanguageStandard Standard) {
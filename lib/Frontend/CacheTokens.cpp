@@ -59,20 +59,28 @@ class PTHEntryKeyVariant {
   union { const FileEntry* FE; const char* Path; };
   enum { IsFE = 0x1, IsDE = 0x2, IsNoExist = 0x0 } Kind;
   FileData *Data;
+  const char *Name;
 
 public:
-  PTHEntryKeyVariant(const FileEntry *fe) : FE(fe), Kind(IsFE), Data(0) {}
+  PTHEntryKeyVariant(const FileEntry *fe)
+      : FE(fe), Kind(IsFE), Data(0), Name(0) {}
+
+  /// Key the tokens of the file by 'name' instead of its path.
+  PTHEntryKeyVariant(const FileEntry *fe, const char *name)
+      : FE(fe), Kind(IsFE), Data(0), Name(name) {}
 
   PTHEntryKeyVariant(FileData *Data, const char *path)
-      : Path(path), Kind(IsDE), Data(new FileData(*Data)) {}
+      : Path(path), Kind(IsDE), Data(new FileData(*Data)), Name(0) {}
 
   explicit PTHEntryKeyVariant(const char *path)
-      : Path(path), Kind(IsNoExist), Data(0) {}
+      : Path(path), Kind(IsNoExist), Data(0), Name(0) {}
 
   bool isFile() const { return Kind == IsFE; }
 
   StringRef getString() const {
-    return Kind == IsFE ? FE->getName() : Path;
+    if (Kind != IsFE)
+      return Path;
+    return Name ? Name : FE->getName();
   }
 
   unsigned getKind() const { return (unsigned) Kind; }
@@ -180,6 +188,10 @@ class PTHWriter {
   Offset CurStrOffset;
   std::vector<llvm::StringMapEntry<OffsetOpt>*> StrEntries;
 
+  /// Whether a lexed file had unbalanced preprocessor conditionals, in which
+  /// case its conditional table is bogus.
+  bool UnbalancedConditionals;
+
   //// Get the persistent id for the given IdentifierInfo*.
   uint32_t ResolveID(const IdentifierInfo* II);
 
@@ -214,12 +226,26 @@ class PTHWriter {
   PTHEntry LexTokens(Lexer& L);
   Offset EmitCachedSpellings();
 
+  /// EmitPrologue - Emit the prologue, returning the offset of the words to
+  /// backpatch with the offsets of the tables.
+  Offset EmitPrologue(const std::string &MainFile);
+
+  /// EmitTables - Emit the tables that follow the token data, and backpatch
+  /// the prologue.
+  void EmitTables(Offset PrologueOffset);
+
 public:
   PTHWriter(llvm::raw_fd_ostream& out, Preprocessor& pp)
-    : Out(out), PP(pp), idcount(0), CurStrOffset(0) {}
+    : Out(out), PP(pp), idcount(0), CurStrOffset(0),
+      UnbalancedConditionals(false) {}
 
   PTHMap &getPM() { return PM; }
   void GeneratePTH(const std::string &MainFile);
+
+  /// GenerateHeaderPTH - Generate a PTH file that only caches the tokens of
+  /// the specified file, keyed by 'Key'.  Returns false if the tokens of the
+  /// file cannot be cached.
+  bool GenerateHeaderPTH(FileID FID, const char *Key);
 };
 } // end anonymous namespace
 
@@ -370,8 +396,11 @@ PTHEntry PTHWriter::LexTokens(Lexer& L) {
         // This will later be set to zero when emitting to the PTH file.  We
         // use 0 for uninitialized indices because that is easier to debug.
         unsigned index = PPCond.size();
+        if (PPStartCond.empty()) {
+          UnbalancedConditionals = true;
+          break;
+        }
         // Backpatch the opening '#if' entry.
-        assert(!PPStartCond.empty());
         assert(PPCond.size() > PPStartCond.back());
         assert(PPCond[PPStartCond.back()].second == 0);
         PPCond[PPStartCond.back()].second = index;
@@ -395,8 +424,11 @@ PTHEntry PTHWriter::LexTokens(Lexer& L) {
         // This serves as both a closing and opening of a conditional block.
         // This means that its entry will get backpatched later.
         unsigned index = PPCond.size();
+        if (PPStartCond.empty()) {
+          UnbalancedConditionals = true;
+          break;
+        }
         // Backpatch the previous '#if' entry.
-        assert(!PPStartCond.empty());
         assert(PPCond.size() > PPStartCond.back());
         assert(PPCond[PPStartCond.back()].second == 0);
         PPCond[PPStartCond.back()].second = index;
@@ -413,7 +445,8 @@ PTHEntry PTHWriter::LexTokens(Lexer& L) {
   }
   while (Tok.isNot(tok::eof));
 
-  assert(PPStartCond.empty() && "Error: imblanced preprocessor conditionals.");
+  if (!PPStartCond.empty())
+    UnbalancedConditionals = true;
 
   // Next write out PPCond.
   Offset PPCondOff = (Offset) Out.tell();
@@ -424,7 +457,8 @@ PTHEntry PTHWriter::LexTokens(Lexer& L) {
   for (unsigned i = 0, e = PPCond.size(); i!=e; ++i) {
     Emit32(PPCond[i].first - TokenOff);
     uint32_t x = PPCond[i].second;
-    assert(x != 0 && "PPCond entry not backpatched.");
+    assert((x != 0 || UnbalancedConditionals) &&
+           "PPCond entry not backpatched.");
     // Emit zero for #endifs.  This allows us to do checking when
     // we read the PTH file back in.
     Emit32(x == i ? 0 : x);
@@ -444,7 +478,7 @@ Offset PTHWriter::EmitCachedSpellings() {
   return SpellingsOff;
 }
 
-void PTHWriter::GeneratePTH(const std::string &MainFile) {
+Offset PTHWriter::EmitPrologue(const std::string &MainFile) {
   // Generate the prologue.
   Out << "cfe-pth" << '\0';
   Emit32(PTHManager::Version);
@@ -463,6 +497,30 @@ void PTHWriter::GeneratePTH(const std::string &MainFile) {
   }
   Emit8(0);
 
+  return PrologueOffset;
+}
+
+void PTHWriter::EmitTables(Offset PrologueOffset) {
+  // Write out the identifier table.
+  const std::pair<Offset,Offset> &IdTableOff = EmitIdentifierTable();
+
+  // Write out the cached strings table.
+  Offset SpellingOff = EmitCachedSpellings();
+
+  // Write out the file table.
+  Offset FileTableOff = EmitFileTable();
+
+  // Finally, write the prologue.
+  Out.seek(PrologueOffset);
+  Emit32(IdTableOff.first);
+  Emit32(IdTableOff.second);
+  Emit32(FileTableOff);
+  Emit32(SpellingOff);
+}
+
+void PTHWriter::GeneratePTH(const std::string &MainFile) {
+  Offset PrologueOffset = EmitPrologue(MainFile);
+
   // Iterate over all the files in SourceManager.  Create a lexer
   // for each file and cache the tokens.
   SourceManager &SM = PP.getSourceManager();
@@ -486,21 +544,26 @@ void PTHWriter::GeneratePTH(const std::string &MainFile) {
     PM.insert(FE, LexTokens(L));
   }
 
-  // Write out the identifier table.
-  const std::pair<Offset,Offset> &IdTableOff = EmitIdentifierTable();
-
-  // Write out the cached strings table.
-  Offset SpellingOff = EmitCachedSpellings();
+  EmitTables(PrologueOffset);
+}
 
-  // Write out the file table.
-  Offset FileTableOff = EmitFileTable();
+bool PTHWriter::GenerateHeaderPTH(FileID FID, const char *Key) {
+  Offset PrologueOffset = EmitPrologue(std::string());
 
-  // Finally, write the prologue.
-  Out.seek(PrologueOffset);
-  Emit32(IdTableOff.first);
-  Emit32(IdTableOff.second);
-  Emit32(FileTableOff);
-  Emit32(SpellingOff);
+  SourceManager &SM = PP.getSourceManager();
+  bool Invalid = false;
+  const llvm::MemoryBuffer *FromFile = SM.getBuffer(FID, &Invalid);
+  const FileEntry *FE = SM.getFileEntryForID(FID);
+  if (Invalid || !FE)
+    return false;
+
+  Lexer L(FID, FromFile, SM, PP.getLangOpts());
+  PM.insert(PTHEntryKeyVariant(FE, Key), LexTokens(L));
+  if (UnbalancedConditionals)
+    return false;
+
+  EmitTables(PrologueOffset);
+  return true;
 }
 
 namespace {
@@ -561,6 +624,12 @@ void clang::CacheTokens(Preprocessor &PP, llvm::raw_fd_ostream* OS) {
   PW.GeneratePTH(MainFilePath.str());
 }
 
+bool clang::CacheHeaderTokens(Preprocessor &PP, FileID FID, const char *Key,
+                              llvm::raw_fd_ostream *OS) {
+  PTHWriter PW(*OS, PP);
+  return PW.GenerateHeaderPTH(FID, Key);
+}
+
 //===----------------------------------------------------------------------===//
 
 namespace {
@@ -13,6 +13,7 @@
 #include "clang/AST/Decl.h"
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/FileManager.h"
+#include "clang/Basic/Parallel.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Basic/TargetInfo.h"
 #include "clang/Basic/Version.h"
@@ -26,17 +27,24 @@
 #include "clang/Frontend/Utils.h"
 #include "clang/Frontend/VerifyDiagnosticConsumer.h"
 #include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/HeaderTokenCache.h"
+#include "clang/Lex/Lexer.h"
 #include "clang/Lex/PTHManager.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Sema/CodeCompleteConsumer.h"
 #include "clang/Sema/Sema.h"
 #include "clang/Serialization/ASTReader.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Config/config.h"
 #include "llvm/Support/CrashRecoveryContext.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Program.h"
@@ -44,6 +52,9 @@
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/system_error.h"
+#include <algorithm>
+#include <map>
+#include <set>
 #include <sys/stat.h>
 #include <time.h>
 
@@ -51,11 +62,13 @@ using namespace clang;
 
 CompilerInstance::CompilerInstance()
   : Invocation(new CompilerInvocation()), ModuleManager(0),
-    BuildGlobalModuleIndex(false), ModuleBuildFailed(false) {
+    BuildGlobalModuleIndex(false), ModuleBuildFailed(false),
+    ModulesPrebuilt(false), StartTime(::time(0)) {
 }
 
 CompilerInstance::~CompilerInstance() {
   assert(OutputFiles.empty() && "Still output files in flight?");
+  llvm::DeleteContainerPointers(PrebuiltModuleDiags);
 }
 
 void CompilerInstance::setInvocation(CompilerInvocation *Value) {
@@ -233,11 +246,18 @@ void CompilerInstance::createPreprocessor() {
   if (PTHMgr) {
     PTHMgr->setPreprocessor(&*PP);
     PP->setPTHManager(PTHMgr);
+  } else if (!PPOpts.HeaderTokenCachePath.empty()) {
+    PP->setHeaderTokenCache(new HeaderTokenCache(PPOpts.HeaderTokenCachePath,
+                                                 getLangOpts()));
+    AttachHeaderTokenCacheGen(*PP);
   }
 
   if (PPOpts.DetailedRecord)
     PP->createPreprocessingRecord();
 
+  if (PPOpts.MemoizeMacroExpansions)
+    PP->createMacroExpansionCache();
+
   InitializePreprocessor(*PP, PPOpts, getHeaderSearchOpts(), getFrontendOpts());
 
   PP->setPreprocessedOutput(getPreprocessorOutputOpts().ShowCPP);
@@ -275,6 +295,17 @@ void CompilerInstance::createPreprocessor() {
     AttachHeaderIncludeGen(*PP, /*ShowAllHeaders=*/false, /*OutputPath=*/"",
                            /*ShowDepth=*/true, /*MSStyle=*/true);
   }
+
+  // Headers skipped for a guard learned by an earlier translation unit are
+  // never entered, so they would be missing from header lists and from line
+  // markers in preprocessed output.
+  if (DepOpts.ShowHeaderIncludes || !DepOpts.HeaderIncludeOutputFile.empty() ||
+      DepOpts.PrintShowIncludes || getPreprocessorOutputOpts().ShowCPP)
+    PP->getHeaderSearchInfo().setUseSharedIncludeGuards(false);
+
+  // Handle recording where headers are found, if requested.
+  if (!getHeaderSearchOpts().HeaderSearchMapOutput.empty())
+    AttachHeaderSearchMapGen(*PP, getHeaderSearchOpts().HeaderSearchMapOutput);
 }
 
 // ASTContext
@@ -733,6 +764,11 @@ bool CompilerInstance::ExecuteAction(FrontendAction &Act) {
     OS << "\n";
   }
 
+  // Modules built for this translation unit are reported along with it.
+  if (getFrontendOpts().ShowStats && getLangOpts().Modules &&
+      getLangOpts().CurrentModule.empty())
+    printModuleCacheStats(OS);
+
   return !getDiagnostics().getClient()->getNumErrors();
 }
 
@@ -780,33 +816,81 @@ namespace {
   };
 }
 
-/// \brief Compile a module file for the given module, using the options 
-/// provided by the importing compiler instance.
-static void compileModule(CompilerInstance &ImportingInstance,
-                          SourceLocation ImportLoc,
-                          Module *Module,
-                          StringRef ModuleFileName) {
-  // FIXME: have LockFileManager return an error_code so that we can
-  // avoid the mkdir when the directory already exists.
-  StringRef Dir = llvm::sys::path::parent_path(ModuleFileName);
-  llvm::sys::fs::create_directories(Dir);
+/// \brief Compute the path of the file in the module cache that stores the
+/// module files with the given contents.
+static bool getModuleStoreFileName(StringRef ModuleFileName,
+                                   StringRef ModuleCachePath,
+                                   SmallVectorImpl<char> &StoreFileName) {
+  OwningPtr<llvm::MemoryBuffer> Buffer;
+  if (llvm::MemoryBuffer::getFile(ModuleFileName, Buffer))
+    return false;
 
-  llvm::LockFileManager Locked(ModuleFileName);
-  switch (Locked) {
-  case llvm::LockFileManager::LFS_Error:
-    return;
+  llvm::MD5 Hash;
+  Hash.update(Buffer->getBuffer());
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Key;
+  llvm::MD5::stringifyResult(Result, Key);
 
-  case llvm::LockFileManager::LFS_Owned:
-    // We're responsible for building the module ourselves. Do so below.
-    break;
+  StoreFileName.assign(ModuleCachePath.begin(), ModuleCachePath.end());
+  llvm::sys::path::append(StoreFileName, "store", Key.str() + ".pcm");
+  return true;
+}
 
-  case llvm::LockFileManager::LFS_Shared:
-    // Someone else is responsible for building the module. Wait for them to
-    // finish.
-    Locked.waitForUnlock();
-    return;
+/// \brief Store a module file that was just built in the content-addressed
+/// store of the module cache.
+///
+/// The store holds a hard link to every module file in the module cache,
+/// named after the hash of its contents.  When the store already has a
+/// module file with the same contents, e.g., because the module was rebuilt
+/// after a change that did not affect it, the new module file is replaced by
+/// a link to the stored one.  Both then share one copy, and the module files
+/// that import it, which check its size and modification time, stay valid.
+///
+/// \returns true if the module file now shares the storage of a module file
+/// that was already in the store.
+static bool shareModuleFile(StringRef ModuleFileName,
+                            StringRef ModuleCachePath) {
+  SmallString<128> StoreFileName;
+  if (!getModuleStoreFileName(ModuleFileName, ModuleCachePath, StoreFileName))
+    return false;
+
+  if (llvm::sys::fs::create_directories(
+          llvm::sys::path::parent_path(StoreFileName.str())))
+    return false;
+
+  // If the store does not have these contents yet, add the module file.  This
+  // fails harmlessly if the file system does not support hard links, or if
+  // another build added the same contents first.
+  if (!llvm::sys::fs::exists(StoreFileName.str())) {
+    llvm::sys::fs::create_hard_link(ModuleFileName, StoreFileName.str());
+    return false;
   }
 
+  // Replace the module file with a link to the stored one.  Readers of the
+  // module file either see the old file or the new link, never neither.
+  SmallString<128> LinkFileName(ModuleFileName);
+  LinkFileName += ".link";
+  bool Existed;
+  llvm::sys::fs::remove(LinkFileName.str(), Existed);
+  if (llvm::sys::fs::create_hard_link(StoreFileName.str(), LinkFileName.str()))
+    return false;
+  if (llvm::sys::fs::rename(LinkFileName.str(), ModuleFileName)) {
+    llvm::sys::fs::remove(LinkFileName.str(), Existed);
+    return false;
+  }
+  return true;
+}
+
+/// \brief Create the invocation that builds the given module, using the
+/// options provided by the importing compiler instance.
+///
+/// If the module is not described by a module map file, a temporary one is
+/// written, which the caller removes once the module has been built.
+static IntrusiveRefCntPtr<CompilerInvocation>
+createModuleInvocation(CompilerInstance &ImportingInstance, Module *Module,
+                       StringRef ModuleFileName,
+                       SmallString<128> &TempModuleMapFileName) {
   ModuleMap &ModMap 
     = ImportingInstance.getPreprocessor().getHeaderSearchInfo().getModuleMap();
     
@@ -852,7 +936,6 @@ static void compileModule(CompilerInstance &ImportingInstance,
   InputKind IK = getSourceInputKindFromOptions(*Invocation->getLangOpts());
 
   // Get or create the module map that we'll use to build this module.
-  SmallString<128> TempModuleMapFileName;
   if (const FileEntry *ModuleMapFile
                                   = ModMap.getContainingModuleMapFile(Module)) {
     // Use the module map where this module resides.
@@ -865,7 +948,7 @@ static void compileModule(CompilerInstance &ImportingInstance,
                                            TempModuleMapFileName)) {
       ImportingInstance.getDiagnostics().Report(diag::err_module_map_temp_file)
         << TempModuleMapFileName;
-      return;
+      return 0;
     }
     // Print the module map to this file.
     llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
@@ -880,25 +963,99 @@ static void compileModule(CompilerInstance &ImportingInstance,
   Invocation->getDiagnosticOpts().VerifyDiagnostics = 0;
   assert(ImportingInstance.getInvocation().getModuleHash() ==
          Invocation->getModuleHash() && "Module hash mismatch!");
-  
+  return Invocation;
+}
+
+namespace clang {
+  /// \brief The diagnostics of a module built ahead of time, along with the
+  /// source manager their locations refer to.
+  struct PrebuiltModuleDiagnostics {
+    std::string ModuleFileName;
+    IntrusiveRefCntPtr<DiagnosticsEngine> Diags;
+    IntrusiveRefCntPtr<FileManager> FileMgr;
+    IntrusiveRefCntPtr<SourceManager> SourceMgr;
+    SmallVector<StoredDiagnostic, 4> Diagnostics;
+  };
+}
+
+namespace {
+  /// \brief Diagnostic consumer that stores the diagnostics of a module
+  /// built ahead of time.
+  ///
+  /// The diagnostics are not counted, so that the compiler instance building
+  /// the module doesn't print a summary; they are counted when reported.
+  class PrebuildDiagnosticConsumer : public DiagnosticConsumer {
+    SmallVectorImpl<StoredDiagnostic> &Diagnostics;
+
+  public:
+    explicit PrebuildDiagnosticConsumer(
+        SmallVectorImpl<StoredDiagnostic> &Diagnostics)
+      : Diagnostics(Diagnostics) { }
+
+    virtual void HandleDiagnostic(DiagnosticsEngine::Level Level,
+                                  const Diagnostic &Info) {
+      Diagnostics.push_back(StoredDiagnostic(Level, Info));
+    }
+  };
+}
+
+/// \brief Build a module file with the given invocation, in a new compiler
+/// instance that reports its diagnostics to \p DiagClient.
+///
+/// If \p Prebuilt is given, it keeps the diagnostics engine and the source
+/// manager of the new compiler instance, so that diagnostics stored by
+/// \p DiagClient can be reported later.
+///
+/// The module file is locked while it is built, so that other compilers,
+/// in this process or others, wait for it to be built instead of building it
+/// again.  This function can run on any thread, provided that nothing else
+/// uses the invocation while it does.
+///
+/// \returns true if this compiler built the module file, successfully or
+/// not, and false if another compiler did.
+static bool buildModuleFile(CompilerInvocation &Invocation,
+                            DiagnosticConsumer *DiagClient,
+                            ModuleBuildStack BuildStack,
+                            Module *Module, FullSourceLoc ImportLoc,
+                            StringRef ModuleFileName,
+                            CompilerInstance::ModuleCacheStatistics &Stats,
+                            PrebuiltModuleDiagnostics *Prebuilt = 0) {
+  // FIXME: have LockFileManager return an error_code so that we can
+  // avoid the mkdir when the directory already exists.
+  StringRef Dir = llvm::sys::path::parent_path(ModuleFileName);
+  llvm::sys::fs::create_directories(Dir);
+
+  llvm::LockFileManager Locked(ModuleFileName);
+  switch (Locked) {
+  case llvm::LockFileManager::LFS_Error:
+    delete DiagClient;
+    return false;
+
+  case llvm::LockFileManager::LFS_Owned:
+    // We're responsible for building the module ourselves. Do so below.
+    break;
+
+  case llvm::LockFileManager::LFS_Shared:
+    // Someone else is responsible for building the module. Wait for them to
+    // finish.
+    delete DiagClient;
+    Locked.waitForUnlock();
+    return false;
+  }
+
   // Construct a compiler instance that will be used to actually create the
   // module.
   CompilerInstance Instance;
-  Instance.setInvocation(&*Invocation);
-
-  Instance.createDiagnostics(new ForwardingDiagnosticConsumer(
-                                   ImportingInstance.getDiagnosticClient()),
-                             /*ShouldOwnClient=*/true);
+  Instance.setInvocation(&Invocation);
+  Instance.createDiagnostics(DiagClient, /*ShouldOwnClient=*/true);
 
   // Note that this module is part of the module build stack, so that we
   // can detect cycles in the module graph.
   Instance.createFileManager(); // FIXME: Adopt file manager from importer?
   Instance.createSourceManager(Instance.getFileManager());
   SourceManager &SourceMgr = Instance.getSourceManager();
-  SourceMgr.setModuleBuildStack(
-    ImportingInstance.getSourceManager().getModuleBuildStack());
-  SourceMgr.pushModuleBuildStack(Module->getTopLevelModuleName(),
-    FullSourceLoc(ImportLoc, ImportingInstance.getSourceManager()));
+  SourceMgr.setModuleBuildStack(BuildStack);
+  SourceMgr.pushModuleBuildStack(Module->getTopLevelModuleName(), ImportLoc);
 
 
   // Construct a module-generating action.
@@ -912,21 +1069,552 @@ static void compileModule(CompilerInstance &ImportingInstance,
   CRC.RunSafelyOnThread(&doCompileMapModule, &Data, ThreadStackSize);
 
   
+  Instance.clearOutputFiles(/*EraseFiles=*/true);
+
+  if (Prebuilt) {
+    Prebuilt->Diags = &Instance.getDiagnostics();
+    Prebuilt->FileMgr = &Instance.getFileManager();
+    Prebuilt->SourceMgr = &Instance.getSourceManager();
+  }
+
+  // Account for the modules built on behalf of the module we just built.
+  const CompilerInstance::ModuleCacheStatistics &InstanceStats
+    = Instance.getModuleCacheStats();
+  Stats.NumModulesBuilt += InstanceStats.NumModulesBuilt;
+  Stats.NumModuleFilesShared += InstanceStats.NumModuleFilesShared;
+  Stats.NumModuleFilesPruned += InstanceStats.NumModuleFilesPruned;
+
+  // If we built the module file, store it by its contents, while we still
+  // hold the lock on it.
+  const std::string &ModuleCachePath
+    = Invocation.getHeaderSearchOpts().ModuleCachePath;
+  if (llvm::sys::fs::exists(ModuleFileName)) {
+    ++Stats.NumModulesBuilt;
+    if (!ModuleCachePath.empty() &&
+        shareModuleFile(ModuleFileName, ModuleCachePath))
+      ++Stats.NumModuleFilesShared;
+  }
+  return true;
+}
+
+/// \brief Compile a module file for the given module, using the options 
+/// provided by the importing compiler instance.
+static void compileModule(CompilerInstance &ImportingInstance,
+                          SourceLocation ImportLoc,
+                          Module *Module,
+                          StringRef ModuleFileName) {
+  SmallString<128> TempModuleMapFileName;
+  IntrusiveRefCntPtr<CompilerInvocation> Invocation
+    = createModuleInvocation(ImportingInstance, Module, ModuleFileName,
+                             TempModuleMapFileName);
+  if (!Invocation)
+    return;
+
+  SourceManager &ImportingSourceMgr = ImportingInstance.getSourceManager();
+  bool Built = buildModuleFile(*Invocation,
+                               new ForwardingDiagnosticConsumer(
+                                 ImportingInstance.getDiagnosticClient()),
+                               ImportingSourceMgr.getModuleBuildStack(),
+                               Module,
+                               FullSourceLoc(ImportLoc, ImportingSourceMgr),
+                               ModuleFileName,
+                               ImportingInstance.getModuleCacheStats());
+
   // Delete the temporary module map file.
   // FIXME: Even though we're executing under crash protection, it would still
   // be nice to do this with RemoveFileOnSignal when we can. However, that
   // doesn't make sense for all clients, so clean this up manually.
-  Instance.clearOutputFiles(/*EraseFiles=*/true);
   if (!TempModuleMapFileName.empty())
     llvm::sys::fs::remove(TempModuleMapFileName.str());
 
   // We've rebuilt a module. If we're allowed to generate or update the global
   // module index, record that fact in the importing compiler instance.
-  if (ImportingInstance.getFrontendOpts().GenerateGlobalModuleIndex) {
+  if (Built && ImportingInstance.getFrontendOpts().GenerateGlobalModuleIndex) {
     ImportingInstance.setBuildGlobalModuleIndex(true);
   }
 }
 
+namespace {
+  /// \brief Finds the modules that files import, by scanning them for module
+  /// imports and for inclusions of headers that belong to modules.
+  ///
+  /// Files are scanned with a raw lexer instead of being preprocessed, so
+  /// the scan does not expand macros or evaluate conditions. It only follows
+  /// the imports and inclusions outside of preprocessor conditionals, other
+  /// than include guards, and misses imports that are spelled with macros or
+  /// made conditionally, so it is only good for building modules ahead of
+  /// time.
+  class ModuleImportScanner {
+    HeaderSearch &HS;
+    FileManager &FileMgr;
+    const LangOptions &LangOpts;
+
+    typedef llvm::SmallPtrSet<const FileEntry *, 16> FileSet;
+
+    void scanFile(const FileEntry *File, Module *Importer, FileSet &Visited,
+                  llvm::SetVector<Module *> &Imports);
+
+  public:
+    ModuleImportScanner(HeaderSearch &HS, FileManager &FileMgr,
+                        const LangOptions &LangOpts)
+      : HS(HS), FileMgr(FileMgr), LangOpts(LangOpts) { }
+
+    /// \brief Find the top-level modules imported by the given file, and by
+    /// the headers it includes that do not belong to a module.
+    void scanFile(const FileEntry *File, llvm::SetVector<Module *> &Imports) {
+      FileSet Visited;
+      scanFile(File, 0, Visited, Imports);
+    }
+
+    /// \brief Find the top-level modules imported by the headers of the given
+    /// top-level module.
+    void scanModule(Module *Mod, llvm::SetVector<Module *> &Imports);
+  };
+}
+
+/// \brief Determine whether the given token is the raw identifier \p Name.
+static bool isRawIdentifier(const Token &Tok, StringRef Name) {
+  return Tok.is(tok::raw_identifier) &&
+         StringRef(Tok.getRawIdentifierData(), Tok.getLength()) == Name;
+}
+
+/// \brief Read the file name of an inclusion directive, which starts at
+/// \p Ptr, the end of the directive name.
+static bool readIncludeFilename(const char *Ptr, const char *End,
+                                StringRef &Filename, bool &IsAngled) {
+  while (Ptr != End && (*Ptr == ' ' || *Ptr == '\t'))
+    ++Ptr;
+  if (Ptr == End || (*Ptr != '"' && *Ptr != '<'))
+    return false;
+
+  char Terminator = *Ptr == '<' ? '>' : '"';
+  const char *Start = ++Ptr;
+  while (Ptr != End && *Ptr != Terminator && *Ptr != '\n' && *Ptr != '\r')
+    ++Ptr;
+  if (Ptr == End || *Ptr != Terminator || Ptr == Start)
+    return false;
+
+  Filename = StringRef(Start, Ptr - Start);
+  IsAngled = Terminator == '>';
+  return true;
+}
+
+void ModuleImportScanner::scanFile(const FileEntry *File, Module *Importer,
+                                   FileSet &Visited,
+                                   llvm::SetVector<Module *> &Imports) {
+  if (!Visited.insert(File))
+    return;
+
+  OwningPtr<llvm::MemoryBuffer> Buffer(FileMgr.getBufferForFile(File));
+  if (!Buffer)
+    return;
+
+  Lexer L(SourceLocation(), LangOpts, Buffer->getBufferStart(),
+          Buffer->getBufferStart(), Buffer->getBufferEnd());
+
+  // For each open conditional, whether it may be the include guard of the
+  // file: an #ifndef before anything else, whose macro the next line
+  // defines. Depth counts the open conditionals that are not.
+  SmallVector<bool, 8> IsGuard;
+  unsigned Depth = 0;
+  bool AtStart = true;
+  StringRef GuardMacro;
+
+  Token Tok;
+  while (true) {
+    L.LexFromRawLexer(Tok);
+    if (Tok.is(tok::eof))
+      break;
+
+    bool WasAtStart = AtStart;
+    AtStart = false;
+    StringRef PendingGuardMacro = GuardMacro;
+    GuardMacro = StringRef();
+
+    if (Tok.isNot(tok::hash) || !Tok.isAtStartOfLine()) {
+      if (!PendingGuardMacro.empty()) {
+        IsGuard.back() = false;
+        ++Depth;
+      }
+
+      // @import module.name;
+      if (Tok.isNot(tok::at) || Depth)
+        continue;
+      L.LexFromRawLexer(Tok);
+      if (!isRawIdentifier(Tok, "import"))
+        continue;
+      L.LexFromRawLexer(Tok);
+      if (Tok.isNot(tok::raw_identifier))
+        continue;
+      StringRef Name(Tok.getRawIdentifierData(), Tok.getLength());
+      if (Module *Imported = HS.lookupModule(Name))
+        if (Imported != Importer)
+          Imports.insert(Imported);
+      continue;
+    }
+
+    L.LexFromRawLexer(Tok);
+    if (!PendingGuardMacro.empty()) {
+      bool IsDefine = isRawIdentifier(Tok, "define");
+      if (IsDefine) {
+        Token Name;
+        L.LexFromRawLexer(Name);
+        if (isRawIdentifier(Name, PendingGuardMacro))
+          continue;
+      }
+      IsGuard.back() = false;
+      ++Depth;
+      if (IsDefine)
+        continue;
+    }
+    if (Tok.isNot(tok::raw_identifier))
+      continue;
+
+    StringRef Directive(Tok.getRawIdentifierData(), Tok.getLength());
+    if (Directive == "if" || Directive == "ifdef" || Directive == "ifndef") {
+      if (WasAtStart && Directive == "ifndef") {
+        L.LexFromRawLexer(Tok);
+        if (Tok.is(tok::raw_identifier)) {
+          GuardMacro = StringRef(Tok.getRawIdentifierData(), Tok.getLength());
+          IsGuard.push_back(true);
+          continue;
+        }
+      }
+      IsGuard.push_back(false);
+      ++Depth;
+      continue;
+    }
+    if (Directive == "elif" || Directive == "else") {
+      if (!IsGuard.empty() && IsGuard.back()) {
+        IsGuard.back() = false;
+        ++Depth;
+      }
+      continue;
+    }
+    if (Directive == "endif") {
+      if (!IsGuard.empty()) {
+        if (!IsGuard.back())
+          --Depth;
+        IsGuard.pop_back();
+      }
+      continue;
+    }
+
+    // #include and #import directives, which import the module of the header
+    // they include.
+    if (Depth || (Directive != "include" && Directive != "import"))
+      continue;
+
+    StringRef Filename;
+    bool IsAngled;
+    if (!readIncludeFilename(L.getBufferLocation(), Buffer->getBufferEnd(),
+                             Filename, IsAngled))
+      continue;
+
+    const DirectoryLookup *CurDir;
+    ModuleMap::KnownHeader SuggestedModule;
+    const FileEntry *Header = HS.LookupFile(Filename, IsAngled,
+                                            /*FromDir=*/0, CurDir, File,
+                                            /*SearchPath=*/0,
+                                            /*RelativePath=*/0,
+                                            &SuggestedModule);
+    if (!Header)
+      continue;
+
+    // Headers of the importing module, and headers that are not part of any
+    // module, are scanned as part of this file.
+    Module *Imported = 0;
+    if (SuggestedModule && SuggestedModule.isAvailable())
+      Imported = SuggestedModule.getModule()->getTopLevelModule();
+    if (!Imported || Imported == Importer)
+      scanFile(Header, Importer, Visited, Imports);
+    else
+      Imports.insert(Imported);
+  }
+}
+
+void ModuleImportScanner::scanModule(Module *Mod,
+                                     llvm::SetVector<Module *> &Imports) {
+  FileSet Visited;
+  SmallVector<Module *, 4> Worklist(1, Mod);
+  while (!Worklist.empty()) {
+    Module *Submodule = Worklist.pop_back_val();
+    if (const FileEntry *Umbrella = Submodule->getUmbrellaHeader())
+      scanFile(Umbrella, Mod, Visited, Imports);
+    for (unsigned I = 0, N = Submodule->NormalHeaders.size(); I != N; ++I)
+      scanFile(Submodule->NormalHeaders[I], Mod, Visited, Imports);
+    for (unsigned I = 0, N = Submodule->PrivateHeaders.size(); I != N; ++I)
+      scanFile(Submodule->PrivateHeaders[I], Mod, Visited, Imports);
+    Worklist.append(Submodule->submodule_begin(), Submodule->submodule_end());
+  }
+}
+
+namespace {
+  /// \brief Determines whether a module file is out of date, by checking its
+  /// input files and the module files it imports the way the AST reader does
+  /// when the module file is loaded, but without content signatures.
+  class ModuleFileValidator : public ASTReaderListener {
+    FileManager &FileMgr;
+
+  public:
+    /// \brief Whether an input file or imported module file changed.
+    bool OutOfDate;
+
+    /// \brief The module files imported by the module file.
+    SmallVector<std::string, 4> Imports;
+
+    explicit ModuleFileValidator(FileManager &FileMgr)
+      : FileMgr(FileMgr), OutOfDate(false) { }
+
+    virtual bool needsInputFileVisitation() { return true; }
+
+    virtual bool visitInputFile(StringRef Filename, bool isSystem,
+                                bool isOverridden, off_t Size,
+                                time_t ModTime) {
+      if (isOverridden)
+        return true;
+      const FileEntry *File = FileMgr.getFile(Filename, /*OpenFile=*/false);
+      OutOfDate = !File || File->getSize() != Size ||
+                  File->getModificationTime() != ModTime;
+      return !OutOfDate;
+    }
+
+    virtual bool needsImportVisitation() { return true; }
+
+    virtual void visitImport(StringRef Filename, off_t Size, time_t ModTime) {
+      // Module files are rebuilt in place, so don't let the file manager
+      // remember their sizes and modification times.
+      Imports.push_back(Filename);
+      llvm::sys::fs::file_status Status;
+      if (llvm::sys::fs::status(Filename, Status) ||
+          (off_t)Status.getSize() != Size ||
+          Status.getLastModificationTime().toEpochTime() != ModTime)
+        OutOfDate = true;
+    }
+  };
+
+  /// \brief A module file that is built ahead of time, on a thread of its
+  /// own.
+  struct ModulePrebuild {
+    Module *Mod;
+    std::string ModuleFileName;
+    IntrusiveRefCntPtr<CompilerInvocation> Invocation;
+    SmallString<128> TempModuleMapFileName;
+    CompilerInstance::ModuleCacheStatistics Stats;
+    PrebuiltModuleDiagnostics *Diagnostics;
+
+    /// \brief Whether an out-of-date module file was removed to be rebuilt.
+    bool OutOfDate;
+
+    /// \brief Whether the module file was built.
+    bool Built;
+  };
+
+  /// \brief The module files built ahead of time for a translation unit.
+  struct ModulePrebuildGraph {
+    std::vector<ModulePrebuild> Prebuilds;
+
+    /// \brief The import that caused the modules to be built, which stands in
+    /// for the imports of every module on the module build stack.
+    FullSourceLoc ImportLoc;
+  };
+}
+
+/// \brief Build one of the module files of a \c ModulePrebuildGraph.
+static bool prebuildModule(void *UserData, unsigned Index) {
+  ModulePrebuildGraph &Graph = *static_cast<ModulePrebuildGraph *>(UserData);
+  ModulePrebuild &Prebuild = Graph.Prebuilds[Index];
+  if (!Prebuild.Invocation)
+    return false;
+
+  // Diagnostics are stored, to be reported when the module is loaded. If the
+  // module fails to build, it is built again when it is imported, and the
+  // diagnostics are reported then.
+  buildModuleFile(*Prebuild.Invocation,
+                  new PrebuildDiagnosticConsumer(
+                    Prebuild.Diagnostics->Diagnostics),
+                  ModuleBuildStack(), Prebuild.Mod, Graph.ImportLoc,
+                  Prebuild.ModuleFileName, Prebuild.Stats,
+                  Prebuild.Diagnostics);
+  Prebuild.Built = llvm::sys::fs::exists(Prebuild.ModuleFileName);
+  return Prebuild.Built;
+}
+
+void CompilerInstance::prebuildModules(Module *Mod, SourceLocation ImportLoc) {
+  HeaderSearch &HS = PP->getHeaderSearchInfo();
+  ModuleImportScanner Scanner(HS, getFileManager(), getLangOpts());
+
+  // Module files that are already loaded, e.g. by a precompiled header, are
+  // in use and cannot be rebuilt.
+  llvm::StringSet<> Loaded;
+  serialization::ModuleManager &ModuleMgr = ModuleManager->getModuleManager();
+  for (serialization::ModuleManager::ModuleIterator M = ModuleMgr.begin(),
+                                                    MEnd = ModuleMgr.end();
+       M != MEnd; ++M)
+    Loaded.insert((*M)->FileName);
+
+  // Find the modules imported by the main file, and the modules they import
+  // in turn. The imports of a module are read from its module file if it is
+  // up to date, and found by scanning its headers otherwise.
+  llvm::SetVector<Module *> Imports;
+  Imports.insert(Mod->getTopLevelModule());
+  if (const FileEntry *MainFile
+        = SourceMgr->getFileEntryForID(SourceMgr->getMainFileID()))
+    Scanner.scanFile(MainFile, Imports);
+
+  PreprocessorOptions &PPOpts = getPreprocessorOpts();
+  std::vector<Module *> Modules;
+  std::vector<std::string> ModuleFileNames;
+  std::vector<bool> NeedsBuild;
+  std::vector<llvm::SetVector<Module *> > ModuleImports;
+  llvm::DenseMap<Module *, unsigned> ModuleIndex;
+  for (unsigned I = 0; I != Imports.size(); ++I) {
+    Module *Imported = Imports[I];
+    std::string ModuleFileName = HS.getModuleFileName(Imported);
+    if (!Imported->isAvailable() ||
+        Imported->getTopLevelModuleName() == getLangOpts().CurrentModule ||
+        (PPOpts.FailedModules &&
+         PPOpts.FailedModules->hasAlreadyFailed(Imported->Name)) ||
+        Loaded.count(ModuleFileName))
+      continue;
+
+    bool Missing = !llvm::sys::fs::exists(ModuleFileName);
+    ModuleFileValidator Validator(getFileManager());
+    // Module files that cannot be read are left to the AST reader to
+    // diagnose.
+    if (!Missing && ASTReader::readASTFileControlBlock(ModuleFileName,
+                                                       getFileManager(),
+                                                       Validator))
+      continue;
+
+    ModuleIndex[Imported] = Modules.size();
+    Modules.push_back(Imported);
+    ModuleFileNames.push_back(ModuleFileName);
+    NeedsBuild.push_back(Missing || Validator.OutOfDate);
+    ModuleImports.push_back(llvm::SetVector<Module *>());
+    if (NeedsBuild.back()) {
+      Scanner.scanModule(Imported, ModuleImports.back());
+    } else {
+      // Module files are named after their modules.
+      for (unsigned J = 0, N = Validator.Imports.size(); J != N; ++J) {
+        StringRef Name = llvm::sys::path::stem(Validator.Imports[J]);
+        if (Module *ImportedByFile = HS.lookupModule(Name))
+          if (HS.getModuleFileName(ImportedByFile) == Validator.Imports[J])
+            ModuleImports.back().insert(ImportedByFile);
+      }
+    }
+    Imports.insert(ModuleImports.back().begin(), ModuleImports.back().end());
+  }
+
+  // A module file that imports a module file that is rebuilt is out of date
+  // too.
+  for (bool Changed = true; Changed; ) {
+    Changed = false;
+    for (unsigned I = 0, N = Modules.size(); I != N; ++I) {
+      for (unsigned J = 0, M = ModuleImports[I].size();
+           J != M && !NeedsBuild[I]; ++J) {
+        llvm::DenseMap<Module *, unsigned>::iterator Known
+          = ModuleIndex.find(ModuleImports[I][J]);
+        if (Known != ModuleIndex.end() && NeedsBuild[Known->second]) {
+          NeedsBuild[I] = true;
+          Changed = true;
+        }
+      }
+    }
+  }
+
+  // Create the invocations here, because creating them reads the state of
+  // this compiler instance. Every module is built as soon as the modules it
+  // imports have been built; modules that fail to build, the modules that
+  // import them, and modules in import cycles are left to be built when they
+  // are imported.
+  ModulePrebuildGraph Graph;
+  Graph.ImportLoc = FullSourceLoc(ImportLoc, getSourceManager());
+  std::vector<unsigned> GraphIndex(Modules.size());
+  for (unsigned I = 0, N = Modules.size(); I != N; ++I) {
+    if (!NeedsBuild[I])
+      continue;
+    GraphIndex[I] = Graph.Prebuilds.size();
+    Graph.Prebuilds.push_back(ModulePrebuild());
+    ModulePrebuild &Prebuild = Graph.Prebuilds.back();
+    Prebuild.Mod = Modules[I];
+    Prebuild.ModuleFileName = ModuleFileNames[I];
+    Prebuild.Diagnostics = 0;
+    Prebuild.Built = false;
+    Prebuild.OutOfDate = false;
+    Prebuild.Invocation
+      = createModuleInvocation(*this, Modules[I], ModuleFileNames[I],
+                               Prebuild.TempModuleMapFileName);
+    if (!Prebuild.Invocation)
+      continue;
+
+    // Concurrent builds must not share the set of failed modules, nor write
+    // the statistics and auxiliary outputs of this compilation.
+    CompilerInvocation &Invocation = *Prebuild.Invocation;
+    Invocation.getPreprocessorOpts().FailedModules
+      = new PreprocessorOptions::FailedModulesSet;
+    Invocation.getFrontendOpts().ShowStats = false;
+    Invocation.getFrontendOpts().ShowTimers = false;
+    Invocation.getDiagnosticOpts().DiagnosticLogFile.clear();
+    Invocation.getDiagnosticOpts().DiagnosticSerializationFile.clear();
+    Invocation.getDependencyOutputOpts() = DependencyOutputOptions();
+    Invocation.getHeaderSearchOpts().HeaderSearchMapOutput.clear();
+    Prebuild.Diagnostics = new PrebuiltModuleDiagnostics;
+    Prebuild.Diagnostics->ModuleFileName = ModuleFileNames[I];
+
+    // Like the AST reader, remove out-of-date module files before rebuilding
+    // them.
+    llvm::sys::fs::remove(ModuleFileNames[I], Prebuild.OutOfDate);
+  }
+  if (Graph.Prebuilds.empty())
+    return;
+
+  std::vector<std::vector<unsigned> > Dependencies(Graph.Prebuilds.size());
+  for (unsigned I = 0, N = Modules.size(); I != N; ++I) {
+    if (!NeedsBuild[I])
+      continue;
+    for (unsigned J = 0, M = ModuleImports[I].size(); J != M; ++J) {
+      llvm::DenseMap<Module *, unsigned>::iterator Known
+        = ModuleIndex.find(ModuleImports[I][J]);
+      if (Known != ModuleIndex.end() && NeedsBuild[Known->second])
+        Dependencies[GraphIndex[I]].push_back(GraphIndex[Known->second]);
+    }
+  }
+
+  runDependencyGraph(Dependencies, getFrontendOpts().ModuleBuildJobs,
+                     prebuildModule, &Graph);
+
+  bool AnyBuilt = false;
+  for (unsigned I = 0, N = Graph.Prebuilds.size(); I != N; ++I) {
+    ModulePrebuild &Prebuild = Graph.Prebuilds[I];
+    if (!Prebuild.TempModuleMapFileName.empty())
+      llvm::sys::fs::remove(Prebuild.TempModuleMapFileName.str());
+
+    const ModuleCacheStatistics &Stats = Prebuild.Stats;
+    ModuleCacheStats.NumModulesBuilt += Stats.NumModulesBuilt;
+    ModuleCacheStats.NumModuleFilesShared += Stats.NumModuleFilesShared;
+    ModuleCacheStats.NumModuleFilesPruned += Stats.NumModuleFilesPruned;
+    if (Prebuild.Built) {
+      AnyBuilt = true;
+      ++ModuleCacheStats.NumModulesPrebuilt;
+      if (Prebuild.OutOfDate)
+        ++ModuleCacheStats.NumOutOfDateModulesPrebuilt;
+    }
+
+    // Keep the diagnostics of the modules that were built until they are
+    // loaded.
+    if (Prebuild.Built && !Prebuild.Diagnostics->Diagnostics.empty())
+      PrebuiltModuleDiags.push_back(Prebuild.Diagnostics);
+    else
+      delete Prebuild.Diagnostics;
+  }
+
+  // We've built modules. If we're allowed to generate or update the global
+  // module index, record that fact.
+  if (AnyBuilt && getFrontendOpts().GenerateGlobalModuleIndex)
+    setBuildGlobalModuleIndex(true);
+}
+
 /// \brief Diagnose differences between the current definition of the given
 /// configuration macro and the definition provided on the command line.
 static void checkConfigMacro(Preprocessor &PP, StringRef ConfigMacro,
@@ -1022,7 +1710,9 @@ static void writeTimestampFile(StringRef TimestampFile) {
 
 /// \brief Prune the module cache of modules that haven't been accessed in
 /// a long time.
-static void pruneModuleCache(const HeaderSearchOptions &HSOpts) {
+///
+/// \returns the number of files that were removed.
+static unsigned pruneModuleCache(const HeaderSearchOptions &HSOpts) {
   struct stat StatBuf;
   llvm::SmallString<128> TimestampFile;
   TimestampFile = HSOpts.ModuleCachePath;
@@ -1034,7 +1724,7 @@ static void pruneModuleCache(const HeaderSearchOptions &HSOpts) {
     if (errno == ENOENT) {
       writeTimestampFile(TimestampFile);
     }
-    return;
+    return 0;
   }
 
   // Check whether the time stamp is older than our pruning interval.
@@ -1042,7 +1732,7 @@ static void pruneModuleCache(const HeaderSearchOptions &HSOpts) {
   time_t TimeStampModTime = StatBuf.st_mtime;
   time_t CurrentTime = time(0);
   if (CurrentTime - TimeStampModTime <= time_t(HSOpts.ModuleCachePruneInterval))
-    return;
+    return 0;
 
   // Write a new timestamp file so that nobody else attempts to prune.
   // There is a benign race condition here, if two Clang instances happen to
@@ -1051,6 +1741,7 @@ static void pruneModuleCache(const HeaderSearchOptions &HSOpts) {
 
   // Walk the entire module cache, looking for unused module files and module
   // indices.
+  unsigned NumRemoved = 0;
   llvm::error_code EC;
   SmallString<128> ModuleCachePathNative;
   llvm::sys::path::native(HSOpts.ModuleCachePath, ModuleCachePathNative);
@@ -1061,6 +1752,9 @@ static void pruneModuleCache(const HeaderSearchOptions &HSOpts) {
     if (!llvm::sys::fs::is_directory(Dir->path()))
       continue;
 
+    // The store links to the module files of all the other directories.
+    bool IsStore = llvm::sys::path::filename(Dir->path()) == "store";
+
     // Walk all of the files within this directory.
     bool RemovedAllFiles = true;
     for (llvm::sys::fs::directory_iterator File(Dir->path(), EC), FileEnd;
@@ -1079,10 +1773,12 @@ static void pruneModuleCache(const HeaderSearchOptions &HSOpts) {
         continue;
       }
 
-      // If the file has been used recently enough, leave it there.
+      // If the file has been used recently enough, leave it there, unless it
+      // is a stored module file that no other directory links to anymore.
       time_t FileAccessTime = StatBuf.st_atime;
       if (CurrentTime - FileAccessTime <=
-              time_t(HSOpts.ModuleCachePruneAfter)) {
+              time_t(HSOpts.ModuleCachePruneAfter) &&
+          !(IsStore && StatBuf.st_nlink == 1)) {
         RemovedAllFiles = false;
         continue;
       }
@@ -1091,6 +1787,8 @@ static void pruneModuleCache(const HeaderSearchOptions &HSOpts) {
       bool Existed;
       if (llvm::sys::fs::remove(File->path(), Existed) || !Existed) {
         RemovedAllFiles = false;
+      } else {
+        ++NumRemoved;
       }
     }
 
@@ -1101,6 +1799,166 @@ static void pruneModuleCache(const HeaderSearchOptions &HSOpts) {
       llvm::sys::fs::remove(Dir->path(), Existed);
     }
   }
+
+  return NumRemoved;
+}
+
+namespace {
+  /// \brief A module file in the module cache, along with all of the paths
+  /// that link to it.
+  struct CachedModuleFile {
+    time_t AccessTime;
+    time_t ModificationTime;
+    uint64_t Size;
+    llvm::sys::fs::UniqueID ID;
+    SmallVector<std::string, 2> Paths;
+
+    bool operator<(const CachedModuleFile &Other) const {
+      return AccessTime < Other.AccessTime;
+    }
+  };
+}
+
+/// \brief Collect the module files in the module cache.
+static void collectModuleFiles(StringRef ModuleCachePath,
+                               std::vector<CachedModuleFile> &Files) {
+  std::map<llvm::sys::fs::UniqueID, unsigned> FileIndex;
+  llvm::error_code EC;
+  SmallString<128> ModuleCachePathNative;
+  llvm::sys::path::native(ModuleCachePath, ModuleCachePathNative);
+  for (llvm::sys::fs::directory_iterator
+         Dir(ModuleCachePathNative.str(), EC), DirEnd;
+       Dir != DirEnd && !EC; Dir.increment(EC)) {
+    if (!llvm::sys::fs::is_directory(Dir->path()))
+      continue;
+
+    for (llvm::sys::fs::directory_iterator File(Dir->path(), EC), FileEnd;
+         File != FileEnd && !EC; File.increment(EC)) {
+      if (llvm::sys::path::extension(File->path()) != ".pcm")
+        continue;
+
+      struct stat StatBuf;
+      llvm::sys::fs::file_status Status;
+      if (::stat(File->path().c_str(), &StatBuf) ||
+          llvm::sys::fs::status(File->path(), Status))
+        continue;
+
+      // Links to the same module file only take up space once.
+      std::pair<std::map<llvm::sys::fs::UniqueID, unsigned>::iterator, bool>
+        Known = FileIndex.insert(std::make_pair(Status.getUniqueID(),
+                                                Files.size()));
+      if (Known.second) {
+        Files.push_back(CachedModuleFile());
+        Files.back().AccessTime = StatBuf.st_atime;
+        Files.back().ModificationTime = StatBuf.st_mtime;
+        Files.back().Size = StatBuf.st_size;
+        Files.back().ID = Status.getUniqueID();
+      }
+      Files[Known.first->second].Paths.push_back(File->path());
+    }
+  }
+}
+
+/// \brief Prune the least recently used module files from the module cache,
+/// until it is no larger than its maximum size.
+///
+/// Module files in \p InUse, and module files modified after \p StartTime,
+/// which other compilations may be about to load, are kept.  The sweep is
+/// skipped if another compiler is pruning the module cache already.
+///
+/// \returns the number of module files that were removed.
+static unsigned
+limitModuleCacheSize(const HeaderSearchOptions &HSOpts,
+                     const std::set<llvm::sys::fs::UniqueID> &InUse,
+                     time_t StartTime) {
+  // Lock a file inside the module cache, so that the lock file lives (and is
+  // cleaned up) along with the rest of the module cache.
+  SmallString<128> PruneFile(HSOpts.ModuleCachePath);
+  llvm::sys::path::append(PruneFile, "modules.prune");
+  llvm::LockFileManager Locked(PruneFile);
+  if (Locked != llvm::LockFileManager::LFS_Owned)
+    return 0;
+
+  std::vector<CachedModuleFile> Files;
+  collectModuleFiles(HSOpts.ModuleCachePath, Files);
+
+  uint64_t Size = 0;
+  for (unsigned I = 0, N = Files.size(); I != N; ++I)
+    Size += Files[I].Size;
+
+  uint64_t MaxSize = uint64_t(HSOpts.ModuleCacheMaxSize) * 1024;
+  if (Size <= MaxSize)
+    return 0;
+
+  // Remove every link to a module file, so that its space is reclaimed.
+  unsigned NumRemoved = 0;
+  std::sort(Files.begin(), Files.end());
+  for (unsigned I = 0, N = Files.size(); I != N && Size > MaxSize; ++I) {
+    if (Files[I].ModificationTime >= StartTime || InUse.count(Files[I].ID))
+      continue;
+    for (unsigned J = 0, M = Files[I].Paths.size(); J != M; ++J) {
+      bool Existed;
+      llvm::sys::fs::remove(Files[I].Paths[J], Existed);
+    }
+    Size -= Files[I].Size;
+    ++NumRemoved;
+  }
+  return NumRemoved;
+}
+
+void CompilerInstance::reportPrebuiltModuleDiagnostics() {
+  // Look the module files up by name, so that the file manager doesn't
+  // remember module files that have not been loaded yet.
+  llvm::StringSet<> Loaded;
+  serialization::ModuleManager &Modules = ModuleManager->getModuleManager();
+  for (serialization::ModuleManager::ModuleIterator M = Modules.begin(),
+                                                    MEnd = Modules.end();
+       M != MEnd; ++M)
+    Loaded.insert((*M)->FileName);
+
+  for (unsigned I = 0; I != PrebuiltModuleDiags.size(); /* in loop */) {
+    PrebuiltModuleDiagnostics *Prebuilt = PrebuiltModuleDiags[I];
+    if (!Loaded.count(Prebuilt->ModuleFileName)) {
+      ++I;
+      continue;
+    }
+
+    // Report the diagnostics in the context of the compiler instance that
+    // built the module, as if it had been built on import.
+    Prebuilt->Diags->setClient(
+      new ForwardingDiagnosticConsumer(getDiagnosticClient()),
+      /*ShouldOwnClient=*/true);
+    for (unsigned J = 0, N = Prebuilt->Diagnostics.size(); J != N; ++J)
+      Prebuilt->Diags->Report(Prebuilt->Diagnostics[J]);
+    delete Prebuilt;
+    PrebuiltModuleDiags.erase(PrebuiltModuleDiags.begin() + I);
+  }
+}
+
+void CompilerInstance::printModuleCacheStats(raw_ostream &OS) {
+  OS << "\n*** Module Cache Stats:\n";
+  OS << ModuleCacheStats.NumModulesBuilt << " modules built, "
+     << ModuleCacheStats.NumModuleFilesShared
+     << " shared with an identical module file, "
+     << ModuleCacheStats.NumModuleFilesPruned << " module files pruned.\n";
+
+  const std::string &ModuleCachePath = getHeaderSearchOpts().ModuleCachePath;
+  if (!ModuleCachePath.empty()) {
+    std::vector<CachedModuleFile> Files;
+    collectModuleFiles(ModuleCachePath, Files);
+    uint64_t Size = 0;
+    unsigned NumPaths = 0;
+    for (unsigned I = 0, N = Files.size(); I != N; ++I) {
+      Size += Files[I].Size;
+      NumPaths += Files[I].Paths.size();
+    }
+    OS << Files.size() << " module files (" << NumPaths << " links) in the "
+       << "module cache, taking " << Size << " bytes.\n";
+  }
+
+  OS << ModuleCacheStats.NumModulesPrebuilt << " modules built ahead of time, "
+     << ModuleCacheStats.NumOutOfDateModulesPrebuilt
+     << " of them out of date.\n";
 }
 
 ModuleLoadResult
@@ -1154,7 +2012,8 @@ CompilerInstance::loadModule(SourceLocation ImportLoc,
       if (getSourceManager().getModuleBuildStack().empty() &&
           getHeaderSearchOpts().ModuleCachePruneInterval > 0 &&
           getHeaderSearchOpts().ModuleCachePruneAfter > 0) {
-        pruneModuleCache(getHeaderSearchOpts());
+        ModuleCacheStats.NumModuleFilesPruned
+          += pruneModuleCache(getHeaderSearchOpts());
       }
 
       std::string Sysroot = getHeaderSearchOpts().Sysroot;
@@ -1179,6 +2038,15 @@ CompilerInstance::loadModule(SourceLocation ImportLoc,
         ModuleManager->StartTranslationUnit(&getASTConsumer());
     }
 
+    // If we're not recursively building a module, build the module files
+    // that this translation unit imports and that are missing or out of date
+    // ahead of time, concurrently.
+    if (Module && !ModulesPrebuilt && getFrontendOpts().ModuleBuildJobs != 1 &&
+        getSourceManager().getModuleBuildStack().empty()) {
+      ModulesPrebuilt = true;
+      prebuildModules(Module, ModuleNameLoc);
+    }
+
     // Try to load the module file.
     unsigned ARRFlags = ASTReader::ARR_OutOfDate | ASTReader::ARR_Missing;
     switch (ModuleManager->ReadAST(ModuleFileName, serialization::MK_Module,
@@ -1262,7 +2130,22 @@ CompilerInstance::loadModule(SourceLocation ImportLoc,
         return ModuleLoadResult();
       }
 
-      // Okay, we've rebuilt and now loaded the module.
+      // Okay, we've rebuilt and now loaded the module. If we're not
+      // recursively building a module, make room for it in the module cache.
+      if (getSourceManager().getModuleBuildStack().empty() &&
+          getHeaderSearchOpts().ModuleCacheMaxSize > 0) {
+        std::set<llvm::sys::fs::UniqueID> InUse;
+        serialization::ModuleManager &Modules
+          = ModuleManager->getModuleManager();
+        for (serialization::ModuleManager::ModuleIterator
+               M = Modules.begin(), MEnd = Modules.end(); M != MEnd; ++M) {
+          llvm::sys::fs::file_status Status;
+          if (!llvm::sys::fs::status((*M)->FileName, Status))
+            InUse.insert(Status.getUniqueID());
+        }
+        ModuleCacheStats.NumModuleFilesPruned
+          += limitModuleCacheSize(getHeaderSearchOpts(), InUse, StartTime);
+      }
       break;
     }
 
@@ -1282,6 +2165,11 @@ CompilerInstance::loadModule(SourceLocation ImportLoc,
       ModuleBuildFailed = true;
       return ModuleLoadResult();
     }
+
+    // Report the diagnostics of the modules just loaded that were built ahead
+    // of time.
+    if (!PrebuiltModuleDiags.empty())
+      reportPrebuiltModuleDiagnostics();
     
     if (!Module) {
       // If we loaded the module directly, without finding a module map first,
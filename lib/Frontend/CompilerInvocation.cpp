@@ -18,7 +18,6 @@
 #include "clang/Frontend/Utils.h"
 #include "clang/Lex/HeaderSearchOptions.h"
 #include "clang/Serialization/ASTReader.h"
-#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringExtras.h"
@@ -31,9 +30,10 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Host.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/system_error.h"
-#include <sys/stat.h>
+#include <map>
 using namespace clang;
 
 //===----------------------------------------------------------------------===//
@@ -224,6 +224,7 @@ static bool ParseAnalyzerArgs(AnalyzerOptions &Opts, ArgList &Args,
     Args.hasArg(OPT_analyzer_opt_analyze_nested_blocks);
   Opts.eagerlyAssumeBinOpBifurcation = Args.hasArg(OPT_analyzer_eagerly_assume);
   Opts.AnalyzeSpecificFunction = Args.getLastArgValue(OPT_analyze_function);
+  Opts.ResultsCachePath = Args.getLastArgValue(OPT_analyzer_results_cache);
   Opts.UnoptimizedCFG = Args.hasArg(OPT_analysis_UnoptimizedCFG);
   Opts.TrimGraph = Args.hasArg(OPT_trim_egraph);
   Opts.maxBlockVisitOnPath =
@@ -752,6 +753,8 @@ static InputKind ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
   Opts.ASTDumpLookups = Args.hasArg(OPT_ast_dump_lookups);
   Opts.UseGlobalModuleIndex = !Args.hasArg(OPT_fno_modules_global_index);
   Opts.GenerateGlobalModuleIndex = Opts.UseGlobalModuleIndex;
+  Opts.ModuleBuildJobs =
+      getLastArgIntValue(Args, OPT_fmodules_build_jobs_EQ, 1, &Diags);
   
   Opts.CodeCompleteOpts.IncludeMacros
     = Args.hasArg(OPT_code_completion_macros);
@@ -878,12 +881,17 @@ static void ParseHeaderSearchArgs(HeaderSearchOptions &Opts, ArgList &Args) {
   Opts.ResourceDir = Args.getLastArgValue(OPT_resource_dir);
   Opts.ModuleCachePath = Args.getLastArgValue(OPT_fmodules_cache_path);
   Opts.DisableModuleHash = Args.hasArg(OPT_fdisable_module_hash);
+  Opts.HeaderSearchMap = Args.getLastArgValue(OPT_fheader_search_map_EQ);
+  Opts.HeaderSearchMapOutput =
+      Args.getLastArgValue(OPT_fheader_search_map_output_EQ);
   // -fmodules implies -fmodule-maps
   Opts.ModuleMaps = Args.hasArg(OPT_fmodule_maps) || Args.hasArg(OPT_fmodules);
   Opts.ModuleCachePruneInterval =
       getLastArgIntValue(Args, OPT_fmodules_prune_interval, 7 * 24 * 60 * 60);
   Opts.ModuleCachePruneAfter =
       getLastArgIntValue(Args, OPT_fmodules_prune_after, 31 * 24 * 60 * 60);
+  Opts.ModuleCacheMaxSize =
+      getLastArgIntValue(Args, OPT_fmodules_cache_max_size, 0);
   for (arg_iterator it = Args.filtered_begin(OPT_fmodules_ignore_macro),
                     ie = Args.filtered_end();
        it != ie; ++it) {
@@ -1404,9 +1412,20 @@ static void ParsePreprocessorArgs(PreprocessorOptions &Opts, ArgList &Args,
       Opts.TokenCache = A->getValue();
   else
     Opts.TokenCache = Opts.ImplicitPTHInclude;
+  Opts.HeaderTokenCachePath = Args.getLastArgValue(OPT_header_token_cache);
   Opts.UsePredefines = !Args.hasArg(OPT_undef);
   Opts.DetailedRecord = Args.hasArg(OPT_detailed_preprocessing_record);
+  Opts.MemoizeMacroExpansions = Args.hasArg(OPT_fmemoize_macro_expansions);
   Opts.DisablePCHValidation = Args.hasArg(OPT_fno_validate_pch);
+  Opts.LazyPCHInputValidation = Args.hasArg(OPT_flazy_pch_input_validation);
+  if (const Arg *A = Args.getLastArg(OPT_fbuild_session_timestamp))
+    if (StringRef(A->getValue()).getAsInteger(10, Opts.BuildSessionTimestamp))
+      Diags.Report(diag::err_drv_invalid_int_value) << A->getAsString(Args)
+                                                    << A->getValue();
+  Opts.ValidateASTInputFilesContent =
+    Args.hasArg(OPT_fvalidate_ast_input_files_content);
+  Opts.ASTWriteJobs = getLastArgIntValue(Args, OPT_fpch_write_jobs_EQ, 1,
+                                         &Diags);
 
   Opts.DumpDeserializedPCHDecls = Args.hasArg(OPT_dump_deserialized_pch_decls);
   for (arg_iterator it = Args.filtered_begin(OPT_error_on_deserialized_pch_decl),
@@ -1666,66 +1685,119 @@ llvm::APInt ModuleSignature::getAsInteger() const {
   return llvm::APInt(Data.size() * 64, Data);
 }
 
+namespace {
+
+  /// \brief Builds the module hash from the options that affect the contents
+  /// of module files.
+  class ModuleHashBuilder {
+    llvm::MD5 Hash;
+
+  public:
+    void add(uint64_t Value);
+    void add(StringRef Value);
+
+    std::string getHash();
+  };
+}
+
+void ModuleHashBuilder::add(uint64_t Value) {
+  uint8_t Bytes[8];
+  for (unsigned I = 0; I != 8; ++I)
+    Bytes[I] = static_cast<uint8_t>(Value >> (8 * I));
+  Hash.update(Bytes);
+}
+
+void ModuleHashBuilder::add(StringRef Value) {
+  // Add the length first, so that adjacent strings cannot run together.
+  add(Value.size());
+  Hash.update(Value);
+}
+
+std::string ModuleHashBuilder::getHash() {
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Str;
+  llvm::MD5::stringifyResult(Result, Str);
+  return Str.str();
+}
+
 std::string CompilerInvocation::getModuleHash() const {
   // Note: For QoI reasons, the things we use as a hash here should all be
   // dumped via the -module-info flag.
-  using llvm::hash_code;
-  using llvm::hash_value;
-  using llvm::hash_combine;
+  //
+  // The hash names the directory of the module cache that holds the module
+  // files built with these options, so it has to be strong enough that two
+  // configurations which build different module files never share one. It
+  // covers only the options that can change the AST of a module, and hashes
+  // them in a normalized form, so that configurations which build the same
+  // module files share a directory and don't rebuild them.
+  ModuleHashBuilder Hash;
 
   // Start the signature with the compiler version.
-  // FIXME: We'd rather use something more cryptographically sound than
-  // CityHash, but this will do for now.
-  hash_code code = hash_value(getClangFullRepositoryVersion());
+  Hash.add(getClangFullRepositoryVersion());
 
   // Extend the signature with the language options
 #define LANGOPT(Name, Bits, Default, Description) \
-   code = hash_combine(code, LangOpts->Name);
+  Hash.add(static_cast<uint64_t>(LangOpts->Name));
 #define ENUM_LANGOPT(Name, Type, Bits, Default, Description) \
-  code = hash_combine(code, static_cast<unsigned>(LangOpts->get##Name()));
+  Hash.add(static_cast<uint64_t>(LangOpts->get##Name()));
 #define BENIGN_LANGOPT(Name, Bits, Default, Description)
 #define BENIGN_ENUM_LANGOPT(Name, Type, Bits, Default, Description)
 #include "clang/Basic/LangOptions.def"
-  
-  // Extend the signature with the target options.
-  code = hash_combine(code, TargetOpts->Triple, TargetOpts->CPU,
-                      TargetOpts->ABI, TargetOpts->CXXABI,
-                      TargetOpts->LinkerVersion);
+
+  // Extend the signature with the target options. The linker version is left
+  // out: only the driver uses it, so it never changes a module file.
+  Hash.add(TargetOpts->Triple);
+  Hash.add(TargetOpts->CPU);
+  Hash.add(TargetOpts->ABI);
+  Hash.add(TargetOpts->CXXABI);
+  Hash.add(TargetOpts->FeaturesAsWritten.size());
   for (unsigned i = 0, n = TargetOpts->FeaturesAsWritten.size(); i != n; ++i)
-    code = hash_combine(code, TargetOpts->FeaturesAsWritten[i]);
+    Hash.add(TargetOpts->FeaturesAsWritten[i]);
 
   // Extend the signature with preprocessor options.
   const PreprocessorOptions &ppOpts = getPreprocessorOpts();
   const HeaderSearchOptions &hsOpts = getHeaderSearchOpts();
-  code = hash_combine(code, ppOpts.UsePredefines, ppOpts.DetailedRecord);
+  Hash.add(ppOpts.UsePredefines);
+  Hash.add(ppOpts.DetailedRecord);
 
-  std::vector<StringRef> MacroDefs;
+  // Only the last -D or -U of each macro matters, and not the order in which
+  // different macros are given, so hash the final state of each macro in
+  // order of name.
+  std::map<StringRef, std::pair<StringRef, bool/*isUndef*/> > Macros;
   for (std::vector<std::pair<std::string, bool/*isUndef*/> >::const_iterator 
             I = getPreprocessorOpts().Macros.begin(),
          IEnd = getPreprocessorOpts().Macros.end();
        I != IEnd; ++I) {
+    StringRef MacroDef = I->first;
+    StringRef MacroName = MacroDef.split('=').first;
+
     // If we're supposed to ignore this macro for the purposes of modules,
     // don't put it into the hash.
-    if (!hsOpts.ModulesIgnoreMacros.empty()) {
-      // Check whether we're ignoring this macro.
-      StringRef MacroDef = I->first;
-      if (hsOpts.ModulesIgnoreMacros.count(MacroDef.split('=').first))
-        continue;
-    }
+    if (hsOpts.ModulesIgnoreMacros.count(MacroName))
+      continue;
 
-    code = hash_combine(code, I->first, I->second);
+    Macros[MacroName] = std::make_pair(I->second ? StringRef() : MacroDef,
+                                       I->second);
+  }
+  for (std::map<StringRef, std::pair<StringRef, bool> >::iterator
+         I = Macros.begin(), IEnd = Macros.end(); I != IEnd; ++I) {
+    Hash.add(I->first);
+    Hash.add(I->second.first);
+    Hash.add(I->second.second);
   }
 
   // Extend the signature with the sysroot.
-  code = hash_combine(code, hsOpts.Sysroot, hsOpts.UseBuiltinIncludes,
-                      hsOpts.UseStandardSystemIncludes,
-                      hsOpts.UseStandardCXXIncludes,
-                      hsOpts.UseLibcxx);
+  Hash.add(hsOpts.Sysroot);
+  Hash.add(hsOpts.UseBuiltinIncludes);
+  Hash.add(hsOpts.UseStandardSystemIncludes);
+  Hash.add(hsOpts.UseStandardCXXIncludes);
+  Hash.add(hsOpts.UseLibcxx);
 
-  // Darwin-specific hack: if we have a sysroot, use the contents and
-  // modification time of
+  // Darwin-specific hack: if we have a sysroot, use the contents of
   //   $sysroot/System/Library/CoreServices/SystemVersion.plist
-  // as part of the module hash.
+  // as part of the module hash. Its modification time is left out, since
+  // touching the file does not change the SDK.
   if (!hsOpts.Sysroot.empty()) {
     llvm::OwningPtr<llvm::MemoryBuffer> buffer;
     SmallString<128> systemVersionFile;
@@ -1734,16 +1806,11 @@ std::string CompilerInvocation::getModuleHash() const {
     llvm::sys::path::append(systemVersionFile, "Library");
     llvm::sys::path::append(systemVersionFile, "CoreServices");
     llvm::sys::path::append(systemVersionFile, "SystemVersion.plist");
-    if (!llvm::MemoryBuffer::getFile(systemVersionFile, buffer)) {
-      code = hash_combine(code, buffer.get()->getBuffer());
-
-      struct stat statBuf;
-      if (stat(systemVersionFile.c_str(), &statBuf) == 0)
-        code = hash_combine(code, statBuf.st_mtime);
-    }
+    if (!llvm::MemoryBuffer::getFile(systemVersionFile, buffer))
+      Hash.add(buffer.get()->getBuffer());
   }
 
-  return llvm::APInt(64, code).toString(36, /*Signed=*/false);
+  return Hash.getHash();
 }
 
 namespace clang {
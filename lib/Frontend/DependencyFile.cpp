@@ -17,6 +17,8 @@
 #include "clang/Frontend/DependencyOutputOptions.h"
 #include "clang/Frontend/FrontendDiagnostic.h"
 #include "clang/Lex/DirectoryLookup.h"
+#include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/HeaderSearchOptions.h"
 #include "clang/Lex/LexDiagnostic.h"
 #include "clang/Lex/PPCallbacks.h"
 #include "clang/Lex/Preprocessor.h"
@@ -41,7 +43,9 @@ class DependencyFileCallback : public PPCallbacks {
 private:
   bool FileMatchesDepCriteria(const char *Filename,
                               SrcMgr::CharacteristicKind FileType);
+  void AddFile(const FileEntry *FE, SrcMgr::CharacteristicKind FileType);
   void AddFilename(StringRef Filename);
+  void AddHeaderSearchMap();
   void OutputDependencyFile();
 
 public:
@@ -56,6 +60,9 @@ public:
   virtual void FileChanged(SourceLocation Loc, FileChangeReason Reason,
                            SrcMgr::CharacteristicKind FileType,
                            FileID PrevFID);
+  virtual void FileSkipped(const FileEntry &SkippedFile,
+                           const Token &FilenameTok,
+                           SrcMgr::CharacteristicKind FileType);
   virtual void InclusionDirective(SourceLocation HashLoc,
                                   const Token &IncludeTok,
                                   StringRef FileName,
@@ -67,6 +74,7 @@ public:
                                   const Module *Imported);
 
   virtual void EndOfMainFile() {
+    AddHeaderSearchMap();
     OutputDependencyFile();
   }
 };
@@ -115,6 +123,19 @@ void DependencyFileCallback::FileChanged(SourceLocation Loc,
     SM.getFileEntryForID(SM.getFileID(SM.getExpansionLoc(Loc)));
   if (FE == 0) return;
 
+  AddFile(FE, FileType);
+}
+
+void DependencyFileCallback::FileSkipped(const FileEntry &SkippedFile,
+                                         const Token &FilenameTok,
+                                         SrcMgr::CharacteristicKind FileType) {
+  // A file may be skipped the first time it is included in this translation
+  // unit if its include guard is known from another one.
+  AddFile(&SkippedFile, FileType);
+}
+
+void DependencyFileCallback::AddFile(const FileEntry *FE,
+                                     SrcMgr::CharacteristicKind FileType) {
   StringRef Filename = FE->getName();
   if (!FileMatchesDepCriteria(Filename.data(), FileType))
     return;
@@ -152,6 +173,20 @@ void DependencyFileCallback::AddFilename(StringRef Filename) {
     Files.push_back(Filename);
 }
 
+/// AddHeaderSearchMap - Add the header map used to find headers, since headers
+/// may be found elsewhere when it changes.
+void DependencyFileCallback::AddHeaderSearchMap() {
+  const HeaderSearchOptions &HSOpts =
+    PP->getHeaderSearchInfo().getHeaderSearchOpts();
+  // A map that this compilation rewrites would always be newer than its
+  // output.
+  if (HSOpts.HeaderSearchMap.empty() ||
+      HSOpts.HeaderSearchMap == HSOpts.HeaderSearchMapOutput ||
+      !llvm::sys::fs::exists(HSOpts.HeaderSearchMap))
+    return;
+  AddFilename(HSOpts.HeaderSearchMap);
+}
+
 /// PrintFilename - GCC escapes spaces, # and $, but apparently not ' or " or
 /// other scary characters.
 static void PrintFilename(raw_ostream &OS, StringRef Filename) {
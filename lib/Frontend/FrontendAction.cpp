@@ -392,6 +392,11 @@ bool FrontendAction::Execute() {
 void FrontendAction::EndSourceFile() {
   CompilerInstance &CI = getCompilerInstance();
 
+  // Input files of a precompiled header that were validated lazily still
+  // need to be checked if they were never used.
+  if (CI.getModuleManager())
+    CI.getModuleManager()->validateRemainingInputFiles();
+
   // Inform the diagnostic client we are done with this source file.
   CI.getDiagnosticClient().EndSourceFile();
 
@@ -0,0 +1,88 @@
+//===--- HeaderSearchMapGen.cpp - Record where headers are found ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This code records where the headers of a translation unit were found in a
+// header map, so that later builds can find them without searching.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Frontend/Utils.h"
+#include "clang/Frontend/FrontendDiagnostic.h"
+#include "clang/Lex/HeaderMap.h"
+#include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/PPCallbacks.h"
+#include "clang/Lex/Preprocessor.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+
+using namespace clang;
+
+namespace {
+class HeaderSearchMapCallback : public PPCallbacks {
+  Preprocessor *PP;
+  std::string OutputFile;
+
+  void OutputHeaderSearchMap();
+
+public:
+  HeaderSearchMapCallback(Preprocessor *PP, StringRef OutputFile)
+    : PP(PP), OutputFile(OutputFile.str()) {}
+
+  virtual void EndOfMainFile() {
+    OutputHeaderSearchMap();
+  }
+};
+}
+
+void clang::AttachHeaderSearchMapGen(Preprocessor &PP, StringRef OutputFile) {
+  PP.getHeaderSearchInfo().setRecordSearchMap(true);
+  PP.addPPCallbacks(new HeaderSearchMapCallback(&PP, OutputFile));
+}
+
+void HeaderSearchMapCallback::OutputHeaderSearchMap() {
+  HeaderSearch &HS = PP->getHeaderSearchInfo();
+  std::vector<HeaderMapEntry> Entries;
+
+  // Other translation units of the same build add to the same map, so start
+  // with what they found, as long as they searched the same directories.
+  OwningPtr<llvm::MemoryBuffer> Buffer;
+  if (!llvm::MemoryBuffer::getFile(OutputFile, Buffer)) {
+    OwningPtr<const HeaderMap> Existing(HeaderMap::Create(Buffer.take()));
+    HeaderMapEntry Signature;
+    if (Existing && Existing->lookupEntry("", Signature) &&
+        Signature.Prefix == HS.getSearchPathSignature())
+      Existing->getEntries(Entries);
+  }
+  HS.getSearchMapEntries(Entries);
+
+  // Write to a temporary file first, so that concurrent builds never see a
+  // partially written map.
+  int FD;
+  SmallString<128> TempPath;
+  if (llvm::error_code EC = llvm::sys::fs::createUniqueFile(
+          OutputFile + "-%%%%%%%%", FD, TempPath)) {
+    PP->getDiagnostics().Report(diag::err_fe_error_opening)
+      << OutputFile << EC.message();
+    return;
+  }
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    HeaderMap::write(Entries, OS);
+  }
+  if (llvm::error_code EC = llvm::sys::fs::rename(TempPath.str(), OutputFile)) {
+    PP->getDiagnostics().Report(diag::err_fe_error_opening)
+      << OutputFile << EC.message();
+    bool Existed;
+    llvm::sys::fs::remove(TempPath.str(), Existed);
+  }
+}
@@ -0,0 +1,99 @@
+//===--- HeaderTokenCacheGen.cpp - Write missing header token caches ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This code writes the entries that were missing from the header token cache
+// of a translation unit, so that later translation units including the same
+// headers can read their tokens instead of lexing them.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Frontend/Utils.h"
+#include "clang/Frontend/FrontendDiagnostic.h"
+#include "clang/Lex/HeaderTokenCache.h"
+#include "clang/Lex/PPCallbacks.h"
+#include "clang/Lex/Preprocessor.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+
+using namespace clang;
+
+namespace {
+class HeaderTokenCacheCallback : public PPCallbacks {
+  Preprocessor *PP;
+
+  void OutputHeaderTokenCache();
+
+public:
+  HeaderTokenCacheCallback(Preprocessor *PP) : PP(PP) {}
+
+  virtual void EndOfMainFile() {
+    OutputHeaderTokenCache();
+  }
+};
+}
+
+void clang::AttachHeaderTokenCacheGen(Preprocessor &PP) {
+  PP.addPPCallbacks(new HeaderTokenCacheCallback(&PP));
+}
+
+void HeaderTokenCacheCallback::OutputHeaderTokenCache() {
+  HeaderTokenCache *Cache = PP->getHeaderTokenCache();
+  const std::vector<std::pair<FileID, std::string> > &Missing =
+    Cache->getMissingHeaders();
+
+  // An error may have cut preprocessing short, so only complete translation
+  // units contribute entries.
+  if (Missing.empty() || PP->getDiagnostics().hasErrorOccurred())
+    return;
+
+  DiagnosticsEngine &Diags = PP->getDiagnostics();
+  if (llvm::error_code EC =
+          llvm::sys::fs::create_directories(Cache->getDirectory())) {
+    Diags.Report(diag::warn_fe_header_token_cache_failure)
+      << Cache->getDirectory() << EC.message();
+    return;
+  }
+
+  for (unsigned I = 0, N = Missing.size(); I != N; ++I) {
+    SmallString<128> Path;
+    Cache->getEntryPath(Missing[I].second, Path);
+
+    // Write to a temporary file first, so that concurrent builds never see a
+    // partially written entry.  Entries with the same name have the same
+    // contents, so it does not matter which build writes an entry last.
+    int FD;
+    SmallString<128> TempPath;
+    if (llvm::error_code EC = llvm::sys::fs::createUniqueFile(
+            Path.str() + "-%%%%%%%%", FD, TempPath)) {
+      Diags.Report(diag::warn_fe_header_token_cache_failure)
+        << Path.str() << EC.message();
+      return;
+    }
+
+    bool Cached;
+    {
+      llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+      Cached = CacheHeaderTokens(*PP, Missing[I].first,
+                                 Missing[I].second.c_str(), &OS);
+    }
+
+    llvm::error_code EC;
+    if (Cached)
+      EC = llvm::sys::fs::rename(TempPath.str(), Path.str());
+    if (!Cached || EC) {
+      bool Existed;
+      llvm::sys::fs::remove(TempPath.str(), Existed);
+    }
+    if (EC)
+      Diags.Report(diag::warn_fe_header_token_cache_failure)
+        << Path.str() << EC.message();
+  }
+}
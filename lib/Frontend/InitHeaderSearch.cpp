@@ -699,4 +699,10 @@ void clang::ApplyHeaderSearchOptions(HeaderSearch &HS,
   }
 
   Init.Realize(Lang);
+
+  // A missing search map is not an error; the build that records it has to
+  // start without one.
+  if (!HSOpts.HeaderSearchMap.empty())
+    if (const FileEntry *FE = HS.getFileMgr().getFile(HSOpts.HeaderSearchMap))
+      HS.setSearchMap(HS.CreateHeaderMap(FE), FE->getModificationTime());
 }
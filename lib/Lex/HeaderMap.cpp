@@ -16,9 +16,12 @@
 #include "clang/Basic/FileManager.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <cstdio>
 using namespace clang;
 
@@ -81,8 +84,14 @@ const HeaderMap *HeaderMap::Create(const FileEntry *FE, FileManager &FM) {
   unsigned FileSize = FE->getSize();
   if (FileSize <= sizeof(HMapHeader)) return 0;
 
-  OwningPtr<const llvm::MemoryBuffer> FileBuffer(FM.getBufferForFile(FE));
-  if (!FileBuffer) return 0;  // Unreadable file?
+  const llvm::MemoryBuffer *Buffer = FM.getBufferForFile(FE);
+  if (!Buffer) return 0;  // Unreadable file?
+  return Create(Buffer);
+}
+
+const HeaderMap *HeaderMap::Create(const llvm::MemoryBuffer *Buffer) {
+  OwningPtr<const llvm::MemoryBuffer> FileBuffer(Buffer);
+  if (FileBuffer->getBufferSize() <= sizeof(HMapHeader)) return 0;
   const char *FileStart = FileBuffer->getBufferStart();
 
   // We know the file is at least as big as the header, check it now.
@@ -197,32 +206,162 @@ void HeaderMap::dump() const {
   }
 }
 
-/// LookupFile - Check to see if the specified relative filename is located in
-/// this HeaderMap.  If so, open it and return its FileEntry.
-const FileEntry *HeaderMap::LookupFile(
-    StringRef Filename, FileManager &FM) const {
+bool HeaderMap::findBucket(StringRef Filename, HMapBucket &Result) const {
   const HMapHeader &Hdr = getHeader();
   unsigned NumBuckets = getEndianAdjustedWord(Hdr.NumBuckets);
 
   // If the number of buckets is not a power of two, the headermap is corrupt.
   // Don't probe infinitely.
   if (NumBuckets & (NumBuckets-1))
-    return 0;
+    return false;
 
   // Linearly probe the hash table.
   for (unsigned Bucket = HashHMapKey(Filename);; ++Bucket) {
     HMapBucket B = getBucket(Bucket & (NumBuckets-1));
-    if (B.Key == HMAP_EmptyBucketKey) return 0; // Hash miss.
+    if (B.Key == HMAP_EmptyBucketKey) return false; // Hash miss.
 
     // See if the key matches.  If not, probe on.
-    if (!Filename.equals_lower(getString(B.Key)))
+    const char *Key = getString(B.Key);
+    if (!Key || !Filename.equals_lower(Key))
       continue;
 
-    // If so, we have a match in the hash table.  Construct the destination
-    // path.
-    SmallString<1024> DestPath;
-    DestPath += getString(B.Prefix);
-    DestPath += getString(B.Suffix);
-    return FM.getFile(DestPath.str());
+    Result = B;
+    return true;
   }
 }
+
+/// LookupFile - Check to see if the specified relative filename is located in
+/// this HeaderMap.  If so, open it and return its FileEntry.
+const FileEntry *HeaderMap::LookupFile(
+    StringRef Filename, FileManager &FM) const {
+  HMapBucket B;
+  if (!findBucket(Filename, B))
+    return 0;
+
+  // If so, we have a match in the hash table.  Construct the destination
+  // path.
+  const char *Prefix = getString(B.Prefix);
+  const char *Suffix = getString(B.Suffix);
+  if (!Prefix || !Suffix)
+    return 0;
+  SmallString<1024> DestPath;
+  DestPath += Prefix;
+  DestPath += Suffix;
+  return FM.getFile(DestPath.str());
+}
+
+bool HeaderMap::lookupEntry(StringRef Filename, HeaderMapEntry &Entry) const {
+  HMapBucket B;
+  if (!findBucket(Filename, B))
+    return false;
+
+  const char *Key = getString(B.Key);
+  const char *Prefix = getString(B.Prefix);
+  const char *Suffix = getString(B.Suffix);
+  if (!Prefix || !Suffix || Filename != Key)
+    return false;
+  Entry.Key = Key;
+  Entry.Prefix = Prefix;
+  Entry.Suffix = Suffix;
+  return true;
+}
+
+void HeaderMap::getEntries(std::vector<HeaderMapEntry> &Entries) const {
+  unsigned NumBuckets = getEndianAdjustedWord(getHeader().NumBuckets);
+  for (unsigned i = 0; i != NumBuckets; ++i) {
+    HMapBucket B = getBucket(i);
+    if (B.Key == HMAP_EmptyBucketKey) continue;
+
+    const char *Key = getString(B.Key);
+    const char *Prefix = getString(B.Prefix);
+    const char *Suffix = getString(B.Suffix);
+    if (!Key || !Prefix || !Suffix)
+      continue;
+    HeaderMapEntry Entry;
+    Entry.Key = Key;
+    Entry.Prefix = Prefix;
+    Entry.Suffix = Suffix;
+    Entries.push_back(Entry);
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Writing
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// \brief The string pool of a header map being written.
+class HMapStringTable {
+  llvm::StringMap<uint32_t> Offsets;
+  SmallString<4096> Data;
+
+public:
+  HMapStringTable() {
+    // Offset zero is reserved to mark empty buckets.
+    Data.push_back('\0');
+  }
+
+  uint32_t get(StringRef Str) {
+    uint32_t &Offset = Offsets[Str];
+    if (!Offset) {
+      Offset = Data.size();
+      Data += Str;
+      Data.push_back('\0');
+    }
+    return Offset;
+  }
+
+  StringRef getData() const { return Data.str(); }
+};
+}
+
+void HeaderMap::write(ArrayRef<HeaderMapEntry> Entries, raw_ostream &OS) {
+  // Keys are looked up without regard to case, so they must be unique that
+  // way. Later entries win.
+  llvm::StringMap<unsigned> Unique;
+  for (unsigned i = 0, e = Entries.size(); i != e; ++i)
+    Unique[StringRef(Entries[i].Key).lower()] = i;
+
+  // Keep the table at most half full, so that probing stays short and always
+  // reaches an empty bucket.
+  uint32_t NumBuckets = 1;
+  while (NumBuckets < 2 * Unique.size())
+    NumBuckets *= 2;
+
+  std::vector<HMapBucket> Buckets(NumBuckets);
+  for (unsigned i = 0; i != NumBuckets; ++i)
+    Buckets[i].Key = HMAP_EmptyBucketKey;
+
+  HMapStringTable Strings;
+  uint32_t MaxValueLength = 0;
+  for (unsigned i = 0, e = Entries.size(); i != e; ++i) {
+    const HeaderMapEntry &Entry = Entries[i];
+    if (Unique[StringRef(Entry.Key).lower()] != i)
+      continue;
+
+    unsigned Bucket = HashHMapKey(Entry.Key) & (NumBuckets - 1);
+    while (Buckets[Bucket].Key != HMAP_EmptyBucketKey)
+      Bucket = (Bucket + 1) & (NumBuckets - 1);
+    Buckets[Bucket].Key = Strings.get(Entry.Key);
+    Buckets[Bucket].Prefix = Strings.get(Entry.Prefix);
+    Buckets[Bucket].Suffix = Strings.get(Entry.Suffix);
+    MaxValueLength = std::max<uint32_t>(MaxValueLength,
+                                        Entry.Prefix.size() +
+                                        Entry.Suffix.size());
+  }
+
+  // The header map is written in host byte order; readers swap as needed.
+  HMapHeader Header;
+  Header.Magic = HMAP_HeaderMagicNumber;
+  Header.Version = HMAP_HeaderVersion;
+  Header.Reserved = 0;
+  Header.StringsOffset = sizeof(HMapHeader) + NumBuckets * sizeof(HMapBucket);
+  Header.NumEntries = Unique.size();
+  Header.NumBuckets = NumBuckets;
+  Header.MaxValueLength = MaxValueLength;
+
+  OS.write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+  OS.write(reinterpret_cast<const char *>(&Buckets[0]),
+           NumBuckets * sizeof(HMapBucket));
+  OS << Strings.getData();
+}
@@ -14,14 +14,18 @@
 #include "clang/Lex/HeaderSearch.h"
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/FileManager.h"
+#include "clang/Basic/FileSystemStatCache.h"
 #include "clang/Basic/IdentifierTable.h"
 #include "clang/Lex/HeaderMap.h"
 #include "clang/Lex/HeaderSearchOptions.h"
 #include "clang/Lex/Lexer.h"
+#include "clang/Lex/Preprocessor.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/Support/Capacity.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 #include <cstdio>
 #if defined(LLVM_ON_UNIX)
 #include <limits.h>
@@ -55,8 +59,15 @@ HeaderSearch::HeaderSearch(IntrusiveRefCntPtr<HeaderSearchOptions> HSOpts,
 
   ExternalLookup = 0;
   ExternalSource = 0;
+  SearchMap = 0;
+  SearchMapModTime = 0;
+  SearchMapChecked = false;
+  RecordSearchMap = false;
+  UseSharedIncludeGuards = true;
   NumIncluded = 0;
   NumMultiIncludeFileOptzn = 0;
+  NumSharedIncludeGuardOptzn = 0;
+  NumSearchMapHits = 0;
   NumFrameworkLookups = NumSubFrameworkLookups = 0;
 }
 
@@ -83,6 +94,11 @@ void HeaderSearch::PrintStats() {
   fprintf(stderr, "  %d #include/#include_next/#import.\n", NumIncluded);
   fprintf(stderr, "    %d #includes skipped due to"
           " the multi-include optimization.\n", NumMultiIncludeFileOptzn);
+  fprintf(stderr, "    %d #includes skipped due to include guards from"
+          " earlier translation units.\n", NumSharedIncludeGuardOptzn);
+  if (SearchMap)
+    fprintf(stderr, "  %d lookups answered by the search map.\n",
+            NumSearchMapHits);
 
   fprintf(stderr, "%d framework lookups.\n", NumFrameworkLookups);
   fprintf(stderr, "%d subframework lookups.\n", NumSubFrameworkLookups);
@@ -243,11 +259,19 @@ const FileEntry *DirectoryLookup::LookupFile(
       RelativePath->clear();
       RelativePath->append(Filename.begin(), Filename.end());
     }
-    
+
+    // Most search directories don't have the file; try to find that out
+    // without asking the file system. Module maps are still loaded as if
+    // the file had been looked for.
+    bool MayExist = HS.getFileMgr().mayContainFile(getDir(), Filename);
+
     // If we have a module map that might map this header, load it and
     // check whether we'll have a suggestion for a module.
     if (SuggestedModule &&
         HS.hasModuleMap(TmpDir, getDir(), isSystemHeaderDirectory())) {
+      if (!MayExist)
+        return 0;
+
       const FileEntry *File = HS.getFileMgr().getFile(TmpDir.str(), 
                                                       /*openFile=*/false);
       if (!File)
@@ -258,7 +282,9 @@ const FileEntry *DirectoryLookup::LookupFile(
       *SuggestedModule = HS.findModuleForHeader(File);
       return File;
     }
-    
+
+    if (!MayExist)
+      return 0;
     return HS.getFileMgr().getFile(TmpDir.str(), /*openFile=*/true);
   }
 
@@ -573,6 +599,7 @@ const FileEntry *HeaderSearch::LookupFile(
   // file was found in.
   if (FromDir)
     i = FromDir-&SearchDirs[0];
+  unsigned StartIdx = i;
 
   // Cache all of the lookups performed by this method.  Many headers are
   // multiply included, and the "pragma once" optimization prevents them from
@@ -592,6 +619,17 @@ const FileEntry *HeaderSearch::LookupFile(
     // our search start.  We will fill in our found location below, so prime the
     // start point value.
     CacheLookup.first = i+1;
+
+    // An earlier build may have found the file in a later directory, in which
+    // case none of the directories in between have it. Module maps are only
+    // loaded for directories that are searched, so don't skip any when
+    // looking for modules.
+    unsigned SearchMapIdx;
+    if (SearchMap && !SuggestedModule &&
+        lookupSearchMap(Filename, i, SearchMapIdx)) {
+      ++NumSearchMapHits;
+      i = SearchMapIdx;
+    }
   }
 
   // Check each directory in sequence to see if it contains this file.
@@ -635,6 +673,9 @@ const FileEntry *HeaderSearch::LookupFile(
       }
     }
     
+    if (RecordSearchMap && StartIdx == 0 && CurDir->isNormalDir())
+      RecordedLookups[Filename] = i;
+
     // Remember this location for the next lookup we do.
     CacheLookup.second = i;
     return FE;
@@ -881,7 +922,9 @@ void HeaderSearch::MarkFileModuleHeader(const FileEntry *FE,
   HFI.setHeaderRole(Role);
 }
 
-bool HeaderSearch::ShouldEnterIncludeFile(const FileEntry *File, bool isImport){
+bool HeaderSearch::ShouldEnterIncludeFile(Preprocessor &PP,
+                                          const FileEntry *File,
+                                          bool isImport) {
   ++NumIncluded; // Count # of attempted #includes.
 
   // Get information about this file.
@@ -911,12 +954,155 @@ bool HeaderSearch::ShouldEnterIncludeFile(const FileEntry *File, bool isImport){
       return false;
     }
 
+  // If this is the first time the file is included, an earlier translation
+  // unit may have learned its guard from the same contents. Don't trust it
+  // for files whose contents are overridden, since the guard was learned from
+  // the contents on disk.
+  SharedFileSystemCache *Shared = FileMgr.getSharedCache();
+  SourceManager &SM = PP.getSourceManager();
+  std::string Macro;
+  if (!FileInfo.NumIncludes && Shared && UseSharedIncludeGuards &&
+      !SM.isFileOverridden(File) &&
+      Shared->getIncludeGuard(File->getUniqueID(), File->getSize(), Macro)) {
+    IdentifierInfo *ControllingMacro = PP.getIdentifierInfo(Macro);
+    if (ControllingMacro->hasMacroDefinition()) {
+      bool Invalid = false;
+      const llvm::MemoryBuffer *Buffer = SM.getMemoryBufferForFile(File,
+                                                                   &Invalid);
+      if (!Invalid && Shared->isIncludeGuardCurrent(File->getUniqueID(),
+                                                    Buffer->getBuffer())) {
+        FileInfo.ControllingMacro = ControllingMacro;
+        ++NumSharedIncludeGuardOptzn;
+        return false;
+      }
+    }
+  }
+
   // Increment the number of times this file has been included.
   ++FileInfo.NumIncludes;
 
   return true;
 }
 
+bool HeaderSearch::lookupSearchMap(StringRef Filename, unsigned StartIdx,
+                                   unsigned &DirIdx) {
+  if (!SearchMapChecked) {
+    SearchMapChecked = true;
+    SearchMapDirs.clear();
+    SearchMapDirModified.clear();
+    SearchMapSubdirModified.clear();
+    HeaderMapEntry Signature;
+    if (!SearchMap || !SearchMap->lookupEntry("", Signature) ||
+        Signature.Prefix != getSearchPathSignature()) {
+      SearchMap = 0;
+      return false;
+    }
+    for (unsigned i = 0, e = SearchDirs.size(); i != e; ++i) {
+      // Adding a header to a directory modifies it. The map may have been
+      // written in the same second, so err on the side of a search.
+      llvm::sys::fs::file_status Status;
+      SearchMapDirModified.push_back(
+          !llvm::sys::fs::status(SearchDirs[i].getName(), Status) &&
+          Status.getLastModificationTime().toEpochTime() >= SearchMapModTime);
+
+      if (!SearchDirs[i].isNormalDir())
+        continue;
+      std::string Prefix = SearchDirs[i].getDir()->getName();
+      Prefix += '/';
+      SearchMapDirs.GetOrCreateValue(Prefix, i);
+    }
+  }
+  if (!SearchMap)
+    return false;
+
+  HeaderMapEntry Entry;
+  if (!SearchMap->lookupEntry(Filename, Entry) || Entry.Suffix != Filename)
+    return false;
+  llvm::StringMap<unsigned>::iterator Dir = SearchMapDirs.find(Entry.Prefix);
+  if (Dir == SearchMapDirs.end() || Dir->getValue() < StartIdx)
+    return false;
+
+  // Make sure no header was added to a directory in between.
+  for (unsigned i = StartIdx, e = Dir->getValue(); i != e; ++i)
+    if (isSearchMapDirModified(i, Filename))
+      return false;
+
+  // Make sure the file is still there.
+  if (!FileMgr.getFile(Entry.Prefix + Entry.Suffix, /*openFile=*/true))
+    return false;
+  DirIdx = Dir->getValue();
+  return true;
+}
+
+bool HeaderSearch::isSearchMapDirModified(unsigned DirIdx,
+                                          StringRef Filename) {
+  StringRef Subdir = llvm::sys::path::parent_path(Filename);
+  if (Subdir.empty() || SearchDirs[DirIdx].isHeaderMap())
+    return SearchMapDirModified[DirIdx];
+  // A framework maps the first component to a different directory, so be
+  // conservative.
+  if (SearchDirs[DirIdx].isFramework())
+    return true;
+
+  SmallString<128> Path(SearchDirs[DirIdx].getName());
+  llvm::sys::path::append(Path, Subdir);
+  llvm::StringMap<bool>::iterator Known = SearchMapSubdirModified.find(Path);
+  if (Known != SearchMapSubdirModified.end())
+    return Known->getValue();
+
+  // Adding the header modifies the deepest directory on its path that already
+  // existed when the map was written; any directories created below that one
+  // since modified it as well.
+  bool Modified = SearchMapDirModified[DirIdx];
+  SmallString<128> Prefix(SearchDirs[DirIdx].getName());
+  for (llvm::sys::path::const_iterator I = llvm::sys::path::begin(Subdir),
+                                       E = llvm::sys::path::end(Subdir);
+       I != E; ++I) {
+    llvm::sys::path::append(Prefix, *I);
+    llvm::sys::fs::file_status Status;
+    if (llvm::sys::fs::status(Prefix.str(), Status) ||
+        !llvm::sys::fs::is_directory(Status))
+      break;
+    Modified =
+        Status.getLastModificationTime().toEpochTime() >= SearchMapModTime;
+  }
+  SearchMapSubdirModified[Path] = Modified;
+  return Modified;
+}
+
+std::string HeaderSearch::getSearchPathSignature() const {
+  std::string Result;
+  llvm::raw_string_ostream OS(Result);
+  OS << AngledDirIdx << ' ' << SystemDirIdx << ' ' << NoCurDirSearch;
+  for (unsigned i = 0, e = SearchDirs.size(); i != e; ++i) {
+    const DirectoryLookup &Dir = SearchDirs[i];
+    OS << '\n' << Dir.getLookupType() << ' ' << Dir.getDirCharacteristic()
+       << ' ' << Dir.isIndexHeaderMap() << ' ' << Dir.getName();
+  }
+  for (unsigned i = 0, e = SystemHeaderPrefixes.size(); i != e; ++i)
+    OS << "\nprefix " << SystemHeaderPrefixes[i].second << ' '
+       << SystemHeaderPrefixes[i].first;
+  return OS.str();
+}
+
+void
+HeaderSearch::getSearchMapEntries(std::vector<HeaderMapEntry> &Entries) const {
+  HeaderMapEntry Signature;
+  Signature.Prefix = getSearchPathSignature();
+  Entries.push_back(Signature);
+
+  for (llvm::StringMap<unsigned>::const_iterator I = RecordedLookups.begin(),
+                                                 E = RecordedLookups.end();
+       I != E; ++I) {
+    HeaderMapEntry Entry;
+    Entry.Key = I->getKey();
+    Entry.Prefix = SearchDirs[I->getValue()].getDir()->getName();
+    Entry.Prefix += '/';
+    Entry.Suffix = I->getKey();
+    Entries.push_back(Entry);
+  }
+}
+
 size_t HeaderSearch::getTotalMemory() const {
   return SearchDirs.capacity()
     + llvm::capacity_in_bytes(FileInfo)
@@ -0,0 +1,126 @@
+//===--- HeaderTokenCache.cpp - Cached tokens of headers ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the HeaderTokenCache interface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Lex/HeaderTokenCache.h"
+#include "clang/Basic/LangOptions.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Basic/Version.h"
+#include "clang/Lex/PTHManager.h"
+#include "clang/Lex/Preprocessor.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+using namespace clang;
+
+HeaderTokenCache::HeaderTokenCache(StringRef Directory,
+                                   const LangOptions &LangOpts)
+  : Directory(Directory.str()), NumHits(0), NumMisses(0) {
+  // The tokens of a header depend on the token kinds of this compiler, and on
+  // the language options, e.g. for keywords and digraphs.
+  llvm::raw_string_ostream OS(Signature);
+  OS << getClangFullRepositoryVersion() << ' ' << PTHManager::Version;
+#define LANGOPT(Name, Bits, Default, Description) \
+  OS << ' ' << static_cast<unsigned>(LangOpts.Name);
+#define ENUM_LANGOPT(Name, Type, Bits, Default, Description) \
+  OS << ' ' << static_cast<unsigned>(LangOpts.get##Name());
+#define BENIGN_LANGOPT(Name, Bits, Default, Description)
+#define BENIGN_ENUM_LANGOPT(Name, Type, Bits, Default, Description)
+#include "clang/Basic/LangOptions.def"
+  OS.flush();
+}
+
+HeaderTokenCache::~HeaderTokenCache() {
+  for (llvm::StringMap<PTHManager*>::iterator I = Entries.begin(),
+       E = Entries.end(); I != E; ++I)
+    delete I->getValue();
+}
+
+void HeaderTokenCache::getEntryPath(StringRef Key,
+                                    SmallVectorImpl<char> &Path) const {
+  Path.assign(Directory.begin(), Directory.end());
+  llvm::sys::path::append(Path, Key + ".pth");
+}
+
+PTHLexer *HeaderTokenCache::CreateLexer(FileID FID, Preprocessor &PP) {
+  SourceManager &SM = PP.getSourceManager();
+  if (FID == SM.getMainFileID())
+    return 0;
+
+  // The lexer does not diagnose anything while an entry is written, so only
+  // headers in system directories, where its warnings are suppressed anyway,
+  // are cached.  Since those warnings are suppressed whatever the warning
+  // options are, entries are shared across them.
+  if (!PP.getDiagnostics().getSuppressSystemWarnings())
+    return 0;
+  bool Invalid = false;
+  const SrcMgr::SLocEntry &Entry = SM.getSLocEntry(FID, &Invalid);
+  if (Invalid || !Entry.isFile() ||
+      Entry.getFile().getFileCharacteristic() == SrcMgr::C_User ||
+      !SM.getFileEntryForSLocEntry(Entry))
+    return 0;
+
+  const llvm::MemoryBuffer *Buffer = SM.getBuffer(FID, &Invalid);
+  if (Invalid)
+    return 0;
+
+  llvm::MD5 Hash;
+  Hash.update(Signature);
+  Hash.update(Buffer->getBuffer());
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Key;
+  llvm::MD5::stringifyResult(Result, Key);
+
+  PTHManager *PTH = 0;
+  llvm::StringMap<PTHManager*>::iterator I = Entries.find(Key);
+  if (I != Entries.end()) {
+    PTH = I->getValue();
+  } else {
+    // The entry is memory mapped, and shared by all inclusions of headers
+    // with these contents.
+    SmallString<128> Path;
+    getEntryPath(Key, Path);
+    OwningPtr<llvm::MemoryBuffer> File;
+    if (!llvm::MemoryBuffer::getFile(Path.str(), File))
+      PTH = PTHManager::Create(File.take(), Path.str(), /*Diags=*/0);
+
+    if (PTH) {
+      PTH->setPreprocessor(&PP);
+      PTH->setSharedIdentifiers(true);
+    } else {
+      MissingHeaders.push_back(std::make_pair(FID, Key.str().str()));
+    }
+    Entries[Key] = PTH;
+  }
+
+  // The entry caches the tokens of the header under its key, which guards
+  // against truncated or misplaced entries.
+  if (PTH)
+    if (PTHLexer *L = PTH->CreateLexer(FID, Key.c_str())) {
+      ++NumHits;
+      return L;
+    }
+
+  ++NumMisses;
+  return 0;
+}
+
+void HeaderTokenCache::PrintStats() const {
+  llvm::errs() << NumHits << "/" << (NumHits + NumMisses)
+               << " headers read from the token cache, "
+               << MissingHeaders.size() << " missing.\n";
+}
@@ -1438,14 +1438,192 @@ static void maybeDiagnoseIDCharCompat(DiagnosticsEngine &Diags, uint32_t C,
   }
  }
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#elif __ALTIVEC__
+#include <altivec.h>
+#undef bool
+#endif
+
+//===----------------------------------------------------------------------===//
+// Fast scanning of runs of uninteresting characters
+//===----------------------------------------------------------------------===//
+//
+// The functions below return a pointer to the first character at or after
+// CurPtr that ends a run of characters the lexer would otherwise skip one at a
+// time. They examine 16 bytes at a time with SSE2 where it is available and
+// fall back to a byte loop near the end of the buffer. The buffer is always
+// terminated by a nul character, which ends every run, so the byte loops do
+// not need to check for the end of the buffer.
+
+#ifdef __SSE2__
+/// \brief Returns a mask of the bytes of \p Chunk in the range [\p Lo, \p Hi].
+/// Both bounds must be ASCII characters.
+static inline __m128i matchRange(__m128i Chunk, char Lo, char Hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(Chunk, _mm_set1_epi8(Lo - 1)),
+                       _mm_cmplt_epi8(Chunk, _mm_set1_epi8(Hi + 1)));
+}
+
+static inline __m128i matchChar(__m128i Chunk, char C) {
+  return _mm_cmpeq_epi8(Chunk, _mm_set1_epi8(C));
+}
+#endif
+
+/// \brief Skips the characters matching [_A-Za-z0-9].
+static const char *skipIdentifierBody(const char *CurPtr,
+                                      const char *BufferEnd) {
+#ifdef __SSE2__
+  while (CurPtr + 16 <= BufferEnd) {
+    __m128i Chunk = _mm_loadu_si128((const __m128i *)CurPtr);
+    __m128i Body = _mm_or_si128(
+        _mm_or_si128(matchRange(Chunk, 'a', 'z'), matchRange(Chunk, 'A', 'Z')),
+        _mm_or_si128(matchRange(Chunk, '0', '9'), matchChar(Chunk, '_')));
+    unsigned Mask = ~_mm_movemask_epi8(Body) & 0xFFFF;
+    if (Mask != 0)
+      return CurPtr + llvm::countTrailingZeros(Mask);
+    CurPtr += 16;
+  }
+#endif
+  while (isIdentifierBody(*CurPtr))
+    ++CurPtr;
+  return CurPtr;
+}
+
+/// \brief Skips horizontal whitespace: ' ', '\\t', '\\f' and '\\v'.
+static const char *skipHorizontalWhitespace(const char *CurPtr,
+                                            const char *BufferEnd) {
+#ifdef __SSE2__
+  while (CurPtr + 16 <= BufferEnd) {
+    __m128i Chunk = _mm_loadu_si128((const __m128i *)CurPtr);
+    __m128i Space = _mm_or_si128(
+        _mm_or_si128(matchChar(Chunk, ' '), matchChar(Chunk, '\t')),
+        _mm_or_si128(matchChar(Chunk, '\f'), matchChar(Chunk, '\v')));
+    unsigned Mask = ~_mm_movemask_epi8(Space) & 0xFFFF;
+    if (Mask != 0)
+      return CurPtr + llvm::countTrailingZeros(Mask);
+    CurPtr += 16;
+  }
+#endif
+  while (isHorizontalWhitespace(*CurPtr))
+    ++CurPtr;
+  return CurPtr;
+}
+
+/// \brief Skips to the next '\\n', '\\r' or nul character.
+static const char *findEndOfLine(const char *CurPtr, const char *BufferEnd) {
+#ifdef __SSE2__
+  while (CurPtr + 16 <= BufferEnd) {
+    __m128i Chunk = _mm_loadu_si128((const __m128i *)CurPtr);
+    __m128i End = _mm_or_si128(
+        _mm_or_si128(matchChar(Chunk, '\n'), matchChar(Chunk, '\r')),
+        matchChar(Chunk, 0));
+    unsigned Mask = _mm_movemask_epi8(End);
+    if (Mask != 0)
+      return CurPtr + llvm::countTrailingZeros(Mask);
+    CurPtr += 16;
+  }
+#endif
+  while (*CurPtr != 0 && *CurPtr != '\n' && *CurPtr != '\r')
+    ++CurPtr;
+  return CurPtr;
+}
+
+/// \brief Skips the characters of a string literal that need no special
+/// handling, stopping at '"', '\\', '?' (a possible trigraph), newlines and
+/// nul characters.
+static const char *skipStringLiteralChars(const char *CurPtr,
+                                          const char *BufferEnd) {
+#ifdef __SSE2__
+  while (CurPtr + 16 <= BufferEnd) {
+    __m128i Chunk = _mm_loadu_si128((const __m128i *)CurPtr);
+    __m128i Special = _mm_or_si128(
+        _mm_or_si128(
+            _mm_or_si128(matchChar(Chunk, '"'), matchChar(Chunk, '\\')),
+            _mm_or_si128(matchChar(Chunk, '?'), matchChar(Chunk, '\n'))),
+        _mm_or_si128(matchChar(Chunk, '\r'), matchChar(Chunk, 0)));
+    unsigned Mask = _mm_movemask_epi8(Special);
+    if (Mask != 0)
+      return CurPtr + llvm::countTrailingZeros(Mask);
+    CurPtr += 16;
+  }
+#endif
+  while (1) {
+    switch (*CurPtr) {
+    case '"': case '\\': case '?': case '\n': case '\r': case 0:
+      return CurPtr;
+    default:
+      ++CurPtr;
+    }
+  }
+}
+
+/// \brief Skips to the next '/' or nul character.
+static const char *findSlash(const char *CurPtr, const char *BufferEnd) {
+#ifdef __SSE2__
+  while (CurPtr + 16 <= BufferEnd) {
+    __m128i Chunk = _mm_loadu_si128((const __m128i *)CurPtr);
+    unsigned Mask = _mm_movemask_epi8(
+        _mm_or_si128(matchChar(Chunk, '/'), matchChar(Chunk, 0)));
+    if (Mask != 0)
+      return CurPtr + llvm::countTrailingZeros(Mask);
+    CurPtr += 16;
+  }
+#endif
+  while (*CurPtr != 0 && *CurPtr != '/')
+    ++CurPtr;
+  return CurPtr;
+}
+
+/// \brief Skips the characters of an excluded line that cannot change how
+/// the following lines are lexed, stopping at newlines, quotes, '/', '\\',
+/// nul characters, and '?' (a possible trigraph) if \p Trigraphs is true.
+static const char *findExcludedLineSpecialChar(const char *CurPtr,
+                                               const char *BufferEnd,
+                                               bool Trigraphs) {
+#ifdef __SSE2__
+  __m128i Question = _mm_set1_epi8(Trigraphs ? '?' : '\n');
+  while (CurPtr + 16 <= BufferEnd) {
+    __m128i Chunk = _mm_loadu_si128((const __m128i *)CurPtr);
+    __m128i Special = _mm_or_si128(
+        _mm_or_si128(
+            _mm_or_si128(matchChar(Chunk, '\n'), matchChar(Chunk, '\r')),
+            _mm_or_si128(matchChar(Chunk, '"'), matchChar(Chunk, '\''))),
+        _mm_or_si128(
+            _mm_or_si128(matchChar(Chunk, '/'), matchChar(Chunk, '\\')),
+            _mm_or_si128(matchChar(Chunk, 0), _mm_cmpeq_epi8(Chunk, Question))));
+    unsigned Mask = _mm_movemask_epi8(Special);
+    if (Mask != 0)
+      return CurPtr + llvm::countTrailingZeros(Mask);
+    CurPtr += 16;
+  }
+#endif
+  while (1) {
+    switch (*CurPtr) {
+    case '\n': case '\r': case '"': case '\'': case '/': case '\\': case 0:
+      return CurPtr;
+    case '?':
+      if (Trigraphs)
+        return CurPtr;
+      // FALL THROUGH.
+    default:
+      ++CurPtr;
+    }
+  }
+}
+
+/// \brief Skips a newline, or a \\r\\n or \\n\\r pair, at \p CurPtr.
+static const char *skipNewline(const char *CurPtr) {
+  char C = *CurPtr++;
+  if ((*CurPtr == '\n' || *CurPtr == '\r') && *CurPtr != C)
+    ++CurPtr;
+  return CurPtr;
+}
+
 void Lexer::LexIdentifier(Token &Result, const char *CurPtr) {
   // Match [_A-Za-z0-9]*, we have already matched [_A-Za-z$]
   unsigned Size;
-  unsigned char C = *CurPtr++;
-  while (isIdentifierBody(C))
-    C = *CurPtr++;
-
-  --CurPtr;   // Back up over the skipped character.
+  CurPtr = skipIdentifierBody(CurPtr, BufferEnd);
+  unsigned char C = *CurPtr;
 
   // Fast path, no $,\,? in identifier found.  '\' might be an escaped newline
   // or UCN, and ? might be a trigraph for '\', an escaped newline or UCN.
@@ -1693,6 +1871,8 @@ void Lexer::LexStringLiteral(Token &Result, const char *CurPtr,
 
       NulCharacter = CurPtr-1;
     }
+    // Skip ahead to the next character that may need special handling.
+    CurPtr = skipStringLiteralChars(CurPtr, BufferEnd);
     C = getAndAdvanceChar(CurPtr, Result);
   }
 
@@ -1897,8 +2077,10 @@ bool Lexer::SkipWhitespace(Token &Result, const char *CurPtr) {
   // Skip consecutive spaces efficiently.
   while (1) {
     // Skip horizontal whitespace very aggressively.
-    while (isHorizontalWhitespace(Char))
-      Char = *++CurPtr;
+    if (isHorizontalWhitespace(Char)) {
+      CurPtr = skipHorizontalWhitespace(CurPtr + 1, BufferEnd);
+      Char = *CurPtr;
+    }
 
     // Otherwise if we have something other than whitespace, we're done.
     if (!isVerticalWhitespace(Char))
@@ -1958,11 +2140,10 @@ bool Lexer::SkipLineComment(Token &Result, const char *CurPtr) {
   // them.  As such, optimize for this case with the inner loop.
   char C;
   do {
+    // Skip over characters in the fast loop, up to a potential EOF, a newline
+    // or a DOS-style newline.
+    CurPtr = findEndOfLine(CurPtr, BufferEnd);
     C = *CurPtr;
-    // Skip over characters in the fast loop.
-    while (C != 0 &&                // Potentially EOF.
-           C != '\n' && C != '\r')  // Newline or DOS-style newline.
-      C = *++CurPtr;
 
     const char *NextLine = CurPtr;
     if (C != 0) {
@@ -2155,13 +2336,6 @@ static bool isEndOfBlockCommentWithEscapedNewLine(const char *CurPtr,
   return true;
 }
 
-#ifdef __SSE2__
-#include <emmintrin.h>
-#elif __ALTIVEC__
-#include <altivec.h>
-#undef bool
-#endif
-
 /// We have just read from input the / and * characters that started a comment.
 /// Read until we find the * and / characters that terminate the comment.
 /// Note that we don't bother decoding trigraphs or escaped newlines in block
@@ -2388,6 +2562,183 @@ void Lexer::ReadToEndOfLine(SmallVectorImpl<char> *Result) {
   }
 }
 
+/// SkipExcludedLines - Skip over the lines of an excluded conditional block
+/// that cannot contain a preprocessor directive, without forming tokens.
+///
+/// This tracks comments, string and character literals, and escaped newlines,
+/// and stops before a '#' (or '%:') that starts a line.  Constructs that it
+/// cannot skip exactly, such as raw string literals, trigraphs, escaped
+/// newlines in unusual places, conflict markers and nul characters, are left
+/// to the lexer: the scan then stops at the last token boundary before them,
+/// and may be resumed once the lexer has lexed the next token.
+void Lexer::SkipExcludedLines() {
+  assert(LexingRawMode && !ParsingPreprocessorDirective &&
+         "Must be skipping an excluded conditional block!");
+
+  // Clean is the last position the lexer can resume lexing from, and
+  // CleanAtStartOfLine is the value IsAtStartOfLine needs there.
+  const char *CurPtr = BufferPtr;
+  const char *Clean = CurPtr;
+  bool CleanAtStartOfLine = IsAtStartOfLine;
+  bool AtStartOfLine = IsAtStartOfLine;
+  bool Trigraphs = LangOpts.Trigraphs;
+
+  while (1) {
+    if (AtStartOfLine) {
+      CurPtr = skipHorizontalWhitespace(CurPtr, BufferEnd);
+      Clean = CurPtr;
+      CleanAtStartOfLine = true;
+
+      unsigned char C = *CurPtr;
+      if (C == '\n' || C == '\r') {
+        ++CurPtr;
+        continue;
+      }
+      // Found a line that may hold a directive.
+      if (C == '#' || (C == '%' && CurPtr[1] == ':' && LangOpts.Digraphs))
+        break;
+      // Comments before the '#' don't keep it from starting a directive.
+      if (C == '/' && (CurPtr[1] == '/' || CurPtr[1] == '*')) {
+        if (!SkipExcludedComment(CurPtr))
+          break;
+        continue;
+      }
+      // Leave escaped newlines, conflict markers, Unicode whitespace, trigraphs
+      // and the end of the buffer to the lexer.
+      if (C == '\\' || C == '<' || C == '=' || C == '|' || C == '>' ||
+          C == 0 || !isASCII(C) || (C == '?' && Trigraphs))
+        break;
+      AtStartOfLine = false;
+    }
+
+    CurPtr = findExcludedLineSpecialChar(CurPtr, BufferEnd, Trigraphs);
+    switch (*CurPtr) {
+    case '\n':
+    case '\r':
+      ++CurPtr;
+      AtStartOfLine = true;
+      continue;
+    case '/':
+      if (CurPtr[1] == '/' || CurPtr[1] == '*') {
+        if (!SkipExcludedComment(CurPtr))
+          break;
+        Clean = CurPtr;
+        CleanAtStartOfLine = false;
+        continue;
+      }
+      // A '/' followed by an escaped newline may start a comment.
+      if (CurPtr[1] == '\\' || (CurPtr[1] == '?' && Trigraphs))
+        break;
+      ++CurPtr;
+      continue;
+    case '"':
+    case '\'': {
+      // Raw string literals can span lines.
+      if (*CurPtr == '"' && LangOpts.CPlusPlus11 && CurPtr != BufferStart &&
+          CurPtr[-1] == 'R')
+        break;
+      // An unterminated literal ends at the end of the line.
+      char Quote = *CurPtr++;
+      while (*CurPtr != Quote && *CurPtr != '\n' && *CurPtr != '\r') {
+        if (*CurPtr == 0 || (*CurPtr == '?' && Trigraphs))
+          break;
+        if (*CurPtr == '\\') {
+          // Skip the escaped character, or the escaped newline.
+          const char *AfterSlash = skipHorizontalWhitespace(CurPtr + 1,
+                                                            BufferEnd);
+          if (*AfterSlash == '\n' || *AfterSlash == '\r')
+            CurPtr = skipNewline(AfterSlash);
+          else if (*++CurPtr != 0)
+            ++CurPtr;
+          continue;
+        }
+        ++CurPtr;
+      }
+      if (*CurPtr == 0 || *CurPtr == '?')
+        break;
+      if (*CurPtr == Quote) {
+        Clean = ++CurPtr;
+        CleanAtStartOfLine = false;
+      }
+      continue;
+    }
+    case '\\': {
+      const char *AfterSlash = skipHorizontalWhitespace(CurPtr + 1, BufferEnd);
+      if (*AfterSlash == '\n' || *AfterSlash == '\r')
+        CurPtr = skipNewline(AfterSlash);
+      else
+        ++CurPtr;
+      continue;
+    }
+    case '?':
+      if (CurPtr[1] == '?')
+        break;
+      ++CurPtr;
+      continue;
+    default:
+      assert(*CurPtr == 0 && "Unexpected character!");
+      // In raw mode, the lexer returns the end of file without looking at what
+      // precedes it. Leave embedded nul characters, such as a code-completion
+      // point, to the lexer.
+      if (CurPtr == BufferEnd) {
+        Clean = CurPtr;
+        CleanAtStartOfLine = AtStartOfLine;
+      }
+      break;
+    }
+
+    // Leave the construct at CurPtr to the lexer.
+    break;
+  }
+
+  BufferPtr = Clean;
+  IsAtStartOfLine = CleanAtStartOfLine;
+}
+
+/// SkipExcludedComment - Skip the comment at CurPtr in an excluded
+/// conditional block.  Returns false, without moving CurPtr, if the comment
+/// should be left to the lexer.
+bool Lexer::SkipExcludedComment(const char *&CurPtr) {
+  const char *Start = CurPtr;
+  if (Start[1] == '/') {
+    if (!LangOpts.LineComment)
+      return false;
+    const char *End = Start + 2;
+    while (1) {
+      End = findEndOfLine(End, BufferEnd);
+      if (*End == 0)
+        return false;
+      const char *EscapePtr = End - 1;
+      while (isHorizontalWhitespace(*EscapePtr))
+        --EscapePtr;
+      if (*EscapePtr == '/' && EscapePtr[-1] == '?' && EscapePtr[-2] == '?')
+        return false; // A possible trigraph-escaped newline.
+      if (*EscapePtr != '\\')
+        break;
+      End = skipNewline(End);
+    }
+    CurPtr = End;
+    return true;
+  }
+
+  // Find the '/' ending the block comment, taking care that the '/' in "/*/"
+  // doesn't end it.
+  const char *End = Start + 2;
+  while (1) {
+    End = findSlash(End, BufferEnd);
+    if (*End == 0)
+      return false;
+    if (End[-1] == '*' && End - 1 != Start + 1)
+      break;
+    // The '*' and '/' may be separated by an escaped newline.
+    if (End[-1] == '\n' || End[-1] == '\r')
+      return false;
+    ++End;
+  }
+  CurPtr = End + 1;
+  return true;
+}
+
 /// LexEndOfFile - CurPtr points to the end of this file.  Handle this
 /// condition, reporting diagnostics and handling other edge cases as required.
 /// This returns true if Result contains a token, false if PP.Lex should be
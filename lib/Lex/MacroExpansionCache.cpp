@@ -0,0 +1,238 @@
+//===--- MacroExpansionCache.cpp - Memoized macro expansions --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the MacroExpansionCache interface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Lex/MacroExpansionCache.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/DiagnosticOptions.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Lex/MacroArgs.h"
+#include "clang/Lex/MacroInfo.h"
+#include "clang/Lex/Preprocessor.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+using namespace clang;
+
+/// MaxRunDistance - Tokens whose spellings are at most this many bytes apart
+/// share a spelling run, like consecutive macro argument tokens do in
+/// TokenLexer.
+static const unsigned MaxRunDistance = 50;
+
+MacroExpansionCache::MacroExpansionCache()
+  : NumHits(0), NumMisses(0), NumUncacheable(0), NumInvalidations(0) {}
+
+template <typename T>
+static void appendBytes(SmallVectorImpl<char> &Key, const T &Value) {
+  const char *Bytes = reinterpret_cast<const char *>(&Value);
+  Key.append(Bytes, Bytes + sizeof(T));
+}
+
+void MacroExpansionCache::computeKey(const Token &Identifier,
+                                     const MacroDirective *MD,
+                                     const MacroArgs *Args, Preprocessor &PP,
+                                     SmallVectorImpl<char> &Key,
+                                     SmallVectorImpl<SourceLocation> &ArgLocs) {
+  appendBytes(Key, MD);
+
+  // The first token of the expansion inherits the whitespace before the
+  // macro name.
+  Key.push_back(Identifier.isAtStartOfLine() |
+                Identifier.hasLeadingSpace() << 1);
+
+  if (!Args || Args->getNumArguments() == 0)
+    return;
+
+  Key.push_back(Args->isVarargsElidedUse());
+
+  // The argument tokens are stored back to back, each argument terminated by
+  // an EOF token.  Spellings matter, e.g. for stringification.
+  SmallString<64> Buffer;
+  const Token *ArgTok = Args->getUnexpArgument(0);
+  for (unsigned i = 0, e = Args->getNumArguments(); i != e; ++i, ++ArgTok) {
+    appendBytes(Key, static_cast<unsigned short>(ArgTok->getKind()));
+    if (ArgTok->is(tok::eof)) {
+      ArgLocs.push_back(SourceLocation());
+      continue;
+    }
+
+    Key.push_back(ArgTok->getFlags());
+    StringRef Spelling = PP.getSpelling(*ArgTok, Buffer);
+    appendBytes(Key, static_cast<unsigned>(Spelling.size()));
+    Key.append(Spelling.begin(), Spelling.end());
+    ArgLocs.push_back(ArgTok->getLocation());
+  }
+}
+
+bool MacroExpansionCache::replay(StringRef Key, const MacroInfo *MI,
+                                 SourceLocation ExpandStart,
+                                 SourceLocation ExpandEnd,
+                                 ArrayRef<SourceLocation> ArgLocs,
+                                 SourceManager &SM,
+                                 SmallVectorImpl<Token> &Result) {
+  llvm::StringMap<Entry>::const_iterator I = Entries.find(Key);
+  if (I == Entries.end()) {
+    ++NumMisses;
+    return false;
+  }
+  ++NumHits;
+  const Entry &E = I->getValue();
+
+  // Reserve a chunk for the macro definition, like TokenLexer does.  Tokens
+  // from the definition point into it, and arguments are expanded into it.
+  SourceLocation DefStart =
+    SM.getExpansionLoc(MI->getReplacementToken(0).getLocation());
+  SourceLocation BodyStart =
+    SM.createExpansionLoc(DefStart, ExpandStart, ExpandEnd,
+                          MI->getDefinitionLength(SM));
+
+  SmallVector<SourceLocation, 8> RunStarts;
+  for (unsigned i = 0, e = E.Runs.size(); i != e; ++i)
+    RunStarts.push_back(SM.createExpansionLoc(E.Runs[i].Start, ExpandStart,
+                                              ExpandEnd, E.Runs[i].Length));
+
+  unsigned First = Result.size();
+  Result.append(E.Tokens.begin(), E.Tokens.end());
+  for (unsigned i = 0, e = E.Tokens.size(); i != e; ++i) {
+    Token &Tok = Result[First + i];
+    const TokenLoc &Loc = E.Locs[i];
+    switch (Loc.Kind) {
+    case TokenLoc::Definition:
+      Tok.setLocation(BodyStart.getLocWithOffset(Loc.Offset));
+      break;
+    case TokenLoc::Argument:
+      assert(Loc.Index < ArgLocs.size() && "Arguments do not match the key?");
+      Tok.setLocation(SM.createMacroArgExpansionLoc(
+          ArgLocs[Loc.Index], BodyStart.getLocWithOffset(Loc.Offset),
+          Tok.getLength()));
+      break;
+    case TokenLoc::Run:
+      Tok.setLocation(RunStarts[Loc.Index].getLocWithOffset(Loc.Offset));
+      break;
+    }
+  }
+  return true;
+}
+
+void MacroExpansionCache::record(StringRef Key, const MacroInfo *MI,
+                                 ArrayRef<SourceLocation> ArgLocs,
+                                 ArrayRef<Token> Expanded, Preprocessor &PP) {
+  SourceManager &SM = PP.getSourceManager();
+  SourceLocation DefStart =
+    SM.getExpansionLoc(MI->getReplacementToken(0).getLocation());
+  unsigned DefLength = MI->getDefinitionLength(SM);
+
+  // Spelling runs flatten the expansion levels that lead to their tokens,
+  // which only goes unnoticed without macro backtraces.
+  bool MayFlatten =
+    PP.getDiagnostics().getDiagnosticOptions().MacroBacktraceLimit == 0;
+
+  llvm::DenseMap<unsigned, unsigned> ArgIndex;
+  for (unsigned i = 0, e = ArgLocs.size(); i != e; ++i)
+    if (ArgLocs[i].isValid())
+      ArgIndex[ArgLocs[i].getRawEncoding()] = i;
+
+  std::vector<TokenLoc> Locs;
+  std::vector<SpellingRun> Runs;
+  FileID RunFID;
+  unsigned RunOffset = 0, PrevOffset = 0;
+  for (unsigned i = 0, e = Expanded.size(); i != e; ++i) {
+    const Token &Tok = Expanded[i];
+    // Annotation tokens come from pragmas, and an 'import' starts a module
+    // import; neither can simply be lexed again.
+    if (Tok.isAnnotation() || Tok.is(tok::code_completion) ||
+        Tok.getLocation().isInvalid() ||
+        (Tok.getIdentifierInfo() &&
+         Tok.getIdentifierInfo()->isModulesImport())) {
+      ++NumUncacheable;
+      return;
+    }
+
+    // Only look through the expansion of this macro itself: the token is
+    // either spelled in its definition, or is an argument token substituted
+    // for a parameter.
+    SourceLocation TokLoc = Tok.getLocation();
+    SourceLocation Immediate;
+    bool IsArg = false;
+    if (TokLoc.isMacroID()) {
+      Immediate = SM.getImmediateSpellingLoc(TokLoc);
+      IsArg = SM.isMacroArgExpansion(TokLoc);
+    }
+
+    TokenLoc Loc;
+    unsigned Offset;
+    llvm::DenseMap<unsigned, unsigned>::iterator Arg;
+    if (Immediate.isValid() && !IsArg &&
+        SM.isInSLocAddrSpace(Immediate, DefStart, DefLength, &Offset)) {
+      Loc.Kind = TokenLoc::Definition;
+      Loc.Index = 0;
+      Loc.Offset = Offset;
+    } else if (Immediate.isValid() && IsArg &&
+               (Arg = ArgIndex.find(Immediate.getRawEncoding())) !=
+                 ArgIndex.end() &&
+               SM.isInSLocAddrSpace(
+                 SM.getImmediateSpellingLoc(
+                   SM.getImmediateExpansionRange(TokLoc).first),
+                 DefStart, DefLength, &Offset)) {
+      Loc.Kind = TokenLoc::Argument;
+      Loc.Index = Arg->second;
+      Loc.Offset = Offset;
+    } else {
+      // Pasted and stringified tokens, and tokens of nested macros.
+      if (!MayFlatten) {
+        ++NumUncacheable;
+        return;
+      }
+      SourceLocation Spelling = SM.getSpellingLoc(TokLoc);
+      std::pair<FileID, unsigned> Decomposed = SM.getDecomposedLoc(Spelling);
+      if (Runs.empty() || Decomposed.first != RunFID ||
+          Decomposed.second < PrevOffset ||
+          Decomposed.second - RunOffset >= MaxRunDistance) {
+        SpellingRun Run;
+        Run.Start = Spelling;
+        Run.Length = 0;
+        Runs.push_back(Run);
+        RunFID = Decomposed.first;
+        RunOffset = Decomposed.second;
+      }
+      PrevOffset = Decomposed.second;
+
+      Loc.Kind = TokenLoc::Run;
+      Loc.Index = Runs.size() - 1;
+      Loc.Offset = Decomposed.second - RunOffset;
+      Runs.back().Length = std::max(Runs.back().Length,
+                                    Loc.Offset + Tok.getLength());
+    }
+    Locs.push_back(Loc);
+  }
+
+  Entry &E = Entries[Key];
+  E.Tokens.assign(Expanded.begin(), Expanded.end());
+  E.Locs.swap(Locs);
+  E.Runs.swap(Runs);
+}
+
+void MacroExpansionCache::invalidate() {
+  if (Entries.empty())
+    return;
+
+  Entries.clear();
+  ++NumInvalidations;
+}
+
+void MacroExpansionCache::PrintStats() const {
+  llvm::errs() << NumHits << "/" << (NumHits + NumMisses)
+               << " memoized macro expansions replayed, "
+               << NumUncacheable << " not memoizable, "
+               << NumInvalidations << " invalidations.\n";
+}
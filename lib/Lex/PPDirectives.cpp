@@ -257,6 +257,9 @@ void Preprocessor::SkipExcludedConditionalBlock(SourceLocation IfTokenLoc,
   CurPPLexer->LexingRawMode = true;
   Token Tok;
   while (1) {
+    // Jump to the next line that may hold a directive without tokenizing the
+    // lines in between.
+    CurLexer->SkipExcludedLines();
     CurLexer->Lex(Tok);
 
     if (Tok.is(tok::code_completion)) {
@@ -1101,17 +1104,31 @@ void Preprocessor::HandleDigitDirective(Token &DigitTok) {
 ///
 void Preprocessor::HandleUserDiagnosticDirective(Token &Tok,
                                                  bool isWarning) {
-  // PTH doesn't emit #warning or #error directives.
-  if (CurPTHLexer)
-    return CurPTHLexer->DiscardToEndOfLine();
-
   // Read the rest of the line raw.  We do this because we don't want macros
   // to be expanded and we don't require that the tokens be valid preprocessing
   // tokens.  For example, this is allowed: "#warning `   'foo".  GCC does
   // collapse multiple consequtive white space between tokens, but this isn't
   // specified by the standard.
   SmallString<128> Message;
-  CurLexer->ReadToEndOfLine(&Message);
+  if (CurLexer) {
+    CurLexer->ReadToEndOfLine(&Message);
+  } else {
+    // PTH doesn't cache the text of #warning or #error directives, so read it
+    // from the source file with a raw lexer.
+    std::pair<FileID, unsigned> LocInfo =
+      SourceMgr.getDecomposedLoc(Tok.getLocation());
+    bool Invalid = false;
+    StringRef Buffer = SourceMgr.getBufferData(LocInfo.first, &Invalid);
+    if (!Invalid) {
+      Lexer RawLex(SourceMgr.getLocForStartOfFile(LocInfo.first),
+                   getLangOpts(), Buffer.begin(),
+                   Buffer.begin() + LocInfo.second + Tok.getLength(),
+                   Buffer.end());
+      RawLex.setParsingPreprocessorDirective(true);
+      RawLex.ReadToEndOfLine(&Message);
+    }
+    CurPTHLexer->DiscardToEndOfLine();
+  }
 
   // Find the first non-whitespace character, so that we can make the
   // diagnostic more succinct.
@@ -1598,7 +1615,8 @@ void Preprocessor::HandleIncludeDirective(SourceLocation HashLoc,
 
   // Ask HeaderInfo if we should enter this #include file.  If not, #including
   // this file will have no effect.
-  if (!HeaderInfo.ShouldEnterIncludeFile(File, isImport)) {
+  if (!HeaderInfo.ShouldEnterIncludeFile(*this, File, isImport)) {
+    ++NumSkippedIncludes;
     if (Callbacks)
       Callbacks->FileSkipped(*File, FilenameTok, FileCharacter);
     return;
@@ -14,8 +14,10 @@
 
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Basic/FileManager.h"
+#include "clang/Basic/FileSystemStatCache.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/HeaderTokenCache.h"
 #include "clang/Lex/LexDiagnostic.h"
 #include "clang/Lex/MacroInfo.h"
 #include "llvm/ADT/StringSwitch.h"
@@ -81,6 +83,12 @@ void Preprocessor::EnterSourceFile(FileID FID, const DirectoryLookup *CurDir,
       EnterSourceFileWithPTH(PL, CurDir);
       return;
     }
+  } else if (HeaderTokens && !KeepComments && !isCodeCompletionEnabled()) {
+    // The cached tokens of a header do not include comments.
+    if (PTHLexer *PL = HeaderTokens->CreateLexer(FID, *this)) {
+      EnterSourceFileWithPTH(PL, CurDir);
+      return;
+    }
   }
   
   // Get the MemoryBuffer for this FID, if it fails, we fail.
@@ -246,6 +254,14 @@ bool Preprocessor::HandleEndOfFile(Token &Result, bool isEndOfMacro) {
       if (const FileEntry *FE =
             SourceMgr.getFileEntryForID(CurPPLexer->getFileID())) {
         HeaderInfo.SetFileControllingMacro(FE, ControllingMacro);
+        // Let later translation units skip the file as well, unless what we
+        // lexed was not the file on disk.
+        if (SharedFileSystemCache *Shared = FileMgr.getSharedCache())
+          if (!SourceMgr.isFileOverridden(FE))
+            Shared->setIncludeGuard(
+                FE->getUniqueID(),
+                SourceMgr.getBuffer(CurPPLexer->getFileID())->getBuffer(),
+                ControllingMacro->getName());
         if (const IdentifierInfo *DefinedMacro =
               CurPPLexer->MIOpt.GetDefinedMacro()) {
           if (!ControllingMacro->hasMacroDefinition() &&
@@ -20,6 +20,7 @@
 #include "clang/Lex/CodeCompletionHandler.h"
 #include "clang/Lex/ExternalPreprocessorSource.h"
 #include "clang/Lex/LexDiagnostic.h"
+#include "clang/Lex/MacroExpansionCache.h"
 #include "clang/Lex/MacroInfo.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
@@ -53,6 +54,10 @@ void Preprocessor::appendMacroDirective(IdentifierInfo *II, MacroDirective *MD){
                          cast<DefMacroDirective>(MD)->isImported();
   if (II->isFromAST() && !isImportedMacro)
     II->setChangedSinceDeserialization();
+
+  // Memoized expansions may depend on the previous definition.
+  if (ExpansionCache)
+    ExpansionCache->invalidate();
 }
 
 void Preprocessor::setLoadedMacroDirective(IdentifierInfo *II,
@@ -66,6 +71,9 @@ void Preprocessor::setLoadedMacroDirective(IdentifierInfo *II,
   II->setHasMacroDefinition(true);
   if (!MD->isDefined())
     II->setHasMacroDefinition(false);
+
+  if (ExpansionCache)
+    ExpansionCache->invalidate();
 }
 
 /// RegisterBuiltinMacro - Register the specified identifier in the identifier
@@ -222,6 +230,11 @@ bool Preprocessor::HandleMacroExpandedIdentifier(Token &Identifier,
 
   // If this is a builtin macro, like __LINE__ or _Pragma, handle it specially.
   if (MI->isBuiltinMacro()) {
+    // Builtin macros expand to something different each time, or have side
+    // effects, so the expansion that contains them cannot be replayed.
+    if (MemoizationBarrier)
+      MemoizedExpansionUncacheable = true;
+
     if (Callbacks) Callbacks->MacroExpands(Identifier, MD,
                                            Identifier.getLocation(),/*Args=*/0);
     ExpandBuiltinMacro(Identifier);
@@ -381,6 +394,12 @@ bool Preprocessor::HandleMacroExpandedIdentifier(Token &Identifier,
     return false;
   }
 
+  // If this invocation was expanded before, replay its tokens.
+  if (ExpansionCache && canMemoizeMacroExpansion()) {
+    ExpandMemoizedMacro(Identifier, ExpansionEnd, MD, MI, Args);
+    return false;
+  }
+
   // Start expanding the macro.
   EnterMacro(Identifier, ExpansionEnd, MI, Args);
 
@@ -390,6 +409,146 @@ bool Preprocessor::HandleMacroExpandedIdentifier(Token &Identifier,
   return false;
 }
 
+/// canMemoizeMacroExpansion - Expansions are only memoized for invocations
+/// read from a source file while no other macro is being expanded, where no
+/// macro is disabled and the expansion cannot depend on what surrounds it.
+bool Preprocessor::canMemoizeMacroExpansion() const {
+  if (!CurPPLexer || InMacroArgs || InMacroArgPreExpansion ||
+      MemoizationBarrier || CurLexerKind == CLK_LexAfterModuleImport)
+    return false;
+
+  // Directives may lex some of the expanded tokens unexpanded, like the
+  // operand of 'defined' in #if.
+  if (CurPPLexer->ParsingPreprocessorDirective)
+    return false;
+
+  // The preprocessing record wants to see every expansion, and a comment
+  // formed by pasting "/" and "/" consumes the rest of the source line.
+  if (Record || isCodeCompletionEnabled() || getLangOpts().MicrosoftMode)
+    return false;
+
+  // A _Pragma operator lexes its string while the macro that contains it is
+  // still being expanded.
+  for (unsigned i = 0, e = IncludeMacroStack.size(); i != e; ++i)
+    if (IncludeMacroStack[i].TheTokenLexer)
+      return false;
+  return true;
+}
+
+/// ExpandMemoizedMacro - Replay the expansion of a macro invocation that was
+/// expanded before with the same arguments.  Otherwise expand it completely,
+/// the same way macro arguments are pre-expanded, and record the result.
+void Preprocessor::ExpandMemoizedMacro(Token &Identifier,
+                                       SourceLocation ExpansionEnd,
+                                       MacroDirective *MD, MacroInfo *MI,
+                                       MacroArgs *Args) {
+  SmallString<128> Key;
+  SmallVector<SourceLocation, 16> ArgLocs;
+  MacroExpansionCache::computeKey(Identifier, MD, Args, *this, Key, ArgLocs);
+
+  SmallVector<Token, 64> Expanded;
+  if (ExpansionCache->replay(Key, MI, Identifier.getLocation(), ExpansionEnd,
+                             ArgLocs, SourceMgr, Expanded)) {
+    if (Args) Args->destroy(*this);
+    EnterMemoizedExpansion(Identifier, Expanded, /*Escaped=*/false);
+    return;
+  }
+
+  // Put an EOF token after the expansion, so that a function-like macro at
+  // its end does not look for arguments after the invocation.
+  Token Barrier;
+  Barrier.startToken();
+  Barrier.setKind(tok::eof);
+  Barrier.setLocation(ExpansionEnd);
+  EnterTokenStream(&Barrier, 1, /*DisableMacroExpansion=*/true,
+                   /*OwnsTokens=*/false);
+  MemoizationBarrier = CurTokenLexer.get();
+  MemoizedExpansionEscaped = false;
+  MemoizedExpansionUncacheable = false;
+
+  // Diagnostics are not emitted again when the expansion is replayed.
+  DiagnosticErrorTrap Trap(*Diags);
+  unsigned NumWarnings = Diags->getNumWarnings();
+
+  EnterMacro(Identifier, ExpansionEnd, MI, Args);
+
+  Token Tok;
+  while (1) {
+    Lex(Tok);
+    // If a nested invocation read its arguments past the barrier, the tokens
+    // lexed from now on are no longer part of this expansion.
+    if (MemoizedExpansionEscaped) {
+      Expanded.push_back(Tok);
+      break;
+    }
+    if (Tok.is(tok::eof))
+      break;
+    Expanded.push_back(Tok);
+  }
+
+  bool Escaped = MemoizedExpansionEscaped;
+  if (!Escaped) {
+    // Pop the barrier off the top of the stack.
+    assert(CurTokenLexer.get() == MemoizationBarrier && "Barrier not reached?");
+    if (InCachingLexMode())
+      ExitCachingLexMode();
+    RemoveTopOfLexerStack();
+    MemoizationBarrier = 0;
+  }
+
+  if (Escaped || MemoizedExpansionUncacheable || Trap.hasErrorOccurred() ||
+      Diags->getNumWarnings() != NumWarnings)
+    ExpansionCache->noteUncacheable();
+  else
+    ExpansionCache->record(Key, MI, ArgLocs, Expanded, *this);
+
+  EnterMemoizedExpansion(Identifier, Expanded, Escaped);
+}
+
+/// EnterMemoizedExpansion - Make the fully expanded tokens of a macro
+/// invocation the next tokens to lex, and lex the first of them.
+void Preprocessor::EnterMemoizedExpansion(Token &Identifier,
+                                          ArrayRef<Token> Expanded,
+                                          bool Escaped) {
+  if (Expanded.empty()) {
+    // This works like the expansion of a macro without tokens.
+    bool HadLeadingSpace = Identifier.hasLeadingSpace();
+    bool IsAtStartOfLine = Identifier.isAtStartOfLine();
+
+    Lex(Identifier);
+
+    if (!Identifier.isAtStartOfLine()) {
+      if (IsAtStartOfLine) Identifier.setFlag(Token::StartOfLine);
+      if (HadLeadingSpace) Identifier.setFlag(Token::LeadingSpace);
+    }
+    Identifier.setFlag(Token::LeadingEmptyMacro);
+    return;
+  }
+
+  // Every identifier in the expansion has already been considered for macro
+  // expansion, except that a function-like macro at its very end may still
+  // be invoked with arguments that follow the invocation.
+  unsigned NumToks = Expanded.size();
+  const Token &Last = Expanded.back();
+  if (!Escaped && Last.getIdentifierInfo() && !Last.isExpandDisabled() &&
+      getMacroDirective(Last.getIdentifierInfo())) {
+    Token *LastTok = new Token[1];
+    LastTok[0] = Last;
+    EnterTokenStream(LastTok, 1, /*DisableMacroExpansion=*/false,
+                     /*OwnsTokens=*/true);
+    --NumToks;
+  }
+
+  if (NumToks) {
+    Token *Toks = new Token[NumToks];
+    std::copy(Expanded.begin(), Expanded.begin() + NumToks, Toks);
+    EnterTokenStream(Toks, NumToks, /*DisableMacroExpansion=*/true,
+                     /*OwnsTokens=*/true);
+  }
+
+  Lex(Identifier);
+}
+
 enum Bracket {
   Brace,
   Paren
@@ -567,6 +726,17 @@ MacroArgs *Preprocessor::ReadFunctionLikeMacroArgs(Token &MacroName,
       // an argument value in a macro could expand to ',' or '(' or ')'.
       LexUnexpandedToken(Tok);
 
+      if (Tok.is(tok::eof) && MemoizationBarrier &&
+          CurTokenLexer.get() == MemoizationBarrier) {
+        // The arguments continue after the end of the macro expansion that is
+        // being memoized.  Drop the barrier and keep reading them from there;
+        // the expansion is no longer self-contained.
+        RemoveTopOfLexerStack();
+        MemoizationBarrier = 0;
+        MemoizedExpansionEscaped = true;
+        continue;
+      }
+
       if (Tok.is(tok::eof) || Tok.is(tok::eod)) { // "#if f(<eof>" & "#if f(\n"
         if (!ContainsCodeCompletionTok) {
           Diag(MacroName, diag::err_unterm_macro_invoc);
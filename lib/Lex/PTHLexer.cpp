@@ -339,11 +339,11 @@ public:
 
 class PTHFileLookupTrait : public PTHFileLookupCommonTrait {
 public:
-  typedef const FileEntry* external_key_type;
-  typedef PTHFileData      data_type;
+  typedef const char*  external_key_type;
+  typedef PTHFileData  data_type;
 
-  static internal_key_type GetInternalKey(const FileEntry* FE) {
-    return std::make_pair((unsigned char) 0x1, FE->getName());
+  static internal_key_type GetInternalKey(const char *Name) {
+    return std::make_pair((unsigned char) 0x1, Name);
   }
 
   static bool EqualKey(internal_key_type a, internal_key_type b) {
@@ -417,7 +417,7 @@ PTHManager::PTHManager(const llvm::MemoryBuffer* buf, void* fileLookup,
                        const char* originalSourceFile)
 : Buf(buf), PerIDCache(perIDCache), FileLookup(fileLookup),
   IdDataTable(idDataTable), StringIdLookup(stringIdLookup),
-  NumIds(numIds), PP(0), SpellingBase(spellingBase),
+  NumIds(numIds), PP(0), SharedIdentifiers(false), SpellingBase(spellingBase),
   OriginalSourceFile(originalSourceFile) {}
 
 PTHManager::~PTHManager() {
@@ -427,8 +427,15 @@ PTHManager::~PTHManager() {
   free(PerIDCache);
 }
 
-static void InvalidPTH(DiagnosticsEngine &Diags, const char *Msg) {
-  Diags.Report(Diags.getCustomDiagID(DiagnosticsEngine::Error, Msg));
+static void InvalidPTH(DiagnosticsEngine *Diags, const char *Msg) {
+  if (Diags)
+    Diags->Report(Diags->getCustomDiagID(DiagnosticsEngine::Error, Msg));
+}
+
+static PTHManager *InvalidPTHFile(DiagnosticsEngine *Diags, StringRef File) {
+  if (Diags)
+    Diags->Report(diag::err_invalid_pth_file) << File;
+  return 0;
 }
 
 PTHManager *PTHManager::Create(const std::string &file,
@@ -442,6 +449,13 @@ PTHManager *PTHManager::Create(const std::string &file,
     return 0;
   }
 
+  return Create(File.take(), file, &Diags);
+}
+
+PTHManager *PTHManager::Create(llvm::MemoryBuffer *Buffer, StringRef file,
+                               DiagnosticsEngine *Diags) {
+  OwningPtr<llvm::MemoryBuffer> File(Buffer);
+
   // Get the buffer ranges and check if there are at least three 32-bit
   // words at the end of the file.
   const unsigned char *BufBeg = (const unsigned char*)File->getBufferStart();
@@ -450,8 +464,7 @@ PTHManager *PTHManager::Create(const std::string &file,
   // Check the prologue of the file.
   if ((BufEnd - BufBeg) < (signed)(sizeof("cfe-pth") + 4 + 4) ||
       memcmp(BufBeg, "cfe-pth", sizeof("cfe-pth")) != 0) {
-    Diags.Report(diag::err_invalid_pth_file) << file;
-    return 0;
+    return InvalidPTHFile(Diags, file);
   }
 
   // Read the PTH version.
@@ -470,8 +483,7 @@ PTHManager *PTHManager::Create(const std::string &file,
   const unsigned char *PrologueOffset = p;
 
   if (PrologueOffset >= BufEnd) {
-    Diags.Report(diag::err_invalid_pth_file) << file;
-    return 0;
+    return InvalidPTHFile(Diags, file);
   }
 
   // Construct the file lookup table.  This will be used for mapping from
@@ -480,8 +492,7 @@ PTHManager *PTHManager::Create(const std::string &file,
   const unsigned char* FileTable = BufBeg + ReadLE32(FileTableOffset);
 
   if (!(FileTable > BufBeg && FileTable < BufEnd)) {
-    Diags.Report(diag::err_invalid_pth_file) << file;
-    return 0; // FIXME: Proper error diagnostic?
+    return InvalidPTHFile(Diags, file); // FIXME: Proper error diagnostic?
   }
 
   OwningPtr<PTHFileLookup> FL(PTHFileLookup::Create(FileTable, BufBeg));
@@ -497,8 +508,7 @@ PTHManager *PTHManager::Create(const std::string &file,
   const unsigned char* IData = BufBeg + ReadLE32(IDTableOffset);
 
   if (!(IData >= BufBeg && IData < BufEnd)) {
-    Diags.Report(diag::err_invalid_pth_file) << file;
-    return 0;
+    return InvalidPTHFile(Diags, file);
   }
 
   // Get the location of the hashtable mapping between strings and
@@ -506,8 +516,7 @@ PTHManager *PTHManager::Create(const std::string &file,
   const unsigned char* StringIdTableOffset = PrologueOffset + sizeof(uint32_t)*1;
   const unsigned char* StringIdTable = BufBeg + ReadLE32(StringIdTableOffset);
   if (!(StringIdTable >= BufBeg && StringIdTable < BufEnd)) {
-    Diags.Report(diag::err_invalid_pth_file) << file;
-    return 0;
+    return InvalidPTHFile(Diags, file);
   }
 
   OwningPtr<PTHStringIdLookup> SL(PTHStringIdLookup::Create(StringIdTable,
@@ -517,8 +526,7 @@ PTHManager *PTHManager::Create(const std::string &file,
   const unsigned char* spellingBaseOffset = PrologueOffset + sizeof(uint32_t)*3;
   const unsigned char* spellingBase = BufBeg + ReadLE32(spellingBaseOffset);
   if (!(spellingBase >= BufBeg && spellingBase < BufEnd)) {
-    Diags.Report(diag::err_invalid_pth_file) << file;
-    return 0;
+    return InvalidPTHFile(Diags, file);
   }
 
   // Get the number of IdentifierInfos and pre-allocate the identifier cache.
@@ -555,13 +563,18 @@ IdentifierInfo* PTHManager::LazilyCreateIdentifierInfo(unsigned PersistentID) {
     (const unsigned char*)Buf->getBufferStart() + ReadLE32(TableEntry);
   assert(IDData < (const unsigned char*)Buf->getBufferEnd());
 
-  // Allocate the object.
-  std::pair<IdentifierInfo,const unsigned char*> *Mem =
-    Alloc.Allocate<std::pair<IdentifierInfo,const unsigned char*> >();
-
-  Mem->second = IDData;
   assert(IDData[0] != '\0');
-  IdentifierInfo *II = new ((void*) Mem) IdentifierInfo();
+  IdentifierInfo *II;
+  if (SharedIdentifiers) {
+    II = PP->getIdentifierInfo((const char*) IDData);
+  } else {
+    // Allocate the object.
+    std::pair<IdentifierInfo,const unsigned char*> *Mem =
+      Alloc.Allocate<std::pair<IdentifierInfo,const unsigned char*> >();
+
+    Mem->second = IDData;
+    II = new ((void*) Mem) IdentifierInfo();
+  }
 
   // Store the new IdentifierInfo in the cache.
   PerIDCache[PersistentID] = II;
@@ -588,11 +601,15 @@ PTHLexer *PTHManager::CreateLexer(FileID FID) {
   if (!FE)
     return 0;
 
-  // Lookup the FileEntry object in our file lookup data structure.  It will
+  return CreateLexer(FID, FE->getName());
+}
+
+PTHLexer *PTHManager::CreateLexer(FileID FID, const char *Name) {
+  // Lookup the file name in our file lookup data structure.  It will
   // return a variant that indicates whether or not there is an offset within
   // the PTH file that contains cached tokens.
   PTHFileLookup& PFL = *((PTHFileLookup*)FileLookup);
-  PTHFileLookup::iterator I = PFL.find(FE);
+  PTHFileLookup::iterator I = PFL.find(Name);
 
   if (I == PFL.end()) // No tokens available?
     return 0;
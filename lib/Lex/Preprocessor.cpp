@@ -33,8 +33,10 @@
 #include "clang/Lex/CodeCompletionHandler.h"
 #include "clang/Lex/ExternalPreprocessorSource.h"
 #include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/HeaderTokenCache.h"
 #include "clang/Lex/LexDiagnostic.h"
 #include "clang/Lex/LiteralSupport.h"
+#include "clang/Lex/MacroExpansionCache.h"
 #include "clang/Lex/MacroInfo.h"
 #include "clang/Lex/ModuleLoader.h"
 #include "clang/Lex/Pragma.h"
@@ -67,8 +69,8 @@ Preprocessor::Preprocessor(IntrusiveRefCntPtr<PreprocessorOptions> PPOpts,
       CodeComplete(0), CodeCompletionFile(0), CodeCompletionOffset(0),
       CodeCompletionReached(0), SkipMainFilePreamble(0, true), CurPPLexer(0),
       CurDirLookup(0), CurLexerKind(CLK_Lexer), Callbacks(0),
-      MacroArgCache(0), Record(0), MIChainHead(0), MICache(0),
-      DeserialMIChainHead(0) {
+      MacroArgCache(0), Record(0), ExpansionCache(0), MemoizationBarrier(0),
+      MIChainHead(0), MICache(0), DeserialMIChainHead(0) {
   OwnsHeaderSearch = OwnsHeaders;
   
   ScratchBuf = new ScratchBuffer(SourceMgr);
@@ -78,6 +80,7 @@ Preprocessor::Preprocessor(IntrusiveRefCntPtr<PreprocessorOptions> PPOpts,
   NumDirectives = NumDefined = NumUndefined = NumPragma = 0;
   NumIf = NumElse = NumEndif = 0;
   NumEnteredSourceFiles = 0;
+  NumSkippedIncludes = 0;
   NumMacroExpanded = NumFnMacroExpanded = NumBuiltinMacroExpanded = 0;
   NumFastMacroExpanded = NumTokenPaste = NumFastTokenPaste = 0;
   MaxIncludeStackDepth = 0;
@@ -93,6 +96,8 @@ Preprocessor::Preprocessor(IntrusiveRefCntPtr<PreprocessorOptions> PPOpts,
   MacroExpansionInDirectivesOverride = false;
   InMacroArgs = false;
   InMacroArgPreExpansion = false;
+  MemoizedExpansionEscaped = false;
+  MemoizedExpansionUncacheable = false;
   NumCachedTokenLexers = 0;
   PragmasEnabled = true;
   ParsingIfOrElifDirective = false;
@@ -167,6 +172,9 @@ Preprocessor::~Preprocessor() {
   // Delete the scratch buffer info.
   delete ScratchBuf;
 
+  // Delete the memoized macro expansions.
+  delete ExpansionCache;
+
   // Delete the header search info, if we own it.
   if (OwnsHeaderSearch)
     delete &HeaderInfo;
@@ -189,6 +197,10 @@ void Preprocessor::setPTHManager(PTHManager* pm) {
   FileMgr.addStatCache(PTH->createStatCache());
 }
 
+void Preprocessor::setHeaderTokenCache(HeaderTokenCache *Cache) {
+  HeaderTokens.reset(Cache);
+}
+
 void Preprocessor::DumpToken(const Token &Tok, bool DumpFlags) const {
   llvm::errs() << tok::getTokenName(Tok.getKind()) << " '"
                << getSpelling(Tok) << "'";
@@ -234,15 +246,22 @@ void Preprocessor::PrintStats() {
   llvm::errs() << "  #include/#include_next/#import:\n";
   llvm::errs() << "    " << NumEnteredSourceFiles << " source files entered.\n";
   llvm::errs() << "    " << MaxIncludeStackDepth << " max include stack depth\n";
+  llvm::errs() << "    " << NumSkippedIncludes << " skipped, "
+               << HeaderInfo.getNumSharedIncludeGuardOptzn()
+               << " due to include guards from earlier translation units.\n";
   llvm::errs() << "  " << NumIf << " #if/#ifndef/#ifdef.\n";
   llvm::errs() << "  " << NumElse << " #else/#elif.\n";
   llvm::errs() << "  " << NumEndif << " #endif.\n";
   llvm::errs() << "  " << NumPragma << " #pragma.\n";
   llvm::errs() << NumSkipped << " #if/#ifndef#ifdef regions skipped\n";
+  if (HeaderTokens)
+    HeaderTokens->PrintStats();
 
   llvm::errs() << NumMacroExpanded << "/" << NumFnMacroExpanded << "/"
              << NumBuiltinMacroExpanded << " obj/fn/builtin macros expanded, "
              << NumFastMacroExpanded << " on the fast path.\n";
+  if (ExpansionCache)
+    ExpansionCache->PrintStats();
   llvm::errs() << (NumFastTokenPaste+NumTokenPaste)
              << " token paste (##) operations performed, "
              << NumFastTokenPaste << " on the fast path.\n";
@@ -826,3 +845,10 @@ void Preprocessor::createPreprocessingRecord() {
   Record = new PreprocessingRecord(getSourceManager());
   addPPCallbacks(Record);
 }
+
+void Preprocessor::createMacroExpansionCache() {
+  if (ExpansionCache)
+    return;
+
+  ExpansionCache = new MacroExpansionCache();
+}
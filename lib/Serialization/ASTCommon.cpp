@@ -16,6 +16,7 @@
 #include "clang/Basic/IdentifierTable.h"
 #include "clang/Serialization/ASTDeserializationListener.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/MD5.h"
 
 using namespace clang;
 
@@ -88,6 +89,52 @@ unsigned serialization::ComputeHash(Selector Sel) {
   return R;
 }
 
+uint64_t serialization::ComputeInputFileSignature(StringRef Contents) {
+  llvm::MD5 Hash;
+  Hash.update(Contents);
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+
+  uint64_t Signature = 0;
+  for (unsigned I = 0; I != 8; ++I)
+    Signature = (Signature << 8) | Result[I];
+  // Zero means that there is no signature.
+  return Signature ? Signature : 1;
+}
+
+serialization::IdentifierBloomHashes::IdentifierBloomHashes(StringRef Name) {
+  // The bits are derived from two independent hashes (Bernstein and FNV-1a),
+  // as in Kirsch and Mitzenmacher's double hashing.  The second hash is odd,
+  // so that the bits of an identifier differ unless the filter is tiny.
+  First = llvm::HashString(Name);
+  Second = 2166136261u;
+  for (unsigned I = 0, N = Name.size(); I != N; ++I) {
+    Second ^= (unsigned char)Name[I];
+    Second *= 16777619u;
+  }
+  Second |= 1;
+}
+
+void serialization::addToIdentifierBloomFilter(
+    unsigned char *Filter, unsigned NumBits, unsigned NumHashes,
+    const IdentifierBloomHashes &Hashes) {
+  for (unsigned I = 0; I != NumHashes; ++I) {
+    unsigned Bit = Hashes.getBit(I, NumBits);
+    Filter[Bit / 8] |= 1 << (Bit % 8);
+  }
+}
+
+bool serialization::mayBeInIdentifierBloomFilter(
+    const unsigned char *Filter, unsigned NumBits, unsigned NumHashes,
+    const IdentifierBloomHashes &Hashes) {
+  for (unsigned I = 0; I != NumHashes; ++I) {
+    unsigned Bit = Hashes.getBit(I, NumBits);
+    if (!(Filter[Bit / 8] & (1 << (Bit % 8))))
+      return false;
+  }
+  return true;
+}
+
 const DeclContext *
 serialization::getDefinitiveDeclContext(const DeclContext *DC) {
   switch (DC->getDeclKind()) {
@@ -60,6 +60,44 @@ TypeID MakeTypeID(ASTContext &Context, QualType T, IdxForTypeTy IdxForType) {
 
 unsigned ComputeHash(Selector Sel);
 
+/// \brief Compute the signature of the contents of an input file, which is
+/// never zero.
+uint64_t ComputeInputFileSignature(StringRef Contents);
+
+/// \brief The number of bits set for each identifier in the Bloom filter of
+/// an identifier table.
+const unsigned IdentifierBloomFilterHashes = 7;
+
+/// \brief The number of bits of the Bloom filter of an identifier table per
+/// identifier, which keeps the false positive rate below 1%.
+const unsigned IdentifierBloomFilterBitsPerIdentifier = 10;
+
+/// \brief The two hashes of an identifier from which the bits that it sets in
+/// a Bloom filter are derived.
+struct IdentifierBloomHashes {
+  uint32_t First;
+  uint32_t Second;
+
+  explicit IdentifierBloomHashes(StringRef Name);
+
+  /// \brief Retrieve the index of the I'th bit of this identifier in a filter
+  /// of \p NumBits bits.
+  unsigned getBit(unsigned I, unsigned NumBits) const {
+    return (First + I * Second) % NumBits;
+  }
+};
+
+/// \brief Set the bits of an identifier in a Bloom filter.
+void addToIdentifierBloomFilter(unsigned char *Filter, unsigned NumBits,
+                                unsigned NumHashes,
+                                const IdentifierBloomHashes &Hashes);
+
+/// \brief Determine whether an identifier may be in a Bloom filter, i.e.
+/// whether all of its bits are set.
+bool mayBeInIdentifierBloomFilter(const unsigned char *Filter, unsigned NumBits,
+                                  unsigned NumHashes,
+                                  const IdentifierBloomHashes &Hashes);
+
 /// \brief Retrieve the "definitive" declaration that provides all of the
 /// visible entries for the given declaration context, if there is one.
 ///
@@ -23,6 +23,8 @@
 #include "clang/AST/Type.h"
 #include "clang/AST/TypeLocVisitor.h"
 #include "clang/Basic/FileManager.h"
+#include "clang/Basic/FileSystemStatCache.h"
+#include "clang/Basic/Parallel.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Basic/SourceManagerInternals.h"
 #include "clang/Basic/TargetInfo.h"
@@ -49,6 +51,7 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/SaveAndRestore.h"
+#include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/system_error.h"
 #include <algorithm>
 #include <cstdio>
@@ -141,7 +144,6 @@ static bool checkTargetOptions(const TargetOptions &TargetOpts,
   CHECK_TARGET_OPT(CPU, "target CPU");
   CHECK_TARGET_OPT(ABI, "target ABI");
   CHECK_TARGET_OPT(CXXABI, "target C++ ABI");
-  CHECK_TARGET_OPT(LinkerVersion, "target linker version");
 #undef CHECK_TARGET_OPT
 
   // Compare feature sets.
@@ -1391,18 +1393,22 @@ namespace {
   /// \brief Visitor class used to look up identifirs in an AST file.
   class IdentifierLookupVisitor {
     StringRef Name;
+    IdentifierBloomHashes BloomHashes;
     unsigned PriorGeneration;
     unsigned &NumIdentifierLookups;
     unsigned &NumIdentifierLookupHits;
+    unsigned &NumIdentifierLookupsFiltered;
     IdentifierInfo *Found;
 
   public:
     IdentifierLookupVisitor(StringRef Name, unsigned PriorGeneration,
                             unsigned &NumIdentifierLookups,
-                            unsigned &NumIdentifierLookupHits)
-      : Name(Name), PriorGeneration(PriorGeneration),
+                            unsigned &NumIdentifierLookupHits,
+                            unsigned &NumIdentifierLookupsFiltered)
+      : Name(Name), BloomHashes(Name), PriorGeneration(PriorGeneration),
         NumIdentifierLookups(NumIdentifierLookups),
         NumIdentifierLookupHits(NumIdentifierLookupHits),
+        NumIdentifierLookupsFiltered(NumIdentifierLookupsFiltered),
         Found()
     {
     }
@@ -1419,6 +1425,17 @@ namespace {
         = (ASTIdentifierLookupTable *)M.IdentifierLookupTable;
       if (!IdTable)
         return false;
+
+      // If the identifier is not in the Bloom filter, it is not in the
+      // table either, and we need not touch the table.
+      if (M.IdentifierBloomFilter &&
+          !mayBeInIdentifierBloomFilter(M.IdentifierBloomFilter,
+                                        M.IdentifierBloomFilterBits,
+                                        M.IdentifierBloomFilterHashes,
+                                        This->BloomHashes)) {
+        ++This->NumIdentifierLookupsFiltered;
+        return false;
+      }
       
       ASTIdentifierLookupTrait Trait(IdTable->getInfoObj().getReader(),
                                      M, This->Found);
@@ -1461,7 +1478,8 @@ void ASTReader::updateOutOfDateIdentifier(IdentifierInfo &II) {
 
   IdentifierLookupVisitor Visitor(II.getName(), PriorGeneration,
                                   NumIdentifierLookups,
-                                  NumIdentifierLookupHits);
+                                  NumIdentifierLookupHits,
+                                  NumIdentifierLookupsFiltered);
   ModuleMgr.visit(IdentifierLookupVisitor::visit, &Visitor, HitsPtr);
   markIdentifierUpToDate(&II);
 }
@@ -1659,6 +1677,11 @@ InputFile ASTReader::getInputFile(ModuleFile &F, unsigned ID, bool Complain) {
     off_t StoredSize = (off_t)Record[1];
     time_t StoredTime = (time_t)Record[2];
     bool Overridden = (bool)Record[3];
+    // AST files written before content signatures were introduced do not
+    // have one.
+    uint64_t StoredSignature = 0;
+    if (Record.size() >= 6)
+      StoredSignature = (Record[4] << 32) | Record[5];
     
     // Get the file entry for this input file.
     StringRef OrigFilename = Blob;
@@ -1713,17 +1736,27 @@ InputFile ASTReader::getInputFile(ModuleFile &F, unsigned ID, bool Complain) {
                               StoredSize, StoredTime);
     }
 
-    bool IsOutOfDate = false;
-
     // For an overridden file, there is nothing to validate.
-    if (!Overridden && (StoredSize != File->getSize()
+    bool IsOutOfDate = false;
+    if (!Overridden) {
+      ++NumInputFilesValidated;
+      IsOutOfDate = StoredSize != File->getSize();
 #if !defined(LLVM_ON_WIN32)
-         // In our regression testing, the Windows file system seems to
-         // have inconsistent modification times that sometimes
-         // erroneously trigger this error-handling path.
-         || StoredTime != File->getModificationTime()
+      // In our regression testing, the Windows file system seems to
+      // have inconsistent modification times that sometimes
+      // erroneously trigger this error-handling path.
+      if (!IsOutOfDate && StoredTime != File->getModificationTime()) {
+        // The file may have been touched without being changed; if so, its
+        // contents still match the signature.
+        IsOutOfDate = !StoredSignature ||
+                      !inputFileMatchesSignature(File, StoredSignature);
+        if (!IsOutOfDate)
+          ++NumInputFilesMatchedBySignature;
+      }
 #endif
-         )) {
+    }
+
+    if (IsOutOfDate) {
       if (Complain) {
         Error(diag::err_fe_pch_file_modified, Filename, F.FileName);
         if (Context.getLangOpts().Modules && !Diags.isDiagnosticInFlight()) {
@@ -1731,8 +1764,6 @@ InputFile ASTReader::getInputFile(ModuleFile &F, unsigned ID, bool Complain) {
             << PP.getHeaderSearchInfo().getModuleCachePath();
         }
       }
-
-      IsOutOfDate = true;
     }
 
     InputFile IF = InputFile(File, Overridden, IsOutOfDate);
@@ -1746,6 +1777,12 @@ InputFile ASTReader::getInputFile(ModuleFile &F, unsigned ID, bool Complain) {
   return InputFile();
 }
 
+bool ASTReader::inputFileMatchesSignature(const FileEntry *File,
+                                          uint64_t Signature) {
+  OwningPtr<llvm::MemoryBuffer> Buffer(FileMgr.getBufferForFile(File));
+  return Buffer && ComputeInputFileSignature(Buffer->getBuffer()) == Signature;
+}
+
 const FileEntry *ASTReader::getFileEntry(StringRef filenameStrRef) {
   ModuleFile &M = ModuleMgr.getPrimaryModule();
   std::string Filename = filenameStrRef;
@@ -1809,12 +1846,16 @@ ASTReader::ReadControlBlock(ModuleFile &F,
       Error("malformed block record in AST file");
       return Failure;
     case llvm::BitstreamEntry::EndBlock:
-      // Validate all of the non-system input files.
-      if (!DisableValidation) {
+      // Validate all of the non-system input files.  Unless this is a
+      // module, which has to be rebuilt when it is out of date, this can be
+      // left until the files are used.
+      if (!DisableValidation &&
+          (F.Kind == MK_Module ||
+           !PP.getPreprocessorOpts().LazyPCHInputValidation)) {
         bool Complain = (ClientLoadCapabilities & ARR_OutOfDate) == 0;
-        // All user input files reside at the index range [0, Record[1]).
-        // Record is the one from INPUT_FILE_OFFSETS.
-        for (unsigned I = 0, N = Record[1]; I < N; ++I) {
+        // All user input files reside at the index range
+        // [0, NumUserInputFiles).
+        for (unsigned I = 0, N = F.NumUserInputFiles; I < N; ++I) {
           InputFile IF = getInputFile(F, I+1, Complain);
           if (!IF.getFile() || IF.isOutOfDate())
             return OutOfDate;
@@ -1878,6 +1919,10 @@ ASTReader::ReadControlBlock(ModuleFile &F,
     }
 
     case IMPORTS: {
+      // Read the imported files, and the files they import, concurrently
+      // before loading them one by one.
+      prefetchImportedModuleFiles(Record);
+
       // Load each of the imported PCH files. 
       unsigned Idx = 0, N = Record.size();
       while (Idx < N) {
@@ -1985,6 +2030,7 @@ ASTReader::ReadControlBlock(ModuleFile &F,
     case INPUT_FILE_OFFSETS:
       F.InputFileOffsets = (const uint32_t *)Blob.data();
       F.InputFilesLoaded.resize(Record[0]);
+      F.NumUserInputFiles = Record[1];
       break;
     }
   }
@@ -2209,6 +2255,16 @@ bool ASTReader::ReadASTBlock(ModuleFile &F) {
       }
       break;
 
+    case IDENTIFIER_BLOOM_FILTER:
+      // A filter that does not have all of its bits is ignored, and the
+      // identifier table is always searched.
+      if (Record[0] && Record[1] && Blob.size() * 8 >= Record[1]) {
+        F.IdentifierBloomFilter = (const unsigned char *)Blob.data();
+        F.IdentifierBloomFilterHashes = Record[0];
+        F.IdentifierBloomFilterBits = Record[1];
+      }
+      break;
+
     case IDENTIFIER_OFFSET: {
       if (F.LocalNumIdentifiers != 0) {
         Error("duplicate IDENTIFIER_OFFSET record in AST file");
@@ -2919,10 +2975,15 @@ ASTReader::ASTReadResult ASTReader::ReadAST(const std::string &FileName,
 
   unsigned NumModules = ModuleMgr.size();
   SmallVector<ImportedModule, 4> Loaded;
-  switch(ASTReadResult ReadResult = ReadASTCore(FileName, Type, ImportLoc,
-                                                /*ImportedBy=*/0, Loaded,
-                                                0, 0,
-                                                ClientLoadCapabilities)) {
+  ASTReadResult ReadResult = ReadASTCore(FileName, Type, ImportLoc,
+                                         /*ImportedBy=*/0, Loaded, 0, 0,
+                                         ClientLoadCapabilities);
+
+  // Module files that were read ahead of time, but turned out not to be
+  // needed, are no longer interesting.
+  ModuleMgr.clearPrefetchedBuffers();
+
+  switch (ReadResult) {
   case Failure:
   case Missing:
   case OutOfDate:
@@ -3335,6 +3396,51 @@ void ASTReader::InitializeContext() {
   ImportedModules.clear();
 }
 
+/// \brief Returns the name of the file that records when the input files of
+/// the AST file \p FileName were last found to be up to date.
+static std::string getInputFilesTimestampFile(StringRef FileName) {
+  return (FileName + ".timestamp").str();
+}
+
+void ASTReader::validateRemainingInputFiles() {
+  const PreprocessorOptions &PPOpts = PP.getPreprocessorOpts();
+  if (DisableValidation || !PPOpts.LazyPCHInputValidation)
+    return;
+
+  // Modules were validated when they were loaded.
+  for (ModuleIterator M = ModuleMgr.begin(), MEnd = ModuleMgr.end();
+       M != MEnd; ++M) {
+    ModuleFile &F = **M;
+    if (F.Kind == MK_Module)
+      continue;
+
+    // Input files don't change during a build session, so there is no need
+    // to check them again if they were found to be up to date in this one.
+    std::string TimestampFile = getInputFilesTimestampFile(F.FileName);
+    llvm::sys::fs::file_status Status;
+    if (PPOpts.BuildSessionTimestamp &&
+        !llvm::sys::fs::status(TimestampFile, Status) &&
+        (uint64_t)Status.getLastModificationTime().toEpochTime() >=
+            PPOpts.BuildSessionTimestamp)
+      continue;
+
+    bool UpToDate = true;
+    for (unsigned I = 0, N = F.NumUserInputFiles; I < N; ++I) {
+      InputFile IF = getInputFile(F, I+1, /*Complain=*/true);
+      if (!IF.getFile() || IF.isOutOfDate())
+        UpToDate = false;
+    }
+
+    if (UpToDate && PPOpts.BuildSessionTimestamp) {
+      // Failing to record the check only means that it is done again.
+      std::string ErrorInfo;
+      llvm::raw_fd_ostream OS(TimestampFile.c_str(), ErrorInfo);
+      if (ErrorInfo.empty())
+        OS << "Timestamp file\n";
+    }
+  }
+}
+
 void ASTReader::finalizeForWriting() {
   for (HiddenNamesMapType::iterator Hidden = HiddenNamesMap.begin(),
                                  HiddenEnd = HiddenNamesMap.end();
@@ -3374,6 +3480,196 @@ static bool SkipCursorToBlock(BitstreamCursor &Cursor, unsigned BlockID) {
   }
 }
 
+namespace {
+  /// \brief A module file read ahead of time by
+  /// ASTReader::prefetchImportedModuleFiles().
+  struct ModuleFilePrefetch {
+    const FileEntry *File;
+
+    /// \brief The path to open, with the working directory applied.
+    std::string Path;
+
+    /// \brief If non-null, the cache through which the file manager reads
+    /// files.  The file is read, and its input files are looked up, through
+    /// this cache as well.
+    SharedFileSystemCache *SharedCache;
+
+    /// \brief The contents of the file, if it could be read and looks like
+    /// an AST file.
+    llvm::MemoryBuffer *Buffer;
+
+    /// \brief The IMPORTS record of the file.
+    ASTReader::RecordData Imports;
+  };
+}
+
+/// \brief Look up the input files of an AST file in \p SharedCache, starting
+/// with \p Cursor at the beginning of its input files block.
+static bool warmInputFileStats(BitstreamCursor &Cursor,
+                               SharedFileSystemCache &SharedCache) {
+  ASTReader::RecordData Record;
+  while (1) {
+    llvm::BitstreamEntry Entry = Cursor.advance();
+    switch (Entry.Kind) {
+    case llvm::BitstreamEntry::Error:
+      return true;
+    case llvm::BitstreamEntry::EndBlock:
+      return false;
+    case llvm::BitstreamEntry::SubBlock:
+      if (Cursor.SkipBlock())
+        return true;
+      continue;
+    case llvm::BitstreamEntry::Record:
+      break;
+    }
+
+    // The cache only knows about absolute paths; the others are resolved
+    // when the input files are validated.
+    Record.clear();
+    StringRef Blob;
+    if (Cursor.readRecord(Entry.ID, Record, &Blob) == INPUT_FILE &&
+        llvm::sys::path::is_absolute(Blob)) {
+      FileData Data;
+      SharedCache.getStat(Blob.str().c_str(), Data, /*isFile=*/true);
+    }
+  }
+}
+
+/// \brief Read a module file and scan its control block for imports.  This
+/// runs on a worker thread, so it must not touch any compiler state.
+static void prefetchModuleFile(void *UserData, unsigned Index) {
+  ModuleFilePrefetch &Prefetch
+    = (*static_cast<std::vector<ModuleFilePrefetch> *>(UserData))[Index];
+
+  OwningPtr<llvm::MemoryBuffer> Buffer;
+  if (Prefetch.SharedCache)
+    Buffer.reset(Prefetch.SharedCache->getBufferForFile(
+        Prefetch.Path.c_str(), Prefetch.File->getUniqueID(),
+        Prefetch.File->getSize(),
+        Prefetch.File->getModificationTime(), /*ErrorStr=*/0));
+  else
+    llvm::MemoryBuffer::getFile(Prefetch.Path, Buffer,
+                                Prefetch.File->getSize());
+  if (!Buffer)
+    return;
+
+  llvm::BitstreamReader StreamFile;
+  BitstreamCursor Stream;
+  StreamFile.init((const unsigned char *)Buffer->getBufferStart(),
+                  (const unsigned char *)Buffer->getBufferEnd());
+  Stream.init(StreamFile);
+
+  // Leave anything that does not look like an AST file to the serial
+  // loading code, which diagnoses it.
+  if (Stream.Read(8) != 'C' ||
+      Stream.Read(8) != 'P' ||
+      Stream.Read(8) != 'C' ||
+      Stream.Read(8) != 'H')
+    return;
+  if (SkipCursorToBlock(Stream, CONTROL_BLOCK_ID))
+    return;
+
+  ASTReader::RecordData Record;
+  while (1) {
+    llvm::BitstreamEntry Entry = Stream.advance();
+    switch (Entry.Kind) {
+    case llvm::BitstreamEntry::Error:
+      return;
+    case llvm::BitstreamEntry::EndBlock:
+      Prefetch.Buffer = Buffer.take();
+      return;
+    case llvm::BitstreamEntry::SubBlock:
+      if (Entry.ID == INPUT_FILES_BLOCK_ID && Prefetch.SharedCache) {
+        if (Stream.EnterSubBlock(INPUT_FILES_BLOCK_ID) ||
+            warmInputFileStats(Stream, *Prefetch.SharedCache))
+          return;
+      } else if (Stream.SkipBlock()) {
+        return;
+      }
+      continue;
+    case llvm::BitstreamEntry::Record:
+      break;
+    }
+
+    Record.clear();
+    if (Stream.readRecord(Entry.ID, Record) == IMPORTS)
+      Prefetch.Imports = Record;
+  }
+}
+
+/// \brief Add the files in an IMPORTS record that are not loaded yet to
+/// \p Prefetches.
+static void
+addModuleFilePrefetches(const ASTReader::RecordData &Imports,
+                        FileManager &FileMgr, ModuleManager &ModuleMgr,
+                        llvm::SmallPtrSet<const FileEntry *, 16> &Seen,
+                        std::vector<ModuleFilePrefetch> &Prefetches) {
+  unsigned Idx = 0, N = Imports.size();
+  while (Idx + 5 <= N) {
+    Idx += 2; // Kind, import location.
+    off_t StoredSize = (off_t)Imports[Idx++];
+    time_t StoredModTime = (time_t)Imports[Idx++];
+    unsigned Length = Imports[Idx++];
+    if (Idx + Length > N)
+      return;
+    SmallString<128> ImportedFile(Imports.begin() + Idx,
+                                  Imports.begin() + Idx + Length);
+    Idx += Length;
+
+    // Files that are missing or out of date are diagnosed when they are
+    // loaded.
+    const FileEntry *File = FileMgr.getFile(ImportedFile, /*openFile=*/false,
+                                            /*cacheFailure=*/false);
+    if (!File ||
+        (StoredSize && StoredSize != File->getSize()) ||
+        (StoredModTime && StoredModTime != File->getModificationTime()) ||
+        ModuleMgr.isKnownModuleFile(File) || !Seen.insert(File))
+      continue;
+
+    ModuleFilePrefetch Prefetch;
+    Prefetch.File = File;
+    Prefetch.SharedCache = FileMgr.getSharedCache();
+    Prefetch.Buffer = 0;
+    Prefetches.push_back(Prefetch);
+    SmallString<128> Path(File->getName());
+    FileMgr.FixupRelativePath(Path);
+    Prefetches.back().Path = Path.str();
+  }
+}
+
+/// \brief Read the module files named by an IMPORTS record, and the module
+/// files they import in turn, before they are loaded.
+///
+/// Loading a module file only discovers its imports once its control block
+/// has been read, so a deep module graph would otherwise be read one file at
+/// a time.  Here the files are read, their signatures are checked and their
+/// control blocks are scanned on several threads, one level of the graph at a
+/// time.  ModuleManager::addModule() then takes the contents from memory,
+/// and all validation and deserialization still happens in order, on this
+/// thread.
+void ASTReader::prefetchImportedModuleFiles(const RecordData &Imports) {
+  llvm::SmallPtrSet<const FileEntry *, 16> Seen;
+  std::vector<ModuleFilePrefetch> Prefetches;
+  addModuleFilePrefetches(Imports, FileMgr, ModuleMgr, Seen, Prefetches);
+
+  while (!Prefetches.empty()) {
+    runInParallel(Prefetches.size(), /*NumThreads=*/0, prefetchModuleFile,
+                  &Prefetches);
+
+    std::vector<ModuleFilePrefetch> Next;
+    for (unsigned I = 0, N = Prefetches.size(); I != N; ++I) {
+      ModuleFilePrefetch &Prefetch = Prefetches[I];
+      if (!Prefetch.Buffer)
+        continue;
+      ModuleMgr.addPrefetchedBuffer(Prefetch.File, Prefetch.Buffer);
+      ++NumModuleFilesPrefetched;
+      addModuleFilePrefetches(Prefetch.Imports, FileMgr, ModuleMgr, Seen,
+                              Next);
+    }
+    Prefetches.swap(Next);
+  }
+}
+
 /// \brief Retrieve the name of the original source file name
 /// directly from the AST file, without actually loading the AST
 /// file.
@@ -3593,7 +3889,10 @@ bool ASTReader::readASTFileControlBlock(StringRef Filename,
         bool shouldContinue = false;
         switch ((InputFileRecordTypes)Cursor.readRecord(Code, Record, &Blob)) {
         case INPUT_FILE:
-          shouldContinue = Listener.visitInputFile(Blob, isSystemFile);
+          shouldContinue = Listener.visitInputFile(Blob, isSystemFile,
+                                                   (bool)Record[3],
+                                                   (off_t)Record[1],
+                                                   (time_t)Record[2]);
           break;
         }
         if (!shouldContinue)
@@ -3602,6 +3901,25 @@ bool ASTReader::readASTFileControlBlock(StringRef Filename,
       break;
     }
 
+    case IMPORTS: {
+      if (!Listener.needsImportVisitation())
+        break;
+
+      unsigned Idx = 0, N = Record.size();
+      while (Idx < N) {
+        // Skip the kind and the import location.
+        Idx += 2;
+        off_t StoredSize = (off_t)Record[Idx++];
+        time_t StoredModTime = (time_t)Record[Idx++];
+        unsigned Length = Record[Idx++];
+        SmallString<128> ImportedFile(Record.begin() + Idx,
+                                      Record.begin() + Idx + Length);
+        Idx += Length;
+        Listener.visitImport(ImportedFile, StoredSize, StoredModTime);
+      }
+      break;
+    }
+
     default:
       // No other validation to perform.
       break;
@@ -6053,6 +6371,32 @@ void ASTReader::PrintStats() {
                  NumIdentifierLookupHits, NumIdentifierLookups,
                  (double)NumIdentifierLookupHits*100.0/NumIdentifierLookups);
   }
+  if (NumIdentifierLookupsFiltered)
+    std::fprintf(stderr,
+                 "  %u identifier table lookups skipped by Bloom filters\n",
+                 NumIdentifierLookupsFiltered);
+
+  unsigned NumInputFiles = 0;
+  for (ModuleManager::ModuleConstIterator M = ModuleMgr.begin(),
+                                       MEnd = ModuleMgr.end();
+       M != MEnd; ++M)
+    NumInputFiles += (*M)->InputFilesLoaded.size();
+  if (NumInputFiles) {
+    std::fprintf(stderr, "  %u/%u input files validated (%f%%)\n",
+                 NumInputFilesValidated, NumInputFiles,
+                 ((float)NumInputFilesValidated/NumInputFiles * 100));
+    if (NumInputFilesMatchedBySignature)
+      std::fprintf(stderr, "  %u touched input files matched their content "
+                   "signature\n", NumInputFilesMatchedBySignature);
+  }
+
+  if (NumModuleFilesPrefetched) {
+    std::fprintf(stderr, "  %u/%u prefetched module files loaded (%f%%)\n",
+                 ModuleMgr.getNumPrefetchedBuffersUsed(),
+                 NumModuleFilesPrefetched,
+                 ((float)ModuleMgr.getNumPrefetchedBuffersUsed()
+                  / NumModuleFilesPrefetched * 100));
+  }
 
   if (GlobalIndex) {
     std::fprintf(stderr, "\n");
@@ -6172,7 +6516,8 @@ IdentifierInfo* ASTReader::get(const char *NameStart, const char *NameEnd) {
   }
   IdentifierLookupVisitor Visitor(Name, /*PriorGeneration=*/0,
                                   NumIdentifierLookups,
-                                  NumIdentifierLookupHits);
+                                  NumIdentifierLookupHits,
+                                  NumIdentifierLookupsFiltered);
   ModuleMgr.visit(IdentifierLookupVisitor::visit, &Visitor, HitsPtr);
   IdentifierInfo *II = Visitor.getIdentifierInfo();
   markIdentifierUpToDate(II);
@@ -7530,13 +7875,16 @@ ASTReader::ASTReader(Preprocessor &PP, ASTContext &Context,
     NumSLocEntriesRead(0), TotalNumSLocEntries(0), 
     NumStatementsRead(0), TotalNumStatements(0), NumMacrosRead(0),
     TotalNumMacros(0), NumIdentifierLookups(0), NumIdentifierLookupHits(0),
+    NumIdentifierLookupsFiltered(0),
     NumSelectorsRead(0), NumMethodPoolEntriesRead(0),
     NumMethodPoolLookups(0), NumMethodPoolHits(0),
     NumMethodPoolTableLookups(0), NumMethodPoolTableHits(0),
     TotalNumMethodPoolEntries(0),
     NumLexicalDeclContextsRead(0), TotalLexicalDeclContexts(0), 
     NumVisibleDeclContextsRead(0), TotalVisibleDeclContexts(0),
-    TotalModulesSizeInBits(0), NumCurrentElementsDeserializing(0),
+    TotalModulesSizeInBits(0), NumModuleFilesPrefetched(0),
+    NumInputFilesValidated(0), NumInputFilesMatchedBySignature(0),
+    NumCurrentElementsDeserializing(0),
     PassingDeclsToConsumer(false),
     NumCXXBaseSpecifiersLoaded(0), ReadingKind(Read_None)
 {
@@ -25,6 +25,7 @@
 #include "clang/Basic/FileManager.h"
 #include "clang/Basic/FileSystemStatCache.h"
 #include "clang/Basic/OnDiskHashTable.h"
+#include "clang/Basic/Parallel.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Basic/SourceManagerInternals.h"
 #include "clang/Basic/TargetInfo.h"
@@ -849,6 +850,7 @@ void ASTWriter::WriteBlockInfoBlock() {
   RECORD(MACRO_OFFSET);
   RECORD(MACRO_TABLE);
   RECORD(LATE_PARSED_TEMPLATE);
+  RECORD(IDENTIFIER_BLOOM_FILTER);
 
   // SourceManager Block.
   BLOCK(SOURCE_MANAGER_BLOCK);
@@ -1238,7 +1240,9 @@ void ASTWriter::WriteControlBlock(Preprocessor &PP, ASTContext &Context,
   WriteInputFiles(Context.SourceMgr,
                   PP.getHeaderSearchInfo().getHeaderSearchOpts(),
                   isysroot,
-                  PP.getLangOpts().Modules);
+                  PP.getLangOpts().Modules,
+                  PP.getPreprocessorOpts().ValidateASTInputFilesContent,
+                  PP.getPreprocessorOpts().ASTWriteJobs);
   Stream.ExitBlock();
 }
 
@@ -1248,13 +1252,29 @@ namespace  {
     const FileEntry *File;
     bool IsSystemFile;
     bool BufferOverridden;
+    /// \brief The signature of the contents of the file, or zero.
+    uint64_t ContentSignature;
+    /// \brief The contents to compute the signature of, or null.
+    const llvm::MemoryBuffer *Contents;
   };
 }
 
+/// \brief Compute the content signature of an input file; the signatures of
+/// all input files are computed concurrently.
+static void ComputeContentSignature(void *SortedFiles, unsigned Index) {
+  InputFileEntry &Entry
+    = (*static_cast<std::deque<InputFileEntry> *>(SortedFiles))[Index];
+  if (Entry.Contents)
+    Entry.ContentSignature = ComputeInputFileSignature(
+        Entry.Contents->getBuffer());
+}
+
 void ASTWriter::WriteInputFiles(SourceManager &SourceMgr,
                                 HeaderSearchOptions &HSOpts,
                                 StringRef isysroot,
-                                bool Modules) {
+                                bool Modules,
+                                bool ContentSignatures,
+                                unsigned NumJobs) {
   using namespace llvm;
   Stream.EnterSubblock(INPUT_FILES_BLOCK_ID, 4);
   RecordData Record;
@@ -1266,6 +1286,8 @@ void ASTWriter::WriteInputFiles(SourceManager &SourceMgr,
   IFAbbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 12)); // Size
   IFAbbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 32)); // Modification time
   IFAbbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 1)); // Overridden
+  IFAbbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32)); // Signature hi
+  IFAbbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32)); // Signature lo
   IFAbbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Blob)); // File name
   unsigned IFAbbrevCode = Stream.EmitAbbrev(IFAbbrev);
 
@@ -1288,6 +1310,14 @@ void ASTWriter::WriteInputFiles(SourceManager &SourceMgr,
     Entry.File = Cache->OrigEntry;
     Entry.IsSystemFile = Cache->IsSystemFile;
     Entry.BufferOverridden = Cache->BufferOverridden;
+    Entry.ContentSignature = 0;
+    Entry.Contents = 0;
+
+    // Only user files are validated, so only they need a signature.  The
+    // contents have already been read by the time the AST file is written.
+    if (ContentSignatures && !Cache->IsSystemFile &&
+        !Cache->BufferOverridden && Cache->ContentsEntry == Cache->OrigEntry)
+      Entry.Contents = Cache->getRawBuffer();
     if (Cache->IsSystemFile)
       SortedFiles.push_back(Entry);
     else
@@ -1303,7 +1333,7 @@ void ASTWriter::WriteInputFiles(SourceManager &SourceMgr,
     llvm::SmallString<128> SDKSettingsFileName(HSOpts.Sysroot);
     llvm::sys::path::append(SDKSettingsFileName, "SDKSettings.plist");
     if (const FileEntry *SDKSettingsFile = FileMgr.getFile(SDKSettingsFileName)) {
-      InputFileEntry Entry = { SDKSettingsFile, false, false };
+      InputFileEntry Entry = { SDKSettingsFile, false, false, 0, 0 };
       SortedFiles.push_front(Entry);
     }
   }
@@ -1316,11 +1346,16 @@ void ASTWriter::WriteInputFiles(SourceManager &SourceMgr,
     llvm::sys::path::append(P, "include");
     llvm::sys::path::append(P, "module.map");
     if (const FileEntry *ModuleMapFile = FileMgr.getFile(P)) {
-      InputFileEntry Entry = { ModuleMapFile, false, false };
+      InputFileEntry Entry = { ModuleMapFile, false, false, 0, 0 };
       SortedFiles.push_front(Entry);
     }
   }
 
+  // Hashing the contents of large headers is the bulk of the work here.
+  if (ContentSignatures)
+    runInParallel(SortedFiles.size(), NumJobs, ComputeContentSignature,
+                  &SortedFiles);
+
   unsigned UserFilesNum = 0;
   // Write out all of the input files.
   std::vector<uint32_t> InputFileOffsets;
@@ -1351,6 +1386,10 @@ void ASTWriter::WriteInputFiles(SourceManager &SourceMgr,
     // Whether this file was overridden.
     Record.push_back(Entry.BufferOverridden);
 
+    // The signature of its contents.
+    Record.push_back(Entry.ContentSignature >> 32);
+    Record.push_back(Entry.ContentSignature & 0xFFFFFFFF);
+
     // Turn the file name into an absolute path, if it isn't already.
     const char *Filename = Entry.File->getName();
     SmallString<128> FilePath(Filename);
@@ -1624,32 +1663,73 @@ void ASTWriter::WriteHeaderSearch(const HeaderSearch &HS, StringRef isysroot) {
     free(const_cast<char *>(SavedStrings[I]));
 }
 
-/// \brief Writes the block containing the serialized form of the
-/// source manager.
+/// \brief The contents of the source manager block, written into a buffer
+/// of their own so that they can be written concurrently with other blocks.
+struct ASTWriter::SourceManagerBlockContents {
+  /// \brief The buffer the block was written to.
+  SmallVector<char, 256> Buffer;
+
+  /// \brief The bits of the buffer after the header of the block, up to the
+  /// end of its last record.
+  uint64_t BeginBit, EndBit;
+
+  /// \brief The offsets of the source location entries within the buffer.
+  std::vector<uint32_t> SLocEntryOffsets;
+
+  /// \brief The source location entries the AST reader should load eagerly.
+  RecordData PreloadSLocs;
+};
+
+/// \brief Copy the bits [BeginBit, EndBit) of a buffer written by a bitstream
+/// writer to a stream.  Both the buffer and the stream are at a 32-bit
+/// boundary, so the bits come out exactly as they went in.
+static void EmitBits(llvm::BitstreamWriter &Stream, ArrayRef<char> Buffer,
+                     uint64_t BeginBit, uint64_t EndBit) {
+  assert(BeginBit % 32 == 0 && Stream.GetCurrentBitNo() % 32 == 0 &&
+         "Bits are not word aligned");
+  const unsigned char *Bytes = (const unsigned char *)Buffer.data();
+  for (uint64_t Bit = BeginBit; Bit < EndBit; Bit += 32) {
+    const unsigned char *Word = Bytes + Bit / 8;
+    uint32_t Value = Word[0] | (Word[1] << 8) | (Word[2] << 16) |
+                     ((uint32_t)Word[3] << 24);
+    unsigned NumBits = std::min<uint64_t>(EndBit - Bit, 32);
+    if (NumBits < 32)
+      Value &= (1U << NumBits) - 1;
+    Stream.Emit(Value, NumBits);
+  }
+}
+
+/// \brief Writes the source location entries of the source manager block
+/// into a buffer of their own.
+///
+/// This only reads the source manager and the file-level declarations of
+/// each file, so it runs concurrently with the writing of other blocks.
 ///
 /// TODO: We should probably use an on-disk hash table (stored in a
 /// blob), indexed based on the file name, so that we only create
 /// entries for files that we actually need. In the common case (no
 /// errors), we probably won't have to create file entries for any of
 /// the files in the AST.
-void ASTWriter::WriteSourceManagerBlock(SourceManager &SourceMgr,
-                                        const Preprocessor &PP,
-                                        StringRef isysroot) {
+void ASTWriter::WriteSourceManagerContents(
+    SourceManager &SourceMgr, const Preprocessor &PP,
+    SourceManagerBlockContents &Contents) const {
+  llvm::BitstreamWriter BlockStream(Contents.Buffer);
   RecordData Record;
 
-  // Enter the source manager block.
-  Stream.EnterSubblock(SOURCE_MANAGER_BLOCK_ID, 3);
+  // Enter the source manager block.  Its header depends on where the block
+  // ends up in the AST file, so only the bits after it are copied there.
+  BlockStream.EnterSubblock(SOURCE_MANAGER_BLOCK_ID, 3);
+  Contents.BeginBit = BlockStream.GetCurrentBitNo();
 
   // Abbreviations for the various kinds of source-location entries.
-  unsigned SLocFileAbbrv = CreateSLocFileAbbrev(Stream);
-  unsigned SLocBufferAbbrv = CreateSLocBufferAbbrev(Stream);
-  unsigned SLocBufferBlobAbbrv = CreateSLocBufferBlobAbbrev(Stream);
-  unsigned SLocExpansionAbbrv = CreateSLocExpansionAbbrev(Stream);
+  unsigned SLocFileAbbrv = CreateSLocFileAbbrev(BlockStream);
+  unsigned SLocBufferAbbrv = CreateSLocBufferAbbrev(BlockStream);
+  unsigned SLocBufferBlobAbbrv = CreateSLocBufferBlobAbbrev(BlockStream);
+  unsigned SLocExpansionAbbrv = CreateSLocExpansionAbbrev(BlockStream);
 
   // Write out the source location entry table. We skip the first
   // entry, which is always the same dummy entry.
-  std::vector<uint32_t> SLocEntryOffsets;
-  RecordData PreloadSLocs;
+  std::vector<uint32_t> &SLocEntryOffsets = Contents.SLocEntryOffsets;
   SLocEntryOffsets.reserve(SourceMgr.local_sloc_entry_size() - 1);
   for (unsigned I = 1, N = SourceMgr.local_sloc_entry_size();
        I != N; ++I) {
@@ -1659,7 +1739,7 @@ void ASTWriter::WriteSourceManagerBlock(SourceManager &SourceMgr,
     assert(&SourceMgr.getSLocEntry(FID) == SLoc);
 
     // Record the offset of this source-location entry.
-    SLocEntryOffsets.push_back(Stream.GetCurrentBitNo());
+    SLocEntryOffsets.push_back(BlockStream.GetCurrentBitNo());
 
     // Figure out which record code to use.
     unsigned Code;
@@ -1688,12 +1768,13 @@ void ASTWriter::WriteSourceManagerBlock(SourceManager &SourceMgr,
                "Writing to AST an overridden file is not supported");
 
         // The source location entry is a file. Emit input file ID.
-        assert(InputFileIDs[Content->OrigEntry] != 0 && "Missed file entry");
-        Record.push_back(InputFileIDs[Content->OrigEntry]);
+        assert(InputFileIDs.lookup(Content->OrigEntry) != 0 &&
+               "Missed file entry");
+        Record.push_back(InputFileIDs.lookup(Content->OrigEntry));
 
         Record.push_back(File.NumCreatedFIDs);
         
-        FileDeclIDsTy::iterator FDI = FileDeclIDs.find(FID);
+        FileDeclIDsTy::const_iterator FDI = FileDeclIDs.find(FID);
         if (FDI != FileDeclIDs.end()) {
           Record.push_back(FDI->second->FirstDeclIndex);
           Record.push_back(FDI->second->DeclIDs.size());
@@ -1702,16 +1783,16 @@ void ASTWriter::WriteSourceManagerBlock(SourceManager &SourceMgr,
           Record.push_back(0);
         }
         
-        Stream.EmitRecordWithAbbrev(SLocFileAbbrv, Record);
+        BlockStream.EmitRecordWithAbbrev(SLocFileAbbrv, Record);
         
         if (Content->BufferOverridden) {
           Record.clear();
           Record.push_back(SM_SLOC_BUFFER_BLOB);
           const llvm::MemoryBuffer *Buffer
             = Content->getBuffer(PP.getDiagnostics(), PP.getSourceManager());
-          Stream.EmitRecordWithBlob(SLocBufferBlobAbbrv, Record,
-                                    StringRef(Buffer->getBufferStart(),
-                                              Buffer->getBufferSize() + 1));          
+          BlockStream.EmitRecordWithBlob(
+              SLocBufferBlobAbbrv, Record,
+              StringRef(Buffer->getBufferStart(), Buffer->getBufferSize() + 1));
         }
       } else {
         // The source location entry is a buffer. The blob associated
@@ -1723,16 +1804,16 @@ void ASTWriter::WriteSourceManagerBlock(SourceManager &SourceMgr,
         const llvm::MemoryBuffer *Buffer
           = Content->getBuffer(PP.getDiagnostics(), PP.getSourceManager());
         const char *Name = Buffer->getBufferIdentifier();
-        Stream.EmitRecordWithBlob(SLocBufferAbbrv, Record,
-                                  StringRef(Name, strlen(Name) + 1));
+        BlockStream.EmitRecordWithBlob(SLocBufferAbbrv, Record,
+                                       StringRef(Name, strlen(Name) + 1));
         Record.clear();
         Record.push_back(SM_SLOC_BUFFER_BLOB);
-        Stream.EmitRecordWithBlob(SLocBufferBlobAbbrv, Record,
-                                  StringRef(Buffer->getBufferStart(),
-                                                  Buffer->getBufferSize() + 1));
+        BlockStream.EmitRecordWithBlob(SLocBufferBlobAbbrv, Record,
+                                       StringRef(Buffer->getBufferStart(),
+                                                 Buffer->getBufferSize() + 1));
 
         if (strcmp(Name, "<built-in>") == 0) {
-          PreloadSLocs.push_back(SLocEntryOffsets.size());
+          Contents.PreloadSLocs.push_back(SLocEntryOffsets.size());
         }
       }
     } else {
@@ -1748,12 +1829,32 @@ void ASTWriter::WriteSourceManagerBlock(SourceManager &SourceMgr,
       if (I + 1 != N)
         NextOffset = SourceMgr.getLocalSLocEntry(I + 1).getOffset();
       Record.push_back(NextOffset - SLoc->getOffset() - 1);
-      Stream.EmitRecordWithAbbrev(SLocExpansionAbbrv, Record);
+      BlockStream.EmitRecordWithAbbrev(SLocExpansionAbbrv, Record);
     }
   }
 
+  Contents.EndBit = BlockStream.GetCurrentBitNo();
+  BlockStream.ExitBlock();
+}
+
+/// \brief Writes the block containing the serialized form of the
+/// source manager, from the contents written by WriteSourceManagerContents.
+void ASTWriter::WriteSourceManagerBlock(SourceManager &SourceMgr,
+                                        StringRef isysroot,
+                                        SourceManagerBlockContents &Contents) {
+  RecordData Record;
+
+  // Copy the source manager block into the AST file, and move the offsets
+  // of its entries along with it.
+  Stream.EnterSubblock(SOURCE_MANAGER_BLOCK_ID, 3);
+  uint64_t BeginBit = Stream.GetCurrentBitNo();
+  EmitBits(Stream, Contents.Buffer, Contents.BeginBit, Contents.EndBit);
   Stream.ExitBlock();
 
+  std::vector<uint32_t> &SLocEntryOffsets = Contents.SLocEntryOffsets;
+  for (unsigned I = 0, N = SLocEntryOffsets.size(); I != N; ++I)
+    SLocEntryOffsets[I] = SLocEntryOffsets[I] - Contents.BeginBit + BeginBit;
+
   if (SLocEntryOffsets.empty())
     return;
 
@@ -1775,7 +1876,7 @@ void ASTWriter::WriteSourceManagerBlock(SourceManager &SourceMgr,
 
   // Write the source location entry preloads array, telling the AST
   // reader which source locations entries it should load eagerly.
-  Stream.EmitRecord(SOURCE_LOCATION_PRELOADS, PreloadSLocs);
+  Stream.EmitRecord(SOURCE_LOCATION_PRELOADS, Contents.PreloadSLocs);
 
   // Write the line table. It depends on remapping working, so it must come
   // after the source location offsets.
@@ -3197,14 +3298,17 @@ void ASTWriter::WriteIdentifierTable(Preprocessor &PP,
     // Create the on-disk hash table representation. We only store offsets
     // for identifiers that appear here for the first time.
     IdentifierOffsets.resize(NextIdentID - FirstIdentID);
+    SmallVector<StringRef, 64> TableNames;
     for (llvm::DenseMap<const IdentifierInfo *, IdentID>::iterator
            ID = IdentifierIDs.begin(), IDEnd = IdentifierIDs.end();
          ID != IDEnd; ++ID) {
       assert(ID->first && "NULL identifier in identifier table");
       if (!Chain || !ID->first->isFromAST() || 
-          ID->first->hasChangedSinceDeserialization())
+          ID->first->hasChangedSinceDeserialization()) {
         Generator.insert(const_cast<IdentifierInfo *>(ID->first), ID->second,
                          Trait);
+        TableNames.push_back(ID->first->getName());
+      }
     }
 
     // Create the on-disk hash table in a buffer.
@@ -3230,6 +3334,31 @@ void ASTWriter::WriteIdentifierTable(Preprocessor &PP,
     Record.push_back(IDENTIFIER_TABLE);
     Record.push_back(BucketOffset);
     Stream.EmitRecordWithBlob(IDTableAbbrev, Record, IdentifierTable.str());
+
+    // Write the Bloom filter of the identifiers in the table, with which
+    // readers avoid searching the table for identifiers that it lacks.
+    unsigned NumBits = std::max<unsigned>(
+        64, TableNames.size() * IdentifierBloomFilterBitsPerIdentifier);
+    NumBits = (NumBits + 7) & ~7U;
+    SmallString<1024> Filter;
+    Filter.resize(NumBits / 8, 0);
+    for (unsigned I = 0, N = TableNames.size(); I != N; ++I)
+      addToIdentifierBloomFilter(
+          reinterpret_cast<unsigned char *>(Filter.data()), NumBits,
+          IdentifierBloomFilterHashes, IdentifierBloomHashes(TableNames[I]));
+
+    Abbrev = new BitCodeAbbrev();
+    Abbrev->Add(BitCodeAbbrevOp(IDENTIFIER_BLOOM_FILTER));
+    Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // # of hashes
+    Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32)); // # of bits
+    Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Blob));
+    unsigned BloomFilterAbbrev = Stream.EmitAbbrev(Abbrev);
+
+    Record.clear();
+    Record.push_back(IDENTIFIER_BLOOM_FILTER);
+    Record.push_back(IdentifierBloomFilterHashes);
+    Record.push_back(NumBits);
+    Stream.EmitRecordWithBlob(BloomFilterAbbrev, Record, Filter.str());
   }
 
   // Write the offsets table for identifier IDs.
@@ -3837,6 +3966,36 @@ static void AddLazyVectorDecls(ASTWriter &Writer, Vector &Vec,
   }
 }
 
+/// \brief The blocks that are written concurrently once all declarations and
+/// types have been written: the contents of the source manager block, which
+/// go into a buffer of their own, and the blocks that precede it in the AST
+/// file.
+struct ASTWriter::ConcurrentBlocks {
+  ASTWriter &Writer;
+  Preprocessor &PP;
+  StringRef isysroot;
+  bool IsModule;
+  SourceManagerBlockContents SourceManagerBlock;
+
+  ConcurrentBlocks(ASTWriter &Writer, Preprocessor &PP, StringRef isysroot,
+                   bool IsModule)
+    : Writer(Writer), PP(PP), isysroot(isysroot), IsModule(IsModule) { }
+};
+
+void ASTWriter::WriteConcurrentBlock(void *UserData, unsigned Index) {
+  ConcurrentBlocks &Blocks = *static_cast<ConcurrentBlocks *>(UserData);
+  ASTWriter &Writer = Blocks.Writer;
+  if (Index == 0) {
+    Writer.WriteSourceManagerContents(Blocks.PP.getSourceManager(), Blocks.PP,
+                                      Blocks.SourceManagerBlock);
+    return;
+  }
+
+  Writer.WriteComments();
+  Writer.WritePreprocessor(Blocks.PP, Blocks.IsModule);
+  Writer.WriteHeaderSearch(Blocks.PP.getHeaderSearchInfo(), Blocks.isysroot);
+}
+
 void ASTWriter::WriteASTCore(Sema &SemaRef,
                              StringRef isysroot,
                              const std::string &OutputFile, 
@@ -4122,9 +4281,21 @@ void ASTWriter::WriteASTCore(Sema &SemaRef,
   DoneWritingDeclsAndTypes = true;
 
   WriteFileDeclIDsMap();
-  WriteSourceManagerBlock(Context.getSourceManager(), PP, isysroot);
-  WriteComments();
-  
+
+  // The source manager block, which holds an entry for every file and macro
+  // expansion, only depends on the source manager and on the file-level
+  // declarations, so its contents are written into a buffer of their own
+  // while the comments, the preprocessor and the header search tables are
+  // written.  The contents are then copied into the AST file bit for bit, so
+  // the AST file is the same however many threads write it.
+  {
+    ConcurrentBlocks Blocks(*this, PP, isysroot, isModule);
+    runInParallel(2, PP.getPreprocessorOpts().ASTWriteJobs,
+                  WriteConcurrentBlock, &Blocks);
+    WriteSourceManagerBlock(Context.getSourceManager(), isysroot,
+                            Blocks.SourceManagerBlock);
+  }
+
   if (Chain) {
     // Write the mapping information describing our module dependencies and how
     // each of those modules were mapped into our own offset/ID space, so that
@@ -4169,8 +4340,6 @@ void ASTWriter::WriteASTCore(Sema &SemaRef,
     Stream.EmitRecordWithBlob(ModuleOffsetMapAbbrev, Record,
                               Buffer.data(), Buffer.size());
   }
-  WritePreprocessor(PP, isModule);
-  WriteHeaderSearch(PP.getHeaderSearchInfo(), isysroot);
   WriteSelectors(SemaRef);
   WriteReferencedSelectorsPool(SemaRef);
   WriteIdentifierTable(PP, SemaRef.IdResolver, isModule);
@@ -22,12 +22,13 @@ using namespace reader;
 
 ModuleFile::ModuleFile(ModuleKind Kind, unsigned Generation)
   : Kind(Kind), File(0), DirectlyImported(false),
-    Generation(Generation), SizeInBits(0),
+    Generation(Generation), SizeInBits(0), NumUserInputFiles(0),
     LocalNumSLocEntries(0), SLocEntryBaseID(0),
     SLocEntryBaseOffset(0), SLocEntryOffsets(0),
     LocalNumIdentifiers(0),
     IdentifierOffsets(0), BaseIdentifierID(0), IdentifierTableData(0),
-    IdentifierLookupTable(0),
+    IdentifierLookupTable(0), IdentifierBloomFilter(0),
+    IdentifierBloomFilterBits(0), IdentifierBloomFilterHashes(0),
     LocalNumMacros(0), MacroOffsets(0),
     BasePreprocessedEntityID(0),
     PreprocessedEntityOffsets(0), NumPreprocessedEntities(0),
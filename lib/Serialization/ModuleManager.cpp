@@ -87,10 +87,17 @@ ModuleManager::addModule(StringRef FileName, ModuleKind Type,
     ModuleEntry = New;
 
     // Load the contents of the module
+    llvm::DenseMap<const FileEntry *, llvm::MemoryBuffer *>::iterator
+      Prefetched = PrefetchedBuffers.find(Entry);
     if (llvm::MemoryBuffer *Buffer = lookupBuffer(FileName)) {
       // The buffer was already provided for us.
       assert(Buffer && "Passed null buffer");
       New->Buffer.reset(Buffer);
+    } else if (Prefetched != PrefetchedBuffers.end()) {
+      // The file was read ahead of time.
+      New->Buffer.reset(Prefetched->second);
+      PrefetchedBuffers.erase(Prefetched);
+      ++NumPrefetchedBuffersUsed;
     } else {
       // Open the AST file.
       llvm::error_code ec;
@@ -180,6 +187,29 @@ void ModuleManager::addInMemoryBuffer(StringRef FileName,
   InMemoryBuffers[Entry] = Buffer;
 }
 
+bool ModuleManager::isKnownModuleFile(const FileEntry *File) const {
+  if (Modules.count(File) || PrefetchedBuffers.count(File))
+    return true;
+  llvm::DenseMap<const FileEntry *, llvm::MemoryBuffer *>::const_iterator
+    Known = InMemoryBuffers.find(File);
+  return Known != InMemoryBuffers.end() && Known->second;
+}
+
+void ModuleManager::addPrefetchedBuffer(const FileEntry *File,
+                                        llvm::MemoryBuffer *Buffer) {
+  llvm::MemoryBuffer *&Entry = PrefetchedBuffers[File];
+  delete Entry;
+  Entry = Buffer;
+}
+
+void ModuleManager::clearPrefetchedBuffers() {
+  for (llvm::DenseMap<const FileEntry *, llvm::MemoryBuffer *>::iterator
+         I = PrefetchedBuffers.begin(), E = PrefetchedBuffers.end();
+       I != E; ++I)
+    delete I->second;
+  PrefetchedBuffers.clear();
+}
+
 ModuleManager::VisitState *ModuleManager::allocateVisitState() {
   // Fast path: if we have a cached state, use it.
   if (FirstVisitState) {
@@ -223,12 +253,14 @@ void ModuleManager::moduleFileAccepted(ModuleFile *MF) {
 }
 
 ModuleManager::ModuleManager(FileManager &FileMgr)
-  : FileMgr(FileMgr), GlobalIndex(), FirstVisitState(0) { }
+  : FileMgr(FileMgr), NumPrefetchedBuffersUsed(0), GlobalIndex(),
+    FirstVisitState(0) { }
 
 ModuleManager::~ModuleManager() {
   for (unsigned i = 0, e = Chain.size(); i != e; ++i)
     delete Chain[e - i - 1];
   delete FirstVisitState;
+  clearPrefetchedBuffers();
 }
 
 void
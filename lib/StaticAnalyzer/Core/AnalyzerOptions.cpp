@@ -254,6 +254,30 @@ unsigned AnalyzerOptions::getMaxNodesPerTopLevelFunction() {
   return MaxNodesPerTopLevelFunction.getValue();
 }
 
+unsigned AnalyzerOptions::getGraphMemoryBudget() {
+  if (!GraphMemoryBudget.hasValue())
+    GraphMemoryBudget = getOptionAsInteger("graph-memory-budget", 0);
+  return GraphMemoryBudget.getValue();
+}
+
+unsigned AnalyzerOptions::getNumWorkerProcesses() {
+  if (!NumWorkerProcesses.hasValue())
+    NumWorkerProcesses = getOptionAsInteger("worker-processes", 1);
+  return NumWorkerProcesses.getValue();
+}
+
+unsigned AnalyzerOptions::getMinSummarizedFunctionSize() {
+  if (!MinSummarizedFunctionSize.hasValue())
+    MinSummarizedFunctionSize = getOptionAsInteger("summary-min-size", 0);
+  return MinSummarizedFunctionSize.getValue();
+}
+
+unsigned AnalyzerOptions::getMaxSummaryReturnValues() {
+  if (!MaxSummaryReturnValues.hasValue())
+    MaxSummaryReturnValues = getOptionAsInteger("summary-max-return-values", 4);
+  return MaxSummaryReturnValues.getValue();
+}
+
 bool AnalyzerOptions::shouldSynthesizeBodies() {
   return getBooleanOption("faux-bodies", true);
 }
@@ -30,6 +30,8 @@ STATISTIC(NumSteps,
             "The # of steps executed.");
 STATISTIC(NumReachedMaxSteps,
             "The # of times we reached the max number of steps.");
+STATISTIC(NumReachedMaxGraphMemory,
+            "The # of times we reached the exploded graph memory budget.");
 STATISTIC(NumPathsExplored,
             "The # of paths explored by the analyzer.");
 
@@ -199,6 +201,10 @@ bool CoreEngine::ExecuteWorkList(const LocationContext *L, unsigned Steps,
 
   // Check if we have a steps limit
   bool UnlimitedSteps = Steps == 0;
+  // Checking the graph's memory usage is not free, so only do it
+  // periodically.
+  const unsigned MemoryCheckInterval = 1000;
+  unsigned StepsUntilMemoryCheck = MemoryCheckInterval;
 
   while (WList->hasWork()) {
     if (!UnlimitedSteps) {
@@ -209,6 +215,14 @@ bool CoreEngine::ExecuteWorkList(const LocationContext *L, unsigned Steps,
       --Steps;
     }
 
+    if (GraphMemoryBudget && --StepsUntilMemoryCheck == 0) {
+      StepsUntilMemoryCheck = MemoryCheckInterval;
+      if (!checkGraphMemoryBudget()) {
+        NumReachedMaxGraphMemory++;
+        break;
+      }
+    }
+
     NumSteps++;
 
     const WorkListUnit& WU = WList->dequeue();
@@ -225,6 +239,16 @@ bool CoreEngine::ExecuteWorkList(const LocationContext *L, unsigned Steps,
   return WList->hasWork();
 }
 
+bool CoreEngine::checkGraphMemoryBudget() {
+  uint64_t Usage = G->getMemoryUsage();
+  if (Usage > GraphMemoryBudget)
+    return false;
+  // Past half of the budget, trade some diagnostic precision for memory.
+  if (Usage > GraphMemoryBudget / 2)
+    G->enableAggressiveReclamation();
+  return true;
+}
+
 void CoreEngine::dispatchWorkItem(ExplodedNode* Pred, ProgramPoint Loc,
                                   const WorkListUnit& WU) {
   // Dispatch on the location type.
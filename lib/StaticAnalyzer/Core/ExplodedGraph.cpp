@@ -48,7 +48,8 @@ void ExplodedNode::SetAuditor(ExplodedNode::Auditor* A) {
 //===----------------------------------------------------------------------===//
 
 ExplodedGraph::ExplodedGraph()
-  : NumNodes(0), ReclaimNodeInterval(0) {}
+  : NumNodes(0), ReclaimNodeInterval(0), AggressiveReclamation(false),
+    PeakNumNodes(0), NumReclaimedNodes(0) {}
 
 ExplodedGraph::~ExplodedGraph() {}
 
@@ -93,6 +94,9 @@ bool ExplodedGraph::shouldCollect(const ExplodedNode *node) {
   // (10) The successor is not a CallExpr StmtPoint (so that we would
   //      be able to find it when retrying a call with no inlining).
   // FIXME: It may be safe to reclaim PreCall and PostCall nodes as well.
+  //
+  // Conditions 8 and 9 only serve to make path diagnostics more precise, so
+  // they are dropped when reclaiming aggressively.
 
   // Conditions 1 and 2.
   if (node->pred_size() != 1 || node->succ_size() != 1)
@@ -133,19 +137,21 @@ bool ExplodedGraph::shouldCollect(const ExplodedNode *node) {
   if (!Ex)
     return false;
 
-  // Condition 8.
-  // Do not collect nodes for "interesting" lvalue expressions since they are
-  // used extensively for generating path diagnostics.
-  if (isInterestingLValueExpr(Ex))
-    return false;
+  if (!AggressiveReclamation) {
+    // Condition 8.
+    // Do not collect nodes for "interesting" lvalue expressions since they
+    // are used extensively for generating path diagnostics.
+    if (isInterestingLValueExpr(Ex))
+      return false;
 
-  // Condition 9.
-  // Do not collect nodes for non-consumed Stmt or Expr to ensure precise
-  // diagnostic generation; specifically, so that we could anchor arrows
-  // pointing to the beginning of statements (as written in code).
-  ParentMap &PM = progPoint.getLocationContext()->getParentMap();
-  if (!PM.isConsumedExpr(Ex))
-    return false;
+    // Condition 9.
+    // Do not collect nodes for non-consumed Stmt or Expr to ensure precise
+    // diagnostic generation; specifically, so that we could anchor arrows
+    // pointing to the beginning of statements (as written in code).
+    ParentMap &PM = progPoint.getLocationContext()->getParentMap();
+    if (!PM.isConsumedExpr(Ex))
+      return false;
+  }
 
   // Condition 10.
   const ProgramPoint SuccLoc = succ->getLocation();
@@ -169,6 +175,7 @@ void ExplodedGraph::collectNode(ExplodedNode *node) {
   FreeNodes.push_back(node);
   Nodes.RemoveNode(node);
   --NumNodes;
+  ++NumReclaimedNodes;
   node->~ExplodedNode();  
 }
 
@@ -322,6 +329,8 @@ ExplodedNode *ExplodedGraph::getNode(const ProgramPoint &L,
     // Insert the node into the node set and return it.
     Nodes.InsertNode(V, InsertPos);
     ++NumNodes;
+    if (NumNodes > PeakNumNodes)
+      PeakNumNodes = NumNodes;
 
     if (IsNew) *IsNew = true;
   }
@@ -50,6 +50,14 @@ STATISTIC(NumMaxBlockCountReachedInInlined,
             "an inlined function");
 STATISTIC(NumTimesRetriedWithoutInlining,
             "The # of times we re-evaluated a call without inlining");
+STATISTIC(MaxNodesInGraph,
+            "The maximum # of nodes in an exploded graph");
+STATISTIC(MaxProgramStates,
+            "The maximum # of program states alive during an analysis");
+STATISTIC(MaxGraphMemoryKB,
+            "The maximum memory allocated for an exploded graph, in KB");
+STATISTIC(NumReclaimedNodes,
+            "The # of exploded graph nodes reclaimed");
 
 //===----------------------------------------------------------------------===//
 // Engine construction and deletion.
@@ -79,6 +87,8 @@ ExprEngine::ExprEngine(AnalysisManager &mgr, bool gcEnabled,
     // Enable eager node reclaimation when constructing the ExplodedGraph.
     G.enableNodeReclamation(TrimInterval);
   }
+  Engine.setGraphMemoryBudget(
+      uint64_t(mgr.options.getGraphMemoryBudget()) << 20);
 }
 
 ExprEngine::~ExprEngine() {
@@ -271,6 +281,18 @@ void ExprEngine::printState(raw_ostream &Out, ProgramStateRef State,
 
 void ExprEngine::processEndWorklist(bool hasWorkRemaining) {
   getCheckerManager().runCheckersForEndAnalysis(G, BR, *this);
+
+  // Record the high-water marks of this analysis for -analyzer-stats.
+  unsigned PeakNodes = G.getPeakNumNodes();
+  if (PeakNodes > MaxNodesInGraph)
+    MaxNodesInGraph = PeakNodes;
+  unsigned PeakStates = StateMgr.getPeakNumStates();
+  if (PeakStates > MaxProgramStates)
+    MaxProgramStates = PeakStates;
+  unsigned GraphMemoryKB = G.getMemoryUsage() >> 10;
+  if (GraphMemoryKB > MaxGraphMemoryKB)
+    MaxGraphMemoryKB = GraphMemoryKB;
+  NumReclaimedNodes += G.getNumReclaimedNodes();
 }
 
 void ExprEngine::processCFGElement(const CFGElement E, ExplodedNode *Pred,
@@ -37,6 +37,9 @@ STATISTIC(NumInlinedCalls,
 STATISTIC(NumReachedInlineCountMax,
   "The # of times we reached inline count maximum");
 
+STATISTIC(NumSummarizedCalls,
+  "The # of times we evaluated a call from a function summary");
+
 void ExprEngine::processCallEnter(CallEnter CE, ExplodedNode *Pred) {
   // Get the entry block in the CFG of the callee.
   const StackFrameContext *calleeCtx = CE.getCalleeContext();
@@ -467,6 +470,54 @@ bool ExprEngine::inlineCall(const CallEvent &Call, const Decl *D,
   return true;
 }
 
+bool ExprEngine::evalCallFromSummary(const CallEvent &Call, const Decl *D,
+                                     NodeBuilder &Bldr, ExplodedNode *Pred,
+                                     ProgramStateRef State) {
+  AnalyzerOptions &Opts = AMgr.options;
+  unsigned MinSize = Opts.getMinSummarizedFunctionSize();
+  if (!MinSize || !D || !AMgr.shouldInlineCall())
+    return false;
+
+  const FunctionDecl *FD = dyn_cast<FunctionDecl>(D);
+  if (!FD)
+    return false;
+
+  // Small functions are cheap to inline, and inlining them is more precise.
+  AnalysisDeclContext *CalleeADC = AMgr.getAnalysisDeclContext(D);
+  if (CalleeADC->isBodyAutosynthesized())
+    return false;
+  const CFG *CalleeCFG = CalleeADC->getCFG();
+  if (!CalleeCFG || CalleeCFG->getNumBlockIDs() < MinSize)
+    return false;
+
+  FunctionSummariesTy &Summaries = *Engine.FunctionSummaries;
+  if (!Summaries.hasNoSideEffects(FD))
+    return false;
+
+  // The callee cannot touch any of the caller's bindings, so there is
+  // nothing to invalidate; only the return value needs to be modeled.
+  const Expr *E = Call.getOriginExpr();
+  const LocationContext *LCtx = Pred->getLocationContext();
+  SmallVector<llvm::APSInt, 4> Values;
+  if (E && Summaries.getConstantReturnValues(FD, *CalleeCFG,
+                                             Opts.getMaxSummaryReturnValues(),
+                                             Values)) {
+    QualType ResultTy = Call.getResultType();
+    for (unsigned I = 0, N = Values.size(); I != N; ++I) {
+      SVal V = svalBuilder.makeIntVal(getBasicVals().Convert(ResultTy,
+                                                             Values[I]));
+      Bldr.generateNode(Call.getProgramPoint(),
+                        State->BindExpr(E, LCtx, V), Pred);
+    }
+  } else {
+    Bldr.generateNode(Call.getProgramPoint(),
+                      bindReturnValue(Call, LCtx, State), Pred);
+  }
+
+  NumSummarizedCalls++;
+  return true;
+}
+
 static ProgramStateRef getInlineFailedState(ProgramStateRef State,
                                             const Stmt *CallE) {
   const void *ReplayState = State->get<ReplayWithoutInlining>();
@@ -921,6 +972,10 @@ void ExprEngine::defaultEvalCall(NodeBuilder &Bldr, ExplodedNode *Pred,
   } else {
     RuntimeDefinition RD = Call->getRuntimeDefinition();
     const Decl *D = RD.getDecl();
+    if (!RD.mayHaveOtherDefinitions() &&
+        evalCallFromSummary(*Call, D, Bldr, Pred, State))
+      return;
+
     if (shouldInlineCall(*Call, D, Pred)) {
       if (RD.mayHaveOtherDefinitions()) {
         AnalyzerOptions &Options = getAnalysisManager().options;
@@ -12,6 +12,9 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/StaticAnalyzer/Core/PathSensitive/FunctionSummary.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/Analysis/CFG.h"
 using namespace clang;
 using namespace ento;
 
@@ -30,3 +33,166 @@ unsigned FunctionSummariesTy::getTotalNumVisitedBasicBlocks() {
   }
   return Total;
 }
+
+/// Returns true if \p E names a variable that lives in the current stack
+/// frame, so that writing to it is invisible to the caller.
+static bool isLocalVariable(const Expr *E) {
+  const DeclRefExpr *DRE = dyn_cast<DeclRefExpr>(E->IgnoreParens());
+  if (!DRE)
+    return false;
+  const VarDecl *VD = dyn_cast<VarDecl>(DRE->getDecl());
+  return VD && VD->hasLocalStorage() && !VD->getType()->isReferenceType();
+}
+
+bool FunctionSummariesTy::mayHaveSideEffects(const Stmt *S) {
+  if (!S)
+    return false;
+
+  switch (S->getStmtClass()) {
+  default:
+    break;
+  case Stmt::GCCAsmStmtClass:
+  case Stmt::MSAsmStmtClass:
+  case Stmt::AtomicExprClass:
+  case Stmt::VAArgExprClass:
+  case Stmt::BlockExprClass:
+  case Stmt::LambdaExprClass:
+  case Stmt::CXXNewExprClass:
+  case Stmt::CXXDeleteExprClass:
+  case Stmt::CXXThrowExprClass:
+  case Stmt::CXXBindTemporaryExprClass:
+  case Stmt::CXXDefaultArgExprClass:
+  case Stmt::CXXDefaultInitExprClass:
+  case Stmt::PseudoObjectExprClass:
+  case Stmt::ObjCMessageExprClass:
+  case Stmt::ObjCAtThrowStmtClass:
+  case Stmt::ObjCAtSynchronizedStmtClass:
+  case Stmt::ObjCAutoreleasePoolStmtClass:
+    return true;
+  }
+
+  if (const BinaryOperator *BO = dyn_cast<BinaryOperator>(S)) {
+    if (BO->isAssignmentOp() && !isLocalVariable(BO->getLHS()))
+      return true;
+  } else if (const UnaryOperator *UO = dyn_cast<UnaryOperator>(S)) {
+    if (UO->isIncrementDecrementOp() && !isLocalVariable(UO->getSubExpr()))
+      return true;
+  } else if (const CallExpr *CE = dyn_cast<CallExpr>(S)) {
+    const FunctionDecl *Callee = CE->getDirectCallee();
+    if (!Callee)
+      return true;
+    if (const CXXMethodDecl *MD = dyn_cast<CXXMethodDecl>(Callee))
+      if (MD->isVirtual())
+        return true;
+    if (!hasNoSideEffects(Callee))
+      return true;
+  } else if (const CXXConstructExpr *CE = dyn_cast<CXXConstructExpr>(S)) {
+    if (!CE->getConstructor()->isTrivial())
+      return true;
+  } else if (const DeclStmt *DS = dyn_cast<DeclStmt>(S)) {
+    // Destructors of local variables run implicitly, so they do not show up
+    // as calls in the body.
+    for (DeclStmt::const_decl_iterator I = DS->decl_begin(),
+                                       E = DS->decl_end(); I != E; ++I)
+      if (const VarDecl *VD = dyn_cast<VarDecl>(*I))
+        if (VD->getType().isDestructedType())
+          return true;
+  }
+
+  for (Stmt::const_child_iterator I = S->child_begin(), E = S->child_end();
+       I != E; ++I)
+    if (mayHaveSideEffects(*I))
+      return true;
+  return false;
+}
+
+bool FunctionSummariesTy::hasNoSideEffects(const FunctionDecl *FD) {
+  const FunctionDecl *Def = 0;
+  if (!FD->hasBody(Def))
+    return false;
+
+  MapTy::iterator I = findOrInsertSummary(Def);
+  if (I->second.EffectsChecked)
+    return I->second.HasNoSideEffects;
+
+  // Recursive calls see the function as having side effects while its body
+  // is being scanned.
+  I->second.EffectsChecked = 1;
+  I->second.HasNoSideEffects = 0;
+
+  // Constructors and destructors initialize or tear down their object
+  // outside of the body as well.
+  bool Result = !isa<CXXConstructorDecl>(Def) &&
+                !isa<CXXDestructorDecl>(Def) &&
+                !Def->isVariadic() &&
+                !Def->isNoReturn() &&
+                !mayHaveSideEffects(Def->getBody());
+
+  // Scanning the body may have added entries to the map.
+  findOrInsertSummary(Def)->second.HasNoSideEffects = Result;
+  return Result;
+}
+
+/// Collects the constants returned by \p FD into \p Values. Returns false
+/// if some path may return something else, or if there are more than
+/// \p MaxValues distinct constants.
+static bool collectConstantReturnValues(const FunctionDecl *FD,
+                                        const CFG &Cfg, unsigned MaxValues,
+                                        SmallVectorImpl<llvm::APSInt> &Values) {
+  if (!FD->getResultType()->isIntegralOrEnumerationType())
+    return false;
+
+  const ASTContext &Ctx = FD->getASTContext();
+  const CFGBlock &Exit = Cfg.getExit();
+  for (CFGBlock::const_pred_iterator I = Exit.pred_begin(),
+                                     E = Exit.pred_end(); I != E; ++I) {
+    const CFGBlock *Pred = *I;
+    if (!Pred)
+      continue;
+
+    // A block that does not end in a return statement falls off the end of
+    // the function.
+    if (Pred->empty())
+      return false;
+    Optional<CFGStmt> Last = Pred->back().getAs<CFGStmt>();
+    if (!Last)
+      return false;
+    const ReturnStmt *RS = dyn_cast<ReturnStmt>(Last->getStmt());
+    if (!RS || !RS->getRetValue())
+      return false;
+
+    llvm::APSInt Value;
+    if (!RS->getRetValue()->EvaluateAsInt(Value, Ctx))
+      return false;
+
+    bool Seen = false;
+    for (unsigned J = 0, N = Values.size(); J != N && !Seen; ++J)
+      Seen = Values[J] == Value;
+    if (Seen)
+      continue;
+    if (Values.size() == MaxValues)
+      return false;
+    Values.push_back(Value);
+  }
+
+  return !Values.empty();
+}
+
+bool FunctionSummariesTy::getConstantReturnValues(
+    const FunctionDecl *FD, const CFG &Cfg, unsigned MaxValues,
+    SmallVectorImpl<llvm::APSInt> &Values) {
+  MapTy::iterator I = findOrInsertSummary(FD);
+  FunctionSummary &Summary = I->second;
+  if (!Summary.ReturnValuesChecked) {
+    Summary.ReturnValuesChecked = 1;
+    Summary.ReturnValuesKnown =
+        collectConstantReturnValues(FD, Cfg, MaxValues, Summary.ReturnValues);
+    if (!Summary.ReturnValuesKnown)
+      Summary.ReturnValues.clear();
+  }
+
+  if (!Summary.ReturnValuesKnown)
+    return false;
+  Values.append(Summary.ReturnValues.begin(), Summary.ReturnValues.end());
+  return true;
+}
@@ -23,6 +23,7 @@
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/raw_ostream.h"
+#include <cstring>
 
 using namespace clang;
 using namespace ento;
@@ -1105,6 +1106,309 @@ void PathDiagnostic::FullProfile(llvm::FoldingSetNodeID &ID) const {
     ID.AddString(*I);
 }
 
+//===----------------------------------------------------------------------===//
+// Serialization.
+//===----------------------------------------------------------------------===//
+
+static void writeInt(raw_ostream &OS, uint64_t V) {
+  OS.write(reinterpret_cast<const char *>(&V), sizeof(V));
+}
+
+static void writePointer(raw_ostream &OS, const void *P) {
+  writeInt(OS, reinterpret_cast<uintptr_t>(P));
+}
+
+static void writeString(raw_ostream &OS, StringRef S) {
+  writeInt(OS, S.size());
+  OS << S;
+}
+
+static bool readInt(StringRef &Data, uint64_t &V) {
+  if (Data.size() < sizeof(V))
+    return false;
+  memcpy(&V, Data.data(), sizeof(V));
+  Data = Data.substr(sizeof(V));
+  return true;
+}
+
+template <typename T>
+static bool readPointer(StringRef &Data, const T *&P) {
+  uint64_t V;
+  if (!readInt(Data, V))
+    return false;
+  P = reinterpret_cast<const T *>(static_cast<uintptr_t>(V));
+  return true;
+}
+
+static bool readString(StringRef &Data, StringRef &S) {
+  uint64_t Size;
+  if (!readInt(Data, Size) || Data.size() < Size)
+    return false;
+  S = Data.substr(0, Size);
+  Data = Data.substr(Size);
+  return true;
+}
+
+void PathDiagnostic::serializeLocation(raw_ostream &OS,
+                                       const PathDiagnosticLocation &L) {
+  writeInt(OS, L.isValid());
+  if (!L.isValid())
+    return;
+  // Write the location as flatten() would leave it.
+  bool HasRange = L.K == PathDiagnosticLocation::RangeK ||
+                  L.K == PathDiagnosticLocation::StmtK;
+  writeInt(OS, HasRange ? PathDiagnosticLocation::RangeK
+                        : PathDiagnosticLocation::SingleLocK);
+  writeInt(OS, L.Loc.getRawEncoding());
+  writeInt(OS, L.Range.getBegin().getRawEncoding());
+  writeInt(OS, L.Range.getEnd().getRawEncoding());
+  writeInt(OS, L.Range.isPoint);
+}
+
+bool PathDiagnostic::deserializeLocation(StringRef &Data,
+                                         const SourceManager &SM,
+                                         PathDiagnosticLocation &L) {
+  uint64_t Valid;
+  if (!readInt(Data, Valid))
+    return false;
+  L = PathDiagnosticLocation();
+  if (!Valid)
+    return true;
+
+  uint64_t K, Loc, Begin, End, IsPoint;
+  if (!readInt(Data, K) || !readInt(Data, Loc) || !readInt(Data, Begin) ||
+      !readInt(Data, End) || !readInt(Data, IsPoint))
+    return false;
+  if (K != PathDiagnosticLocation::RangeK &&
+      K != PathDiagnosticLocation::SingleLocK)
+    return false;
+
+  L.K = static_cast<PathDiagnosticLocation::Kind>(K);
+  L.SM = &SM;
+  L.Loc = FullSourceLoc(SourceLocation::getFromRawEncoding(Loc), SM);
+  L.Range = PathDiagnosticRange(
+      SourceRange(SourceLocation::getFromRawEncoding(Begin),
+                  SourceLocation::getFromRawEncoding(End)),
+      IsPoint);
+  return true;
+}
+
+void PathDiagnostic::serializePieces(raw_ostream &OS,
+                                     const PathPieces &Pieces) {
+  writeInt(OS, Pieces.size());
+  for (PathPieces::const_iterator I = Pieces.begin(), E = Pieces.end();
+       I != E; ++I) {
+    const PathDiagnosticPiece *Piece = I->getPtr();
+    assert(Piece->getDisplayHint() == PathDiagnosticPiece::Below &&
+           "Display hints are not serialized");
+    writeInt(OS, Piece->getKind());
+    writeString(OS, Piece->getString());
+    writePointer(OS, Piece->getTag());
+    writeInt(OS, Piece->isLastInMainSourceFile());
+    ArrayRef<SourceRange> Ranges = Piece->getRanges();
+    writeInt(OS, Ranges.size());
+    for (ArrayRef<SourceRange>::iterator RI = Ranges.begin(),
+                                         RE = Ranges.end(); RI != RE; ++RI) {
+      writeInt(OS, RI->getBegin().getRawEncoding());
+      writeInt(OS, RI->getEnd().getRawEncoding());
+    }
+
+    switch (Piece->getKind()) {
+    case PathDiagnosticPiece::Event:
+      serializeLocation(OS, Piece->getLocation());
+      writeInt(OS, cast<PathDiagnosticEventPiece>(Piece)->isPrunable());
+      break;
+    case PathDiagnosticPiece::Macro: {
+      const PathDiagnosticMacroPiece *Macro =
+          cast<PathDiagnosticMacroPiece>(Piece);
+      serializeLocation(OS, Macro->getLocation());
+      serializePieces(OS, Macro->subPieces);
+      break;
+    }
+    case PathDiagnosticPiece::ControlFlow: {
+      const PathDiagnosticControlFlowPiece *CF =
+          cast<PathDiagnosticControlFlowPiece>(Piece);
+      writeInt(OS, CF->end() - CF->begin());
+      for (PathDiagnosticControlFlowPiece::const_iterator PI = CF->begin(),
+                                                          PE = CF->end();
+           PI != PE; ++PI) {
+        serializeLocation(OS, PI->getStart());
+        serializeLocation(OS, PI->getEnd());
+      }
+      break;
+    }
+    case PathDiagnosticPiece::Call: {
+      const PathDiagnosticCallPiece *Call =
+          cast<PathDiagnosticCallPiece>(Piece);
+      writePointer(OS, Call->Caller);
+      writePointer(OS, Call->Callee);
+      writeInt(OS, Call->NoExit);
+      writeString(OS, Call->CallStackMessage);
+      serializeLocation(OS, Call->callEnter);
+      serializeLocation(OS, Call->callEnterWithin);
+      serializeLocation(OS, Call->callReturn);
+      serializePieces(OS, Call->path);
+      break;
+    }
+    }
+  }
+}
+
+bool PathDiagnostic::deserializePieces(StringRef &Data,
+                                       const SourceManager &SM,
+                                       PathPieces &Pieces) {
+  uint64_t NumPieces;
+  if (!readInt(Data, NumPieces))
+    return false;
+
+  for (; NumPieces; --NumPieces) {
+    uint64_t Kind, LastInMainSourceFile, NumRanges;
+    StringRef Str;
+    const char *Tag;
+    if (!readInt(Data, Kind) || !readString(Data, Str) ||
+        !readPointer(Data, Tag) || !readInt(Data, LastInMainSourceFile) ||
+        !readInt(Data, NumRanges))
+      return false;
+    SmallVector<SourceRange, 4> Ranges;
+    for (; NumRanges; --NumRanges) {
+      uint64_t Begin, End;
+      if (!readInt(Data, Begin) || !readInt(Data, End))
+        return false;
+      Ranges.push_back(SourceRange(SourceLocation::getFromRawEncoding(Begin),
+                                   SourceLocation::getFromRawEncoding(End)));
+    }
+
+    IntrusiveRefCntPtr<PathDiagnosticPiece> Piece;
+    switch (Kind) {
+    case PathDiagnosticPiece::Event: {
+      PathDiagnosticLocation Pos;
+      uint64_t Prunable;
+      if (!deserializeLocation(Data, SM, Pos) || !readInt(Data, Prunable) ||
+          !Pos.asLocation().isValid())
+        return false;
+      PathDiagnosticEventPiece *Event =
+          new PathDiagnosticEventPiece(Pos, Str, /*addPosRange=*/false);
+      Piece = Event;
+      Event->setPrunable(Prunable);
+      break;
+    }
+    case PathDiagnosticPiece::Macro: {
+      PathDiagnosticLocation Pos;
+      if (!deserializeLocation(Data, SM, Pos) || !Pos.asLocation().isValid())
+        return false;
+      PathDiagnosticMacroPiece *Macro = new PathDiagnosticMacroPiece(Pos);
+      Piece = Macro;
+      if (!deserializePieces(Data, SM, Macro->subPieces))
+        return false;
+      break;
+    }
+    case PathDiagnosticPiece::ControlFlow: {
+      uint64_t NumPairs;
+      if (!readInt(Data, NumPairs) || !NumPairs)
+        return false;
+      PathDiagnosticControlFlowPiece *CF = 0;
+      for (; NumPairs; --NumPairs) {
+        PathDiagnosticLocation Start, End;
+        if (!deserializeLocation(Data, SM, Start) ||
+            !deserializeLocation(Data, SM, End))
+          return false;
+        if (CF) {
+          CF->push_back(PathDiagnosticLocationPair(Start, End));
+        } else {
+          CF = new PathDiagnosticControlFlowPiece(Start, End, Str);
+          Piece = CF;
+        }
+      }
+      break;
+    }
+    case PathDiagnosticPiece::Call: {
+      const Decl *Caller, *Callee;
+      uint64_t NoExit;
+      StringRef CallStackMessage;
+      PathDiagnosticLocation CallEnter, CallEnterWithin, CallReturn;
+      if (!readPointer(Data, Caller) || !readPointer(Data, Callee) ||
+          !readInt(Data, NoExit) || !readString(Data, CallStackMessage) ||
+          !deserializeLocation(Data, SM, CallEnter) ||
+          !deserializeLocation(Data, SM, CallEnterWithin) ||
+          !deserializeLocation(Data, SM, CallReturn))
+        return false;
+      PathDiagnosticCallPiece *Call =
+          new PathDiagnosticCallPiece(Caller, CallReturn);
+      Piece = Call;
+      Call->Callee = Callee;
+      Call->NoExit = NoExit;
+      Call->CallStackMessage = CallStackMessage;
+      Call->callEnter = CallEnter;
+      Call->callEnterWithin = CallEnterWithin;
+      if (!deserializePieces(Data, SM, Call->path))
+        return false;
+      break;
+    }
+    default:
+      return false;
+    }
+
+    if (Tag)
+      Piece->setTag(Tag);
+    if (LastInMainSourceFile)
+      Piece->setAsLastInMainSourceFile();
+    // A macro piece's constructor already added the range of its location.
+    for (unsigned I = Piece->getRanges().size(), E = Ranges.size(); I < E; ++I)
+      Piece->addRange(Ranges[I]);
+    Pieces.push_back(Piece);
+  }
+  return true;
+}
+
+void PathDiagnostic::serialize(raw_ostream &OS) const {
+  assert(pathStack.empty() && "Serializing a diagnostic under construction");
+  writePointer(OS, DeclWithIssue);
+  writeString(OS, BugType);
+  writeString(OS, VerboseDesc);
+  writeString(OS, ShortDesc);
+  writeString(OS, Category);
+  writeInt(OS, OtherDesc.size());
+  for (meta_iterator I = meta_begin(), E = meta_end(); I != E; ++I)
+    writeString(OS, *I);
+  serializeLocation(OS, Loc);
+  serializeLocation(OS, UniqueingLoc);
+  writePointer(OS, UniqueingDecl);
+  serializePieces(OS, pathImpl);
+}
+
+PathDiagnostic *PathDiagnostic::deserialize(StringRef &Data,
+                                            const SourceManager &SM) {
+  const Decl *IssueDecl, *UniqueDecl;
+  StringRef Type, Verbose, Short, Cat;
+  uint64_t NumMeta;
+  if (!readPointer(Data, IssueDecl) || !readString(Data, Type) ||
+      !readString(Data, Verbose) || !readString(Data, Short) ||
+      !readString(Data, Cat) || !readInt(Data, NumMeta))
+    return 0;
+  SmallVector<StringRef, 4> Meta;
+  for (; NumMeta; --NumMeta) {
+    StringRef S;
+    if (!readString(Data, S))
+      return 0;
+    Meta.push_back(S);
+  }
+  PathDiagnosticLocation L, UniqueLoc;
+  if (!deserializeLocation(Data, SM, L) ||
+      !deserializeLocation(Data, SM, UniqueLoc) ||
+      !readPointer(Data, UniqueDecl))
+    return 0;
+
+  OwningPtr<PathDiagnostic> D(new PathDiagnostic(IssueDecl, Type, Verbose,
+                                                 Short, Cat, UniqueLoc,
+                                                 UniqueDecl));
+  for (unsigned I = 0, E = Meta.size(); I != E; ++I)
+    D->addMeta(Meta[I]);
+  D->Loc = L;
+  if (!deserializePieces(Data, SM, D->pathImpl))
+    return 0;
+  return D.take();
+}
+
 StackHintGenerator::~StackHintGenerator() {}
 
 std::string StackHintGeneratorForSymbol::getMessage(const ExplodedNode *N){
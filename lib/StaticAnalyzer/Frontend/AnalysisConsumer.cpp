@@ -14,16 +14,20 @@
 #define DEBUG_TYPE "AnalysisConsumer"
 
 #include "AnalysisConsumer.h"
+#include "AnalysisResultsCache.h"
 #include "clang/AST/ASTConsumer.h"
 #include "clang/AST/Decl.h"
 #include "clang/AST/DeclCXX.h"
 #include "clang/AST/DeclObjC.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/AST/ExprObjC.h"
 #include "clang/AST/ParentMap.h"
 #include "clang/AST/RecursiveASTVisitor.h"
 #include "clang/Analysis/Analyses/LiveVariables.h"
 #include "clang/Analysis/CFG.h"
 #include "clang/Analysis/CallGraph.h"
 #include "clang/Basic/FileManager.h"
+#include "clang/Basic/Parallel.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/StaticAnalyzer/Checkers/LocalCheckers.h"
@@ -35,18 +39,37 @@
 #include "clang/StaticAnalyzer/Core/PathSensitive/AnalysisManager.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/ExprEngine.h"
 #include "clang/StaticAnalyzer/Frontend/CheckerRegistration.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/EquivalenceClasses.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Config/config.h"
+#include "llvm/Support/Atomic.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <queue>
 
+#ifdef LLVM_ON_UNIX
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 using namespace clang;
 using namespace ento;
 using llvm::SmallPtrSet;
@@ -61,6 +84,9 @@ STATISTIC(NumBlocksInAnalyzedFunctions,
                       "The # of basic blocks in the analyzed functions.");
 STATISTIC(PercentReachableBlocks, "The % of reachable basic blocks.");
 STATISTIC(MaxCFGSize, "The maximum number of basic blocks in a function.");
+STATISTIC(NumFunctionsFromResultsCache,
+                      "The # of functions not analyzed because the results "
+                      "cache showed they have nothing to report.");
 
 //===----------------------------------------------------------------------===//
 // Special PathDiagnosticConsumers.
@@ -149,6 +175,45 @@ public:
     }
   }
 };
+
+/// \brief Stands in for one of the parent process's PathDiagnosticConsumers
+/// in an analyzer worker process. The worker builds the diagnostics that
+/// consumer would get, and passes them on to the parent.
+class WorkerPathDiagConsumer : public PathDiagnosticConsumer {
+  const PathDiagnosticConsumer &Consumer;
+public:
+  explicit WorkerPathDiagConsumer(const PathDiagnosticConsumer &Consumer)
+    : Consumer(Consumer) {}
+  virtual StringRef getName() const { return Consumer.getName(); }
+
+  virtual PathGenerationScheme getGenerationScheme() const {
+    return Consumer.getGenerationScheme();
+  }
+  virtual bool supportsLogicalOpControlFlow() const {
+    return Consumer.supportsLogicalOpControlFlow();
+  }
+  virtual bool supportsCrossFileDiagnostics() const {
+    return Consumer.supportsCrossFileDiagnostics();
+  }
+
+  void FlushDiagnosticsImpl(std::vector<const PathDiagnostic *> &Flushed,
+                            FilesMade *filesMade) {}
+
+  /// \brief Writes the diagnostics handled since the last call to \p OS,
+  /// each preceded by \p Index, and forgets them.
+  void takeDiagnostics(uint32_t Index, raw_ostream &OS) {
+    std::vector<PathDiagnostic *> Taken;
+    for (llvm::FoldingSet<PathDiagnostic>::iterator I = Diags.begin(),
+                                                    E = Diags.end();
+         I != E; ++I) {
+      OS.write(reinterpret_cast<const char *>(&Index), sizeof(Index));
+      I->serialize(OS);
+      Taken.push_back(&*I);
+    }
+    Diags.clear();
+    llvm::DeleteContainerPointers(Taken);
+  }
+};
 } // end anonymous namespace
 
 //===----------------------------------------------------------------------===//
@@ -157,6 +222,24 @@ public:
 
 namespace {
 
+/// \brief What a worker process learned about one top-level function.
+struct WorkerResult {
+  /// \brief Whether the worker finished analyzing the function.
+  bool Valid;
+
+  /// \brief Whether the analysis produced any bug reports.
+  bool HasReports;
+
+  /// \brief The functions to consider analyzed after this one.
+  SmallVector<const Decl *, 8> VisitedCallees;
+
+  /// \brief The diagnostics the analysis produced, serialized, each preceded
+  /// by the index of the PathDiagnosticConsumer it was built for.
+  std::string Reports;
+
+  WorkerResult() : Valid(false), HasReports(false) {}
+};
+
 class AnalysisConsumer : public ASTConsumer,
                          public RecursiveASTVisitor<AnalysisConsumer> {
   enum {
@@ -201,13 +284,25 @@ public:
   /// translation unit.
   FunctionSummariesTy FunctionSummaries;
 
+  /// Whether the path-sensitive analysis of the current function produced
+  /// any bug reports.
+  bool FoundPathReports;
+
+  /// The cache of functions known to have nothing to report, if any.
+  OwningPtr<AnalysisResultsCache> ResultsCache;
+
   AnalysisConsumer(const Preprocessor& pp,
                    const std::string& outdir,
                    AnalyzerOptionsRef opts,
                    ArrayRef<std::string> plugins)
     : RecVisitorMode(0), RecVisitorBR(0),
-      Ctx(0), PP(pp), OutDir(outdir), Opts(opts), Plugins(plugins) {
+      Ctx(0), PP(pp), OutDir(outdir), Opts(opts), Plugins(plugins),
+      FoundPathReports(false) {
     DigestAnalyzerOptions();
+    if (!Opts->ResultsCachePath.empty())
+      ResultsCache.reset(new AnalysisResultsCache(Opts->ResultsCachePath,
+                                                  *Opts, PP.getLangOpts(),
+                                                  Plugins));
     if (Opts->PrintStats) {
       llvm::EnableStatistics();
       TUTotalTimer = new llvm::Timer("Analyzer Total Time");
@@ -257,7 +352,8 @@ public:
   }
 
   void DisplayFunction(const Decl *D, AnalysisMode Mode,
-                       ExprEngine::InliningModes IMode) {
+                       ExprEngine::InliningModes IMode,
+                       bool InWorker = false) {
     if (!Opts->AnalyzerDisplayProgress)
       return;
 
@@ -278,6 +374,8 @@ public:
             llvm::errs() << " Inline_Regular";
             break;
         }
+        if (InWorker)
+          llvm::errs() << ", in worker";
         llvm::errs() << ")";
       }
       else
@@ -330,6 +428,44 @@ public:
   /// use it to define the order in which the functions should be visited.
   void HandleDeclsCallGraph(const unsigned LocalTUDeclsSize);
 
+  /// \brief Analyze \p Roots, split into the independent \p Groups, using up
+  /// to \p NumWorkers forked worker processes, and record what was learned
+  /// in \p Results.
+  ///
+  /// \returns false if no worker process could be started.
+  bool AnalyzeRootsInWorkers(ArrayRef<Decl *> Roots,
+                             ArrayRef<SmallVector<unsigned, 4> > Groups,
+                             const llvm::StringMap<const Decl *> &RootsByName,
+                             unsigned NumWorkers,
+                             std::vector<WorkerResult> &Results);
+
+  /// \brief Hands the diagnostics a worker process produced to the
+  /// PathDiagnosticConsumers they were built for.
+  void EmitWorkerReports(StringRef Reports);
+
+  /// \brief Returns the key of the results cache entry for analyzing \p D
+  /// with \p IMode, or an empty string if it has none.
+  std::string getResultsCacheKey(Decl *D, ExprEngine::InliningModes IMode,
+                                 ArrayRef<Decl *> Roots);
+
+  /// \brief Looks up the result cached under \p Key, and adds the callees it
+  /// lists to \p VisitedCallees. Fails if a callee cannot be identified
+  /// among the roots.
+  bool LookupCachedResult(StringRef Key,
+                          const llvm::StringMap<const Decl *> &RootsByName,
+                          SetOfConstDecls &VisitedCallees);
+
+  /// \brief Records under \p Key that the function analyzed last has nothing
+  /// to report, and inlined \p VisitedCallees.
+  void StoreCachedResult(StringRef Key, const SetOfConstDecls &VisitedCallees);
+
+  /// \brief The body of a worker process: analyze the groups of roots handed
+  /// out through \p NextGroup and write the results to \p FD, then exit.
+  void RunWorkerProcess(ArrayRef<Decl *> Roots,
+                        ArrayRef<SmallVector<unsigned, 4> > Groups,
+                        const llvm::StringMap<const Decl *> &RootsByName,
+                        volatile llvm::sys::cas_flag *NextGroup, int FD);
+
   /// \brief Run analyzes(syntax or path sensitive) on the given function.
   /// \param Mode - determines if we are requesting syntax only or path
   /// sensitive only analysis.
@@ -462,6 +598,200 @@ AnalysisConsumer::getInliningModeForFunction(const Decl *D,
   return ExprEngine::Inline_Regular;
 }
 
+namespace {
+/// \brief Collects what the analysis of a declaration's body may inline, or
+/// otherwise depend on: the functions it refers to, the constructors,
+/// destructors and virtual methods of the objects it creates or destroys,
+/// the blocks it contains and the selectors of the messages it sends.
+class DependencyCollector : public RecursiveASTVisitor<DependencyCollector> {
+  SmallVectorImpl<const Decl *> &Decls;
+  SmallVectorImpl<Selector> &Selectors;
+
+  void addDestructor(QualType T) {
+    if (T.isNull())
+      return;
+    const CXXRecordDecl *RD =
+        T->getBaseElementTypeUnsafe()->getAsCXXRecordDecl();
+    if (RD && RD->hasDefinition())
+      if (const CXXDestructorDecl *Dtor = RD->getDestructor())
+        Decls.push_back(Dtor);
+  }
+
+  void addConstructor(const CXXConstructorDecl *Ctor) {
+    Decls.push_back(Ctor);
+    // Calls on the new object may be devirtualized to its methods.
+    const CXXRecordDecl *RD = Ctor->getParent();
+    if (const CXXDestructorDecl *Dtor = RD->getDestructor())
+      Decls.push_back(Dtor);
+    for (CXXRecordDecl::method_iterator I = RD->method_begin(),
+                                        E = RD->method_end(); I != E; ++I)
+      if (I->isVirtual())
+        Decls.push_back(*I);
+  }
+
+public:
+  DependencyCollector(SmallVectorImpl<const Decl *> &Decls,
+                      SmallVectorImpl<Selector> &Selectors)
+    : Decls(Decls), Selectors(Selectors) {}
+
+  bool shouldVisitImplicitCode() const { return true; }
+  bool shouldWalkTypesOfTypeLocs() const { return false; }
+
+  void collect(const Decl *D) {
+    if (const CXXMethodDecl *MD = dyn_cast<CXXMethodDecl>(D)) {
+      // A call to an overridden method may be dispatched to this one.
+      const CXXMethodDecl *Canon = MD->getCanonicalDecl();
+      Decls.append(Canon->begin_overridden_methods(),
+                   Canon->end_overridden_methods());
+
+      // Destroying an object destroys its bases and fields.
+      if (const CXXDestructorDecl *Dtor = dyn_cast<CXXDestructorDecl>(MD)) {
+        const CXXRecordDecl *RD = Dtor->getParent();
+        for (CXXRecordDecl::base_class_const_iterator I = RD->bases_begin(),
+                                                      E = RD->bases_end();
+             I != E; ++I)
+          addDestructor(I->getType());
+        for (CXXRecordDecl::base_class_const_iterator I = RD->vbases_begin(),
+                                                      E = RD->vbases_end();
+             I != E; ++I)
+          addDestructor(I->getType());
+        for (RecordDecl::field_iterator I = RD->field_begin(),
+                                        E = RD->field_end(); I != E; ++I)
+          addDestructor(I->getType());
+      }
+    }
+    TraverseDecl(const_cast<Decl *>(D));
+  }
+
+  bool VisitDeclRefExpr(DeclRefExpr *E) {
+    if (FunctionDecl *FD = dyn_cast<FunctionDecl>(E->getDecl()))
+      Decls.push_back(FD);
+    return true;
+  }
+
+  bool VisitMemberExpr(MemberExpr *E) {
+    if (FunctionDecl *FD = dyn_cast<FunctionDecl>(E->getMemberDecl()))
+      Decls.push_back(FD);
+    return true;
+  }
+
+  bool VisitBlockExpr(BlockExpr *E) {
+    Decls.push_back(E->getBlockDecl());
+    return true;
+  }
+
+  bool VisitVarDecl(VarDecl *VD) {
+    addDestructor(VD->getType());
+    return true;
+  }
+
+  bool VisitCXXConstructExpr(CXXConstructExpr *E) {
+    addConstructor(E->getConstructor());
+    return true;
+  }
+
+  bool VisitCXXBindTemporaryExpr(CXXBindTemporaryExpr *E) {
+    if (const CXXDestructorDecl *Dtor = E->getTemporary()->getDestructor())
+      Decls.push_back(Dtor);
+    return true;
+  }
+
+  bool VisitCXXNewExpr(CXXNewExpr *E) {
+    if (FunctionDecl *New = E->getOperatorNew())
+      Decls.push_back(New);
+    if (FunctionDecl *Delete = E->getOperatorDelete())
+      Decls.push_back(Delete);
+    return true;
+  }
+
+  bool VisitCXXDeleteExpr(CXXDeleteExpr *E) {
+    if (FunctionDecl *Delete = E->getOperatorDelete())
+      Decls.push_back(Delete);
+    addDestructor(E->getDestroyedType());
+    return true;
+  }
+
+  // Default arguments and initializers are evaluated where they are used.
+  bool VisitCXXDefaultArgExpr(CXXDefaultArgExpr *E) {
+    return TraverseStmt(E->getExpr());
+  }
+
+  bool VisitCXXDefaultInitExpr(CXXDefaultInitExpr *E) {
+    return TraverseStmt(E->getExpr());
+  }
+
+  bool VisitObjCMessageExpr(ObjCMessageExpr *E) {
+    Selectors.push_back(E->getSelector());
+    return true;
+  }
+
+  bool VisitObjCPropertyRefExpr(ObjCPropertyRefExpr *E) {
+    Selectors.push_back(E->getGetterSelector());
+    Selectors.push_back(E->getSetterSelector());
+    return true;
+  }
+};
+} // end anonymous namespace
+
+/// \brief Returns the key under which \p D is grouped with the declarations
+/// whose analyses may depend on it. A message may be dispatched to any
+/// method with its selector, so ObjC methods are grouped by selector.
+static const void *getDependencyKey(const Decl *D) {
+  if (const ObjCMethodDecl *MD = dyn_cast<ObjCMethodDecl>(D))
+    return MD->getSelector().getAsOpaquePtr();
+  return D->getCanonicalDecl();
+}
+
+/// \brief Splits \p Roots into groups that can be analyzed independently:
+/// the analysis of a root never inlines, skips, or uses the function
+/// summaries of, a function the analysis of a root in another group may
+/// reach. Each group lists its roots in order, and the groups are ordered by
+/// their first root.
+static void GroupDependentRoots(ArrayRef<Decl *> Roots,
+                                std::vector<SmallVector<unsigned, 4> > &Groups) {
+  llvm::EquivalenceClasses<const void *> Classes;
+  for (unsigned Idx = 0, NumRoots = Roots.size(); Idx != NumRoots; ++Idx)
+    Classes.insert(getDependencyKey(Roots[Idx]));
+
+  SmallPtrSet<const Decl *, 64> Collected;
+  SmallVector<const Decl *, 64> Worklist(Roots.begin(), Roots.end());
+  while (!Worklist.empty()) {
+    const Decl *D = Worklist.pop_back_val();
+    if (!Collected.insert(D))
+      continue;
+
+    SmallVector<const Decl *, 16> Decls;
+    SmallVector<Selector, 4> Selectors;
+    DependencyCollector Collector(Decls, Selectors);
+    Collector.collect(D);
+
+    const void *Key = getDependencyKey(D);
+    for (unsigned I = 0, E = Decls.size(); I != E; ++I) {
+      Classes.unionSets(Key, getDependencyKey(Decls[I]));
+      // Follow the body the analysis would inline.
+      const FunctionDecl *Definition;
+      if (const FunctionDecl *FD = dyn_cast<FunctionDecl>(Decls[I])) {
+        if (FD->hasBody(Definition))
+          Worklist.push_back(Definition);
+      } else if (isa<BlockDecl>(Decls[I])) {
+        Worklist.push_back(Decls[I]);
+      }
+    }
+    for (unsigned I = 0, E = Selectors.size(); I != E; ++I)
+      Classes.unionSets(Key, Selectors[I].getAsOpaquePtr());
+  }
+
+  llvm::DenseMap<const void *, unsigned> GroupOfLeader;
+  for (unsigned Idx = 0, NumRoots = Roots.size(); Idx != NumRoots; ++Idx) {
+    const void *Leader = Classes.getLeaderValue(getDependencyKey(Roots[Idx]));
+    std::pair<llvm::DenseMap<const void *, unsigned>::iterator, bool> Entry =
+        GroupOfLeader.insert(std::make_pair(Leader, (unsigned)Groups.size()));
+    if (Entry.second)
+      Groups.resize(Groups.size() + 1);
+    Groups[Entry.first->second].push_back(Idx);
+  }
+}
+
 void AnalysisConsumer::HandleDeclsCallGraph(const unsigned LocalTUDeclsSize) {
   // Build the Call Graph by adding all the top level declarations to the graph.
   // Note: CallGraph can trigger deserialization of more items from a pch
@@ -478,19 +808,57 @@ void AnalysisConsumer::HandleDeclsCallGraph(const unsigned LocalTUDeclsSize) {
   // inlined functions. The topological order allows the "do not reanalyze
   // previously inlined function" performance heuristic to be triggered more
   // often.
-  SetOfConstDecls Visited;
-  SetOfConstDecls VisitedAsTopLevel;
+  SmallVector<Decl *, 64> Roots;
   llvm::ReversePostOrderTraversal<clang::CallGraph*> RPOT(&CG);
   for (llvm::ReversePostOrderTraversal<clang::CallGraph*>::rpo_iterator
          I = RPOT.begin(), E = RPOT.end(); I != E; ++I) {
     NumFunctionTopLevel++;
 
-    CallGraphNode *N = *I;
-    Decl *D = N->getDecl();
-    
     // Skip the abstract root node.
-    if (!D)
-      continue;
+    if (Decl *D = (*I)->getDecl())
+      Roots.push_back(D);
+  }
+
+  // The results cache names the callees of a function, so that they can be
+  // found again in a later compilation. A name shared by several roots is
+  // useless for that.
+  llvm::StringMap<const Decl *> RootsByName;
+  if (ResultsCache) {
+    for (unsigned Idx = 0, NumRoots = Roots.size(); Idx != NumRoots; ++Idx) {
+      llvm::StringMapEntry<const Decl *> &Entry =
+          RootsByName.GetOrCreateValue(
+              AnalysisResultsCache::getStableName(Roots[Idx]), Roots[Idx]);
+      if (Entry.getValue() != Roots[Idx])
+        Entry.setValue(0);
+    }
+  }
+
+  // With worker processes, the roots are first split into groups that do
+  // not affect each other's analysis. The workers walk each group as the
+  // walk below would, and send back the reports and inlined callees of each
+  // root they analyze. The walk below then uses those instead of analyzing
+  // the roots again, so the result is the same as without workers.
+  //
+  // Reports and results refer to Decls by address, so the workers must not
+  // deserialize any.
+  unsigned NumWorkers = Mgr->options.getNumWorkerProcesses();
+  if (NumWorkers == 0)
+    NumWorkers = getHardwareConcurrency();
+  std::vector<WorkerResult> Results;
+  bool UseWorkers = false;
+  if (NumWorkers > 1 && Roots.size() > 1 && !Mgr->shouldVisualize() &&
+      !Ctx->getExternalSource()) {
+    std::vector<SmallVector<unsigned, 4> > Groups;
+    GroupDependentRoots(Roots, Groups);
+    UseWorkers = Groups.size() > 1 &&
+                 AnalyzeRootsInWorkers(Roots, Groups, RootsByName, NumWorkers,
+                                       Results);
+  }
+
+  SetOfConstDecls Visited;
+  SetOfConstDecls VisitedAsTopLevel;
+  for (unsigned Idx = 0, NumRoots = Roots.size(); Idx != NumRoots; ++Idx) {
+    Decl *D = Roots[Idx];
 
     // Skip the functions which have been processed already or previously
     // inlined.
@@ -499,9 +867,33 @@ void AnalysisConsumer::HandleDeclsCallGraph(const unsigned LocalTUDeclsSize) {
 
     // Analyze the function.
     SetOfConstDecls VisitedCallees;
-
-    HandleCode(D, AM_Path, getInliningModeForFunction(D, Visited),
-               (Mgr->options.InliningMode == All ? 0 : &VisitedCallees));
+    ExprEngine::InliningModes IMode = getInliningModeForFunction(D, Visited);
+    std::string CacheKey = getResultsCacheKey(D, IMode, Roots);
+
+    if (!CacheKey.empty() &&
+        LookupCachedResult(CacheKey, RootsByName, VisitedCallees)) {
+      NumFunctionsFromResultsCache++;
+    } else if (UseWorkers && Results[Idx].Valid) {
+      // A worker analyzed the function just as it would be here. If the
+      // worker crashed, the function is analyzed here after all.
+      const WorkerResult &Result = Results[Idx];
+      if (getModeForDecl(D, AM_Path) != AM_None)
+        DisplayFunction(D, AM_Path, IMode, /*InWorker=*/true);
+      EmitWorkerReports(Result.Reports);
+      for (unsigned C = 0, NumCallees = Result.VisitedCallees.size();
+           C != NumCallees; ++C)
+        VisitedCallees.insert(Result.VisitedCallees[C]);
+      if (!CacheKey.empty() && !Result.HasReports)
+        StoreCachedResult(CacheKey, VisitedCallees);
+    } else {
+      if (ResultsCache)
+        FunctionSummaries = FunctionSummariesTy();
+      FoundPathReports = false;
+      HandleCode(D, AM_Path, IMode,
+                 (Mgr->options.InliningMode == All ? 0 : &VisitedCallees));
+      if (!CacheKey.empty() && !FoundPathReports)
+        StoreCachedResult(CacheKey, VisitedCallees);
+    }
 
     // Add the visited callees to the global visited set.
     for (SetOfConstDecls::iterator I = VisitedCallees.begin(),
@@ -512,6 +904,301 @@ void AnalysisConsumer::HandleDeclsCallGraph(const unsigned LocalTUDeclsSize) {
   }
 }
 
+std::string AnalysisConsumer::getResultsCacheKey(
+    Decl *D, ExprEngine::InliningModes IMode, ArrayRef<Decl *> Roots) {
+  // Cached results are only known for functions analyzed in isolation with
+  // regular inlining.
+  if (ResultsCache && IMode == ExprEngine::Inline_Regular &&
+      getModeForDecl(D, AM_Path) == AM_Path)
+    return ResultsCache->getKey(D, Roots);
+  return std::string();
+}
+
+void AnalysisConsumer::EmitWorkerReports(StringRef Reports) {
+  ArrayRef<PathDiagnosticConsumer *> Consumers =
+      Mgr->getPathDiagnosticConsumers();
+  const SourceManager &SM = Ctx->getSourceManager();
+  uint32_t Consumer;
+  while (Reports.size() >= sizeof(Consumer)) {
+    memcpy(&Consumer, Reports.data(), sizeof(Consumer));
+    Reports = Reports.substr(sizeof(Consumer));
+    PathDiagnostic *PD = PathDiagnostic::deserialize(Reports, SM);
+    if (!PD || Consumer >= Consumers.size()) {
+      delete PD;
+      return;
+    }
+    Consumers[Consumer]->HandlePathDiagnostic(PD);
+  }
+}
+
+bool AnalysisConsumer::LookupCachedResult(
+    StringRef Key, const llvm::StringMap<const Decl *> &RootsByName,
+    SetOfConstDecls &VisitedCallees) {
+  std::vector<std::string> Names;
+  if (!ResultsCache->lookup(Key, Names))
+    return false;
+
+  SetOfConstDecls Callees;
+  for (unsigned I = 0, E = Names.size(); I != E; ++I) {
+    llvm::StringMap<const Decl *>::const_iterator Root =
+        RootsByName.find(Names[I]);
+    // Callees that are not top-level functions are never skipped anyway.
+    if (Root == RootsByName.end())
+      continue;
+    if (!Root->getValue())
+      return false;
+    Callees.insert(Root->getValue());
+  }
+
+  for (SetOfConstDecls::iterator I = Callees.begin(), E = Callees.end();
+       I != E; ++I)
+    VisitedCallees.insert(*I);
+  return true;
+}
+
+void AnalysisConsumer::StoreCachedResult(StringRef Key,
+                                         const SetOfConstDecls &VisitedCallees) {
+  std::vector<std::string> Names;
+  for (SetOfConstDecls::const_iterator I = VisitedCallees.begin(),
+                                       E = VisitedCallees.end(); I != E; ++I)
+    Names.push_back(AnalysisResultsCache::getStableName(*I));
+  // Keep the entries independent of the order of the set.
+  std::sort(Names.begin(), Names.end());
+  ResultsCache->store(Key, Names);
+}
+
+#ifdef LLVM_ON_UNIX
+
+static void WorkerFatalErrorHandler(void *, const std::string &, bool) {
+  // Leave the function to the parent process, which will report the error.
+  ::_exit(1);
+}
+
+/// \brief Appends a record for one analyzed root to a worker's results.
+static void WriteWorkerResult(raw_ostream &OS, uint32_t Index,
+                              bool HasReports,
+                              const SetOfConstDecls &VisitedCallees,
+                              StringRef Reports) {
+  uint32_t Header[4] = { Index, HasReports, (uint32_t)VisitedCallees.size(),
+                         (uint32_t)Reports.size() };
+  OS.write(reinterpret_cast<const char *>(Header), sizeof(Header));
+  for (SetOfConstDecls::const_iterator I = VisitedCallees.begin(),
+                                       E = VisitedCallees.end(); I != E; ++I) {
+    // Workers deserialize no Decls, so the callee is at the same address in
+    // the parent.
+    uintptr_t Callee = reinterpret_cast<uintptr_t>(*I);
+    OS.write(reinterpret_cast<const char *>(&Callee), sizeof(Callee));
+  }
+  OS << Reports;
+}
+
+/// \brief Reads the records written by a worker into \p Results. The records
+/// of a group of roots the worker did not finish are ignored.
+static void ReadWorkerResults(StringRef Path,
+                              std::vector<WorkerResult> &Results) {
+  OwningPtr<llvm::MemoryBuffer> Buffer;
+  if (llvm::MemoryBuffer::getFile(Path, Buffer))
+    return;
+
+  StringRef Data = Buffer->getBuffer();
+  uint32_t NumRecords;
+  while (Data.size() >= sizeof(NumRecords)) {
+    memcpy(&NumRecords, Data.data(), sizeof(NumRecords));
+    Data = Data.substr(sizeof(NumRecords));
+
+    std::vector<std::pair<uint32_t, WorkerResult> > Group;
+    for (uint32_t R = 0; R != NumRecords; ++R) {
+      uint32_t Header[4];
+      if (Data.size() < sizeof(Header))
+        return;
+      memcpy(Header, Data.data(), sizeof(Header));
+      Data = Data.substr(sizeof(Header));
+      if (Header[0] >= Results.size() ||
+          Data.size() < Header[2] * sizeof(uintptr_t) + Header[3])
+        return;
+
+      Group.push_back(std::make_pair(Header[0], WorkerResult()));
+      WorkerResult &Result = Group.back().second;
+      Result.Valid = true;
+      Result.HasReports = Header[1];
+      for (uint32_t I = 0; I != Header[2]; ++I) {
+        uintptr_t Callee;
+        memcpy(&Callee, Data.data(), sizeof(Callee));
+        Data = Data.substr(sizeof(Callee));
+        Result.VisitedCallees.push_back(
+            reinterpret_cast<const Decl *>(Callee));
+      }
+      Result.Reports = Data.substr(0, Header[3]);
+      Data = Data.substr(Header[3]);
+    }
+
+    for (unsigned I = 0, E = Group.size(); I != E; ++I)
+      Results[Group[I].first] = Group[I].second;
+  }
+}
+
+void AnalysisConsumer::RunWorkerProcess(
+    ArrayRef<Decl *> Roots, ArrayRef<SmallVector<unsigned, 4> > Groups,
+    const llvm::StringMap<const Decl *> &RootsByName,
+    volatile llvm::sys::cas_flag *NextGroup, int FD) {
+  // A crashing worker must not run the parent's cleanups, such as removing
+  // its output files; the parent analyzes whatever the worker did not finish.
+  static const int Signals[] = {
+    SIGHUP, SIGINT, SIGPIPE, SIGTERM, SIGUSR1, SIGUSR2, SIGILL, SIGTRAP,
+    SIGABRT, SIGFPE, SIGBUS, SIGSEGV, SIGQUIT, SIGSYS, SIGXCPU, SIGXFSZ
+  };
+  for (unsigned I = 0; I != llvm::array_lengthof(Signals); ++I)
+    ::signal(Signals[I], SIG_DFL);
+  llvm::remove_fatal_error_handler();
+  llvm::install_fatal_error_handler(WorkerFatalErrorHandler, 0);
+
+  // Anything the worker would print is printed again by the parent.
+  int Null = ::open("/dev/null", O_WRONLY);
+  if (Null >= 0) {
+    ::dup2(Null, 1);
+    ::dup2(Null, 2);
+    ::close(Null);
+  }
+  Opts->AnalyzerDisplayProgress = false;
+
+  // Build the diagnostics the parent's consumers would get, to send them to
+  // the parent.
+  SmallVector<WorkerPathDiagConsumer *, 4> Proxies;
+  PathDiagnosticConsumers ProxyConsumers;
+  ArrayRef<PathDiagnosticConsumer *> Consumers =
+      Mgr->getPathDiagnosticConsumers();
+  for (unsigned I = 0, E = Consumers.size(); I != E; ++I) {
+    Proxies.push_back(new WorkerPathDiagConsumer(*Consumers[I]));
+    ProxyConsumers.push_back(Proxies.back());
+  }
+  Mgr->setPathDiagnosticConsumers(ProxyConsumers);
+
+  llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+  while (true) {
+    unsigned Group = llvm::sys::AtomicIncrement(NextGroup) - 1;
+    if (Group >= Groups.size())
+      break;
+
+    // Walk the group as the parent would walk its roots. No other group
+    // affects it, so it starts with fresh function summaries.
+    std::string Records;
+    llvm::raw_string_ostream RecordsOS(Records);
+    uint32_t NumRecords = 0;
+    SetOfConstDecls Visited;
+    SetOfConstDecls VisitedAsTopLevel;
+    FunctionSummaries = FunctionSummariesTy();
+    for (unsigned M = 0, NumMembers = Groups[Group].size(); M != NumMembers;
+         ++M) {
+      unsigned Idx = Groups[Group][M];
+      Decl *D = Roots[Idx];
+      if (shouldSkipFunction(D, Visited, VisitedAsTopLevel))
+        continue;
+
+      SetOfConstDecls VisitedCallees;
+      ExprEngine::InliningModes IMode = getInliningModeForFunction(D, Visited);
+      std::string CacheKey = getResultsCacheKey(D, IMode, Roots);
+      if (CacheKey.empty() ||
+          !LookupCachedResult(CacheKey, RootsByName, VisitedCallees)) {
+        if (ResultsCache)
+          FunctionSummaries = FunctionSummariesTy();
+        FoundPathReports = false;
+        HandleCode(D, AM_Path, IMode,
+                   (Mgr->options.InliningMode == All ? 0 : &VisitedCallees));
+
+        std::string Reports;
+        llvm::raw_string_ostream ReportsOS(Reports);
+        for (unsigned C = 0, E = Proxies.size(); C != E; ++C)
+          Proxies[C]->takeDiagnostics(C, ReportsOS);
+        WriteWorkerResult(RecordsOS, Idx, FoundPathReports, VisitedCallees,
+                          ReportsOS.str());
+        ++NumRecords;
+      }
+
+      for (SetOfConstDecls::iterator I = VisitedCallees.begin(),
+                                     E = VisitedCallees.end(); I != E; ++I)
+        Visited.insert(*I);
+      VisitedAsTopLevel.insert(D);
+    }
+
+    // Write the records of the group only once all of it is analyzed. If the
+    // worker crashes, the parent analyzes the unfinished group itself, so it
+    // must find either all of its records or none.
+    OS.write(reinterpret_cast<const char *>(&NumRecords), sizeof(NumRecords));
+    OS << RecordsOS.str();
+    OS.flush();
+  }
+  OS.close();
+  ::_exit(0);
+}
+
+bool AnalysisConsumer::AnalyzeRootsInWorkers(
+    ArrayRef<Decl *> Roots, ArrayRef<SmallVector<unsigned, 4> > Groups,
+    const llvm::StringMap<const Decl *> &RootsByName, unsigned NumWorkers,
+    std::vector<WorkerResult> &Results) {
+  if (NumWorkers > Groups.size())
+    NumWorkers = Groups.size();
+
+  // Hand out the groups through a counter in memory shared with the workers.
+  void *Shared = ::mmap(0, sizeof(llvm::sys::cas_flag), PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANON, -1, 0);
+  if (Shared == MAP_FAILED)
+    return false;
+  volatile llvm::sys::cas_flag *NextGroup =
+      static_cast<volatile llvm::sys::cas_flag *>(Shared);
+  *NextGroup = 0;
+
+  // Don't let the workers inherit output that is still buffered.
+  llvm::outs().flush();
+  llvm::errs().flush();
+
+  std::vector<std::pair<pid_t, std::string> > Workers;
+  for (unsigned I = 0; I != NumWorkers; ++I) {
+    int FD;
+    SmallString<128> Path;
+    if (llvm::sys::fs::createTemporaryFile("analyzer-worker", "dat", FD, Path))
+      break;
+
+    pid_t Pid = ::fork();
+    if (Pid == 0)
+      RunWorkerProcess(Roots, Groups, RootsByName, NextGroup, FD);
+    ::close(FD);
+    if (Pid < 0) {
+      llvm::sys::fs::remove(Path.str());
+      break;
+    }
+    Workers.push_back(std::make_pair(Pid, Path.str().str()));
+  }
+
+  Results.assign(Roots.size(), WorkerResult());
+  for (unsigned I = 0, E = Workers.size(); I != E; ++I) {
+    while (::waitpid(Workers[I].first, 0, 0) < 0 && errno == EINTR)
+      ;
+    ReadWorkerResults(Workers[I].second, Results);
+    llvm::sys::fs::remove(Workers[I].second);
+  }
+
+  ::munmap(Shared, sizeof(llvm::sys::cas_flag));
+  return !Workers.empty();
+}
+
+#else
+
+void AnalysisConsumer::RunWorkerProcess(
+    ArrayRef<Decl *> Roots, ArrayRef<SmallVector<unsigned, 4> > Groups,
+    const llvm::StringMap<const Decl *> &RootsByName,
+    volatile llvm::sys::cas_flag *NextGroup, int FD) {
+  llvm_unreachable("Worker processes are not supported on this platform");
+}
+
+bool AnalysisConsumer::AnalyzeRootsInWorkers(
+    ArrayRef<Decl *> Roots, ArrayRef<SmallVector<unsigned, 4> > Groups,
+    const llvm::StringMap<const Decl *> &RootsByName, unsigned NumWorkers,
+    std::vector<WorkerResult> &Results) {
+  return false;
+}
+
+#endif
+
 void AnalysisConsumer::HandleTranslationUnit(ASTContext &C) {
   // Don't run the actions if an error has occurred with parsing the file.
   DiagnosticsEngine &Diags = PP.getDiagnostics();
@@ -667,6 +1354,10 @@ void AnalysisConsumer::ActionExprEngine(Decl *D, bool ObjCGCEnabled,
   // created BugReporter.
   ExplodedNode::SetAuditor(0);
 
+  BugReporter &BR = Eng.getBugReporter();
+  if (BR.EQClasses_begin() != BR.EQClasses_end())
+    FoundPathReports = true;
+
   // Visualize the exploded graph.
   if (Mgr->options.visualizeExplodedGraphWithGraphViz)
     Eng.ViewGraph(Mgr->options.TrimGraph);
@@ -0,0 +1,367 @@
+//===--- AnalysisResultsCache.cpp - Reusing clean results across runs -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the on-disk cache of the top-level functions whose
+// path-sensitive analysis produced no reports.
+//
+//===----------------------------------------------------------------------===//
+
+#include "AnalysisResultsCache.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/DeclObjC.h"
+#include "clang/AST/DeclTemplate.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/AST/ExprObjC.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Basic/TargetInfo.h"
+#include "clang/Basic/Version.h"
+#include "clang/Lex/Lexer.h"
+#include "clang/StaticAnalyzer/Core/AnalyzerOptions.h"
+#include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+using namespace clang;
+using namespace ento;
+
+namespace {
+/// \brief Computes an MD5 digest of a sequence of strings and values.
+class KeyHasher {
+  llvm::MD5 Hash;
+
+public:
+  void add(StringRef Bytes) {
+    add((uint64_t)Bytes.size());
+    Hash.update(Bytes);
+  }
+
+  void add(uint64_t Value) {
+    uint8_t Bytes[8];
+    for (unsigned I = 0; I != 8; ++I)
+      Bytes[I] = (uint8_t)(Value >> (I * 8));
+    Hash.update(Bytes);
+  }
+
+  void add(const llvm::FoldingSetNodeID &ID) {
+    llvm::BumpPtrAllocator Allocator;
+    llvm::FoldingSetNodeIDRef Ref = ID.Intern(Allocator);
+    add(StringRef(reinterpret_cast<const char *>(Ref.getData()),
+                  Ref.getSize() * sizeof(unsigned)));
+  }
+
+  /// \brief Returns the digest of everything added so far. The hasher cannot
+  /// be used afterwards.
+  std::string getHexDigest() {
+    llvm::MD5::MD5Result Result;
+    Hash.final(Result);
+    SmallString<32> Str;
+    llvm::MD5::stringifyResult(Result, Str);
+    return Str.str();
+  }
+};
+
+/// \brief Collects the declarations the analysis of a function may depend on.
+class DependencyCollector {
+  SmallVector<const Decl *, 16> Worklist;
+  llvm::SmallPtrSet<const Decl *, 16> Seen;
+
+  void addDestructorOf(QualType T) {
+    const CXXRecordDecl *RD = T->getBaseElementTypeUnsafe()
+                               ->getAsCXXRecordDecl();
+    if (RD && RD->hasDefinition())
+      if (const CXXDestructorDecl *Dtor = RD->getDestructor())
+        add(Dtor);
+  }
+
+public:
+  /// \brief Whether a call may be dispatched to a function that cannot be
+  /// determined statically.
+  bool HasDynamicCalls;
+
+  DependencyCollector() : HasDynamicCalls(false) {}
+
+  void add(const Decl *D) {
+    if (!D)
+      return;
+
+    if (const FunctionDecl *FD = dyn_cast<FunctionDecl>(D)) {
+      if (const CXXMethodDecl *MD = dyn_cast<CXXMethodDecl>(FD))
+        if (MD->isVirtual())
+          HasDynamicCalls = true;
+      const FunctionDecl *Def = 0;
+      if (!FD->hasBody(Def))
+        return;
+      D = Def;
+    } else if (const VarDecl *VD = dyn_cast<VarDecl>(D)) {
+      if (!VD->hasGlobalStorage())
+        return;
+    } else if (const FieldDecl *Field = dyn_cast<FieldDecl>(D)) {
+      D = Field->getParent();
+    } else if (!isa<ObjCMethodDecl>(D) && !isa<BlockDecl>(D)) {
+      return;
+    }
+
+    if (Seen.insert(D))
+      Worklist.push_back(D);
+  }
+
+  void scan(const Stmt *S) {
+    if (!S)
+      return;
+
+    if (const DeclRefExpr *DRE = dyn_cast<DeclRefExpr>(S)) {
+      add(DRE->getDecl());
+    } else if (const MemberExpr *ME = dyn_cast<MemberExpr>(S)) {
+      add(ME->getMemberDecl());
+    } else if (const CallExpr *CE = dyn_cast<CallExpr>(S)) {
+      if (!CE->getDirectCallee())
+        HasDynamicCalls = true;
+    } else if (isa<ObjCMessageExpr>(S)) {
+      HasDynamicCalls = true;
+    } else if (const CXXConstructExpr *CE = dyn_cast<CXXConstructExpr>(S)) {
+      add(CE->getConstructor());
+    } else if (const CXXNewExpr *NE = dyn_cast<CXXNewExpr>(S)) {
+      add(NE->getOperatorNew());
+    } else if (const CXXDeleteExpr *DE = dyn_cast<CXXDeleteExpr>(S)) {
+      add(DE->getOperatorDelete());
+      addDestructorOf(DE->getDestroyedType());
+    } else if (const CXXBindTemporaryExpr *BTE =
+                   dyn_cast<CXXBindTemporaryExpr>(S)) {
+      add(BTE->getTemporary()->getDestructor());
+    } else if (const CXXDefaultArgExpr *DAE = dyn_cast<CXXDefaultArgExpr>(S)) {
+      scan(DAE->getExpr());
+    } else if (const CXXDefaultInitExpr *DIE =
+                   dyn_cast<CXXDefaultInitExpr>(S)) {
+      scan(DIE->getExpr());
+    } else if (const BlockExpr *BE = dyn_cast<BlockExpr>(S)) {
+      scan(BE->getBody());
+    } else if (const LambdaExpr *LE = dyn_cast<LambdaExpr>(S)) {
+      scan(LE->getBody());
+    } else if (const DeclStmt *DS = dyn_cast<DeclStmt>(S)) {
+      // Destructors of local variables are called implicitly.
+      for (DeclStmt::const_decl_iterator I = DS->decl_begin(),
+                                         E = DS->decl_end(); I != E; ++I)
+        if (const VarDecl *VD = dyn_cast<VarDecl>(*I))
+          addDestructorOf(VD->getType());
+    }
+
+    for (Stmt::const_child_iterator I = S->child_begin(), E = S->child_end();
+         I != E; ++I)
+      scan(*I);
+  }
+
+  /// \brief Scans the parts of \p D that run when it is used.
+  void scanDecl(const Decl *D) {
+    if (const VarDecl *VD = dyn_cast<VarDecl>(D)) {
+      scan(VD->getAnyInitializer());
+      return;
+    }
+    if (const CXXConstructorDecl *Ctor = dyn_cast<CXXConstructorDecl>(D))
+      for (CXXConstructorDecl::init_const_iterator I = Ctor->init_begin(),
+                                                   E = Ctor->init_end();
+           I != E; ++I)
+        scan((*I)->getInit());
+    if (const CXXDestructorDecl *Dtor = dyn_cast<CXXDestructorDecl>(D))
+      for (CXXRecordDecl::field_iterator I = Dtor->getParent()->field_begin(),
+                                         E = Dtor->getParent()->field_end();
+           I != E; ++I)
+        addDestructorOf(I->getType());
+    if (!isa<RecordDecl>(D))
+      scan(D->getBody());
+  }
+
+  ArrayRef<const Decl *> getWorklist() const { return Worklist; }
+};
+} // end anonymous namespace
+
+/// \brief Adds what identifies \p D, and what it looks like in this
+/// compilation, to \p Hasher.
+static void addDecl(KeyHasher &Hasher, const Decl *D) {
+  ASTContext &Ctx = D->getASTContext();
+  const SourceManager &SM = Ctx.getSourceManager();
+
+  Hasher.add(D->getKind());
+  Hasher.add(AnalysisResultsCache::getStableName(D));
+
+  // Reports point into the source, so the key depends on exactly where the
+  // declaration is and how it is written.
+  SourceRange Range = D->getSourceRange();
+  SourceLocation Begin = SM.getExpansionLoc(Range.getBegin());
+  SourceLocation End = SM.getExpansionRange(Range.getEnd()).second;
+  PresumedLoc PLoc = SM.getPresumedLoc(Begin);
+  if (PLoc.isValid()) {
+    Hasher.add(PLoc.getFilename());
+    Hasher.add(PLoc.getLine());
+    Hasher.add(PLoc.getColumn());
+  }
+  Hasher.add(Lexer::getSourceText(CharSourceRange::getTokenRange(Begin, End),
+                                  SM, Ctx.getLangOpts()));
+
+  // The profile catches changes the text does not show, such as those to
+  // macros and typedefs.
+  llvm::FoldingSetNodeID ID;
+  if (const ValueDecl *VD = dyn_cast<ValueDecl>(D))
+    Hasher.add(VD->getType().getCanonicalType().getAsString());
+  if (const VarDecl *VD = dyn_cast<VarDecl>(D)) {
+    if (const Expr *Init = VD->getAnyInitializer())
+      Init->ProfileStable(ID, Ctx);
+  } else if (!isa<RecordDecl>(D)) {
+    if (const Stmt *Body = D->getBody())
+      Body->ProfileStable(ID, Ctx);
+  }
+  Hasher.add(ID);
+}
+
+AnalysisResultsCache::AnalysisResultsCache(StringRef Dir,
+                                           const AnalyzerOptions &Opts,
+                                           const LangOptions &LangOpts,
+                                           ArrayRef<std::string> Plugins)
+  : Dir(Dir), Valid(false) {
+  bool Existed;
+  Valid = !llvm::sys::fs::create_directories(Dir, Existed);
+
+  // Only the options given explicitly are in the table at this point; the
+  // defaults of the others are implied by the version.
+  llvm::raw_string_ostream OS(ConfigKey);
+  OS << "results-cache-1 " << getClangFullVersion() << '\n';
+  for (unsigned I = 0, E = Opts.CheckersControlList.size(); I != E; ++I)
+    OS << (Opts.CheckersControlList[I].second ? '+' : '-')
+       << Opts.CheckersControlList[I].first << '\n';
+  std::vector<std::string> Config;
+  for (AnalyzerOptions::ConfigTable::const_iterator I = Opts.Config.begin(),
+                                                    E = Opts.Config.end();
+       I != E; ++I)
+    Config.push_back(I->getKey().str() + "=" + I->getValue());
+  std::sort(Config.begin(), Config.end());
+  for (unsigned I = 0, E = Config.size(); I != E; ++I)
+    OS << Config[I] << '\n';
+  for (unsigned I = 0, E = Plugins.size(); I != E; ++I)
+    OS << "plugin " << Plugins[I] << '\n';
+  OS << Opts.AnalysisStoreOpt << ' ' << Opts.AnalysisConstraintsOpt << ' '
+     << Opts.AnalysisPurgeOpt << ' ' << Opts.maxBlockVisitOnPath << ' '
+     << Opts.AnalyzeAll << Opts.AnalyzeNestedBlocks
+     << Opts.eagerlyAssumeBinOpBifurcation << Opts.UnoptimizedCFG
+     << Opts.NoRetryExhausted << ' ' << Opts.InlineMaxStackDepth << ' '
+     << Opts.InliningMode << ' ' << Opts.AnalyzeSpecificFunction << ' '
+     << LangOpts.getGC() << '\n';
+  OS.flush();
+}
+
+std::string AnalysisResultsCache::getKey(const Decl *D,
+                                         ArrayRef<Decl *> Roots) {
+  KeyHasher Hasher;
+  Hasher.add(ConfigKey);
+  Hasher.add(D->getASTContext().getTargetInfo().getTriple().str());
+
+  DependencyCollector Collector;
+  Collector.add(D);
+  // The worklist grows while it is being walked.
+  for (unsigned I = 0; I != Collector.getWorklist().size(); ++I) {
+    const Decl *Dep = Collector.getWorklist()[I];
+    Collector.scanDecl(Dep);
+    addDecl(Hasher, Dep);
+  }
+
+  if (Collector.HasDynamicCalls) {
+    if (TranslationUnitKey.empty()) {
+      KeyHasher TUHasher;
+      for (unsigned I = 0, E = Roots.size(); I != E; ++I)
+        addDecl(TUHasher, Roots[I]);
+      TranslationUnitKey = TUHasher.getHexDigest();
+    }
+    Hasher.add(TranslationUnitKey);
+  }
+
+  return Hasher.getHexDigest();
+}
+
+bool AnalysisResultsCache::lookup(StringRef Key,
+                                  std::vector<std::string> &VisitedCallees) {
+  if (!Valid)
+    return false;
+
+  SmallString<128> Path(Dir);
+  llvm::sys::path::append(Path, Key + ".result");
+  OwningPtr<llvm::MemoryBuffer> Buffer;
+  if (llvm::MemoryBuffer::getFile(Path.str(), Buffer))
+    return false;
+
+  SmallVector<StringRef, 16> Lines;
+  Buffer->getBuffer().split(Lines, "\n", /*MaxSplit=*/-1,
+                            /*KeepEmpty=*/false);
+  VisitedCallees.clear();
+  for (unsigned I = 0, E = Lines.size(); I != E; ++I)
+    VisitedCallees.push_back(Lines[I]);
+  return true;
+}
+
+void AnalysisResultsCache::store(StringRef Key,
+                                 ArrayRef<std::string> VisitedCallees) {
+  if (!Valid)
+    return;
+
+  // Write to a temporary file first, so that concurrent analyses of the same
+  // code never see a partial entry.
+  SmallString<128> TempPath(Dir);
+  llvm::sys::path::append(TempPath, Key + "-%%%%%%%%.tmp");
+  int FD;
+  if (llvm::sys::fs::createUniqueFile(TempPath.str(), FD, TempPath))
+    return;
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    for (unsigned I = 0, E = VisitedCallees.size(); I != E; ++I)
+      OS << VisitedCallees[I] << '\n';
+  }
+
+  SmallString<128> Path(Dir);
+  llvm::sys::path::append(Path, Key + ".result");
+  if (llvm::sys::fs::rename(TempPath.str(), Path.str()))
+    llvm::sys::fs::remove(TempPath.str());
+}
+
+std::string AnalysisResultsCache::getStableName(const Decl *D) {
+  std::string Name;
+  llvm::raw_string_ostream OS(Name);
+
+  if (const ObjCMethodDecl *MD = dyn_cast<ObjCMethodDecl>(D)) {
+    OS << (MD->isInstanceMethod() ? '-' : '+') << '[';
+    if (const NamedDecl *Container = dyn_cast<NamedDecl>(MD->getDeclContext()))
+      OS << Container->getName();
+    OS << ' ' << MD->getSelector().getAsString() << ']';
+  } else if (const NamedDecl *ND = dyn_cast<NamedDecl>(D)) {
+    OS << ND->getQualifiedNameAsString();
+    if (const FunctionDecl *FD = dyn_cast<FunctionDecl>(ND)) {
+      if (const TemplateArgumentList *Args =
+              FD->getTemplateSpecializationArgs())
+        TemplateSpecializationType::PrintTemplateArgumentList(
+            OS, Args->data(), Args->size(),
+            FD->getASTContext().getPrintingPolicy());
+      OS << ' ' << FD->getType().getCanonicalType().getAsString();
+    }
+  } else {
+    // Blocks have no name; identify them by where they are written.
+    const SourceManager &SM = D->getASTContext().getSourceManager();
+    PresumedLoc PLoc = SM.getPresumedLoc(SM.getExpansionLoc(D->getLocation()));
+    OS << "block";
+    if (PLoc.isValid())
+      OS << ' ' << PLoc.getFilename() << ':' << PLoc.getLine() << ':'
+         << PLoc.getColumn();
+  }
+
+  return OS.str();
+}
@@ -0,0 +1,82 @@
+//===--- AnalysisResultsCache.h - Reusing clean results across runs -*- C++ -*-//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines an on-disk cache of the top-level functions whose
+// path-sensitive analysis produced no reports.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_GR_ANALYSISRESULTSCACHE_H
+#define LLVM_CLANG_GR_ANALYSISRESULTSCACHE_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include <string>
+#include <vector>
+
+namespace clang {
+class AnalyzerOptions;
+class ASTContext;
+class Decl;
+class LangOptions;
+
+namespace ento {
+
+/// \brief An on-disk cache of the top-level functions whose path-sensitive
+/// analysis produced no reports.
+///
+/// An entry is keyed by a hash of everything the analysis of a function may
+/// depend on: the analyzer's version and configuration, and the location,
+/// source text and stable AST profile of the function and of every function,
+/// global variable and record it may reach. A function whose key is in the
+/// cache need not be analyzed again. The entry records the callees the
+/// analysis inlined, so that they can be treated as analyzed as well.
+///
+/// Calls that may be dispatched dynamically make the key depend on every
+/// top-level function of the translation unit instead. Changes to
+/// declarations that are not reachable this way are not detected.
+class AnalysisResultsCache {
+  std::string Dir;
+
+  /// \brief The part of every key that describes the configuration.
+  std::string ConfigKey;
+
+  /// \brief The part of the key of functions with dynamic calls that
+  /// describes the whole translation unit, or empty if not computed yet.
+  std::string TranslationUnitKey;
+
+  /// \brief Whether the cache directory is usable.
+  bool Valid;
+
+public:
+  AnalysisResultsCache(StringRef Dir, const AnalyzerOptions &Opts,
+                       const LangOptions &LangOpts,
+                       ArrayRef<std::string> Plugins);
+
+  /// \brief Computes the key for analyzing \p D as a top-level function.
+  /// \p Roots are all the top-level functions of the translation unit.
+  std::string getKey(const Decl *D, ArrayRef<Decl *> Roots);
+
+  /// \brief Looks up \p Key. If found, returns true and stores the names of
+  /// the callees that were inlined into the function in \p VisitedCallees.
+  bool lookup(StringRef Key, std::vector<std::string> &VisitedCallees);
+
+  /// \brief Records that the analysis under \p Key produced no reports.
+  void store(StringRef Key, ArrayRef<std::string> VisitedCallees);
+
+  /// \brief Returns a name for \p D that identifies it within its
+  /// translation unit, and is the same across compilations.
+  static std::string getStableName(const Decl *D);
+};
+
+} // end namespace ento
+} // end namespace clang
+
+#endif
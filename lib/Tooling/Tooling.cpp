@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/Tooling/Tooling.h"
+#include "clang/Basic/Parallel.h"
 #include "clang/Driver/Compilation.h"
 #include "clang/Driver/Driver.h"
 #include "clang/Driver/Tool.h"
@@ -26,6 +27,7 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Host.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/raw_ostream.h"
 
 // For chdir, see the comment in ClangTool::run for more information.
@@ -142,7 +144,8 @@ std::string getAbsolutePath(StringRef File) {
 ToolInvocation::ToolInvocation(
     ArrayRef<std::string> CommandLine, FrontendAction *ToolAction,
     FileManager *Files)
-    : CommandLine(CommandLine.vec()), ToolAction(ToolAction), Files(Files) {
+    : CommandLine(CommandLine.vec()), ToolAction(ToolAction), Files(Files),
+      DiagConsumer(NULL) {
 }
 
 void ToolInvocation::mapVirtualFile(StringRef FilePath, StringRef Content) {
@@ -161,7 +164,7 @@ bool ToolInvocation::run() {
       llvm::errs(), &*DiagOpts);
   DiagnosticsEngine Diagnostics(
     IntrusiveRefCntPtr<clang::DiagnosticIDs>(new DiagnosticIDs()),
-    &*DiagOpts, &DiagnosticPrinter, false);
+    &*DiagOpts, DiagConsumer ? DiagConsumer : &DiagnosticPrinter, false);
 
   const OwningPtr<clang::driver::Driver> Driver(
       newDriver(&Diagnostics, BinaryName));
@@ -202,7 +205,7 @@ bool ToolInvocation::runInvocation(
   OwningPtr<FrontendAction> ScopedToolAction(ToolAction.take());
 
   // Create the compilers actual diagnostics engine.
-  Compiler.createDiagnostics();
+  Compiler.createDiagnostics(DiagConsumer, /*ShouldOwnClient=*/false);
   if (!Compiler.hasDiagnostics())
     return false;
 
@@ -232,7 +235,9 @@ void ToolInvocation::addFileMappingsTo(SourceManager &Sources) {
 
 ClangTool::ClangTool(const CompilationDatabase &Compilations,
                      ArrayRef<std::string> SourcePaths)
-    : Files((FileSystemOptions())) {
+    : Files((FileSystemOptions())), SharedCache(new SharedFileSystemCache()),
+      NumThreads(1) {
+  Files.setSharedCache(SharedCache.getPtr());
   ArgsAdjusters.push_back(new ClangStripOutputAdjuster());
   ArgsAdjusters.push_back(new ClangSyntaxOnlyAdjuster());
   for (unsigned I = 0, E = SourcePaths.size(); I != E; ++I) {
@@ -275,6 +280,17 @@ void ClangTool::clearArgumentsAdjusters() {
   ArgsAdjusters.clear();
 }
 
+std::vector<std::string>
+ClangTool::getAdjustedCommandLine(unsigned Index, StringRef MainExecutable) {
+  std::vector<std::string> CommandLine =
+      CompileCommands[Index].second.CommandLine;
+  for (unsigned I = 0, E = ArgsAdjusters.size(); I != E; ++I)
+    CommandLine = ArgsAdjusters[I]->Adjust(CommandLine);
+  assert(!CommandLine.empty());
+  CommandLine[0] = MainExecutable;
+  return CommandLine;
+}
+
 int ClangTool::run(FrontendActionFactory *ActionFactory) {
   // Exists solely for the purpose of lookup of the resource path.
   // This just needs to be some symbol in the binary.
@@ -287,6 +303,13 @@ int ClangTool::run(FrontendActionFactory *ActionFactory) {
   std::string MainExecutable =
       llvm::sys::fs::getMainExecutable("clang_tool", &StaticSymbol);
 
+  // Files may have changed since the last run, e.g. because a refactoring
+  // was applied.
+  SharedCache->clear();
+
+  if (NumThreads != 1 && CompileCommands.size() > 1)
+    return runInParallel(ActionFactory, MainExecutable);
+
   bool ProcessingFailed = false;
   for (unsigned I = 0; I < CompileCommands.size(); ++I) {
     std::string File = CompileCommands[I].first;
@@ -297,14 +320,13 @@ int ClangTool::run(FrontendActionFactory *ActionFactory) {
     // for example on network filesystems, where symlinks might be switched
     // during runtime of the tool. Fixing this depends on having a file system
     // abstraction that allows openat() style interactions.
+    // Parallel runs accept that difference and use -working-directory
+    // instead, see runInParallel.
     if (chdir(CompileCommands[I].second.Directory.c_str()))
       llvm::report_fatal_error("Cannot chdir into \"" +
                                CompileCommands[I].second.Directory + "\n!");
-    std::vector<std::string> CommandLine = CompileCommands[I].second.CommandLine;
-    for (unsigned I = 0, E = ArgsAdjusters.size(); I != E; ++I)
-      CommandLine = ArgsAdjusters[I]->Adjust(CommandLine);
-    assert(!CommandLine.empty());
-    CommandLine[0] = MainExecutable;
+    std::vector<std::string> CommandLine =
+        getAdjustedCommandLine(I, MainExecutable);
     // FIXME: We need a callback mechanism for the tool writer to output a
     // customized message for each file.
     DEBUG({
@@ -324,5 +346,119 @@ int ClangTool::run(FrontendActionFactory *ActionFactory) {
   return ProcessingFailed ? 1 : 0;
 }
 
+namespace {
+/// \brief State shared by the worker threads of a parallel ClangTool::run.
+struct ParallelToolRun {
+  ParallelToolRun(FrontendActionFactory *ActionFactory,
+                  SharedFileSystemCache *SharedCache,
+                  ArrayRef<std::pair<StringRef, StringRef> > MappedFileContents,
+                  unsigned NumCommands)
+      : ActionFactory(ActionFactory), SharedCache(SharedCache),
+        MappedFileContents(MappedFileContents),
+        Files(NumCommands), Directories(NumCommands),
+        CommandLines(NumCommands), Outputs(NumCommands),
+        Finished(NumCommands, false), NextOutput(0), ProcessingFailed(false) {}
+
+  FrontendActionFactory *ActionFactory;
+  SharedFileSystemCache *SharedCache;
+  ArrayRef<std::pair<StringRef, StringRef> > MappedFileContents;
+
+  /// \brief The source file, working directory and fully adjusted command
+  /// line of every compile command, computed up front on the calling thread.
+  std::vector<std::string> Files;
+  std::vector<std::string> Directories;
+  std::vector<std::vector<std::string> > CommandLines;
+
+  /// \brief Guards everything below, as well as calls to
+  /// ActionFactory->create().
+  llvm::sys::Mutex Lock;
+
+  /// \brief The buffered diagnostics of every compile command that finished
+  /// but could not be printed yet, because an earlier one is still running.
+  std::vector<std::string> Outputs;
+  std::vector<bool> Finished;
+
+  /// \brief The index of the next compile command whose output is printed.
+  unsigned NextOutput;
+
+  bool ProcessingFailed;
+};
+}
+
+/// \brief Runs the tool over the compile command \p Index of the
+/// \c ParallelToolRun \p UserData.
+static void runToolInvocationOnThread(void *UserData, unsigned Index) {
+  ParallelToolRun &Run = *static_cast<ParallelToolRun *>(UserData);
+
+  FrontendAction *Action;
+  {
+    llvm::sys::ScopedLock L(Run.Lock);
+    Action = Run.ActionFactory->create();
+  }
+
+  // Never touch the process' working directory; resolve relative paths in
+  // this translation unit against its compile command's directory instead.
+  FileSystemOptions FileSystemOpts;
+  FileSystemOpts.WorkingDir = Run.Directories[Index];
+  FileManager Files(FileSystemOpts);
+  Files.setSharedCache(Run.SharedCache);
+
+  std::string Output;
+  llvm::raw_string_ostream OS(Output);
+  IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts = new DiagnosticOptions();
+  TextDiagnosticPrinter DiagnosticPrinter(OS, &*DiagOpts);
+
+  ToolInvocation Invocation(Run.CommandLines[Index], Action, &Files);
+  Invocation.setDiagnosticConsumer(&DiagnosticPrinter);
+  for (unsigned I = 0, E = Run.MappedFileContents.size(); I != E; ++I) {
+    Invocation.mapVirtualFile(Run.MappedFileContents[I].first,
+                              Run.MappedFileContents[I].second);
+  }
+  bool Success = Invocation.run();
+  if (!Success) {
+    // FIXME: Diagnostics should be used instead.
+    OS << "Error while processing " << Run.Files[Index] << ".\n";
+  }
+  OS.flush();
+
+  // Print the output of every finished compile command that does not have to
+  // wait for an earlier one, so diagnostics appear in compile command order.
+  llvm::sys::ScopedLock L(Run.Lock);
+  if (!Success)
+    Run.ProcessingFailed = true;
+  Run.Outputs[Index].swap(Output);
+  Run.Finished[Index] = true;
+  while (Run.NextOutput < Run.Finished.size() &&
+         Run.Finished[Run.NextOutput]) {
+    llvm::errs() << Run.Outputs[Run.NextOutput];
+    std::string().swap(Run.Outputs[Run.NextOutput]);
+    ++Run.NextOutput;
+  }
+}
+
+int ClangTool::runInParallel(FrontendActionFactory *ActionFactory,
+                             StringRef MainExecutable) {
+  ParallelToolRun Run(ActionFactory, SharedCache.getPtr(), MappedFileContents,
+                      CompileCommands.size());
+  for (unsigned I = 0, E = CompileCommands.size(); I != E; ++I) {
+    Run.Files[I] = CompileCommands[I].first;
+    Run.Directories[I] = CompileCommands[I].second.Directory;
+    std::vector<std::string> CommandLine =
+        getAdjustedCommandLine(I, MainExecutable);
+    // The driver uses -working-directory to resolve relative input paths and
+    // forwards it to the frontend.
+    CommandLine.insert(CommandLine.begin() + 1, Run.Directories[I]);
+    CommandLine.insert(CommandLine.begin() + 1, "-working-directory");
+    Run.CommandLines[I].swap(CommandLine);
+    DEBUG({
+      llvm::dbgs() << "Processing: " << Run.Files[I] << ".\n";
+    });
+  }
+
+  clang::runInParallel(CompileCommands.size(), NumThreads,
+                       runToolInvocationOnThread, &Run);
+  return Run.ProcessingFailed ? 1 : 0;
+}
+
 } // end namespace tooling
 } // end namespace clang
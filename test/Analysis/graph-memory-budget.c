@@ -0,0 +1,35 @@
+// RUN: %clang_cc1 -analyze -analyzer-checker=core -analyzer-config graph-memory-budget=1 -verify %s
+// RUN: %clang_cc1 -analyze -analyzer-checker=core -analyzer-config graph-memory-budget=1 -analyzer-stats %s 2>&1 | FileCheck %s
+// REQUIRES: asserts
+
+// The exploded graph for this function grows well past 1MB. The analysis
+// must stop gracefully, keeping the reports found so far.
+
+int manyPaths(int *a, int d) {
+  int s = 0;
+  if (a[0]) s += 1;
+  if (a[1]) s += 2;
+  if (a[2]) s += 3;
+  if (a[3]) s += 4;
+  if (a[4]) s += 5;
+  if (a[5]) s += 6;
+  if (a[6]) s += 7;
+  if (a[7]) s += 8;
+  if (a[8]) s += 9;
+  if (a[9]) s += 10;
+  if (a[10]) s += 11;
+  if (a[11]) s += 12;
+  if (a[12]) s += 13;
+  if (a[13]) s += 14;
+  if (a[14]) s += 15;
+  if (a[15]) s += 16;
+  if (a[16]) s += 17;
+  if (a[17]) s += 18;
+  if (a[18]) s += 19;
+  if (a[19]) s += 20;
+  if (d == 0)
+    return s / d; // expected-warning{{Division by zero}}
+  return s;
+}
+
+// CHECK: The # of times we reached the exploded graph memory budget.
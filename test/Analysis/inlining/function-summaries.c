@@ -0,0 +1,69 @@
+// RUN: %clang_cc1 -analyze -analyzer-checker=core,debug.ExprInspection -verify %s
+// RUN: %clang_cc1 -analyze -analyzer-checker=core,debug.ExprInspection -analyzer-config summary-min-size=1 -DSUMMARIES -verify %s
+// RUN: %clang_cc1 -analyze -analyzer-checker=core,debug.ExprInspection -analyzer-config summary-min-size=1 -analyzer-config summary-max-return-values=0 -DSUMMARIES -DNO_RETURN_VALUES -verify %s
+
+void clang_analyzer_eval(int);
+
+int isLarge(int x) {
+  if (x > 10)
+    return 1;
+  return 0;
+}
+
+int classify(int x) {
+  if (isLarge(x))
+    return 5;
+  return 7;
+}
+
+int g;
+
+int readOnly(int *p) {
+  return *p + g;
+}
+
+void store(int *p) {
+  *p = 3;
+}
+
+void testReturnValues(int x) {
+  int r = isLarge(x);
+  clang_analyzer_eval(r <= 1);
+#if defined(NO_RETURN_VALUES)
+  // expected-warning@-2 {{UNKNOWN}}
+#else
+  // expected-warning@-4 {{TRUE}}
+#endif
+
+  // Summaries do not relate the return value to the arguments.
+  clang_analyzer_eval(r == (x > 10));
+#if defined(SUMMARIES)
+  // expected-warning@-2 {{UNKNOWN}}
+#else
+  // expected-warning@-4 {{TRUE}}
+#endif
+}
+
+void testLayeredCalls(int x) {
+  int r = classify(x);
+  clang_analyzer_eval(r >= 5);
+#if defined(NO_RETURN_VALUES)
+  // expected-warning@-2 {{UNKNOWN}}
+#else
+  // expected-warning@-4 {{TRUE}}
+#endif
+}
+
+void testBindingsAreKept() {
+  int a = 1;
+  g = 2;
+  readOnly(&a);
+  clang_analyzer_eval(a == 1); // expected-warning{{TRUE}}
+  clang_analyzer_eval(g == 2); // expected-warning{{TRUE}}
+}
+
+void testSideEffectsAreInlined() {
+  int a = 1;
+  store(&a);
+  clang_analyzer_eval(a == 3); // expected-warning{{TRUE}}
+}
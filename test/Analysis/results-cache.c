@@ -0,0 +1,47 @@
+// RUN: rm -rf %t
+// RUN: %clang_cc1 -analyze -analyzer-checker=core -analyzer-results-cache %t -verify %s
+// RUN: %clang_cc1 -analyze -analyzer-checker=core -analyzer-results-cache %t -verify %s
+// RUN: %clang_cc1 -analyze -analyzer-checker=core -analyzer-results-cache %t -analyzer-display-progress %s > %t.out 2>&1
+// RUN: FileCheck --input-file=%t.out %s
+// RUN: FileCheck --input-file=%t.out -check-prefix=CACHED %s
+// RUN: %clang_cc1 -analyze -analyzer-checker=core -analyzer-results-cache %t -analyzer-display-progress -DVALUE=0 %s > %t.out 2>&1
+// RUN: FileCheck --input-file=%t.out -check-prefix=CHANGED %s
+// RUN: FileCheck --input-file=%t.out -check-prefix=UNCHANGED %s
+
+// Functions with reports are analyzed again to emit them; the others are
+// skipped, along with the callees they inlined, until their code changes.
+
+#ifndef VALUE
+#define VALUE 1
+#endif
+
+void deref(int *p) {
+  *p = 1; // expected-warning{{Dereference of null pointer}}
+}
+
+void derefNull(void) {
+  deref(0);
+}
+
+int getValue(void) {
+  return VALUE;
+}
+
+int divideByValue(int x) {
+  return x / getValue();
+}
+
+int nothingToReport(int x) {
+  return x + 1;
+}
+
+// CHECK: Inline_Regular): {{.*}}results-cache.c derefNull
+
+// CACHED-NOT: Inline_Regular): {{.*}}results-cache.c getValue
+// CACHED-NOT: Inline_Regular): {{.*}}results-cache.c divideByValue
+// CACHED-NOT: Inline_Regular): {{.*}}results-cache.c nothingToReport
+
+// CHANGED: Inline_Regular): {{.*}}results-cache.c divideByValue
+// CHANGED: Division by zero
+
+// UNCHANGED-NOT: Inline_Regular): {{.*}}results-cache.c nothingToReport
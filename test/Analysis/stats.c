@@ -7,3 +7,6 @@ void foo() {
 // CHECK: ... Statistics Collected ...
 // CHECK:100 AnalysisConsumer - The % of reachable basic blocks.
 // CHECK:The # of times RemoveDeadBindings is called
+// CHECK:The maximum # of nodes in an exploded graph
+// CHECK:The maximum # of program states alive during an analysis
+// CHECK:The maximum memory allocated for an exploded graph, in KB
@@ -0,0 +1,48 @@
+// RUN: %clang_cc1 -analyze -analyzer-checker=core -verify %s
+// RUN: %clang_cc1 -analyze -analyzer-checker=core -analyzer-config worker-processes=2 -verify %s
+// RUN: %clang_cc1 -analyze -analyzer-checker=core -analyzer-config worker-processes=4 -verify %s
+// RUN: %clang_cc1 -analyze -analyzer-checker=core -analyzer-config worker-processes=2 -analyzer-display-progress %s > %t.out 2>&1
+// RUN: FileCheck --input-file=%t.out -check-prefix=TRACE %s
+// RUN: FileCheck --input-file=%t.out -check-prefix=ONCE %s
+// RUN: FileCheck --input-file=%t.out -check-prefix=INLINED %s
+
+// Worker processes must not change which functions are reported, or how.
+// Each function is analyzed once, by a worker, and the functions inlined
+// into storeNull are skipped as in a serial run.
+
+// TRACE-DAG: Inline_Regular, in worker): {{.*}}worker-processes.c storeNull{{$}}
+// TRACE-DAG: Inline_Regular, in worker): {{.*}}worker-processes.c checkThenStore{{$}}
+// TRACE-DAG: Inline_Regular, in worker): {{.*}}worker-processes.c divide{{$}}
+// TRACE-DAG: Inline_Regular, in worker): {{.*}}worker-processes.c nothingToReport{{$}}
+
+// ONCE: (Path, {{.*}}worker-processes.c divide{{$}}
+// ONCE-NOT: (Path, {{.*}}worker-processes.c divide{{$}}
+
+// INLINED-NOT: (Path, {{.*}}worker-processes.c store{{$}}
+// INLINED-NOT: (Path, {{.*}}worker-processes.c getNull{{$}}
+
+int *getNull(void) { return 0; }
+
+void store(int *p) {
+  *p = 1; // expected-warning{{Dereference of null pointer}}
+}
+
+void storeNull(void) {
+  store(getNull());
+}
+
+void checkThenStore(int *p) {
+  if (p)
+    return;
+  *p = 2; // expected-warning{{Dereference of null pointer}}
+}
+
+int divide(int x, int y) {
+  if (y == 0)
+    return x / y; // expected-warning{{Division by zero}}
+  return x / y;
+}
+
+int nothingToReport(int x) {
+  return x + 1;
+}
@@ -0,0 +1 @@
+int b = undeclared_b;
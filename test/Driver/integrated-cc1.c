@@ -0,0 +1,36 @@
+// RUN: %clang -fintegrated-cc1 -c %s -o %t.o
+// RUN: not %clang -fintegrated-cc1 -fsyntax-only -DERROR %s 2>&1 \
+// RUN:   | FileCheck --check-prefix=CHECK-ERROR %s
+// RUN: not %clang -fintegrated-cc1 -fsyntax-only -DERROR %s %s 2>&1 \
+// RUN:   | FileCheck --check-prefix=CHECK-ERROR --check-prefix=CHECK-TWICE %s
+// RUN: %clang -fintegrated-cc1 -fno-integrated-cc1 -fsyntax-only -### %s 2>&1 \
+// RUN:   | FileCheck --check-prefix=CHECK-CLAIMED %s
+
+// -cc1 jobs run in the driver's process, unless they set LLVM options.
+// RUN: %clang -fintegrated-cc1 -fsyntax-only -### %s 2>&1 \
+// RUN:   | FileCheck --check-prefix=CHECK-IN-PROCESS %s
+// RUN: %clang -fintegrated-cc1 -fsyntax-only -v %s 2>&1 \
+// RUN:   | FileCheck --check-prefix=CHECK-IN-PROCESS %s
+// RUN: %clang -fintegrated-cc1 -fno-integrated-cc1 -fsyntax-only -### %s 2>&1 \
+// RUN:   | FileCheck --check-prefix=CHECK-NEW-PROCESS %s
+// RUN: %clang -fintegrated-cc1 -fsyntax-only -mllvm -stats -### %s 2>&1 \
+// RUN:   | FileCheck --check-prefix=CHECK-NEW-PROCESS %s
+// RUN: %clang -fintegrated-cc1 -fsyntax-only -ftime-report -### %s 2>&1 \
+// RUN:   | FileCheck --check-prefix=CHECK-NEW-PROCESS %s
+
+int f(void) { return 0; }
+
+#ifdef ERROR
+int g(void) { return undeclared; }
+// CHECK-ERROR: integrated-cc1.c:[[@LINE-1]]:22: error: use of undeclared identifier 'undeclared'
+// CHECK-TWICE: integrated-cc1.c:[[@LINE-2]]:22: error: use of undeclared identifier 'undeclared'
+#endif
+
+// CHECK-CLAIMED-NOT: argument unused
+
+// CHECK-IN-PROCESS: (in-process)
+// CHECK-IN-PROCESS-NEXT: "-cc1"
+
+// CHECK-NEW-PROCESS-NOT: (in-process)
+// CHECK-NEW-PROCESS: "-cc1"
+// CHECK-NEW-PROCESS-NOT: (in-process)
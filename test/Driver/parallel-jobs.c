@@ -0,0 +1,17 @@
+// Check that -fparallel-jobs runs every job and reports diagnostics in job
+// order.
+// RUN: not %clang -fsyntax-only -fparallel-jobs=2 %s %S/Inputs/parallel-jobs-b.c %s 2>&1 \
+// RUN:   | FileCheck %s
+// CHECK: parallel-jobs.c:[[@LINE+4]]:9: error: use of undeclared identifier 'undeclared_a'
+// CHECK-NEXT: int a = undeclared_a;
+// CHECK: parallel-jobs-b.c:1:9: error: use of undeclared identifier 'undeclared_b'
+// CHECK: parallel-jobs.c:[[@LINE+1]]:9: error: use of undeclared identifier 'undeclared_a'
+int a = undeclared_a;
+
+// RUN: %clang -fsyntax-only -fparallel-jobs=0 -### %s 2>&1 \
+// RUN:   | FileCheck --check-prefix=CHECK-CLAIMED %s
+// CHECK-CLAIMED-NOT: argument unused
+
+// RUN: not %clang -fsyntax-only -fparallel-jobs=x %s 2>&1 \
+// RUN:   | FileCheck --check-prefix=CHECK-INVALID %s
+// CHECK-INVALID: invalid integral value 'x' in '-fparallel-jobs=x'
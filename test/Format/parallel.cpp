@@ -0,0 +1,11 @@
+// RUN: clang-format -style=LLVM -j=1 %s > %t.serial.cpp
+// RUN: clang-format -style=LLVM -j=4 %s > %t.parallel.cpp
+// RUN: diff %t.serial.cpp %t.parallel.cpp
+
+int aaaaaaaaaaaaaaaaaaaa = functionCall(bbbbbbbbbbbbbbbbbbbbbbbbbbbbbb, cccccccccccccccccccccccc, dddddddddddddddddddd);
+int bbbbbbbbbbbbbbbbbbbb = functionCall(bbbbbbbbbbbbbbbbbbbbbbbbbbbbbb, cccccccccccccccccccccccc, dddddddddddddddddddd);
+void f() {
+  other(x.begin(), x.end(), [&](int, int) { return aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa(bbbbbbbbbbbbbbbbbbbbbbbbb); });
+  someOtherFunction(aaaaaaaaaaaaaaaaaaaaaaaaa, bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb, cccccccccccccccccccccccccccc);
+}
+int  unchanged   =  0;
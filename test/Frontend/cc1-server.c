@@ -0,0 +1,37 @@
+// REQUIRES: shell
+
+// Without a server listening on the socket, -cc1 runs the job itself.
+// RUN: rm -f %t.sock
+// RUN: env CLANG_CC1_SERVER=%t.sock %clang_cc1 -fsyntax-only -verify %s
+
+// RUN: not %clang -cc1server 2>&1 | FileCheck -check-prefix=NO-SOCKET %s
+// NO-SOCKET: error: no socket given (use -socket <path>)
+
+// RUN: not %clang -cc1server -socket %t.sock -workers x 2>&1 \
+// RUN:   | FileCheck -check-prefix=BAD-WORKERS %s
+// BAD-WORKERS: error: invalid number of workers 'x'
+
+// RUN: not %clang -cc1server -socket %t.sock -- 2>&1 \
+// RUN:   | FileCheck -check-prefix=NO-COMMAND %s
+// NO-COMMAND: error: no command given after '--'
+
+// With a command, the server runs it with CLANG_CC1_SERVER set, shuts down
+// once it exits and exits with its status. Its worker runs the command's
+// jobs, and their diagnostics show up once.
+// RUN: %clang -cc1server -socket %t.sock -workers 1 -v -- \
+// RUN:   %clang_cc1 -fsyntax-only -verify %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=LOG %s
+// RUN: test ! -S %t.sock
+// RUN: not %clang -cc1server -socket %t.sock -workers 1 -v -- \
+// RUN:   %clang_cc1 -fsyntax-only -DERROR %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=SERVED %s
+// RUN: test ! -S %t.sock
+// LOG: cc1server: running job in '{{.*}}': {{.*}}-fsyntax-only -verify
+// SERVED: cc1server: running job in '{{.*}}': {{.*}}-fsyntax-only -DERROR
+// SERVED: cc1-server.c:[[@LINE+3]]:2: error: served job
+// SERVED-NOT: error: served job
+#ifdef ERROR
+#error served job
+#endif
+
+int f(void) { return 0; } // expected-no-diagnostics
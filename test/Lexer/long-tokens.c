@@ -0,0 +1,18 @@
+// RUN: %clang_cc1 -fsyntax-only -Wno-comment -verify %s
+
+// The lexer skips over the characters of identifiers, whitespace, line
+// comments and string literals several bytes at a time. Check runs that are
+// longer than that, and runs interrupted by characters that need attention.
+
+int an_identifier_much_longer_than_sixteen_characters_0123456789_ABCDEFGHIJ = 1;
+int x = an_identifier_much_longer_than_sixteen_characters_0123456789_ABCDEFGHIJ;
+int                                                         y	 	 	 	 	 	 = 2;
+
+int a1[sizeof("a string literal that is longer than sixteen characters") == 56 ? 1 : -1];
+int a2[sizeof("0123456789abcdef\"0123456789abcdef\\0123456789abcdef?") == 52 ? 1 : -1];
+int a3[sizeof("a string literal with an escaped newline after sixteen characters\
+, continued") == 77 ? 1 : -1];
+
+// A line comment that is longer than sixteen characters and continues \
+int hidden;
+int z = hidden; // expected-error {{use of undeclared identifier 'hidden'}}
@@ -0,0 +1 @@
+int conditional(void);
@@ -0,0 +1,4 @@
+@import diamond_left;
+@import diamond_right;
+
+char bottom(char *x);
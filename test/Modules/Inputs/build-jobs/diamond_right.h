@@ -0,0 +1,7 @@
+@import diamond_top;
+
+double right(double *);
+
+struct left_and_right {
+  int left, right;
+};
@@ -0,0 +1,4 @@
+int top(int *);
+
+int top_left(char *c);
+
@@ -0,0 +1,14 @@
+// RUN: rm -rf %t
+// RUN: %clang_cc1 -fmodules -fmodules-cache-path=%t -I %S/Inputs/ModuleDiags -fmodules-build-jobs=2 -fsyntax-only %s 2>&1 | FileCheck %s
+
+// Diagnostics of a module built ahead of time are reported when it is
+// imported, before the diagnostics of the importing file.
+// CHECK: While building module 'HasWarnings' imported from {{.*}}build-jobs-diags.m:11:
+// CHECK: has_warnings.h:3:8: warning: incompatible pointer types initializing 'float *'
+// CHECK: build-jobs-diags.m:14:9: warning: incompatible pointer types initializing 'double *'
+// CHECK: 2 warnings generated.
+
+@import HasWarnings;
+
+float float_val;
+double *double_ptr = &float_val;
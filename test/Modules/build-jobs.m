@@ -0,0 +1,38 @@
+// RUN: rm -rf %t
+// RUN: mkdir -p %t
+// RUN: cp -r %S/Inputs/build-jobs %t/Inputs
+// RUN: %clang_cc1 -fmodules -fmodules-cache-path=%t/cache -I %t/Inputs -fmodules-build-jobs=4 %s -verify -print-stats 2>&1 | FileCheck %s
+// RUN: %clang_cc1 -fmodules -fmodules-cache-path=%t/cache -I %t/Inputs -fmodules-build-jobs=4 %s -verify -print-stats 2>&1 | FileCheck -check-prefix=CACHED %s
+// RUN: touch -t 200001010000 %t/Inputs/diamond_top.h
+// RUN: %clang_cc1 -fmodules -fmodules-cache-path=%t/cache -I %t/Inputs -fmodules-build-jobs=4 %s -verify -print-stats 2>&1 | FileCheck -check-prefix=OUT-OF-DATE %s
+
+// The imports of diamond_bottom are found before it is built, and each
+// module is built once the modules it imports are: diamond_top, then
+// diamond_left and diamond_right, then diamond_bottom. The module of the
+// header included under #if 0 is not built.
+// CHECK: *** Module Cache Stats:
+// CHECK-NEXT: 4 modules built,
+// CHECK: 4 modules built ahead of time, 0 of them out of date.
+
+// CACHED: *** Module Cache Stats:
+// CACHED-NEXT: 0 modules built,
+// CACHED: 0 modules built ahead of time, 0 of them out of date.
+
+// Once diamond_top.h changes, the module files of diamond_top and of the
+// modules that import it are out of date, and rebuilt ahead of time.
+// OUT-OF-DATE: *** Module Cache Stats:
+// OUT-OF-DATE-NEXT: 4 modules built,
+// OUT-OF-DATE: 4 modules built ahead of time, 4 of them out of date.
+
+// expected-no-diagnostics
+#if 0
+#include "conditional.h"
+#endif
+@import diamond_bottom;
+
+void test_diamond(int i, float f, double d, char c) {
+  top(&i);
+  left(&f);
+  right(&d);
+  bottom(&c);
+}
@@ -0,0 +1,50 @@
+// Test the content-addressed store and the size limit of the module cache.
+
+// We need hard links and 'rm' with wildcards for this test to work.
+// REQUIRES: shell
+
+// RUN: rm -rf %t
+// RUN: %clang_cc1 -fmodules -fmodules-cache-path=%t -I %S/Inputs %s -verify -print-stats 2>&1 | FileCheck -check-prefix=BUILD %s
+// BUILD: *** Module Cache Stats:
+// BUILD-NEXT: 4 modules built, 0 shared with an identical module file, 0 module files pruned.
+// BUILD-NEXT: 4 module files (8 links) in the module cache
+
+// Rebuilding a module with the same contents shares the stored module file,
+// so the modules that import it are still up to date.
+// RUN: rm %t/*/diamond_bottom.pcm
+// RUN: %clang_cc1 -fmodules -fmodules-cache-path=%t -I %S/Inputs %s -verify -print-stats 2>&1 | FileCheck -check-prefix=SHARE %s
+// SHARE: *** Module Cache Stats:
+// SHARE-NEXT: 1 modules built, 1 shared with an identical module file, 0 module files pruned.
+// SHARE-NEXT: 4 module files (8 links) in the module cache
+
+// The least recently used module files are pruned once the module cache
+// grows beyond its maximum size, but not the ones this compilation has just
+// built or loaded.
+// RUN: echo '@import irgen;' | %clang_cc1 -fmodules -fmodules-cache-path=%t -I %S/Inputs -x objective-c -fsyntax-only -
+// RUN: touch -t 200001010000 %t/*/irgen.pcm
+// RUN: rm %t/*/diamond_bottom.pcm
+// RUN: %clang_cc1 -fmodules -fmodules-cache-path=%t -I %S/Inputs -fmodules-cache-max-size=1 %s -verify -print-stats 2>&1 | FileCheck -check-prefix=PRUNE %s
+// PRUNE: *** Module Cache Stats:
+// PRUNE-NEXT: 1 modules built, 1 shared with an identical module file, 1 module files pruned.
+// PRUNE-NEXT: 4 module files (8 links) in the module cache
+
+// Options that cannot change the modules, such as the order of -D options or
+// the linker version, select the same module files.
+// RUN: rm -rf %t-hash
+// RUN: %clang_cc1 -fmodules -fmodules-cache-path=%t-hash -I %S/Inputs -DA -DB=1 %s -verify -print-stats 2>&1 | FileCheck -check-prefix=HASH-BUILD %s
+// RUN: %clang_cc1 -fmodules -fmodules-cache-path=%t-hash -I %S/Inputs -DB=1 -DA -target-linker-version 1.0 %s -verify -print-stats 2>&1 | FileCheck -check-prefix=HASH-REUSE %s
+// RUN: %clang_cc1 -fmodules -fmodules-cache-path=%t-hash -I %S/Inputs -DB=1 -DA -UA %s -verify -print-stats 2>&1 | FileCheck -check-prefix=HASH-BUILD %s
+// HASH-BUILD: *** Module Cache Stats:
+// HASH-BUILD-NEXT: 4 modules built
+// HASH-REUSE: *** Module Cache Stats:
+// HASH-REUSE-NEXT: 0 modules built
+
+// expected-no-diagnostics
+@import diamond_bottom;
+
+void test_diamond(int i, float f, double d, char c) {
+  top(&i);
+  left(&f);
+  right(&d);
+  bottom(&c);
+}
@@ -0,0 +1,33 @@
+// Test that identifiers that are not in a precompiled header are looked up
+// through its Bloom filter, without searching its identifier table.
+
+// RUN: %clang_cc1 -emit-pch -o %t1 -DFIRST %s
+// RUN: %clang_cc1 -emit-pch -o %t2 -DSECOND -include-pch %t1 %s
+// RUN: %clang_cc1 -fsyntax-only -verify -include-pch %t2 %s -print-stats 2> %t.stats
+// RUN: FileCheck %s < %t.stats
+// expected-no-diagnostics
+
+#if defined(FIRST)
+
+int first_value;
+#define FIRST_MACRO 1
+
+#elif defined(SECOND)
+
+int second_value;
+int first_and_second(void);
+
+#else
+
+int only_in_main_file;
+
+int use(void) {
+  int another_local = FIRST_MACRO;
+  return first_value + second_value + first_and_second() + another_local +
+         only_in_main_file;
+}
+
+#endif
+
+// CHECK: identifier table lookups succeeded
+// CHECK: {{[1-9][0-9]*}} identifier table lookups skipped by Bloom filters
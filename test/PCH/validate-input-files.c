@@ -0,0 +1,47 @@
+// RUN: rm -rf %t
+// RUN: mkdir -p %t
+// RUN: echo 'int touched(void);' > %t/touched.h
+// RUN: echo 'int changed(void);' > %t/changed.h
+// RUN: touch -m -a -t 201001010000 %t/touched.h %t/changed.h
+// RUN: %clang_cc1 -emit-pch -o %t/nosig.pch %s -I %t
+// RUN: %clang_cc1 -emit-pch -fvalidate-ast-input-files-content -o %t/sig.pch %s -I %t
+
+// A header that was touched, but not changed, only invalidates a PCH without
+// content signatures.
+// RUN: touch -m -a -t 201101010000 %t/touched.h
+// RUN: not %clang_cc1 -fsyntax-only -include-pch %t/nosig.pch %s -I %t 2>&1 | FileCheck -check-prefix=TOUCHED %s
+// RUN: %clang_cc1 -fsyntax-only -include-pch %t/sig.pch %s -I %t -print-stats 2>&1 | FileCheck -check-prefix=SIGNATURE %s
+// TOUCHED: file '{{.*}}touched.h' has been modified since the precompiled header
+// SIGNATURE: 3/3 input files validated
+// SIGNATURE: 1 touched input files matched their content signature
+
+// A header that was changed is diagnosed, even when the input files are
+// validated lazily and nothing in it is used.
+// RUN: echo 'int changed(int);' > %t/changed.h
+// RUN: not %clang_cc1 -fsyntax-only -include-pch %t/sig.pch %s -I %t 2>&1 | FileCheck -check-prefix=CHANGED %s
+// RUN: not %clang_cc1 -fsyntax-only -flazy-pch-input-validation -include-pch %t/sig.pch %s -I %t 2>&1 | FileCheck -check-prefix=CHANGED %s
+// CHANGED: file '{{.*}}changed.h' has been modified since the precompiled header
+
+// Within a build session, the unused input files are only checked by the first
+// translation unit that finds them up to date.
+// RUN: %clang_cc1 -emit-pch -o %t/session.pch %s -I %t
+// RUN: %clang_cc1 -fsyntax-only -flazy-pch-input-validation -fbuild-session-timestamp=1 -include-pch %t/session.pch %s -I %t -print-stats 2>&1 | FileCheck -check-prefix=SESSION-FIRST %s
+// RUN: %clang_cc1 -fsyntax-only -flazy-pch-input-validation -fbuild-session-timestamp=1 -include-pch %t/session.pch %s -I %t -print-stats 2>&1 | FileCheck -check-prefix=SESSION-LATER %s
+// SESSION-FIRST: 3/3 input files validated
+// SESSION-LATER: {{[0-2]}}/3 input files validated
+
+// A new build session checks them again.
+// RUN: echo 'int changed(long);' > %t/changed.h
+// RUN: not %clang_cc1 -fsyntax-only -flazy-pch-input-validation -fbuild-session-timestamp=4102444800 -include-pch %t/session.pch %s -I %t 2>&1 | FileCheck -check-prefix=CHANGED %s
+
+#ifndef HEADER
+#define HEADER
+
+#include "touched.h"
+#include "changed.h"
+
+#else
+
+int main_file;
+
+#endif
@@ -0,0 +1,32 @@
+// Test that precompiled headers written with several threads are the same as
+// those written with one thread.
+
+// RUN: %clang_cc1 -emit-pch -fvalidate-ast-input-files-content -o %t.1 %s
+// RUN: %clang_cc1 -emit-pch -fvalidate-ast-input-files-content -o %t.4 %s \
+// RUN:   -fpch-write-jobs=4
+// RUN: cmp %t.1 %t.4
+// RUN: %clang_cc1 -emit-pch -o %t.0 %s -fpch-write-jobs=0
+// RUN: %clang_cc1 -emit-pch -o %t.serial %s
+// RUN: cmp %t.0 %t.serial
+// RUN: %clang_cc1 -include-pch %t.4 -fsyntax-only -verify %s
+// expected-no-diagnostics
+
+#ifndef HEADER
+#define HEADER
+
+/// A documented declaration, so that the comments block is not empty.
+#define SQUARE(x) ((x) * (x))
+#define CUBE(x) (SQUARE(x) * (x))
+
+#line 100 "renamed.h"
+static inline int cube(int x) { return CUBE(x); }
+
+int values[] = { SQUARE(1), SQUARE(2), CUBE(3) };
+
+#else
+
+int use(void) {
+  return cube(values[0]) + SQUARE(2) + __LINE__;
+}
+
+#endif
@@ -0,0 +1,2 @@
+int next_from_a;
+#include_next <next.h>
@@ -0,0 +1 @@
+int next_from_b;
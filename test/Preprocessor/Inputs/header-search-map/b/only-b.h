@@ -0,0 +1 @@
+int only_b;
@@ -0,0 +1,3 @@
+#pragma once
+#define MORE(x) more_ ## x
+int MORE(tokens) = __LINE__;
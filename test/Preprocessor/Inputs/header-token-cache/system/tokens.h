@@ -0,0 +1,20 @@
+#ifndef TOKENS_H
+#define TOKENS_H
+
+#define STR "a string literal"
+#define CAT(a, b) a ## b
+%:define DIGRAPH <: 1 :>
+
+#if defined(FAIL)
+#error failure from a cached header
+#elif defined(OTHER)
+int other;
+#else
+static const char *tokens_str = STR;
+#endif
+
+int CAT(tokens_, value) = sizeof('c') + sizeof(L"wide") + 0x1p3;
+int tokens_array DIGRAPH;
+
+#include <more.h>
+#endif
@@ -0,0 +1 @@
+int user_tokens;
@@ -0,0 +1,4 @@
+#ifndef SHARED_INCLUDE_GUARD_H
+#define SHARED_INCLUDE_GUARD_H
+int guarded;
+#endif
@@ -0,0 +1,87 @@
+// RUN: %clang_cc1 -E %s | FileCheck -strict-whitespace %s
+// RUN: %clang_cc1 -E -x c++ -std=c++11 -DCXX11 %s | FileCheck -strict-whitespace -check-prefix=CXX11 %s
+// RUN: %clang_cc1 -E -trigraphs -DTRIGRAPHS %s | FileCheck -strict-whitespace -check-prefix=TRIGRAPHS %s
+
+// Excluded blocks are skipped line by line. Check that only a '#' that would
+// start a directive when lexing the block ends it.
+
+#if 0
+x /* A block comment
+#else
+   spanning lines */ #else
+"a string with /* in it"
+int in_if_1;
+#else
+int in_else_1;
+#endif
+
+#if 0
+Don't treat the apostrophe /* as the end of a character literal.
+#else
+int in_else_2;
+#endif
+
+#if 0
+// A line comment with an escaped newline \
+#else
+  int in_if_3 = 1 + \
+#else
+  2;
+  /* comment */ # /* comment */ else
+int in_else_3;
+#endif
+
+#if 0
+int in_if_4;
+%:else
+int in_else_4;
+#endif
+
+#if 0
+#if 1
+int in_if_5;
+#else
+#endif
+#elif 1
+int in_elif_5;
+#endif
+
+#ifdef CXX11
+#if 0
+const char *in_if_6 = R"(
+#elif 1
+int in_if_6b;
+)";
+#else
+int in_else_6;
+#endif
+#endif
+
+#ifdef TRIGRAPHS
+#if 0
+// A line comment with a trigraph escaped newline ??/
+#else
+int in_if_7;
+??=else
+int in_else_7;
+#endif
+#endif
+
+// CHECK-NOT: in_if
+// CHECK: {{^}}int in_else_1;
+// CHECK-NOT: in_if
+// CHECK: {{^}}int in_else_2;
+// CHECK-NOT: in_if
+// CHECK: {{^}}int in_else_3;
+// CHECK-NOT: in_if
+// CHECK: {{^}}int in_else_4;
+// CHECK-NOT: in_if
+// CHECK: {{^}}int in_elif_5;
+// CHECK-NOT: in_
+
+// CXX11-NOT: in_if_6
+// CXX11: {{^}}int in_else_6;
+// CXX11-NOT: in_if_6
+
+// TRIGRAPHS-NOT: in_if_7
+// TRIGRAPHS: {{^}}int in_else_7;
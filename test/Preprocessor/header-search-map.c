@@ -0,0 +1,58 @@
+// RUN: rm -f %t.hmap
+// RUN: %clang_cc1 -E -I %S/Inputs/header-search-map/a -I %S/Inputs/header-search-map/b -fheader-search-map-output=%t.hmap %s | FileCheck %s
+// RUN: %clang_cc1 -E -I %S/Inputs/header-search-map/a -I %S/Inputs/header-search-map/b -fheader-search-map=%t.hmap -print-stats %s 2> %t.stats | FileCheck %s
+// RUN: FileCheck -check-prefix=STATS %s < %t.stats
+
+// A map recorded with a different search path is ignored.
+// RUN: %clang_cc1 -E -I %S/Inputs/header-search-map/b -I %S/Inputs/header-search-map/a -fheader-search-map=%t.hmap %s | FileCheck -check-prefix=REVERSED %s
+
+// A header added to a directory after the map was written is found.
+// RUN: rm -rf %t.dir
+// RUN: mkdir -p %t.dir/a %t.dir/b
+// RUN: echo 'int added_from_b;' > %t.dir/b/added.h
+// RUN: echo '#include <added.h>' > %t.dir/main.c
+// RUN: touch -t 200001010000 %t.dir/a %t.dir/b
+// RUN: %clang_cc1 -E -I %t.dir/a -I %t.dir/b -fheader-search-map-output=%t.dir/map.hmap %t.dir/main.c | FileCheck -check-prefix=BEFORE %s
+// RUN: echo 'int added_from_a;' > %t.dir/a/added.h
+// RUN: %clang_cc1 -E -I %t.dir/a -I %t.dir/b -fheader-search-map=%t.dir/map.hmap %t.dir/main.c | FileCheck -check-prefix=ADDED %s
+
+// So is a header added to an existing subdirectory of a search directory,
+// which leaves the search directory itself unmodified.
+// RUN: rm -rf %t.subdir
+// RUN: mkdir -p %t.subdir/a/sub %t.subdir/b/sub
+// RUN: echo 'int added_from_b;' > %t.subdir/b/sub/added.h
+// RUN: echo '#include <sub/added.h>' > %t.subdir/main.c
+// RUN: touch -t 200001010000 %t.subdir/a %t.subdir/a/sub %t.subdir/b %t.subdir/b/sub
+// RUN: %clang_cc1 -E -I %t.subdir/a -I %t.subdir/b -fheader-search-map-output=%t.subdir/map.hmap %t.subdir/main.c | FileCheck -check-prefix=BEFORE %s
+// RUN: %clang_cc1 -E -I %t.subdir/a -I %t.subdir/b -fheader-search-map=%t.subdir/map.hmap -print-stats %t.subdir/main.c -o %t.subdir/main.i 2>&1 | FileCheck -check-prefix=SUBDIR-HIT %s
+// RUN: FileCheck -check-prefix=BEFORE %s < %t.subdir/main.i
+// RUN: echo 'int added_from_a;' > %t.subdir/a/sub/added.h
+// RUN: %clang_cc1 -E -I %t.subdir/a -I %t.subdir/b -fheader-search-map=%t.subdir/map.hmap %t.subdir/main.c | FileCheck -check-prefix=ADDED %s
+
+// The map is a dependency, unless this compilation rewrites it.
+// RUN: %clang_cc1 -E -I %S/Inputs/header-search-map/a -I %S/Inputs/header-search-map/b -fheader-search-map=%t.hmap -dependency-file %t.d -MT out %s > /dev/null
+// RUN: FileCheck -check-prefix=DEPS %s < %t.d
+// RUN: %clang_cc1 -E -I %S/Inputs/header-search-map/a -I %S/Inputs/header-search-map/b -fheader-search-map=%t.hmap -fheader-search-map-output=%t.hmap -dependency-file %t.d -MT out %s > /dev/null
+// RUN: FileCheck -check-prefix=NODEPS %s < %t.d
+
+#include <only-b.h>
+#include "both.h"
+#include <next.h>
+
+// CHECK: int only_b;
+// CHECK: int both_from_a;
+// CHECK: int next_from_a;
+// CHECK: int next_from_b;
+
+// STATS: 3 lookups answered by the search map.
+
+// REVERSED: int only_b;
+// REVERSED: int both_from_b;
+// REVERSED: int next_from_b;
+
+// BEFORE: int added_from_b;
+// ADDED: int added_from_a;
+// SUBDIR-HIT: 1 lookups answered by the search map.
+
+// DEPS: header-search-map.c.tmp.hmap
+// NODEPS-NOT: .hmap
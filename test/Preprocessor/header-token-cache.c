@@ -0,0 +1,46 @@
+// RUN: rm -rf %t
+// RUN: %clang_cc1 -E -isystem %S/Inputs/header-token-cache/system %s -o %t.lexed
+// RUN: %clang_cc1 -E -isystem %S/Inputs/header-token-cache/system -header-token-cache %t/cache -print-stats %s -o %t.written 2> %t.stats
+// RUN: FileCheck -check-prefix=WRITTEN %s < %t.stats
+// RUN: ls %t/cache | count 2
+// RUN: %clang_cc1 -E -isystem %S/Inputs/header-token-cache/system -header-token-cache %t/cache -print-stats %s -o %t.cached 2> %t.stats
+// RUN: FileCheck -check-prefix=CACHED %s < %t.stats
+// RUN: diff %t.lexed %t.written
+// RUN: diff %t.lexed %t.cached
+// RUN: FileCheck %s < %t.cached
+
+// Cached headers still see the macros of the translation unit.
+// RUN: %clang_cc1 -E -isystem %S/Inputs/header-token-cache/system -header-token-cache %t/cache -DOTHER %s | FileCheck -check-prefix=OTHER %s
+// RUN: not %clang_cc1 -fsyntax-only -isystem %S/Inputs/header-token-cache/system -header-token-cache %t/cache -DFAIL %s 2>&1 | FileCheck -check-prefix=FAIL %s
+
+// Entries are only used for headers with the same contents and language
+// options, but are shared across warning options.
+// RUN: %clang_cc1 -E -isystem %S/Inputs/header-token-cache/system -header-token-cache %t/cache -std=c99 -print-stats %s -o /dev/null 2> %t.stats
+// RUN: FileCheck -check-prefix=WRITTEN %s < %t.stats
+// RUN: %clang_cc1 -E -isystem %S/Inputs/header-token-cache/system -header-token-cache %t/cache -Wall -print-stats %s -o /dev/null 2> %t.stats
+// RUN: FileCheck -check-prefix=CACHED %s < %t.stats
+
+// With -Wsystem-headers, the lexer's warnings in system headers matter, so
+// the cache is not used at all.
+// RUN: %clang_cc1 -E -isystem %S/Inputs/header-token-cache/system -header-token-cache %t/cache -Wsystem-headers -print-stats %s -o /dev/null 2> %t.stats
+// RUN: FileCheck -check-prefix=UNUSED %s < %t.stats
+
+#include <tokens.h>
+#include <more.h>
+#include "Inputs/header-token-cache/user.h"
+
+int main_tokens = MORE(main);
+
+// CHECK: static const char *tokens_str = "a string literal";
+// CHECK: int tokens_value = sizeof('c') + sizeof(L"wide") + 0x1p3;
+// CHECK: int tokens_array <: 1 :>;
+// CHECK: int more_tokens = 3;
+// CHECK: int user_tokens;
+// CHECK: int main_tokens = more_main;
+
+// WRITTEN: 0/2 headers read from the token cache, 2 missing.
+// CACHED: 2/2 headers read from the token cache, 0 missing.
+// UNUSED: 0/0 headers read from the token cache, 0 missing.
+
+// OTHER: int other;
+// FAIL: tokens.h:9:2: error: failure from a cached header
@@ -0,0 +1,67 @@
+// RUN: %clang_cc1 -E %s -o %t.expanded
+// RUN: %clang_cc1 -E -fmemoize-macro-expansions %s -o %t.memoized
+// RUN: diff %t.expanded %t.memoized
+// RUN: FileCheck %s < %t.memoized
+// RUN: %clang_cc1 -fsyntax-only -verify -fmemoize-macro-expansions -fmacro-backtrace-limit 0 -print-stats %s 2> %t.stats
+// RUN: FileCheck -check-prefix=STATS %s < %t.stats
+
+// Expansions that go through nested macros are not memoized while macro
+// backtraces are shown, so the backtraces are the same.
+// RUN: not %clang_cc1 -fsyntax-only %s 2> %t.diags
+// RUN: not %clang_cc1 -fsyntax-only -fmemoize-macro-expansions %s 2> %t.memoized-diags
+// RUN: diff %t.diags %t.memoized-diags
+// RUN: FileCheck -check-prefix=BACKTRACE %s < %t.memoized-diags
+
+int counter;
+
+#define ID(x) x
+#define STR(x) #x
+#define CAT(a, b) a ## b
+#define NULLPTR ((void *)0)
+#define EXPECT(cond) do { if (!(cond)) fail(STR(cond), CAT(li, ne)); } while (0)
+#define CHECK(cond) do { if (!(cond)) fail(STR(cond), ID(__LINE__)); } while (0)
+#define CALL f
+#define f(x) x + 1
+#define PAIR(a, b) a + b
+#define OPEN PAIR(1,
+#define DEREF(x) ID(*x)
+
+void fail(const char *msg, int line);
+int line;
+
+void test(int *p, int n) {
+  EXPECT(p != NULLPTR);
+  EXPECT(p != NULLPTR);
+  EXPECT(n > 0);
+  CHECK(n > 0);
+  CHECK(n > 0);
+  n = CALL(n);
+  n = CALL(n);
+  n = OPEN 2);
+  n = DEREF(n); // expected-error {{indirection requires pointer operand ('int' invalid)}}
+  n = DEREF(n); // expected-error {{indirection requires pointer operand ('int' invalid)}}
+}
+
+// CHECK: do { if (!(p != ((void *)0))) fail("p != NULLPTR", line); } while (0);
+// CHECK: do { if (!(p != ((void *)0))) fail("p != NULLPTR", line); } while (0);
+// CHECK: do { if (!(n > 0)) fail("n > 0", 29); } while (0);
+// CHECK: do { if (!(n > 0)) fail("n > 0", 30); } while (0);
+// CHECK: n = n + 1;
+// CHECK: n = n + 1;
+// CHECK: n = 1 + 2;
+
+// Defining a macro invalidates the memoized expansions.
+#define counter (counter + 1)
+
+int a = counter;
+int b = counter;
+
+// CHECK: int a = (counter + 1);
+// CHECK: int b = (counter + 1);
+
+// BACKTRACE: error: indirection requires pointer operand
+// BACKTRACE: note: expanded from macro
+// BACKTRACE: error: indirection requires pointer operand
+// BACKTRACE: note: expanded from macro
+
+// STATS: 4/12 memoized macro expansions replayed, 3 not memoizable, 1 invalidations.
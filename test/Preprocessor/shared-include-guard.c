@@ -0,0 +1,34 @@
+// REQUIRES: shell
+
+// Test that a guarded header is skipped without being lexed when a job run by
+// the same cc1 server worker has already learned its guard, that -MD output
+// still lists it, and that the header is not skipped when -H or -E need to
+// see every header entered.
+
+// RUN: rm -f %t.sock %t.d %t.i
+// RUN: %clang -cc1server -socket %t.sock -workers 1 -- sh -c ' \
+// RUN:   %clang_cc1 -fsyntax-only -I %S/Inputs %s -print-stats && \
+// RUN:   %clang_cc1 -fsyntax-only -I %S/Inputs %s -DSHARED_INCLUDE_GUARD_H \
+// RUN:     -dependency-file %t.d -MT %s.o -print-stats && \
+// RUN:   %clang_cc1 -fsyntax-only -I %S/Inputs %s -DSHARED_INCLUDE_GUARD_H \
+// RUN:     -H -print-stats && \
+// RUN:   %clang_cc1 -E -I %S/Inputs %s -DSHARED_INCLUDE_GUARD_H -o %t.i' 2>&1 \
+// RUN:   | FileCheck %s
+// RUN: FileCheck -check-prefix=DEPS %s < %t.d
+// RUN: FileCheck -check-prefix=LINE-MARKERS %s < %t.i
+
+// CHECK: 1 skipped, 0 due to include guards from earlier translation units.
+// CHECK: 2 skipped, 1 due to include guards from earlier translation units.
+// CHECK: . {{.*}}shared-include-guard.h
+// CHECK: 1 skipped, 0 due to include guards from earlier translation units.
+// DEPS: shared-include-guard.c.o:
+// DEPS: shared-include-guard.c
+// DEPS: Inputs{{/|\\}}shared-include-guard.h
+// LINE-MARKERS: # 1 "{{.*}}shared-include-guard.h" 1
+
+#include "shared-include-guard.h"
+#include "shared-include-guard.h"
+
+#ifndef SHARED_INCLUDE_GUARD_H
+#error guard macro not defined
+#endif
@@ -0,0 +1,22 @@
+// Verifies that -j processes every file, resolves paths relative to the
+// directory in the compilation database and prints diagnostics in the order of
+// the files on the command line.
+// RUN: rm -rf %t
+// RUN: mkdir %t
+// RUN: echo "[{\"directory\":\"%t\",\"command\":\"clang -c a.cpp -I.\",\"file\":\"%t/a.cpp\"},{\"directory\":\"%t\",\"command\":\"clang -c b.cpp -I.\",\"file\":\"%t/b.cpp\"},{\"directory\":\"%t\",\"command\":\"clang -c c.cpp -I.\",\"file\":\"%t/c.cpp\"}]" | sed -e 's/\\/\//g' > %t/compile_commands.json
+// RUN: cp "%s" "%t/a.cpp"
+// RUN: echo '#include "clang-check-test.h"' > %t/b.cpp
+// RUN: echo 'invalid_b;' >> %t/b.cpp
+// RUN: cp "%s" "%t/c.cpp"
+// RUN: touch "%t/clang-check-test.h"
+// RUN: not clang-check -j 3 -p "%t" "%t/a.cpp" "%t/b.cpp" "%t/c.cpp" 2>&1|FileCheck %s
+
+#include "clang-check-test.h"
+
+// CHECK: a.cpp:{{[0-9]+}}:1: error: C++ requires
+// CHECK: Error while processing {{.*}}a.cpp.
+// CHECK: b.cpp:2:1: error: C++ requires
+// CHECK: Error while processing {{.*}}b.cpp.
+// CHECK: c.cpp:{{[0-9]+}}:1: error: C++ requires
+// CHECK: Error while processing {{.*}}c.cpp.
+invalid;
@@ -79,6 +79,10 @@ static cl::list<std::string> ArgsAfter("extra-arg",
     cl::desc("Additional argument to append to the compiler command line"));
 static cl::list<std::string> ArgsBefore("extra-arg-before",
     cl::desc("Additional argument to prepend to the compiler command line"));
+static cl::opt<unsigned> NumThreads("j",
+    cl::desc("Number of translation units to process concurrently "
+             "(0 means one per hardware thread)"),
+    cl::init(1));
 
 namespace {
 
@@ -190,6 +194,7 @@ int main(int argc, const char **argv) {
   CommonOptionsParser OptionsParser(argc, argv);
   ClangTool Tool(OptionsParser.getCompilations(),
                  OptionsParser.getSourcePathList());
+  Tool.setNumThreads(NumThreads);
 
   // Clear adjusters because -fsyntax-only is inserted by the default chain.
   Tool.clearArgumentsAdjusters();
@@ -91,6 +91,13 @@ static cl::opt<unsigned>
                     "clang-format from an editor integration"),
            cl::init(0), cl::cat(ClangFormatCategory));
 
+static cl::opt<unsigned>
+    NumThreads("j",
+               cl::desc("The number of threads used to break lines that do\n"
+                        "not fit into the column limit. 0 uses one per\n"
+                        "hardware thread. Defaults to 1."),
+               cl::init(1), cl::cat(ClangFormatCategory));
+
 static cl::list<std::string> FileNames(cl::Positional, cl::desc("[<file> ...]"),
                                        cl::cat(ClangFormatCategory));
 
@@ -250,7 +257,8 @@ static bool format(std::string FileName) {
   FormatStyle FormatStyle = getStyle(Style, FileName);
   Lexer Lex(ID, Sources.getBuffer(ID), Sources,
             getFormattingLangOpts(FormatStyle.Standard));
-  tooling::Replacements Replaces = reformat(FormatStyle, Lex, Sources, Ranges);
+  tooling::Replacements Replaces = reformat(FormatStyle, Lex, Sources, Ranges,
+                                            NumThreads);
   if (OutputXML) {
     llvm::outs()
         << "<?xml version='1.0'?>\n<replacements xml:space='preserve'>\n";
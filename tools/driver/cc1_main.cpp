@@ -56,8 +56,11 @@ static void LLVMErrorHandler(void *UserData, const std::string &Message,
   exit(GenCrashDiag ? 70 : 1);
 }
 
-int cc1_main(const char **ArgBegin, const char **ArgEnd,
-             const char *Argv0, void *MainAddr) {
+/// \brief Runs a -cc1 job. If \p InProcess, the process goes on to run
+/// other jobs, so the job frees its memory and leaves LLVM's global state
+/// alone, whether or not it was given -disable-free.
+static int ExecuteCC1(const char **ArgBegin, const char **ArgEnd,
+                      const char *Argv0, void *MainAddr, bool InProcess) {
   OwningPtr<CompilerInstance> Clang(new CompilerInstance());
   IntrusiveRefCntPtr<DiagnosticIDs> DiagID(new DiagnosticIDs());
 
@@ -82,6 +85,11 @@ int cc1_main(const char **ArgBegin, const char **ArgEnd,
     Clang->getHeaderSearchOpts().ResourceDir =
       CompilerInvocation::GetResourcesPath(Argv0, MainAddr);
 
+  if (InProcess) {
+    Clang->getFrontendOpts().DisableFree = false;
+    Clang->getCodeGenOpts().DisableFree = false;
+  }
+
   // Create the actual diagnostics engine.
   Clang->createDiagnostics();
   if (!Clang->hasDiagnostics())
@@ -116,9 +124,26 @@ int cc1_main(const char **ArgBegin, const char **ArgEnd,
     return !Success;
   }
 
+  // Later jobs in this process still need LLVM's global state.
+  if (InProcess) {
+    if (llvm::AreStatisticsEnabled() || Clang->getFrontendOpts().ShowStats)
+      llvm::PrintStatistics();
+    return !Success;
+  }
+
   // Managed static deconstruction. Useful for making things like
   // -time-passes usable.
   llvm::llvm_shutdown();
 
   return !Success;
 }
+
+int cc1_main(const char **ArgBegin, const char **ArgEnd,
+             const char *Argv0, void *MainAddr) {
+  return ExecuteCC1(ArgBegin, ArgEnd, Argv0, MainAddr, /*InProcess=*/false);
+}
+
+int cc1_main_in_process(const char **ArgBegin, const char **ArgEnd,
+                        const char *Argv0, void *MainAddr) {
+  return ExecuteCC1(ArgBegin, ArgEnd, Argv0, MainAddr, /*InProcess=*/true);
+}
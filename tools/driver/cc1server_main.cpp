@@ -0,0 +1,822 @@
+//===-- cc1server_main.cpp - Clang CC1 Compile Server ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This is the entry point to clang -cc1server, a long-lived process that runs
+// -cc1 jobs on behalf of other clang processes, along with the client side of
+// its protocol.
+//
+// A "clang -cc1" process started with CLANG_CC1_SERVER set to the path of a
+// server's socket connects to the server and sends it its working directory,
+// its executable path, its environment and its arguments, together with its
+// standard input and two unlinked temporary files. A server worker runs the
+// job in that directory and environment, with those descriptors installed as
+// its standard streams, and replies with the job's exit code, at which point
+// the client copies the job's output to its own stdout and stderr. If there is
+// no server, the server declines the job, or the worker dies before replying,
+// the client discards any partial output and runs the job itself.
+//
+// Each worker keeps a SharedFileSystemCache across jobs, so the contents of
+// headers, PCH files and module files that are unchanged on disk are only
+// read once, guarded headers whose guard macro is already defined are not
+// read at all, and jobs skip the cost of starting a new process.
+//
+// "clang -cc1server ... -- <command>" runs <command> with CLANG_CC1_SERVER
+// pointing at the server, and shuts the server down once it exits.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/FileManager.h"
+#include "clang/Basic/FileSystemStatCache.h"
+#include "clang/Basic/Parallel.h"
+#include "clang/Driver/Util.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/FrontendDiagnostic.h"
+#include "clang/Frontend/TextDiagnosticBuffer.h"
+#include "clang/FrontendTool/Utils.h"
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Config/config.h"
+#include "llvm/Support/DataTypes.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef LLVM_ON_UNIX
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <crt_externs.h>
+#define environ (*_NSGetEnviron())
+#else
+extern char **environ;
+#endif
+#endif
+
+using namespace clang;
+
+#ifdef LLVM_ON_UNIX
+
+//===----------------------------------------------------------------------===//
+// Protocol
+//===----------------------------------------------------------------------===//
+
+// A request is a 32-bit count followed by that many strings, each a 32-bit
+// length followed by its bytes: the client's working directory, its
+// executable path, its environment and its -cc1 arguments. The environment is
+// a single string holding each NAME=VALUE entry followed by a null byte. The
+// descriptors the job should use as its stdin, stdout and stderr are passed
+// along with the count. The reply is two 32-bit words: a ReplyKind and, for
+// finished jobs, the job's exit code. Client and server run on the same
+// machine, so words are in native byte order.
+
+namespace {
+enum ReplyKind {
+  Reply_Finished = 0,
+  Reply_Declined = 1
+};
+}
+
+static const unsigned NumPassedFDs = 3;
+
+/// \brief The exit code of a worker that can no longer accept connections,
+/// telling the server not to replace it.
+static const int WorkerListenFailure = 3;
+
+/// \brief The exit code of a worker that went without a job for longer than
+/// the server's idle timeout.
+static const int WorkerIdle = 4;
+
+/// \brief Once the cached file contents of a worker exceed this many bytes,
+/// the worker starts over with an empty cache.
+static const uint64_t MaxBytesRetained = 1ULL << 30;
+
+static bool writeAll(int FD, const char *Data, size_t Size) {
+  while (Size) {
+    ssize_t N = ::write(FD, Data, Size);
+    if (N < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    Data += N;
+    Size -= N;
+  }
+  return true;
+}
+
+static bool readAll(int FD, char *Data, size_t Size) {
+  while (Size) {
+    ssize_t N = ::read(FD, Data, Size);
+    if (N < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    if (N == 0)
+      return false;
+    Data += N;
+    Size -= N;
+  }
+  return true;
+}
+
+static void appendWord(std::string &Buffer, uint32_t Word) {
+  Buffer.append(reinterpret_cast<const char *>(&Word), sizeof(Word));
+}
+
+static void appendString(std::string &Buffer, StringRef Str) {
+  appendWord(Buffer, Str.size());
+  Buffer.append(Str.begin(), Str.end());
+}
+
+static bool sendReply(int Conn, ReplyKind Kind, int Result) {
+  int32_t Reply[2] = { Kind, Result };
+  return writeAll(Conn, reinterpret_cast<const char *>(Reply), sizeof(Reply));
+}
+
+namespace {
+/// \brief Suitably aligned storage for a message carrying our descriptors.
+union FDControlBuffer {
+  struct cmsghdr Header;
+  char Buffer[CMSG_SPACE(sizeof(int) * NumPassedFDs)];
+};
+}
+
+/// \brief Sends \p Request, passing \p FDs along with its leading count
+/// word.
+static bool sendRequest(int Sock, const std::string &Request,
+                        const int (&FDs)[NumPassedFDs]) {
+  FDControlBuffer Control;
+  std::memset(&Control, 0, sizeof(Control));
+
+  struct iovec IOV;
+  IOV.iov_base = const_cast<char *>(Request.data());
+  IOV.iov_len = sizeof(uint32_t);
+
+  struct msghdr Msg;
+  std::memset(&Msg, 0, sizeof(Msg));
+  Msg.msg_iov = &IOV;
+  Msg.msg_iovlen = 1;
+  Msg.msg_control = Control.Buffer;
+  Msg.msg_controllen = sizeof(Control.Buffer);
+
+  struct cmsghdr *C = CMSG_FIRSTHDR(&Msg);
+  C->cmsg_level = SOL_SOCKET;
+  C->cmsg_type = SCM_RIGHTS;
+  C->cmsg_len = CMSG_LEN(sizeof(FDs));
+  std::memcpy(CMSG_DATA(C), FDs, sizeof(FDs));
+
+  ssize_t N;
+  do
+    N = ::sendmsg(Sock, &Msg, 0);
+  while (N < 0 && errno == EINTR);
+  if (N != (ssize_t)sizeof(uint32_t))
+    return false;
+
+  return writeAll(Sock, Request.data() + sizeof(uint32_t),
+                  Request.size() - sizeof(uint32_t));
+}
+
+static void closeFDs(int (&FDs)[NumPassedFDs]) {
+  for (unsigned I = 0; I != NumPassedFDs; ++I)
+    ::close(FDs[I]);
+}
+
+/// \brief Copies everything written to the file open as \p From to \p To.
+static bool copyOutput(int From, int To) {
+  if (::lseek(From, 0, SEEK_SET) != 0)
+    return false;
+  char Buffer[8192];
+  while (true) {
+    ssize_t N = ::read(From, Buffer, sizeof(Buffer));
+    if (N < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    if (N == 0)
+      return true;
+    if (!writeAll(To, Buffer, N))
+      return false;
+  }
+}
+
+/// \brief Reads a request and the descriptors passed with it from \p Conn.
+///
+/// On success, the caller is responsible for closing \p FDs.
+static bool receiveRequest(int Conn, int (&FDs)[NumPassedFDs],
+                           std::vector<std::string> &Strings) {
+  uint32_t NumStrings;
+  FDControlBuffer Control;
+
+  struct iovec IOV;
+  IOV.iov_base = &NumStrings;
+  IOV.iov_len = sizeof(NumStrings);
+
+  struct msghdr Msg;
+  std::memset(&Msg, 0, sizeof(Msg));
+  Msg.msg_iov = &IOV;
+  Msg.msg_iovlen = 1;
+  Msg.msg_control = Control.Buffer;
+  Msg.msg_controllen = sizeof(Control.Buffer);
+
+  ssize_t N;
+  do
+    N = ::recvmsg(Conn, &Msg, 0);
+  while (N < 0 && errno == EINTR);
+  if (N <= 0)
+    return false;
+
+  bool HaveFDs = false;
+  for (struct cmsghdr *C = CMSG_FIRSTHDR(&Msg); C; C = CMSG_NXTHDR(&Msg, C)) {
+    if (C->cmsg_level == SOL_SOCKET && C->cmsg_type == SCM_RIGHTS &&
+        C->cmsg_len == CMSG_LEN(sizeof(FDs))) {
+      std::memcpy(FDs, CMSG_DATA(C), sizeof(FDs));
+      HaveFDs = true;
+    }
+  }
+  if (!HaveFDs)
+    return false;
+
+  bool Success = (size_t)N == sizeof(NumStrings) ||
+                 readAll(Conn, reinterpret_cast<char *>(&NumStrings) + N,
+                         sizeof(NumStrings) - N);
+  for (uint32_t I = 0; Success && I != NumStrings; ++I) {
+    uint32_t Length;
+    Success = readAll(Conn, reinterpret_cast<char *>(&Length), sizeof(Length));
+    if (!Success)
+      break;
+    Strings.push_back(std::string(Length, '\0'));
+    if (Length)
+      Success = readAll(Conn, &Strings.back()[0], Length);
+  }
+
+  if (!Success)
+    closeFDs(FDs);
+  return Success;
+}
+
+static bool setSocketAddress(struct sockaddr_un &Addr, const char *Path) {
+  if (std::strlen(Path) >= sizeof(Addr.sun_path))
+    return false;
+  std::memset(&Addr, 0, sizeof(Addr));
+  Addr.sun_family = AF_UNIX;
+  std::strcpy(Addr.sun_path, Path);
+  return true;
+}
+
+/// \brief Returns a socket connected to the server at \p Path, or -1.
+static int connectToServer(const char *Path) {
+  struct sockaddr_un Addr;
+  if (!setSocketAddress(Addr, Path))
+    return -1;
+  int Sock = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (Sock < 0)
+    return -1;
+  if (::connect(Sock, reinterpret_cast<struct sockaddr *>(&Addr),
+                sizeof(Addr)) != 0) {
+    ::close(Sock);
+    return -1;
+  }
+  return Sock;
+}
+
+//===----------------------------------------------------------------------===//
+// Server workers
+//===----------------------------------------------------------------------===//
+
+namespace {
+struct FatalErrorInfo {
+  DiagnosticsEngine *Diags;
+  int Conn;
+};
+}
+
+static void LLVMErrorHandler(void *UserData, const std::string &Message,
+                             bool GenCrashDiag) {
+  FatalErrorInfo &Info = *static_cast<FatalErrorInfo *>(UserData);
+
+  Info.Diags->Report(diag::err_fe_error_backend) << Message;
+
+  // Run the interrupt handlers to make sure any special cleanups get done, in
+  // particular that we remove files registered with RemoveFileOnSignal.
+  llvm::sys::RunInterruptHandlers();
+
+  // The worker cannot recover from llvm errors. Report the exit status cc1
+  // would have had, then let the server replace this worker.
+  llvm::outs().flush();
+  sendReply(Info.Conn, Reply_Finished, GenCrashDiag ? 70 : 1);
+  ::_exit(1);
+}
+
+/// \brief Runs a single -cc1 job, like cc1_main, but without leaking memory
+/// or tearing down global state, and reading files through \p Cache.
+static int ExecuteJob(const char **ArgBegin, const char **ArgEnd,
+                      const char *Argv0, void *MainAddr,
+                      SharedFileSystemCache &Cache, int Conn) {
+  OwningPtr<CompilerInstance> Clang(new CompilerInstance());
+  IntrusiveRefCntPtr<DiagnosticIDs> DiagID(new DiagnosticIDs());
+
+  // Buffer diagnostics from argument parsing so that we can output them using a
+  // well formed diagnostic object.
+  IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts = new DiagnosticOptions();
+  TextDiagnosticBuffer *DiagsBuffer = new TextDiagnosticBuffer;
+  DiagnosticsEngine Diags(DiagID, &*DiagOpts, DiagsBuffer);
+  bool Success;
+  Success = CompilerInvocation::CreateFromArgs(Clang->getInvocation(),
+                                               ArgBegin, ArgEnd, Diags);
+
+  // Infer the builtin include path if unspecified.
+  if (Clang->getHeaderSearchOpts().UseBuiltinIncludes &&
+      Clang->getHeaderSearchOpts().ResourceDir.empty())
+    Clang->getHeaderSearchOpts().ResourceDir =
+      CompilerInvocation::GetResourcesPath(Argv0, MainAddr);
+
+  // The worker outlives the job, so the job has to clean up after itself.
+  Clang->getFrontendOpts().DisableFree = false;
+  Clang->getCodeGenOpts().DisableFree = false;
+
+  // Create the actual diagnostics engine.
+  Clang->createDiagnostics();
+  if (!Clang->hasDiagnostics())
+    return 1;
+
+  FatalErrorInfo Info = { &Clang->getDiagnostics(), Conn };
+  llvm::install_fatal_error_handler(LLVMErrorHandler, &Info);
+
+  DiagsBuffer->FlushDiagnostics(Clang->getDiagnostics());
+  if (Success) {
+    Clang->createFileManager();
+    Clang->getFileManager().setSharedCache(&Cache);
+
+    // Execute the frontend actions.
+    Success = ExecuteCompilerInvocation(Clang.get());
+  }
+
+  llvm::TimerGroup::printAll(llvm::errs());
+  llvm::remove_fatal_error_handler();
+  return !Success;
+}
+
+/// \brief Serves a single connection.
+static void ServeConnection(int Conn, StringRef Executable, const char *Argv0,
+                            void *MainAddr, SharedFileSystemCache &Cache,
+                            bool Verbose) {
+  int FDs[NumPassedFDs];
+  std::vector<std::string> Strings;
+  if (!receiveRequest(Conn, FDs, Strings))
+    return;
+
+  std::vector<const char *> Args;
+  for (unsigned I = 3, E = Strings.size(); I < E; ++I)
+    Args.push_back(Strings[I].c_str());
+
+  // Only run jobs for the same compiler, and leave jobs that set LLVM
+  // options to the client: those options cannot be reset between jobs.
+  bool Accept = Strings.size() >= 3 && Strings[1] == Executable &&
+                !driver::CC1ArgsSetLLVMOptions(Args) &&
+                ::chdir(Strings[0].c_str()) == 0;
+  if (!Accept) {
+    closeFDs(FDs);
+    sendReply(Conn, Reply_Declined, 0);
+    return;
+  }
+
+  // The job sees the client's environment rather than the server's.
+  std::vector<char *> Environment;
+  std::string &EnvironmentEntries = Strings[2];
+  for (size_t Start = 0, End; Start < EnvironmentEntries.size();
+       Start = End + 1) {
+    End = EnvironmentEntries.find('\0', Start);
+    if (End == std::string::npos)
+      break;
+    Environment.push_back(&EnvironmentEntries[Start]);
+  }
+  Environment.push_back(0);
+  char **SavedEnvironment = environ;
+  environ = &Environment[0];
+
+  if (Verbose) {
+    llvm::errs() << "cc1server: running job in '" << Strings[0] << "':";
+    for (unsigned I = 0, E = Args.size(); I != E; ++I)
+      llvm::errs() << ' ' << Args[I];
+    llvm::errs() << '\n';
+  }
+
+  // Install the job's standard streams for the duration of the job.
+  int SavedFDs[NumPassedFDs];
+  for (unsigned I = 0; I != NumPassedFDs; ++I) {
+    SavedFDs[I] = ::dup(I);
+    ::dup2(FDs[I], I);
+  }
+  closeFDs(FDs);
+
+  int Result = ExecuteJob(Args.empty() ? 0 : &Args[0],
+                          Args.empty() ? 0 : &Args[0] + Args.size(), Argv0,
+                          MainAddr, Cache, Conn);
+  environ = SavedEnvironment;
+
+  llvm::outs().flush();
+  llvm::errs().flush();
+  std::fflush(stdout);
+  std::fflush(stderr);
+  // A client that stopped reading its output should not affect later jobs.
+  llvm::outs().clear_error();
+  llvm::errs().clear_error();
+
+  for (unsigned I = 0; I != NumPassedFDs; ++I) {
+    ::dup2(SavedFDs[I], I);
+    ::close(SavedFDs[I]);
+  }
+
+  sendReply(Conn, Reply_Finished, Result);
+}
+
+namespace {
+struct WorkerOptions {
+  /// \brief How long, in seconds, a worker waits for a job before exiting, or
+  /// zero to wait forever.
+  unsigned IdleTimeout;
+
+  /// \brief Whether workers log the jobs they run to the server's stderr.
+  bool Verbose;
+};
+}
+
+/// \brief Accepts and serves connections on \p Listen, one at a time.
+///
+/// \p Listen is non-blocking, so that a worker that loses the race for a
+/// connection to another worker goes back to waiting for the next one.
+static int RunWorker(int Listen, const char *Argv0, void *MainAddr,
+                     const WorkerOptions &Opts) {
+  std::string Executable = llvm::sys::fs::getMainExecutable(Argv0, MainAddr);
+  IntrusiveRefCntPtr<SharedFileSystemCache> Cache(new SharedFileSystemCache());
+
+  while (true) {
+    struct pollfd PollFD;
+    PollFD.fd = Listen;
+    PollFD.events = POLLIN;
+    PollFD.revents = 0;
+    int Ready = ::poll(&PollFD, 1, Opts.IdleTimeout ? Opts.IdleTimeout * 1000
+                                                    : -1);
+    if (Ready == 0)
+      return WorkerIdle;
+    if (Ready < 0) {
+      if (errno == EINTR)
+        continue;
+      return WorkerListenFailure;
+    }
+
+    int Conn = ::accept(Listen, 0, 0);
+    if (Conn < 0) {
+      if (errno == EINTR || errno == ECONNABORTED || errno == EAGAIN ||
+          errno == EWOULDBLOCK)
+        continue;
+      return WorkerListenFailure;
+    }
+    // Some systems let accepted sockets inherit O_NONBLOCK.
+    ::fcntl(Conn, F_SETFL, ::fcntl(Conn, F_GETFL) & ~O_NONBLOCK);
+
+    // Files may have changed since the previous job; only file contents that
+    // still match a fresh stat are reused.
+    Cache->invalidateStats();
+    if (Cache->getNumBytesRetained() > MaxBytesRetained)
+      Cache->clear();
+
+    ServeConnection(Conn, Executable, Argv0, MainAddr, *Cache, Opts.Verbose);
+    ::close(Conn);
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Server process
+//===----------------------------------------------------------------------===//
+
+static volatile sig_atomic_t ShutdownRequested = 0;
+
+static void HandleShutdownSignal(int) {
+  ShutdownRequested = 1;
+}
+
+static void setSignalHandler(int Signal, void (*Handler)(int)) {
+  struct sigaction Action;
+  std::memset(&Action, 0, sizeof(Action));
+  Action.sa_handler = Handler;
+  sigemptyset(&Action.sa_mask);
+  // Leave SA_RESTART unset, so that waitpid() notices shutdown requests.
+  ::sigaction(Signal, &Action, 0);
+}
+
+static pid_t StartWorker(int Listen, const char *Argv0, void *MainAddr,
+                         const WorkerOptions &Opts) {
+  pid_t Pid = ::fork();
+  if (Pid != 0)
+    return Pid;
+
+  setSignalHandler(SIGINT, SIG_DFL);
+  setSignalHandler(SIGTERM, SIG_DFL);
+  ::_exit(RunWorker(Listen, Argv0, MainAddr, Opts));
+}
+
+/// \brief Starts the command [\p ArgBegin, \p ArgEnd) with CLANG_CC1_SERVER
+/// set to \p SocketPath.
+static pid_t StartCommand(const char **ArgBegin, const char **ArgEnd,
+                          const char *SocketPath, int Listen) {
+  pid_t Pid = ::fork();
+  if (Pid != 0)
+    return Pid;
+
+  setSignalHandler(SIGINT, SIG_DFL);
+  setSignalHandler(SIGTERM, SIG_DFL);
+  ::signal(SIGPIPE, SIG_DFL);
+  ::close(Listen);
+  ::setenv("CLANG_CC1_SERVER", SocketPath, 1);
+
+  std::vector<char *> Argv;
+  for (const char **I = ArgBegin; I != ArgEnd; ++I)
+    Argv.push_back(const_cast<char *>(*I));
+  Argv.push_back(0);
+  ::execvp(Argv[0], &Argv[0]);
+  llvm::errs() << "error: unable to run '" << Argv[0]
+               << "': " << std::strerror(errno) << "\n";
+  ::_exit(127);
+}
+
+int cc1server_main(const char **ArgBegin, const char **ArgEnd,
+                   const char *Argv0, void *MainAddr) {
+  const char *SocketPath = 0;
+  unsigned NumWorkers = 0;
+  WorkerOptions Opts;
+  Opts.IdleTimeout = 0;
+  Opts.Verbose = false;
+  const char **CommandBegin = ArgEnd;
+  for (const char **I = ArgBegin; I != ArgEnd; ++I) {
+    StringRef Arg(*I);
+    if (Arg == "--") {
+      CommandBegin = I + 1;
+      if (CommandBegin == ArgEnd) {
+        llvm::errs() << "error: no command given after '--'\n";
+        return 1;
+      }
+      break;
+    }
+    if (Arg == "-v") {
+      Opts.Verbose = true;
+      continue;
+    }
+    if (Arg != "-socket" && Arg != "-workers" && Arg != "-idle-timeout") {
+      llvm::errs() << "error: unknown argument '" << Arg << "'\n";
+      return 1;
+    }
+    if (I + 1 == ArgEnd) {
+      llvm::errs() << "error: missing argument to '" << Arg << "'\n";
+      return 1;
+    }
+    ++I;
+    if (Arg == "-socket") {
+      SocketPath = *I;
+    } else if (Arg == "-workers") {
+      if (StringRef(*I).getAsInteger(10, NumWorkers)) {
+        llvm::errs() << "error: invalid number of workers '" << *I << "'\n";
+        return 1;
+      }
+    } else if (StringRef(*I).getAsInteger(10, Opts.IdleTimeout)) {
+      llvm::errs() << "error: invalid idle timeout '" << *I << "'\n";
+      return 1;
+    }
+  }
+  if (!SocketPath) {
+    llvm::errs() << "error: no socket given (use -socket <path>)\n";
+    return 1;
+  }
+  if (NumWorkers == 0)
+    NumWorkers = getHardwareConcurrency();
+
+  struct sockaddr_un Addr;
+  if (!setSocketAddress(Addr, SocketPath)) {
+    llvm::errs() << "error: socket path '" << SocketPath << "' is too long\n";
+    return 1;
+  }
+
+  // Don't steal the socket of a server that is still running.
+  int Existing = connectToServer(SocketPath);
+  if (Existing >= 0) {
+    ::close(Existing);
+    llvm::errs() << "error: a server is already listening on '" << SocketPath
+                 << "'\n";
+    return 1;
+  }
+  ::unlink(SocketPath);
+
+  int Listen = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  // Only the user running the server may submit jobs to it.
+  mode_t OldMask = ::umask(077);
+  bool Bound = Listen >= 0 &&
+               ::bind(Listen, reinterpret_cast<struct sockaddr *>(&Addr),
+                      sizeof(Addr)) == 0;
+  ::umask(OldMask);
+  if (!Bound || ::listen(Listen, SOMAXCONN) != 0 ||
+      ::fcntl(Listen, F_SETFL, ::fcntl(Listen, F_GETFL) | O_NONBLOCK) != 0) {
+    llvm::errs() << "error: unable to listen on '" << SocketPath
+                 << "': " << std::strerror(errno) << "\n";
+    return 1;
+  }
+
+  // Initialize targets once, before forking, so that every worker starts warm.
+  llvm::InitializeAllTargets();
+  llvm::InitializeAllTargetMCs();
+  llvm::InitializeAllAsmPrinters();
+  llvm::InitializeAllAsmParsers();
+
+  // Clients that go away must not take the server down with them.
+  ::signal(SIGPIPE, SIG_IGN);
+  setSignalHandler(SIGINT, HandleShutdownSignal);
+  setSignalHandler(SIGTERM, HandleShutdownSignal);
+
+  // The socket is already listening, so the command's jobs wait for the
+  // workers rather than running without them.
+  pid_t CommandPid = 0;
+  int CommandStatus = 0;
+  if (CommandBegin != ArgEnd) {
+    CommandPid = StartCommand(CommandBegin, ArgEnd, SocketPath, Listen);
+    if (CommandPid < 0) {
+      llvm::errs() << "error: unable to run '" << *CommandBegin
+                   << "': " << std::strerror(errno) << "\n";
+      ::close(Listen);
+      ::unlink(SocketPath);
+      return 1;
+    }
+  }
+
+  std::vector<pid_t> Workers;
+  for (unsigned I = 0; I != NumWorkers; ++I) {
+    pid_t Pid = StartWorker(Listen, Argv0, MainAddr, Opts);
+    if (Pid > 0)
+      Workers.push_back(Pid);
+  }
+
+  // Whether every worker that exited so far did so for lack of jobs.
+  bool AllIdle = true;
+
+  while ((!Workers.empty() || CommandPid) && !ShutdownRequested) {
+    int Status;
+    pid_t Pid = ::waitpid(-1, &Status, 0);
+    if (Pid < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+
+    // The server only runs for as long as its command does.
+    if (Pid == CommandPid) {
+      CommandPid = 0;
+      CommandStatus = WIFEXITED(Status) ? WEXITSTATUS(Status) : 1;
+      break;
+    }
+
+    std::vector<pid_t>::iterator I =
+        std::find(Workers.begin(), Workers.end(), Pid);
+    if (I == Workers.end())
+      continue;
+
+    // Workers exit after a crash or a fatal error in one of their jobs;
+    // replace them, unless they lost the listening socket or ran out of work.
+    bool Idle = WIFEXITED(Status) && WEXITSTATUS(Status) == WorkerIdle;
+    AllIdle &= Idle;
+    pid_t NewPid = -1;
+    if (!Idle &&
+        (!WIFEXITED(Status) || WEXITSTATUS(Status) != WorkerListenFailure))
+      NewPid = StartWorker(Listen, Argv0, MainAddr, Opts);
+    if (NewPid > 0)
+      *I = NewPid;
+    else
+      Workers.erase(I);
+  }
+
+  for (unsigned I = 0, E = Workers.size(); I != E; ++I)
+    ::kill(Workers[I], SIGTERM);
+  for (unsigned I = 0, E = Workers.size(); I != E; ++I)
+    ::waitpid(Workers[I], 0, 0);
+
+  ::close(Listen);
+  ::unlink(SocketPath);
+
+  if (CommandPid) {
+    // Shutting down interrupts the command, which is then reported as failed.
+    ::kill(CommandPid, SIGTERM);
+    ::waitpid(CommandPid, 0, 0);
+    return 1;
+  }
+  if (CommandBegin != ArgEnd)
+    return CommandStatus;
+  return ShutdownRequested || (Workers.empty() && AllIdle) ? 0 : 1;
+}
+
+//===----------------------------------------------------------------------===//
+// Client
+//===----------------------------------------------------------------------===//
+
+bool cc1server_run_job(const char *SocketPath, const char **ArgBegin,
+                       const char **ArgEnd, const char *Argv0, void *MainAddr,
+                       int &Res) {
+  SmallString<128> WorkingDir;
+  if (llvm::sys::fs::current_path(WorkingDir))
+    return false;
+
+  std::string Environment;
+  for (char **I = environ; *I; ++I) {
+    Environment += *I;
+    Environment += '\0';
+  }
+
+  std::string Request;
+  appendWord(Request, 3 + (ArgEnd - ArgBegin));
+  appendString(Request, WorkingDir);
+  appendString(Request, llvm::sys::fs::getMainExecutable(Argv0, MainAddr));
+  appendString(Request, Environment);
+  for (const char **I = ArgBegin; I != ArgEnd; ++I)
+    appendString(Request, *I);
+
+  int Sock = connectToServer(SocketPath);
+  if (Sock < 0)
+    return false;
+
+  // The job writes its output to temporary files, which are only copied to
+  // our own stdout and stderr once the job has finished. A worker that dies
+  // halfway through the job then leaves nothing behind, and running the job
+  // here doesn't repeat its diagnostics.
+  int FDs[NumPassedFDs] = { 0, -1, -1 };
+  for (unsigned I = 1; I != NumPassedFDs; ++I) {
+    SmallString<128> Path;
+    if (llvm::sys::fs::createTemporaryFile("cc1server", "out", FDs[I], Path)) {
+      for (unsigned J = 1; J != I; ++J)
+        ::close(FDs[J]);
+      ::close(Sock);
+      return false;
+    }
+    ::unlink(Path.c_str());
+  }
+
+  // If the server goes away, fall back to running the job here rather than
+  // dying of SIGPIPE.
+  void (*OldHandler)(int) = ::signal(SIGPIPE, SIG_IGN);
+  int32_t Reply[2];
+  bool Success =
+      sendRequest(Sock, Request, FDs) &&
+      readAll(Sock, reinterpret_cast<char *>(Reply), sizeof(Reply)) &&
+      Reply[0] == Reply_Finished;
+  ::close(Sock);
+
+  if (Success) {
+    // The job is done; a failure to copy its output is the job's failure to
+    // write it, not a reason to run it again.
+    if (!copyOutput(FDs[1], 1) || !copyOutput(FDs[2], 2))
+      Reply[1] = Reply[1] ? Reply[1] : 1;
+    Res = Reply[1];
+  }
+  ::signal(SIGPIPE, OldHandler);
+  for (unsigned I = 1; I != NumPassedFDs; ++I)
+    ::close(FDs[I]);
+  return Success;
+}
+
+#else
+
+int cc1server_main(const char **ArgBegin, const char **ArgEnd,
+                   const char *Argv0, void *MainAddr) {
+  llvm::errs() << "error: -cc1server is not supported on this platform\n";
+  return 1;
+}
+
+bool cc1server_run_job(const char *SocketPath, const char **ArgBegin,
+                       const char **ArgEnd, const char *Argv0, void *MainAddr,
+                       int &Res) {
+  return false;
+}
+
+#endif
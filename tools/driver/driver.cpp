@@ -30,6 +30,7 @@
 #include "llvm/Option/OptTable.h"
 #include "llvm/Option/Option.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/CrashRecoveryContext.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Host.h"
@@ -187,8 +188,51 @@ static void ApplyQAOverride(SmallVectorImpl<const char*> &Args,
 
 extern int cc1_main(const char **ArgBegin, const char **ArgEnd,
                     const char *Argv0, void *MainAddr);
+extern int cc1_main_in_process(const char **ArgBegin, const char **ArgEnd,
+                               const char *Argv0, void *MainAddr);
 extern int cc1as_main(const char **ArgBegin, const char **ArgEnd,
                       const char *Argv0, void *MainAddr);
+extern int cc1server_main(const char **ArgBegin, const char **ArgEnd,
+                          const char *Argv0, void *MainAddr);
+extern bool cc1server_run_job(const char *SocketPath, const char **ArgBegin,
+                              const char **ArgEnd, const char *Argv0,
+                              void *MainAddr, int &Res);
+
+namespace {
+struct CC1InProcessInfo {
+  const char **ArgBegin;
+  const char **ArgEnd;
+  const char *Argv0;
+  int Res;
+};
+}
+
+static void RunCC1InProcess(void *UserData) {
+  CC1InProcessInfo &Info = *static_cast<CC1InProcessInfo *>(UserData);
+  Info.Res = cc1_main_in_process(Info.ArgBegin, Info.ArgEnd, Info.Argv0,
+                                 (void*) (intptr_t) GetExecutablePath);
+}
+
+/// ExecuteCC1InProcess - Run a -cc1 job in the driver's process, saving the
+/// cost of spawning a new one, for -fintegrated-cc1.
+///
+/// Crashes are caught and reported like a signalled child process, so that the
+/// driver can still generate crash diagnostics (in a new process).
+///
+/// FIXME: A fatal LLVM error still exits the driver with cc1's exit code,
+/// without running the driver's cleanups.
+static int ExecuteCC1InProcess(const char **ArgBegin, const char **ArgEnd,
+                               const char *Argv0) {
+  CC1InProcessInfo Info = { ArgBegin, ArgEnd, Argv0, 1 };
+  llvm::CrashRecoveryContext::Enable();
+  llvm::CrashRecoveryContext CRC;
+  if (!CRC.RunSafely(RunCC1InProcess, &Info)) {
+    // The crashed job did not get to remove its fatal error handler.
+    llvm::remove_fatal_error_handler();
+    return -2;
+  }
+  return Info.Res;
+}
 
 static void ParseProgName(SmallVectorImpl<const char *> &ArgVector,
                           std::set<std::string> &SavedStrings,
@@ -301,12 +345,24 @@ int main(int argc_, const char **argv_) {
   if (argv.size() > 1 && StringRef(argv[1]).startswith("-cc1")) {
     StringRef Tool = argv[1] + 4;
 
-    if (Tool == "")
+    if (Tool == "") {
+      // Let a compile server run the job if one is available.
+      if (const char *Socket = ::getenv("CLANG_CC1_SERVER")) {
+        int Res;
+        if (cc1server_run_job(Socket, argv.data()+2, argv.data()+argv.size(),
+                              argv[0], (void*) (intptr_t) GetExecutablePath,
+                              Res))
+          return Res;
+      }
       return cc1_main(argv.data()+2, argv.data()+argv.size(), argv[0],
                       (void*) (intptr_t) GetExecutablePath);
+    }
     if (Tool == "as")
       return cc1as_main(argv.data()+2, argv.data()+argv.size(), argv[0],
                       (void*) (intptr_t) GetExecutablePath);
+    if (Tool == "server")
+      return cc1server_main(argv.data()+2, argv.data()+argv.size(), argv[0],
+                            (void*) (intptr_t) GetExecutablePath);
 
     // Reject unknown tools.
     llvm::errs() << "error: unknown integrated tool '" << Tool << "'\n";
@@ -360,6 +416,7 @@ int main(int argc_, const char **argv_) {
   ProcessWarningOptions(Diags, *DiagOpts, /*ReportDiags=*/false);
 
   Driver TheDriver(Path, llvm::sys::getDefaultTargetTriple(), "a.out", Diags);
+  TheDriver.CC1Main = ExecuteCC1InProcess;
 
   // Attempt to find the original path used to invoke the driver, to determine
   // the installed path. We do this manually, because we want to support that
@@ -10,7 +10,13 @@
 #include "clang/Basic/FileManager.h"
 #include "clang/Basic/FileSystemOptions.h"
 #include "clang/Basic/FileSystemStatCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
+#include <ctime>
 
 using namespace llvm;
 using namespace clang;
@@ -231,6 +237,270 @@ TEST_F(FileManagerTest, getFileReturnsSameFileEntryForAliasedVirtualFiles) {
   EXPECT_EQ(manager.getFile("abc/foo.cpp"), manager.getFile("abc/bar.cpp"));
 }
 
+// Writes \p Contents to the file open as \p FD and closes it. The file's
+// modification time is set a minute into the past, so that its contents are
+// not too recent for a SharedFileSystemCache to keep.
+static void writeOldFile(int FD, StringRef Contents) {
+  llvm::raw_fd_ostream OutStream(FD, true);
+  OutStream << Contents;
+  OutStream.flush();
+  llvm::sys::fs::setLastModificationAndAccessTime(
+      FD, llvm::sys::TimeValue::fromEpochTime(::time(0) - 60));
+}
+
+// FileManagers sharing a SharedFileSystemCache see the same files, and only
+// the first one to ask for them has to go to the file system.
+TEST(SharedFileSystemCacheTest, SharesStatsAndBuffersBetweenManagers) {
+  int FD;
+  SmallString<128> Path;
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("shared-cache", "h", FD,
+                                                  Path));
+  writeOldFile(FD, "int x;\n");
+
+  IntrusiveRefCntPtr<SharedFileSystemCache> Cache(new SharedFileSystemCache);
+  FileManager First((FileSystemOptions()));
+  FileManager Second((FileSystemOptions()));
+  First.setSharedCache(Cache.getPtr());
+  Second.setSharedCache(Cache.getPtr());
+
+  const FileEntry *FirstFile = First.getFile(Path);
+  ASSERT_TRUE(FirstFile != NULL);
+  const FileEntry *SecondFile = Second.getFile(Path);
+  ASSERT_TRUE(SecondFile != NULL);
+  EXPECT_EQ(FirstFile->getSize(), SecondFile->getSize());
+  EXPECT_EQ(FirstFile->getUniqueID(), SecondFile->getUniqueID());
+
+  OwningPtr<llvm::MemoryBuffer> FirstBuffer(First.getBufferForFile(FirstFile));
+  OwningPtr<llvm::MemoryBuffer> SecondBuffer(
+      Second.getBufferForFile(SecondFile));
+  OwningPtr<llvm::MemoryBuffer> ThirdBuffer(
+      Second.getBufferForFile(SecondFile));
+  ASSERT_TRUE(FirstBuffer && SecondBuffer && ThirdBuffer);
+  EXPECT_EQ("int x;\n", FirstBuffer->getBuffer());
+  EXPECT_EQ("int x;\n", SecondBuffer->getBuffer());
+  // The second request retains the contents; later ones share them.
+  EXPECT_EQ(SecondBuffer->getBufferStart(), ThirdBuffer->getBufferStart());
+
+  // Failed lookups are shared as well.
+  SmallString<128> Missing(Path);
+  Missing += ".missing";
+  EXPECT_EQ(NULL, First.getFile(Missing));
+  EXPECT_EQ(NULL, Second.getFile(Missing));
+
+  llvm::sys::fs::remove(Path.str());
+  // The cache assumes the file system does not change...
+  FileManager Third((FileSystemOptions()));
+  Third.setSharedCache(Cache.getPtr());
+  EXPECT_TRUE(Third.getFile(Path) != NULL);
+  // ...until it is cleared.
+  FirstBuffer.reset();
+  SecondBuffer.reset();
+  ThirdBuffer.reset();
+  Cache->clear();
+  FileManager Fourth((FileSystemOptions()));
+  Fourth.setSharedCache(Cache.getPtr());
+  EXPECT_EQ(NULL, Fourth.getFile(Path));
+}
+
+// Invalidating stats keeps the contents of files that did not change.
+TEST(SharedFileSystemCacheTest, InvalidateStatsKeepsBuffers) {
+  int FD;
+  SmallString<128> Path;
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("shared-cache", "h", FD,
+                                                  Path));
+  writeOldFile(FD, "int y;\n");
+
+  IntrusiveRefCntPtr<SharedFileSystemCache> Cache(new SharedFileSystemCache);
+  OwningPtr<llvm::MemoryBuffer> First, Second;
+  {
+    FileManager Manager((FileSystemOptions()));
+    Manager.setSharedCache(Cache.getPtr());
+    First.reset(Manager.getBufferForFile(Path.str()));
+    Second.reset(Manager.getBufferForFile(Path.str()));
+  }
+  ASSERT_TRUE(First && Second);
+  EXPECT_NE(0U, Cache->getNumBytesRetained());
+
+  Cache->invalidateStats();
+  FileManager Manager((FileSystemOptions()));
+  Manager.setSharedCache(Cache.getPtr());
+  OwningPtr<llvm::MemoryBuffer> Third(Manager.getBufferForFile(Path.str()));
+  ASSERT_TRUE(Third);
+  EXPECT_EQ("int y;\n", Third->getBuffer());
+  EXPECT_EQ(Second->getBufferStart(), Third->getBufferStart());
+
+  llvm::sys::fs::remove(Path.str());
+  Cache->invalidateStats();
+  EXPECT_EQ(NULL, Manager.getFile(Path));
+}
+
+// A file that is rewritten with the same size is not served from the
+// contents retained for its old version, whether it is replaced by a new
+// file with the same modification time or rewritten within the second its
+// contents were read.
+TEST(SharedFileSystemCacheTest, RewrittenFilesAreReadAgain) {
+  int FD;
+  SmallString<128> Path, NewPath;
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("shared-cache", "h", FD,
+                                                  Path));
+  writeOldFile(FD, "int a;\n");
+
+  IntrusiveRefCntPtr<SharedFileSystemCache> Cache(new SharedFileSystemCache);
+  {
+    FileManager Manager((FileSystemOptions()));
+    Manager.setSharedCache(Cache.getPtr());
+    OwningPtr<llvm::MemoryBuffer> First(Manager.getBufferForFile(Path.str()));
+    OwningPtr<llvm::MemoryBuffer> Second(
+        Manager.getBufferForFile(Path.str()));
+    ASSERT_TRUE(First && Second);
+  }
+  EXPECT_NE(0U, Cache->getNumBytesRetained());
+
+  // Replace the file with another one of the same size and age.
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("shared-cache", "h", FD,
+                                                  NewPath));
+  writeOldFile(FD, "int b;\n");
+  ASSERT_FALSE(llvm::sys::fs::rename(NewPath.str(), Path.str()));
+  Cache->invalidateStats();
+  {
+    FileManager Manager((FileSystemOptions()));
+    Manager.setSharedCache(Cache.getPtr());
+    OwningPtr<llvm::MemoryBuffer> Buffer(Manager.getBufferForFile(Path.str()));
+    ASSERT_TRUE(Buffer);
+    EXPECT_EQ("int b;\n", Buffer->getBuffer());
+  }
+
+  // Rewrite the file in place, twice, right after reading it.
+  for (unsigned I = 0; I != 2; ++I) {
+    std::string Contents = I ? "int d;\n" : "int c;\n";
+    {
+      std::string ErrorInfo;
+      llvm::raw_fd_ostream OutStream(Path.c_str(), ErrorInfo);
+      ASSERT_TRUE(ErrorInfo.empty());
+      OutStream << Contents;
+    }
+    Cache->invalidateStats();
+    FileManager Manager((FileSystemOptions()));
+    Manager.setSharedCache(Cache.getPtr());
+    OwningPtr<llvm::MemoryBuffer> First(Manager.getBufferForFile(Path.str()));
+    OwningPtr<llvm::MemoryBuffer> Second(
+        Manager.getBufferForFile(Path.str()));
+    ASSERT_TRUE(First && Second);
+    EXPECT_EQ(Contents, First->getBuffer());
+    EXPECT_EQ(Contents, Second->getBuffer());
+  }
+
+  llvm::sys::fs::remove(Path.str());
+}
+
+// Lookups that do not cache failures, like those of module files that may
+// be built later, neither remember nor reuse a missing file.
+TEST(SharedFileSystemCacheTest, DoesNotCacheFailuresWhenAskedNotTo) {
+  int FD;
+  SmallString<128> Path;
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("shared-cache", "pcm", FD,
+                                                  Path));
+  {
+    llvm::raw_fd_ostream OutStream(FD, true);
+  }
+  SmallString<128> Missing(Path);
+  Missing += ".later";
+
+  IntrusiveRefCntPtr<SharedFileSystemCache> Cache(new SharedFileSystemCache);
+  {
+    FileManager Manager((FileSystemOptions()));
+    Manager.setSharedCache(Cache.getPtr());
+    EXPECT_EQ(NULL, Manager.getFile(Missing, /*openFile=*/false,
+                                    /*CacheFailure=*/false));
+    // Other lookups still cache the failure, but it is not used by the
+    // lookup below.
+    EXPECT_EQ(NULL, Manager.getFile(Missing));
+  }
+
+  ASSERT_FALSE(llvm::sys::fs::rename(Path.str(), Missing.str()));
+  FileManager Manager((FileSystemOptions()));
+  Manager.setSharedCache(Cache.getPtr());
+  EXPECT_TRUE(Manager.getFile(Missing, /*openFile=*/false,
+                              /*CacheFailure=*/false) != NULL);
+  llvm::sys::fs::remove(Missing.str());
+}
+
+// Directories that are searched repeatedly are read once, after which files
+// that are not in them are pruned without a 'stat' call.
+TEST_F(FileManagerTest, mayContainFileUsesDirectoryListings) {
+  int FD;
+  SmallString<128> Path;
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("listing", "h", FD, Path));
+  {
+    llvm::raw_fd_ostream OutStream(FD, true);
+  }
+
+  const DirectoryEntry *Dir =
+      manager.getDirectory(llvm::sys::path::parent_path(Path.str()));
+  ASSERT_TRUE(Dir != NULL);
+  StringRef Name = llvm::sys::path::filename(Path.str());
+  std::string Missing = Name.str() + ".missing";
+  std::string MissingInSubdir = Missing + "/file.h";
+
+  // Before the directory is read, nothing is known to be missing.
+  EXPECT_TRUE(manager.mayContainFile(Dir, Missing));
+  for (unsigned I = 0; I != 4; ++I)
+    EXPECT_TRUE(manager.mayContainFile(Dir, Name));
+  EXPECT_FALSE(manager.mayContainFile(Dir, Missing));
+  EXPECT_FALSE(manager.mayContainFile(Dir, MissingInSubdir));
+  EXPECT_TRUE(manager.mayContainFile(Dir, "./" + Missing));
+
+  // Names that differ in case are only pruned if the file system tells them
+  // apart.
+  std::string Upper = Name.upper();
+  SmallString<128> UpperPath(Dir->getName());
+  llvm::sys::path::append(UpperPath, Upper);
+  EXPECT_EQ(llvm::sys::fs::exists(UpperPath.str()),
+            manager.mayContainFile(Dir, Upper));
+
+  // Virtual files are never pruned.
+  SmallString<128> VirtualPath(Dir->getName());
+  llvm::sys::path::append(VirtualPath, Missing);
+  manager.getVirtualFile(VirtualPath, 10, 0);
+  EXPECT_TRUE(manager.mayContainFile(Dir, Missing));
+
+  llvm::sys::fs::remove(Path.str());
+  FileManager Other((FileSystemOptions()));
+  Dir = Other.getDirectory(llvm::sys::path::parent_path(Path.str()));
+  ASSERT_TRUE(Dir != NULL);
+  for (unsigned I = 0; I != 4; ++I)
+    Other.mayContainFile(Dir, Missing);
+  EXPECT_FALSE(Other.mayContainFile(Dir, Name));
+  // Clearing the stat caches forgets the listings too.
+  Other.clearStatCaches();
+  EXPECT_TRUE(Other.mayContainFile(Dir, Name));
+}
+
+// Include guards are only current for files with the same contents as the
+// ones the guard was learned from, even if their size didn't change.
+TEST(SharedFileSystemCacheTest, RemembersIncludeGuards) {
+  IntrusiveRefCntPtr<SharedFileSystemCache> Cache(new SharedFileSystemCache);
+  llvm::sys::fs::UniqueID Header(1, 42), Other(1, 43);
+  StringRef Contents = "#ifndef HEADER_H\n#define HEADER_H\n#endif\n";
+  StringRef Rewritten = "#ifndef HEADER_X\n#define HEADER_X\n#endif\n";
+  Cache->setIncludeGuard(Header, Contents, "HEADER_H");
+
+  std::string Macro;
+  EXPECT_TRUE(Cache->getIncludeGuard(Header, Contents.size(), Macro));
+  EXPECT_EQ("HEADER_H", Macro);
+  EXPECT_TRUE(Cache->isIncludeGuardCurrent(Header, Contents));
+  EXPECT_FALSE(Cache->isIncludeGuardCurrent(Header, Rewritten));
+  EXPECT_FALSE(Cache->getIncludeGuard(Header, Contents.size() + 1, Macro));
+  EXPECT_FALSE(Cache->getIncludeGuard(Other, Contents.size(), Macro));
+  EXPECT_FALSE(Cache->isIncludeGuardCurrent(Other, Contents));
+
+  // Guards survive invalidated stats, but not a full clear.
+  Cache->invalidateStats();
+  EXPECT_TRUE(Cache->isIncludeGuardCurrent(Header, Contents));
+  Cache->clear();
+  EXPECT_FALSE(Cache->getIncludeGuard(Header, Contents.size(), Macro));
+}
+
 #endif  // !_WIN32
 
 } // anonymous namespace
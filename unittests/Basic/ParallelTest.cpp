@@ -0,0 +1,79 @@
+//===- unittests/Basic/ParallelTest.cpp - Parallel helper tests -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/Parallel.h"
+#include "llvm/Support/Mutex.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+using namespace clang;
+
+namespace {
+
+struct GraphRun {
+  unsigned FailingItem;
+  llvm::sys::Mutex Lock;
+  std::vector<unsigned> Order;
+};
+
+bool runItem(void *UserData, unsigned Index) {
+  GraphRun &Run = *static_cast<GraphRun *>(UserData);
+  llvm::sys::ScopedLock L(Run.Lock);
+  Run.Order.push_back(Index);
+  return Index != Run.FailingItem;
+}
+
+/// \brief Returns the position of \p Index in \p Order, or -1.
+int positionOf(const std::vector<unsigned> &Order, unsigned Index) {
+  for (unsigned I = 0, E = Order.size(); I != E; ++I)
+    if (Order[I] == Index)
+      return I;
+  return -1;
+}
+
+// 0 <- 1 <- 3, 0 <- 2 <- 3, and 4 <-> 5 form a cycle.
+std::vector<std::vector<unsigned> > makeGraph() {
+  std::vector<std::vector<unsigned> > Dependencies(6);
+  Dependencies[1].push_back(0);
+  Dependencies[2].push_back(0);
+  Dependencies[3].push_back(1);
+  Dependencies[3].push_back(2);
+  Dependencies[4].push_back(5);
+  Dependencies[5].push_back(4);
+  return Dependencies;
+}
+
+TEST(ParallelTest, runDependencyGraphRunsItemsAfterDependencies) {
+  std::vector<std::vector<unsigned> > Dependencies = makeGraph();
+  for (unsigned NumThreads = 1; NumThreads != 5; ++NumThreads) {
+    GraphRun Run;
+    Run.FailingItem = ~0U;
+    runDependencyGraph(Dependencies, NumThreads, runItem, &Run);
+
+    ASSERT_EQ(4U, Run.Order.size());
+    EXPECT_EQ(0U, Run.Order[0]);
+    EXPECT_LT(positionOf(Run.Order, 1), positionOf(Run.Order, 3));
+    EXPECT_LT(positionOf(Run.Order, 2), positionOf(Run.Order, 3));
+    EXPECT_EQ(-1, positionOf(Run.Order, 4));
+    EXPECT_EQ(-1, positionOf(Run.Order, 5));
+  }
+}
+
+TEST(ParallelTest, runDependencyGraphSkipsDependentsOfFailures) {
+  std::vector<std::vector<unsigned> > Dependencies = makeGraph();
+  GraphRun Run;
+  Run.FailingItem = 1;
+  runDependencyGraph(Dependencies, 4, runItem, &Run);
+
+  ASSERT_EQ(3U, Run.Order.size());
+  EXPECT_NE(-1, positionOf(Run.Order, 2));
+  EXPECT_EQ(-1, positionOf(Run.Order, 3));
+}
+
+} // anonymous namespace
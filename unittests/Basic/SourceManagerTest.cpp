@@ -164,6 +164,88 @@ TEST_F(SourceManagerTest, getColumnNumber) {
   EXPECT_EQ(1U, SourceMgr.getColumnNumber(MainFileID, 0, NULL));
 }
 
+TEST_F(SourceManagerTest, getFileIDWithManyExpansions) {
+  std::string Source(4096, 'x');
+  MemoryBuffer *Buf = MemoryBuffer::getMemBufferCopy(Source);
+  FileID MainFileID = SourceMgr.createMainFileIDForMemBuffer(Buf);
+  SourceLocation Start = SourceMgr.getLocForStartOfFile(MainFileID);
+
+  // Create expansions of many lengths, so that the lookups cover short and
+  // long runs of entries between two indexed offsets.
+  std::vector<SourceLocation> Expansions;
+  std::vector<unsigned> Lengths;
+  for (unsigned I = 0; I != 2000; ++I) {
+    SourceLocation Spelling = Start.getLocWithOffset(I);
+    unsigned Length = 1 + (I * 7) % 600;
+    Expansions.push_back(SourceMgr.createExpansionLoc(Spelling, Spelling,
+                                                      Spelling, Length));
+    Lengths.push_back(Length);
+  }
+
+  // Look the locations up out of order, to defeat the caches.
+  for (unsigned Step = 0; Step != 3; ++Step) {
+    for (unsigned I = Step; I < Expansions.size(); I += 3) {
+      FileID FID = SourceMgr.getFileID(Expansions[I]);
+      EXPECT_EQ(SourceMgr.getFileID(Expansions[I].getLocWithOffset(
+                    Lengths[I] - 1)), FID);
+      EXPECT_EQ(SourceMgr.getFileID(Expansions[I].getLocWithOffset(
+                    Lengths[I] / 2)), FID);
+      EXPECT_EQ(SourceMgr.getExpansionLoc(Expansions[I]),
+                Start.getLocWithOffset(I));
+      if (I != 0)
+        EXPECT_NE(SourceMgr.getFileID(Expansions[I - 1]), FID);
+      EXPECT_EQ(SourceMgr.getFileID(Start.getLocWithOffset(I)), MainFileID);
+    }
+  }
+}
+
+TEST_F(SourceManagerTest, getFileIDInLoadedEntries) {
+  MemoryBuffer *MainBuf = MemoryBuffer::getMemBuffer("int x;");
+  FileID MainFileID = SourceMgr.createMainFileIDForMemBuffer(MainBuf);
+
+  // Load files of several sizes, the way the AST reader does: the entries of
+  // one AST file are allocated at once, with increasing IDs and offsets.
+  const unsigned NumFiles = 5;
+  unsigned Sizes[NumFiles] = { 10, 1, 300, 7, 42 };
+  unsigned TotalSize = 0;
+  for (unsigned I = 0; I != NumFiles; ++I)
+    TotalSize += Sizes[I] + 1;
+  std::pair<int, unsigned> Base =
+      SourceMgr.AllocateLoadedSLocEntries(NumFiles, TotalSize);
+
+  std::vector<FileID> FileIDs;
+  unsigned Offset = Base.second;
+  for (unsigned I = 0; I != NumFiles; ++I) {
+    MemoryBuffer *Buf =
+        MemoryBuffer::getMemBufferCopy(std::string(Sizes[I], 'x'));
+    FileIDs.push_back(SourceMgr.createFileIDForMemBuffer(
+        Buf, SrcMgr::C_User, Base.first + I, Offset));
+    Offset += Sizes[I] + 1;
+  }
+  // The last of them is the last loaded entry in the address space.
+  EXPECT_EQ(-2, Base.first + int(NumFiles) - 1);
+
+  // Look up the first, middle and last location of every file, from both
+  // ends of the table and more than once, so that the lookups go through
+  // the recent lookups as well.
+  for (unsigned Step = 0; Step != 3; ++Step) {
+    for (unsigned J = 0; J != NumFiles; ++J) {
+      unsigned I = Step == 1 ? NumFiles - 1 - J : J;
+      SourceLocation Start = SourceMgr.getLocForStartOfFile(FileIDs[I]);
+      EXPECT_EQ(FileIDs[I], SourceMgr.getFileID(Start));
+      EXPECT_EQ(FileIDs[I],
+                SourceMgr.getFileID(Start.getLocWithOffset(Sizes[I] / 2)));
+      EXPECT_EQ(FileIDs[I],
+                SourceMgr.getFileID(Start.getLocWithOffset(Sizes[I])));
+      if (I + 1 != NumFiles)
+        EXPECT_EQ(FileIDs[I + 1],
+                  SourceMgr.getFileID(Start.getLocWithOffset(Sizes[I] + 1)));
+      EXPECT_EQ(MainFileID, SourceMgr.getFileID(
+                                SourceMgr.getLocForStartOfFile(MainFileID)));
+    }
+  }
+}
+
 #if defined(LLVM_ON_UNIX)
 
 TEST_F(SourceManagerTest, getMacroArgExpandedLocation) {
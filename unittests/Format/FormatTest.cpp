@@ -6409,5 +6409,28 @@ TEST_F(FormatTest, FormatsBlocks) {
                "onOperationDone]; }] };");
 }
 
+TEST_F(FormatTest, FormatsLongLinesInParallel) {
+  std::string Code;
+  for (unsigned i = 0; i != 20; ++i) {
+    Code += "int aaaaaaaaaaaaaaaaaaaa = functionCall("
+            "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbb, cccccccccccccccccccccccc + "
+            "dddddddddddddddddd);\n";
+    Code += "void f() {\n"
+            "  other(x.begin(), x.end(), [&](int, int) { return "
+            "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa(bbbbbbbbbbbbbbbbbbbbbbbbb); "
+            "});\n"
+            "}\n";
+  }
+  std::vector<tooling::Range> Ranges(1, tooling::Range(0, Code.size()));
+  FormatStyle Style = getLLVMStyle();
+  std::string Serial =
+      applyAllReplacements(Code, reformat(Style, Code, Ranges));
+  std::string Parallel = applyAllReplacements(
+      Code, reformat(Style, Code, Ranges, "<stdin>", /*NumThreads=*/4));
+  EXPECT_EQ(Serial, Parallel);
+  EXPECT_EQ(Serial, format(Code));
+  EXPECT_NE(Code, Serial);
+}
+
 } // end namespace tooling
 } // end namespace clang
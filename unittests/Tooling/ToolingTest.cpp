@@ -234,5 +234,41 @@ TEST(ClangToolTest, ArgumentAdjusters) {
   EXPECT_FALSE(Found);
 }
 
+#if !defined(_WIN32)
+struct CountingActionFactory : public FrontendActionFactory {
+  CountingActionFactory() : Created(0) {}
+  virtual clang::FrontendAction *create() {
+    ++Created;
+    return new SyntaxOnlyAction;
+  }
+  unsigned Created;
+};
+
+TEST(ClangToolTest, RunsInParallel) {
+  FixedCompilationDatabase Compilations("/", std::vector<std::string>());
+  std::vector<std::string> Sources;
+  Sources.push_back("/a.cc");
+  Sources.push_back("/b.cc");
+  Sources.push_back("/c.cc");
+  Sources.push_back("/d.cc");
+  ClangTool Tool(Compilations, Sources);
+  Tool.setNumThreads(4);
+
+  Tool.mapVirtualFile("/a.cc", "#include \"x.h\"\nvoid a() { x(); }");
+  Tool.mapVirtualFile("/b.cc", "#include \"x.h\"\nvoid b() { x(); }");
+  Tool.mapVirtualFile("/c.cc", "void c() {}");
+  Tool.mapVirtualFile("/d.cc", "void d() {}");
+  Tool.mapVirtualFile("/x.h", "void x();");
+
+  CountingActionFactory Factory;
+  EXPECT_EQ(0, Tool.run(&Factory));
+  EXPECT_EQ(4u, Factory.Created);
+
+  Tool.mapVirtualFile("/d.cc", "void d() { an_error_here }");
+  EXPECT_EQ(1, Tool.run(&Factory));
+  EXPECT_EQ(8u, Factory.Created);
+}
+#endif
+
 } // end namespace tooling
 } // end namespace clang
@@ -0,0 +1,98 @@
+#!/usr/bin/env python
+
+"""
+Measures how fast clang lexes and preprocesses a set of headers.
+
+Each header is preprocessed with 'clang -cc1 -Eonly' several times, and the
+best time is reported together with the resulting throughput. Only the size
+of the given headers counts towards the throughput, not that of the headers
+they include. If no headers are given, a large synthetic header with long
+identifiers, indentation, line comments and string literals is generated and
+measured instead.
+
+Example:
+
+  lexer-throughput.py --clang=bin/clang -I /usr/include \\
+      /usr/include/stdio.h /usr/include/stdlib.h
+"""
+
+import optparse
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+def generate_header(path, lines):
+    f = open(path, 'w')
+    f.write('#ifndef LEXER_THROUGHPUT_H\n#define LEXER_THROUGHPUT_H\n')
+    for i in range(lines):
+        f.write('// Line comment number %d, which is about as long as the '
+                'comments found in system headers.\n' % i)
+        f.write('static const char *const a_rather_long_identifier_%d = '
+                '"a string literal with \\"escapes\\" and some text %d";\n'
+                % (i, i))
+        f.write('struct structure_with_a_long_name_%d {\n'
+                '                int   first_member_of_the_structure;\n'
+                '\t\tunsigned long second_member_of_the_structure;\n'
+                '};\n' % i)
+    f.write('#endif\n')
+    f.close()
+
+def time_header(clang, args, path, runs):
+    cmd = [clang, '-cc1', '-Eonly'] + args + [path]
+    best = None
+    for i in range(runs):
+        start = time.time()
+        if subprocess.call(cmd) != 0:
+            sys.exit('error: %s failed' % ' '.join(cmd))
+        elapsed = time.time() - start
+        if best is None or elapsed < best:
+            best = elapsed
+    return best
+
+def main():
+    parser = optparse.OptionParser(usage='%prog [options] [headers...]')
+    parser.add_option('--clang', default='clang',
+                      help='the clang binary to measure')
+    parser.add_option('-I', dest='includes', action='append', default=[],
+                      help='add a directory to the include path')
+    parser.add_option('-x', dest='language', default='c++-header',
+                      help='the language to lex the headers as')
+    parser.add_option('--runs', type='int', default=5,
+                      help='the number of runs per header')
+    parser.add_option('--lines', type='int', default=200000,
+                      help='the size of the synthetic header, in declarations')
+    opts, headers = parser.parse_args()
+
+    args = ['-x', opts.language]
+    for include in opts.includes:
+        args += ['-I', include]
+
+    synthetic = None
+    if not headers:
+        fd, synthetic = tempfile.mkstemp(suffix='.h')
+        os.close(fd)
+        generate_header(synthetic, opts.lines)
+        headers = [synthetic]
+
+    try:
+        total_bytes = 0
+        total_time = 0.0
+        for header in headers:
+            size = os.path.getsize(header)
+            elapsed = time_header(opts.clang, args, header, opts.runs)
+            total_bytes += size
+            total_time += elapsed
+            print('%-50s %10d bytes %8.3fs %8.1f MB/s' %
+                  (header, size, elapsed, size / elapsed / 1e6))
+        if len(headers) > 1:
+            print('%-50s %10d bytes %8.3fs %8.1f MB/s' %
+                  ('total', total_bytes, total_time,
+                   total_bytes / total_time / 1e6))
+    finally:
+        if synthetic:
+            os.remove(synthetic)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,107 @@
+#!/usr/bin/env python
+
+"""
+Measures how much memory clang spends on source location entries.
+
+Each file is preprocessed with 'clang -cc1 -Eonly -print-stats' several times.
+The number of local SLocEntries, the memory they take, and the number of
+FileID lookups are taken from the statistics, and the best time is reported.
+If no files are given, a synthetic translation unit that expands many nested
+function-like macros is generated and measured instead. With --baseline,
+the same files are measured with a second clang binary for comparison.
+
+Example:
+
+  sloc-usage.py --clang=bin/clang --baseline=old/bin/clang
+"""
+
+import optparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+def generate_source(path, lines):
+    f = open(path, 'w')
+    f.write('#define ID(x) x\n'
+            '#define ADD(a, b) ((a) + (b))\n'
+            '#define MAX(a, b) ((a) > (b) ? (a) : (b))\n'
+            '#define CLAMP(x, lo, hi) MAX(lo, ADD(ID(x), -MAX(x, hi) + hi))\n'
+            '#define CAT(a, b) a ## b\n'
+            '#define FIELD(n) int CAT(field_, n);\n')
+    for i in range(lines):
+        f.write('int value_%d = CLAMP(%d, ID(0), ADD(%d, 1));\n' % (i, i, i))
+        f.write('struct s_%d { FIELD(a) FIELD(b) };\n' % i)
+    f.close()
+
+def measure(clang, args, path, runs):
+    cmd = [clang, '-cc1', '-Eonly', '-print-stats'] + args + [path]
+    best = None
+    stats = None
+    for i in range(runs):
+        start = time.time()
+        p = subprocess.Popen(cmd, stderr=subprocess.PIPE)
+        _, err = p.communicate()
+        if p.returncode != 0:
+            sys.exit('error: %s failed' % ' '.join(cmd))
+        elapsed = time.time() - start
+        if best is None or elapsed < best:
+            best = elapsed
+        stats = err.decode('utf-8', 'replace')
+
+    m = re.search(r"(\d+) local SLocEntry's allocated \((\d+) bytes", stats)
+    if not m:
+        sys.exit('error: no SourceManager statistics from %s' % clang)
+    entries, size = int(m.group(1)), int(m.group(2))
+    m = re.search(r'FileID scans: (\d+) linear, (\d+) binary', stats)
+    scans = int(m.group(1)) + int(m.group(2)) if m else 0
+    return entries, size, scans, best
+
+def report(name, result):
+    entries, size, scans, elapsed = result
+    print('%-40s %10d entries %10.1f MB %12d scans %8.3fs' %
+          (name, entries, size / 1e6, scans, elapsed))
+
+def main():
+    parser = optparse.OptionParser(usage='%prog [options] [files...]')
+    parser.add_option('--clang', default='clang',
+                      help='the clang binary to measure')
+    parser.add_option('--baseline', default=None,
+                      help='a clang binary to compare against')
+    parser.add_option('-I', dest='includes', action='append', default=[],
+                      help='add a directory to the include path')
+    parser.add_option('--runs', type='int', default=3,
+                      help='the number of runs per file')
+    parser.add_option('--lines', type='int', default=100000,
+                      help='the size of the synthetic file, in declarations')
+    opts, files = parser.parse_args()
+
+    args = []
+    for include in opts.includes:
+        args += ['-I', include]
+
+    synthetic = None
+    if not files:
+        fd, synthetic = tempfile.mkstemp(suffix='.c')
+        os.close(fd)
+        generate_source(synthetic, opts.lines)
+        files = [synthetic]
+
+    try:
+        for path in files:
+            result = measure(opts.clang, args, path, opts.runs)
+            report(path, result)
+            if opts.baseline:
+                base = measure(opts.baseline, args, path, opts.runs)
+                report('  baseline', base)
+                if base[1]:
+                    print('  %.1f%% of the baseline SLocEntry memory' %
+                          (100.0 * result[1] / base[1]))
+    finally:
+        if synthetic:
+            os.remove(synthetic)
+
+if __name__ == '__main__':
+    main()